@@ -0,0 +1,499 @@
+#include "AsyncRuntime.h"
+#include "Constants.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+
+/**
+ * @brief Cancela o token e todas as suas cópias, executando os callbacks registrados.
+ */
+void CancellationToken::cancel() {
+    std::unordered_map<std::uint64_t, std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> state_lock(state->mutex);
+        if (state->cancelled.exchange(true)) {
+            return;
+        }
+        callbacks.swap(state->callbacks);
+    }
+
+    // Fora do mutex do token: os callbacks bloqueiam o mutex das esperas do EventLoop
+    for (auto& [callback_id, callback] : callbacks) {
+        callback();
+    }
+}
+
+
+/**
+ * @brief Registra uma função a ser executada quando o token for cancelado.
+ */
+std::uint64_t CancellationToken::registerCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> state_lock(state->mutex);
+    if (state->cancelled.load()) {
+        return 0;
+    }
+    std::uint64_t callback_id = state->next_callback_id++;
+    state->callbacks.emplace(callback_id, std::move(callback));
+    return callback_id;
+}
+
+
+/**
+ * @brief Remove um callback registrado.
+ */
+void CancellationToken::unregisterCallback(std::uint64_t callback_id) const {
+    std::lock_guard<std::mutex> state_lock(state->mutex);
+    state->callbacks.erase(callback_id);
+}
+
+
+/**
+ * @brief Construtor da classe EventLoop. Cria o epoll e o eventfd do reator.
+ */
+EventLoop::EventLoop(Executor& executor) : stopping(false), next_waiter_id(1), executor(executor) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // O eventfd fica registrado permanentemente, apenas para acordar o reator
+    struct epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+}
+
+
+/**
+ * @brief Destrutor da classe EventLoop. Fecha os descritores.
+ */
+EventLoop::~EventLoop() {
+    close(wake_fd);
+    close(epoll_fd);
+}
+
+
+/**
+ * @brief Executa o loop na thread atual até que stop seja chamado.
+ */
+void EventLoop::run() {
+    executor.start();
+
+    runReactor();
+
+    // Encerra o Executor depois que as corrotinas retomadas no encerramento terminarem
+    executor.stop();
+}
+
+
+/**
+ * @brief Encerra o loop.
+ */
+void EventLoop::stop() {
+    stopping.store(true);
+    cancelAllWaiters();
+    wakeReactor();
+}
+
+
+/**
+ * @brief Envia uma corrotina para ser retomada pelo Executor.
+ */
+void EventLoop::post(std::coroutine_handle<> handle, TaskPriority priority) {
+    executor.submit([handle] { handle.resume(); }, priority);
+}
+
+
+/**
+ * @brief Inicia uma Task de forma independente no Executor.
+ */
+void EventLoop::spawn(Task<void> task, TaskPriority priority) {
+    runDetached(std::move(task), priority);
+}
+
+
+/**
+ * @brief Inicia uma Task na thread atual, sem passar pela fila do Executor.
+ */
+void EventLoop::spawnInline(Task<void> task) {
+    runInline(std::move(task));
+}
+
+
+/**
+ * @brief Transfere a execução de uma Task para o Executor e a executa até o fim.
+ */
+EventLoop::DetachedTask EventLoop::runDetached(Task<void> task, TaskPriority priority) {
+    co_await schedule(priority);
+    co_await task;
+}
+
+
+/**
+ * @brief Executa uma Task na thread atual até a primeira espera e a mantém até o fim.
+ */
+EventLoop::DetachedTask EventLoop::runInline(Task<void> task) {
+    co_await task;
+}
+
+
+/**
+ * @brief Retorna um awaitable que espera o descritor ficar pronto para leitura.
+ */
+EventLoop::IoAwaiter EventLoop::readable(int fd, std::optional<CancellationToken> token) {
+    return IoAwaiter{*this, fd, EPOLLIN, std::move(token)};
+}
+
+
+/**
+ * @brief Retorna um awaitable que espera o descritor ficar pronto para escrita.
+ */
+EventLoop::IoAwaiter EventLoop::writable(int fd, std::optional<CancellationToken> token) {
+    return IoAwaiter{*this, fd, EPOLLOUT, std::move(token)};
+}
+
+
+/**
+ * @brief Retorna um awaitable que espera o intervalo de tempo informado.
+ */
+EventLoop::TimerAwaiter EventLoop::sleep(std::chrono::steady_clock::duration duration, std::optional<CancellationToken> token) {
+    return TimerAwaiter{*this, std::chrono::steady_clock::now() + duration, std::move(token)};
+}
+
+
+/**
+ * @brief Registra no token da espera o callback que a cancela.
+ */
+bool EventLoop::registerCancellation(Waiter& waiter, std::function<void()> callback) {
+    if (!waiter.token) {
+        return true;
+    }
+    waiter.callback_id = waiter.token->registerCallback(std::move(callback));
+    return waiter.callback_id != 0;
+}
+
+
+/**
+ * @brief Remove do token o callback de uma espera que terminou.
+ */
+void EventLoop::releaseWaiter(const Waiter& waiter) {
+    if (waiter.token && waiter.callback_id != 0) {
+        waiter.token->unregisterCallback(waiter.callback_id);
+    }
+}
+
+
+/**
+ * @brief Cancela a espera de um descritor, se ela ainda for a espera indicada.
+ */
+void EventLoop::cancelIoWaiter(int fd, std::uint64_t waiter_id) {
+    {
+        std::lock_guard<std::mutex> waiters_lock(waiters_mutex);
+
+        // A espera pode já ter terminado, e o descritor pode ter sido reutilizado por outra
+        auto it = io_waiters.find(fd);
+        if (it == io_waiters.end() || it->second.id != waiter_id) {
+            return;
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        *it->second.cancelled = true;
+        post(it->second.handle);
+        io_waiters.erase(it);
+    }
+    wakeReactor();
+}
+
+
+/**
+ * @brief Cancela a espera de um timer, se ela ainda estiver registrada.
+ */
+void EventLoop::cancelTimer(std::chrono::steady_clock::time_point deadline, std::uint64_t waiter_id) {
+    {
+        std::lock_guard<std::mutex> waiters_lock(waiters_mutex);
+
+        auto [first, last] = timers.equal_range(deadline);
+        auto it = std::find_if(first, last, [waiter_id](const auto& timer) { return timer.second.id == waiter_id; });
+        if (it == last) {
+            return;
+        }
+        *it->second.cancelled = true;
+        post(it->second.handle);
+        timers.erase(it);
+    }
+    // O primeiro timer pode ter mudado
+    wakeReactor();
+}
+
+
+/**
+ * @brief Verifica se a espera pode ser evitada (loop encerrando ou token já cancelado).
+ */
+bool EventLoop::IoAwaiter::await_ready() noexcept {
+    cancelled = loop.isStopping() || (token && token->isCancelled());
+    return cancelled;
+}
+
+
+/**
+ * @brief Registra a corrotina para ser retomada quando o descritor ficar pronto.
+ */
+void EventLoop::IoAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> waiters_lock(loop.waiters_mutex);
+
+    // O loop pode ter sido encerrado entre await_ready e o registro
+    if (loop.isStopping()) {
+        cancelled = true;
+        loop.post(handle);
+        return;
+    }
+
+    // O callback do token cancela apenas esta espera, identificada pelo id
+    std::uint64_t waiter_id = loop.next_waiter_id++;
+    Waiter waiter{handle, token, &cancelled, waiter_id, 0};
+    EventLoop& event_loop = loop;
+    int waiter_fd = fd;
+    if (!loop.registerCancellation(waiter, [&event_loop, waiter_fd, waiter_id] { event_loop.cancelIoWaiter(waiter_fd, waiter_id); })) {
+        // Token cancelado entre await_ready e o registro
+        cancelled = true;
+        loop.post(handle);
+        return;
+    }
+    loop.io_waiters[fd] = waiter;
+
+    // EPOLLONESHOT: o reator remove o descritor assim que o evento chega
+    struct epoll_event event{};
+    event.events = events | EPOLLONESHOT;
+    event.data.fd = fd;
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0 &&
+        (errno != EEXIST || epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0)) {
+        // Descritor inválido para o epoll: retoma a corrotina para que a operação reporte o erro
+        loop.releaseWaiter(waiter);
+        loop.io_waiters.erase(fd);
+        loop.post(handle);
+    }
+}
+
+
+/**
+ * @brief Verifica se a espera pode ser evitada (tempo já vencido, loop encerrando ou token cancelado).
+ */
+bool EventLoop::TimerAwaiter::await_ready() noexcept {
+    cancelled = loop.isStopping() || (token && token->isCancelled());
+    return cancelled || deadline <= std::chrono::steady_clock::now();
+}
+
+
+/**
+ * @brief Registra a corrotina para ser retomada no vencimento do timer.
+ */
+void EventLoop::TimerAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    // Após o registro a corrotina pode ser retomada (e este awaiter destruído) a qualquer momento
+    EventLoop& event_loop = loop;
+    bool is_earliest;
+    {
+        std::lock_guard<std::mutex> waiters_lock(event_loop.waiters_mutex);
+
+        // O loop pode ter sido encerrado entre await_ready e o registro
+        if (event_loop.isStopping()) {
+            cancelled = true;
+            event_loop.post(handle);
+            return;
+        }
+
+        // O callback do token cancela apenas este timer, identificado pelo vencimento e pelo id
+        std::uint64_t waiter_id = event_loop.next_waiter_id++;
+        Waiter waiter{handle, token, &cancelled, waiter_id, 0};
+        auto timer_deadline = deadline;
+        if (!event_loop.registerCancellation(waiter, [&event_loop, timer_deadline, waiter_id] { event_loop.cancelTimer(timer_deadline, waiter_id); })) {
+            // Token cancelado entre await_ready e o registro
+            cancelled = true;
+            event_loop.post(handle);
+            return;
+        }
+
+        auto it = event_loop.timers.emplace(deadline, waiter);
+        is_earliest = it == event_loop.timers.begin();
+    }
+
+    // Um novo primeiro timer muda o tempo de espera do reator
+    if (is_earliest) {
+        event_loop.wakeReactor();
+    }
+}
+
+
+/**
+ * @brief Acorda a thread reator, que recalcula o próximo timer.
+ */
+void EventLoop::wakeReactor() {
+    uint64_t value = 1;
+    ssize_t bytes_written = write(wake_fd, &value, sizeof(value));
+    (void)bytes_written;
+}
+
+
+/**
+ * @brief Retoma todas as esperas indicando o cancelamento (loop encerrando).
+ */
+void EventLoop::cancelAllWaiters() {
+    std::lock_guard<std::mutex> waiters_lock(waiters_mutex);
+
+    for (auto& [fd, waiter] : io_waiters) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        releaseWaiter(waiter);
+        *waiter.cancelled = true;
+        post(waiter.handle);
+    }
+    io_waiters.clear();
+
+    for (auto& [deadline, waiter] : timers) {
+        releaseWaiter(waiter);
+        *waiter.cancelled = true;
+        post(waiter.handle);
+    }
+    timers.clear();
+}
+
+
+/**
+ * @brief Loop da thread reator: espera eventos e timers e enfileira as corrotinas prontas.
+ */
+void EventLoop::runReactor() {
+    struct epoll_event events[Constants::ASYNC_MAX_EVENTS_PER_WAIT];
+
+    while (!stopping.load()) {
+        // Espera até o próximo timer, ou sem limite se não houver timers. Novos timers, cancelamentos
+        // e o encerramento acordam o reator pelo wake_fd
+        int timeout_ms = -1;
+        {
+            std::lock_guard<std::mutex> waiters_lock(waiters_mutex);
+            if (!timers.empty()) {
+                auto until_next_timer = std::chrono::duration_cast<std::chrono::milliseconds>(timers.begin()->first - std::chrono::steady_clock::now());
+                timeout_ms = static_cast<int>(std::max<std::int64_t>(0, until_next_timer.count() + 1));
+            }
+        }
+
+        int ready_events = epoll_wait(epoll_fd, events, Constants::ASYNC_MAX_EVENTS_PER_WAIT, timeout_ms);
+
+        {
+            std::lock_guard<std::mutex> waiters_lock(waiters_mutex);
+
+            // Retoma as corrotinas cujos descritores ficaram prontos
+            for (int i = 0; i < ready_events; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == wake_fd) {
+                    uint64_t value;
+                    ssize_t bytes_read = read(wake_fd, &value, sizeof(value));
+                    (void)bytes_read;
+                    continue;
+                }
+
+                auto it = io_waiters.find(fd);
+                if (it != io_waiters.end()) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+                    releaseWaiter(it->second);
+                    post(it->second.handle);
+                    io_waiters.erase(it);
+                }
+            }
+
+            // Retoma as corrotinas cujos timers venceram
+            auto now = std::chrono::steady_clock::now();
+            while (!timers.empty() && timers.begin()->first <= now) {
+                releaseWaiter(timers.begin()->second);
+                post(timers.begin()->second.handle);
+                timers.erase(timers.begin());
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Recebe dados de um socket não bloqueante, esperando que haja dados disponíveis.
+ */
+Task<ssize_t> EventLoop::recv(int fd, void* buffer, size_t length, std::optional<CancellationToken> token) {
+    while (true) {
+        ssize_t bytes_received = ::recv(fd, buffer, length, 0);
+        if (bytes_received >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            co_return bytes_received;
+        }
+        if (errno != EINTR && !co_await readable(fd, token)) {
+            errno = ECANCELED;
+            co_return -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Envia dados por um socket não bloqueante, esperando que haja espaço no buffer do kernel.
+ */
+Task<ssize_t> EventLoop::send(int fd, const void* buffer, size_t length, std::optional<CancellationToken> token) {
+    while (true) {
+        ssize_t bytes_sent = ::send(fd, buffer, length, MSG_NOSIGNAL);
+        if (bytes_sent >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            co_return bytes_sent;
+        }
+        if (errno != EINTR && !co_await writable(fd, token)) {
+            errno = ECANCELED;
+            co_return -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Aceita uma conexão em um socket de escuta não bloqueante.
+ */
+Task<int> EventLoop::accept(int fd, std::optional<CancellationToken> token) {
+    while (true) {
+        int client_fd = ::accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)) {
+            co_return client_fd;
+        }
+        if (errno != EINTR && errno != ECONNABORTED && !co_await readable(fd, token)) {
+            errno = ECANCELED;
+            co_return -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Conecta um socket não bloqueante ao endereço informado.
+ */
+Task<int> EventLoop::connect(int fd, const struct sockaddr* address, socklen_t address_length, std::optional<CancellationToken> token) {
+    if (::connect(fd, address, address_length) == 0) {
+        co_return 0;
+    }
+    if (errno != EINPROGRESS) {
+        co_return -1;
+    }
+
+    // A conexão é concluída quando o socket fica pronto para escrita
+    if (!co_await writable(fd, token)) {
+        errno = ECANCELED;
+        co_return -1;
+    }
+
+    int error = 0;
+    socklen_t error_length = sizeof(error);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length);
+    if (error != 0) {
+        errno = error;
+        co_return -1;
+    }
+    co_return 0;
+}
+
+
+/**
+ * @brief Coloca um descritor em modo não bloqueante.
+ */
+bool EventLoop::setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
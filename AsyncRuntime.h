@@ -0,0 +1,493 @@
+#ifndef ASYNCRUNTIME_H
+#define ASYNCRUNTIME_H
+
+#include "Executor.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <utility>
+
+
+/**
+ * @brief Token de cancelamento cooperativo compartilhado entre corrotinas.
+ *
+ * Cópias do token compartilham o mesmo estado. Quando cancelado, todas as esperas (timers e
+ * sockets) associadas a ele são encerradas pelo EventLoop, que retoma as corrotinas
+ * indicando o cancelamento. O EventLoop registra um callback por espera, executado por
+ * cancel, assim o cancelamento é percebido imediatamente, sem varreduras periódicas.
+ */
+class CancellationToken {
+private:
+    /**
+     * @brief Estado compartilhado entre as cópias do token.
+     */
+    struct State {
+        std::atomic<bool> cancelled{false};                                         ///< Indica que o token foi cancelado.
+        std::mutex mutex;                                                           ///< Mutex que protege callbacks e next_callback_id.
+        std::unordered_map<std::uint64_t, std::function<void()>> callbacks;         ///< Funções executadas no cancelamento, indexadas pelo identificador.
+        std::uint64_t next_callback_id = 1;                                         ///< Identificador do próximo callback registrado.
+    };
+
+    std::shared_ptr<State> state;                       ///< Estado compartilhado entre as cópias do token.
+
+public:
+    /**
+     * @brief Construtor da classe CancellationToken. Cria um token ainda não cancelado.
+     */
+    CancellationToken() : state(std::make_shared<State>()) {}
+
+    /**
+     * @brief Cancela o token e todas as suas cópias, executando os callbacks registrados.
+     *
+     * Os callbacks são executados na thread que chama cancel, sem o mutex do token bloqueado.
+     */
+    void cancel();
+
+    /**
+     * @brief Verifica se o token foi cancelado.
+     *
+     * @return true se o token foi cancelado, false caso contrário.
+     */
+    bool isCancelled() const { return state->cancelled.load(); }
+
+    /**
+     * @brief Registra uma função a ser executada quando o token for cancelado.
+     *
+     * @param callback Função executada uma única vez, no cancelamento.
+     * @return Identificador do registro, ou 0 se o token já estiver cancelado (o callback não é registrado nem executado).
+     */
+    std::uint64_t registerCallback(std::function<void()> callback);
+
+    /**
+     * @brief Remove um callback registrado. Não faz nada se ele já foi executado.
+     *
+     * @param callback_id Identificador devolvido por registerCallback.
+     */
+    void unregisterCallback(std::uint64_t callback_id) const;
+};
+
+
+template <typename T = void>
+class Task;
+
+
+namespace detail {
+    /**
+     * @brief Parte comum das promises de Task: guarda a corrotina que aguarda o resultado.
+     *
+     * Ao terminar, a corrotina transfere a execução diretamente para quem a aguardava
+     * (symmetric transfer), sem crescer a pilha.
+     */
+    struct TaskPromiseBase {
+        std::coroutine_handle<> continuation;           ///< Corrotina a ser retomada quando esta terminar.
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                auto continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+
+    template <typename T>
+    struct TaskPromise : TaskPromiseBase {
+        std::optional<T> value;                         ///< Valor retornado pela corrotina.
+
+        Task<T> get_return_object();
+        void return_value(T result) { value = std::move(result); }
+    };
+
+    template <>
+    struct TaskPromise<void> : TaskPromiseBase {
+        Task<void> get_return_object();
+        void return_void() const noexcept {}
+    };
+}
+
+
+/**
+ * @brief Corrotina preguiçosa que produz um valor do tipo T.
+ *
+ * A corrotina só começa a executar quando é aguardada com co_await (ou entregue ao
+ * EventLoop::spawn). Ao terminar, retoma quem a aguardava.
+ *
+ * @tparam T Tipo do valor produzido (void se não produz valor).
+ */
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> handle;         ///< Handle da corrotina.
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*handle.promise().value);
+        }
+    }
+};
+
+
+namespace detail {
+    template <typename T>
+    Task<T> TaskPromise<T>::get_return_object() {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object() {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+}
+
+
+/**
+ * @brief Runtime de corrotinas baseado em epoll, com timers e cancelamento.
+ *
+ * O EventLoop possui uma thread reator, que espera eventos de sockets (epoll) e o vencimento
+ * de timers, e entrega as corrotinas prontas ao Executor, cujas threads as retomam. Assim,
+ * milhares de downloads e uploads simultâneos compartilham poucas threads: enquanto uma
+ * corrotina espera um socket ou um timer, nenhuma thread fica bloqueada por ela.
+ *
+ * Cada descritor de arquivo pode ter no máximo uma corrotina aguardando por vez.
+ */
+class EventLoop {
+private:
+    /**
+     * @brief Corrotina aguardando um evento de socket ou o vencimento de um timer.
+     */
+    struct Waiter {
+        std::coroutine_handle<> handle;                 ///< Corrotina a ser retomada.
+        std::optional<CancellationToken> token;         ///< Token que pode cancelar a espera.
+        bool* cancelled;                                ///< Indicador de cancelamento no awaiter da corrotina.
+        std::uint64_t id;                               ///< Identificador único da espera, usado pelo callback de cancelamento para encontrá-la.
+        std::uint64_t callback_id;                      ///< Registro do callback no token (0 se não houver).
+    };
+
+    int epoll_fd;                                                               ///< Descritor do epoll.
+    int wake_fd;                                                                ///< eventfd usado para acordar o reator.
+    std::atomic<bool> stopping;                                                 ///< Indica que o loop está sendo encerrado.
+    std::mutex waiters_mutex;                                                   ///< Mutex que protege io_waiters e timers.
+    std::unordered_map<int, Waiter> io_waiters;                                 ///< Corrotinas aguardando eventos, indexadas pelo descritor.
+    std::multimap<std::chrono::steady_clock::time_point, Waiter> timers;        ///< Corrotinas aguardando timers, ordenadas pelo vencimento.
+    std::uint64_t next_waiter_id;                                               ///< Identificador da próxima espera registrada (protegido por waiters_mutex).
+    Executor& executor;                                                         ///< Pool de threads que retoma as corrotinas prontas.
+
+    /**
+     * @brief Corrotina auxiliar que executa uma Task até o fim e se destrói sozinha.
+     */
+    struct DetachedTask {
+        struct promise_type {
+            DetachedTask get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+
+    /**
+     * @brief Transfere a execução de uma Task para o Executor e a executa até o fim.
+     */
+    DetachedTask runDetached(Task<void> task, TaskPriority priority);
+
+    /**
+     * @brief Executa uma Task na thread atual até a primeira espera e a mantém até o fim.
+     */
+    DetachedTask runInline(Task<void> task);
+
+    /**
+     * @brief Loop da thread reator: espera eventos e timers e enfileira as corrotinas prontas.
+     */
+    void runReactor();
+
+    /**
+     * @brief Acorda a thread reator, que recalcula o próximo timer.
+     */
+    void wakeReactor();
+
+    /**
+     * @brief Retoma todas as esperas indicando o cancelamento (loop encerrando).
+     */
+    void cancelAllWaiters();
+
+    /**
+     * @brief Registra no token da espera o callback que a cancela. Chamado com waiters_mutex bloqueado.
+     *
+     * @return false se o token já estava cancelado (a espera não deve ser registrada).
+     */
+    bool registerCancellation(Waiter& waiter, std::function<void()> callback);
+
+    /**
+     * @brief Remove do token o callback de uma espera que terminou. Chamado com waiters_mutex bloqueado.
+     */
+    void releaseWaiter(const Waiter& waiter);
+
+    /**
+     * @brief Cancela a espera de um descritor, se ela ainda for a espera indicada.
+     */
+    void cancelIoWaiter(int fd, std::uint64_t waiter_id);
+
+    /**
+     * @brief Cancela a espera de um timer, se ela ainda estiver registrada.
+     */
+    void cancelTimer(std::chrono::steady_clock::time_point deadline, std::uint64_t waiter_id);
+
+public:
+    /**
+     * @brief Awaitable que retoma a corrotina em uma das threads do Executor, com a prioridade indicada.
+     */
+    struct ScheduleAwaiter {
+        EventLoop& loop;
+        TaskPriority priority;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { loop.post(handle, priority); }
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief Awaitable que espera um descritor ficar pronto para leitura ou escrita.
+     *
+     * O resultado do co_await é true quando o descritor ficou pronto e false quando a
+     * espera foi cancelada.
+     */
+    struct IoAwaiter {
+        EventLoop& loop;
+        int fd;
+        uint32_t events;
+        std::optional<CancellationToken> token;
+        bool cancelled = false;
+
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() const noexcept { return !cancelled; }
+    };
+
+    /**
+     * @brief Awaitable que espera um intervalo de tempo.
+     *
+     * O resultado do co_await é true quando o tempo passou e false quando a espera foi cancelada.
+     */
+    struct TimerAwaiter {
+        EventLoop& loop;
+        std::chrono::steady_clock::time_point deadline;
+        std::optional<CancellationToken> token;
+        bool cancelled = false;
+
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() const noexcept { return !cancelled; }
+    };
+
+    /**
+     * @brief Construtor da classe EventLoop. Cria o epoll e o eventfd do reator.
+     *
+     * @param executor Pool de threads que retoma as corrotinas prontas.
+     */
+    explicit EventLoop(Executor& executor);
+
+
+    /**
+     * @brief Destrutor da classe EventLoop. Fecha os descritores.
+     */
+    ~EventLoop();
+
+
+    /**
+     * @brief Executa o loop na thread atual até que stop seja chamado.
+     *
+     * A thread que chama run se torna a thread reator. O Executor é iniciado aqui e
+     * encerrado antes de retornar, depois de executar as tarefas pendentes.
+     */
+    void run();
+
+
+    /**
+     * @brief Encerra o loop.
+     *
+     * Cancela todas as esperas pendentes, retomando as corrotinas com o indicador de
+     * cancelamento, e faz run retornar.
+     */
+    void stop();
+
+
+    /**
+     * @brief Verifica se o loop está sendo encerrado.
+     *
+     * @return true se stop foi chamado, false caso contrário.
+     */
+    bool isStopping() const { return stopping.load(); }
+
+
+    /**
+     * @brief Envia uma corrotina para ser retomada pelo Executor.
+     *
+     * @param handle Corrotina a ser retomada.
+     * @param priority Prioridade da retomada. Corrotinas acordadas pelo reator usam HIGH.
+     */
+    void post(std::coroutine_handle<> handle, TaskPriority priority = TaskPriority::HIGH);
+
+
+    /**
+     * @brief Inicia uma Task de forma independente no Executor.
+     *
+     * A Task passa a pertencer ao loop e é destruída ao terminar.
+     *
+     * @param task Task a ser executada.
+     * @param priority Prioridade com que a Task começa a executar.
+     */
+    void spawn(Task<void> task, TaskPriority priority = TaskPriority::NORMAL);
+
+
+    /**
+     * @brief Inicia uma Task na thread atual, sem passar pela fila do Executor.
+     *
+     * A Task executa na thread que chamou até a sua primeira espera (socket, timer ou
+     * schedule); a partir daí é retomada pelo Executor, como as demais. Usado pelas threads
+     * de recebimento UDP, para que cada mensagem seja interpretada no núcleo do seu socket.
+     *
+     * @param task Task a ser executada.
+     */
+    void spawnInline(Task<void> task);
+
+
+    /**
+     * @brief Retorna um awaitable que transfere a corrotina para o Executor com a prioridade indicada.
+     *
+     * Usado, por exemplo, para executar a gravação de chunks em disco com prioridade baixa.
+     *
+     * @param priority Prioridade da retomada.
+     */
+    ScheduleAwaiter schedule(TaskPriority priority = TaskPriority::NORMAL) { return ScheduleAwaiter{*this, priority}; }
+
+
+    /**
+     * @brief Retorna um awaitable que espera o descritor ficar pronto para leitura.
+     *
+     * @param fd Descritor de arquivo (em modo não bloqueante).
+     * @param token Token opcional que cancela a espera.
+     */
+    IoAwaiter readable(int fd, std::optional<CancellationToken> token = std::nullopt);
+
+
+    /**
+     * @brief Retorna um awaitable que espera o descritor ficar pronto para escrita.
+     *
+     * @param fd Descritor de arquivo (em modo não bloqueante).
+     * @param token Token opcional que cancela a espera.
+     */
+    IoAwaiter writable(int fd, std::optional<CancellationToken> token = std::nullopt);
+
+
+    /**
+     * @brief Retorna um awaitable que espera o intervalo de tempo informado.
+     *
+     * @param duration Tempo de espera.
+     * @param token Token opcional que cancela a espera.
+     */
+    TimerAwaiter sleep(std::chrono::steady_clock::duration duration, std::optional<CancellationToken> token = std::nullopt);
+
+
+    /**
+     * @brief Recebe dados de um socket não bloqueante, esperando que haja dados disponíveis.
+     *
+     * @param fd Socket em modo não bloqueante.
+     * @param buffer Buffer de destino.
+     * @param length Tamanho máximo a ser recebido.
+     * @param token Token opcional que cancela a espera.
+     * @return Número de bytes recebidos, 0 se a conexão foi fechada ou -1 em caso de erro (errno = ECANCELED se cancelado).
+     */
+    Task<ssize_t> recv(int fd, void* buffer, size_t length, std::optional<CancellationToken> token = std::nullopt);
+
+
+    /**
+     * @brief Envia dados por um socket não bloqueante, esperando que haja espaço no buffer do kernel.
+     *
+     * @param fd Socket em modo não bloqueante.
+     * @param buffer Dados a serem enviados.
+     * @param length Número de bytes a serem enviados.
+     * @param token Token opcional que cancela a espera.
+     * @return Número de bytes enviados ou -1 em caso de erro (errno = ECANCELED se cancelado).
+     */
+    Task<ssize_t> send(int fd, const void* buffer, size_t length, std::optional<CancellationToken> token = std::nullopt);
+
+
+    /**
+     * @brief Aceita uma conexão em um socket de escuta não bloqueante.
+     *
+     * @param fd Socket de escuta em modo não bloqueante.
+     * @param token Token opcional que cancela a espera.
+     * @return Descritor da nova conexão (já em modo não bloqueante) ou -1 em caso de erro.
+     */
+    Task<int> accept(int fd, std::optional<CancellationToken> token = std::nullopt);
+
+
+    /**
+     * @brief Conecta um socket não bloqueante ao endereço informado.
+     *
+     * @param fd Socket em modo não bloqueante.
+     * @param address Endereço de destino.
+     * @param address_length Tamanho da estrutura do endereço.
+     * @param token Token opcional que cancela a espera.
+     * @return 0 se a conexão foi estabelecida ou -1 em caso de erro (errno indica o motivo).
+     */
+    Task<int> connect(int fd, const struct sockaddr* address, socklen_t address_length, std::optional<CancellationToken> token = std::nullopt);
+
+
+    /**
+     * @brief Coloca um descritor em modo não bloqueante.
+     *
+     * @param fd Descritor de arquivo.
+     * @return true se a configuração foi aplicada, false caso contrário.
+     */
+    static bool setNonBlocking(int fd);
+};
+
+#endif // ASYNCRUNTIME_H
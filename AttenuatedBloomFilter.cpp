@@ -0,0 +1,124 @@
+#include "AttenuatedBloomFilter.h"
+#include "Constants.h"
+#include <bit>
+#include <charconv>
+#include <sstream>
+
+
+/**
+ * @brief Construtor da classe AttenuatedBloomFilter. Cria um filtro vazio com Constants::BLOOM_FILTER_DEPTH níveis.
+ */
+AttenuatedBloomFilter::AttenuatedBloomFilter()
+    : levels(Constants::BLOOM_FILTER_DEPTH, std::vector<std::uint64_t>(Constants::BLOOM_FILTER_BITS / 64, 0)) {}
+
+
+/**
+ * @brief Retorna a posição do i-ésimo bit de uma chave.
+ */
+std::size_t AttenuatedBloomFilter::getBitIndex(std::uint64_t key, int hash_index) {
+    // Hashing duplo: a segunda função é derivada da primeira e precisa ser ímpar para percorrer todas as posições
+    std::uint64_t second_hash = (std::rotl(key, 32) * 0x9E3779B97F4A7C15ULL) | 1;
+    return static_cast<std::size_t>((key + static_cast<std::uint64_t>(hash_index) * second_hash) % Constants::BLOOM_FILTER_BITS);
+}
+
+
+/**
+ * @brief Adiciona uma chave a um nível.
+ */
+void AttenuatedBloomFilter::add(int level, std::uint64_t key) {
+    if (level < 0 || level >= static_cast<int>(levels.size())) {
+        return;
+    }
+    for (int hash_index = 0; hash_index < Constants::BLOOM_FILTER_HASHES; ++hash_index) {
+        std::size_t bit = getBitIndex(key, hash_index);
+        levels[level][bit / 64] |= std::uint64_t(1) << (bit % 64);
+    }
+}
+
+
+/**
+ * @brief Verifica se uma chave pode estar em um nível (falsos positivos são possíveis, falsos negativos não).
+ */
+bool AttenuatedBloomFilter::mayContain(int level, std::uint64_t key) const {
+    if (level < 0 || level >= static_cast<int>(levels.size())) {
+        return false;
+    }
+    for (int hash_index = 0; hash_index < Constants::BLOOM_FILTER_HASHES; ++hash_index) {
+        std::size_t bit = getBitIndex(key, hash_index);
+        if ((levels[level][bit / 64] & (std::uint64_t(1) << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief Verifica se uma chave pode estar em algum dos primeiros níveis.
+ */
+bool AttenuatedBloomFilter::mayContainWithin(std::uint64_t key, int max_level) const {
+    for (int level = 0; level <= max_level && level < static_cast<int>(levels.size()); ++level) {
+        if (mayContain(level, key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Acumula outro filtro deslocado de um nível (o nível i do outro vai para o nível i + 1).
+ */
+void AttenuatedBloomFilter::mergeShifted(const AttenuatedBloomFilter& other) {
+    for (std::size_t level = 1; level < levels.size(); ++level) {
+        for (std::size_t word = 0; word < levels[level].size(); ++word) {
+            levels[level][word] |= other.levels[level - 1][word];
+        }
+    }
+}
+
+
+/**
+ * @brief Converte o filtro em texto (um campo hexadecimal por nível, separados por espaço).
+ */
+std::string AttenuatedBloomFilter::serialize() const {
+    static const char hex_digits[] = "0123456789abcdef";
+    std::string text;
+    for (std::size_t level = 0; level < levels.size(); ++level) {
+        if (level > 0) {
+            text += ' ';
+        }
+        for (std::uint64_t word : levels[level]) {
+            for (int shift = 60; shift >= 0; shift -= 4) {
+                text += hex_digits[(word >> shift) & 0xF];
+            }
+        }
+    }
+    return text;
+}
+
+
+/**
+ * @brief Lê um filtro convertido em texto por serialize.
+ */
+bool AttenuatedBloomFilter::deserialize(const std::string& text, AttenuatedBloomFilter& filter) {
+    std::stringstream ss(text);
+    AttenuatedBloomFilter result;
+
+    for (auto& level : result.levels) {
+        std::string level_text;
+        if (!(ss >> level_text) || level_text.size() != level.size() * 16) {
+            return false;
+        }
+        for (std::size_t word = 0; word < level.size(); ++word) {
+            const char* begin = level_text.data() + word * 16;
+            auto parse_result = std::from_chars(begin, begin + 16, level[word], 16);
+            if (parse_result.ec != std::errc() || parse_result.ptr != begin + 16) {
+                return false;
+            }
+        }
+    }
+
+    filter = std::move(result);
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef ATTENUATEDBLOOMFILTER_H
+#define ATTENUATEDBLOOMFILTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Filtro de Bloom atenuado: um filtro de Bloom por distância em saltos.
+ *
+ * O nível i resume os arquivos alcançáveis a exatamente i saltos além do peer que enviou o
+ * filtro (o nível 0 são os arquivos do próprio peer). Os níveis têm
+ * Constants::BLOOM_FILTER_BITS bits e cada chave marca Constants::BLOOM_FILTER_HASHES bits,
+ * calculados por hashing duplo a partir da chave de 64 bits do arquivo.
+ */
+class AttenuatedBloomFilter {
+private:
+    std::vector<std::vector<std::uint64_t>> levels;     ///< Bits de cada nível, em palavras de 64 bits.
+
+    /**
+     * @brief Retorna a posição do i-ésimo bit de uma chave.
+     */
+    static std::size_t getBitIndex(std::uint64_t key, int hash_index);
+
+public:
+    /**
+     * @brief Construtor da classe AttenuatedBloomFilter. Cria um filtro vazio com Constants::BLOOM_FILTER_DEPTH níveis.
+     */
+    AttenuatedBloomFilter();
+
+
+    /**
+     * @brief Adiciona uma chave a um nível.
+     *
+     * @param level Nível (distância em saltos).
+     * @param key Chave do arquivo (ver DHTNode::keyFor).
+     */
+    void add(int level, std::uint64_t key);
+
+
+    /**
+     * @brief Verifica se uma chave pode estar em um nível (falsos positivos são possíveis, falsos negativos não).
+     *
+     * @param level Nível (distância em saltos).
+     * @param key Chave do arquivo.
+     * @return true se todos os bits da chave estão marcados no nível.
+     */
+    bool mayContain(int level, std::uint64_t key) const;
+
+
+    /**
+     * @brief Verifica se uma chave pode estar em algum dos primeiros níveis.
+     *
+     * @param key Chave do arquivo.
+     * @param max_level Último nível verificado (limitado à profundidade do filtro).
+     * @return true se a chave pode estar a até max_level saltos.
+     */
+    bool mayContainWithin(std::uint64_t key, int max_level) const;
+
+
+    /**
+     * @brief Acumula outro filtro deslocado de um nível (o nível i do outro vai para o nível i + 1).
+     *
+     * Usado para montar o filtro enviado a um vizinho a partir dos filtros recebidos dos demais:
+     * o que está a i saltos deles está a i + 1 saltos deste peer. O último nível do outro
+     * filtro é descartado.
+     *
+     * @param other Filtro recebido de outro vizinho.
+     */
+    void mergeShifted(const AttenuatedBloomFilter& other);
+
+
+    /**
+     * @brief Converte o filtro em texto (um campo hexadecimal por nível, separados por espaço).
+     */
+    std::string serialize() const;
+
+
+    /**
+     * @brief Lê um filtro convertido em texto por serialize.
+     *
+     * @param text Texto com os níveis em hexadecimal.
+     * @param filter Recebe o filtro lido.
+     * @return true se o texto é válido, false caso contrário.
+     */
+    static bool deserialize(const std::string& text, AttenuatedBloomFilter& filter);
+};
+
+#endif // ATTENUATEDBLOOMFILTER_H
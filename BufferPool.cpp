@@ -0,0 +1,340 @@
+#include "BufferPool.h"
+#include "Constants.h"
+#include "Utils.h"
+#include <cstring>
+#include <dirent.h>
+#include <iomanip>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+/**
+ * @brief Construtor da classe BufferPool. Detecta os nós NUMA do sistema.
+ */
+BufferPool::BufferPool() : acquired(0), reused(0), mapped_bytes(0) {
+    class_count = 0;
+    for (std::size_t capacity = Constants::BUFFER_POOL_MIN_CLASS_SIZE; capacity <= Constants::BUFFER_POOL_MAX_CLASS_SIZE; capacity *= 2) {
+        class_count++;
+    }
+
+    // Conta os nós NUMA pelas entradas "nodeN" do sysfs (sem NUMA, há um único nó)
+    int node_count = 0;
+    if (DIR* node_dir = opendir("/sys/devices/system/node")) {
+        while (struct dirent* entry = readdir(node_dir)) {
+            if (std::strncmp(entry->d_name, "node", 4) == 0 && std::isdigit(static_cast<unsigned char>(entry->d_name[4]))) {
+                node_count = std::max(node_count, std::atoi(entry->d_name + 4) + 1);
+            }
+        }
+        closedir(node_dir);
+    }
+
+    for (int node = 0; node < std::max(1, node_count); ++node) {
+        auto cache = std::make_unique<NodeCache>();
+        cache->free_blocks.resize(class_count);
+        node_caches.push_back(std::move(cache));
+    }
+}
+
+
+/**
+ * @brief Retorna o pool compartilhado pelo processo.
+ */
+BufferPool& BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+
+/**
+ * @brief Retorna a classe de tamanho que comporta o tamanho informado.
+ */
+int BufferPool::getSizeClass(std::size_t size) const {
+    std::size_t capacity = Constants::BUFFER_POOL_MIN_CLASS_SIZE;
+    for (std::size_t size_class = 0; size_class < class_count; ++size_class, capacity *= 2) {
+        if (size <= capacity) {
+            return static_cast<int>(size_class);
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Retorna a capacidade dos blocos de uma classe de tamanho.
+ */
+std::size_t BufferPool::getClassCapacity(int size_class) const {
+    return Constants::BUFFER_POOL_MIN_CLASS_SIZE << size_class;
+}
+
+
+/**
+ * @brief Retorna o nó NUMA da CPU em que a thread atual está executando.
+ */
+int BufferPool::getCurrentNode() const {
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) < 0 || node >= node_caches.size()) {
+        return 0;
+    }
+    return static_cast<int>(node);
+}
+
+
+/**
+ * @brief Mapeia memória anônima, usando huge pages quando solicitado.
+ */
+char* BufferPool::mapMemory(std::size_t size, bool huge_pages) {
+    void* memory = MAP_FAILED;
+
+    if (huge_pages) {
+        // Huge pages reservadas (hugetlbfs), quando o tamanho é múltiplo de uma huge page
+        if (size % Constants::BUFFER_POOL_HUGEPAGE_CLASS_SIZE == 0) {
+            memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+
+        // Sem huge pages reservadas: pede transparent huge pages ao kernel
+        if (memory == MAP_FAILED) {
+            memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory != MAP_FAILED) {
+                madvise(memory, size, MADV_HUGEPAGE);
+            }
+        }
+    } else {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if (memory == MAP_FAILED) {
+        perror("Erro ao mapear memória para o pool de buffers");
+        return nullptr;
+    }
+
+    // Toca a memória na thread atual: pela política first-touch as páginas ficam no nó NUMA local
+    std::memset(memory, 0, size);
+
+    mapped_bytes.fetch_add(size);
+    return static_cast<char*>(memory);
+}
+
+
+/**
+ * @brief Aloca novos blocos de uma classe e os coloca na lista de livres do nó.
+ */
+void BufferPool::refill(NodeCache& cache, int size_class, int node) {
+    std::size_t capacity = getClassCapacity(size_class);
+
+    // Classes grandes: um mapeamento por bloco
+    if (capacity >= Constants::BUFFER_POOL_SLAB_SIZE) {
+        char* memory = mapMemory(capacity, capacity >= Constants::BUFFER_POOL_HUGEPAGE_CLASS_SIZE);
+        if (memory != nullptr) {
+            cache.free_blocks[size_class].push_back(new Block{memory, capacity, size_class, node, {0}});
+        }
+        return;
+    }
+
+    // Classes pequenas: recorta um slab em blocos do mesmo tamanho (os slabs nunca são devolvidos ao sistema)
+    char* slab = mapMemory(Constants::BUFFER_POOL_SLAB_SIZE, false);
+    if (slab == nullptr) {
+        return;
+    }
+    for (std::size_t offset = 0; offset + capacity <= Constants::BUFFER_POOL_SLAB_SIZE; offset += capacity) {
+        cache.free_blocks[size_class].push_back(new Block{slab + offset, capacity, size_class, node, {0}});
+    }
+}
+
+
+/**
+ * @brief Obtém um buffer com pelo menos o tamanho informado.
+ */
+BufferPool::Buffer BufferPool::acquire(std::size_t size) {
+    acquired.fetch_add(1);
+    int size_class = getSizeClass(std::max<std::size_t>(size, 1));
+
+    // Maior que a maior classe: mapeamento próprio, devolvido ao sistema na liberação
+    if (size_class < 0) {
+        char* memory = mapMemory(size, true);
+        if (memory == nullptr) {
+            return Buffer();
+        }
+        Block* block = new Block{memory, size, -1, getCurrentNode(), {1}};
+        return Buffer(block, size);
+    }
+
+    int node = getCurrentNode();
+    NodeCache& cache = *node_caches[node];
+    Block* block = nullptr;
+    {
+        std::lock_guard<std::mutex> cache_lock(cache.mutex);
+        auto& free_blocks = cache.free_blocks[size_class];
+        if (!free_blocks.empty()) {
+            reused.fetch_add(1);
+        } else {
+            refill(cache, size_class, node);
+        }
+
+        if (!free_blocks.empty()) {
+            block = free_blocks.back();
+            free_blocks.pop_back();
+        }
+    }
+
+    if (block == nullptr) {
+        return Buffer();
+    }
+    block->references.store(1);
+    return Buffer(block, size);
+}
+
+
+/**
+ * @brief Devolve um bloco ao pool (ou ao sistema, se for maior que a maior classe).
+ */
+void BufferPool::release(Block* block) {
+    if (block->size_class < 0) {
+        munmap(block->memory, block->capacity);
+        mapped_bytes.fetch_sub(block->capacity);
+        delete block;
+        return;
+    }
+
+    // Volta para a lista do nó em que foi alocado, mantendo a localidade da memória
+    NodeCache& cache = *node_caches[block->node];
+    std::size_t max_cached_blocks = std::max<std::size_t>(1, Constants::BUFFER_POOL_MAX_CACHED_BYTES_PER_CLASS / block->capacity);
+    {
+        std::lock_guard<std::mutex> cache_lock(cache.mutex);
+        auto& free_blocks = cache.free_blocks[block->size_class];
+
+        // Blocos de slab sempre voltam para a lista, blocos grandes só até o limite por classe
+        if (block->capacity < Constants::BUFFER_POOL_SLAB_SIZE || free_blocks.size() < max_cached_blocks) {
+            free_blocks.push_back(block);
+            return;
+        }
+    }
+
+    munmap(block->memory, block->capacity);
+    mapped_bytes.fetch_sub(block->capacity);
+    delete block;
+}
+
+
+/**
+ * @brief Monta uma linha de log com o uso do pool.
+ */
+std::string BufferPool::describeStats() const {
+    std::uint64_t total_acquired = acquired.load();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "Pool de buffers: " << total_acquired << " buffers entregues, "
+       << (total_acquired > 0 ? 100.0 * reused.load() / total_acquired : 0.0) << "% reutilizados, "
+       << mapped_bytes.load() / 1024 << " KiB mapeados em " << node_caches.size() << " nó(s) NUMA.";
+    return ss.str();
+}
+
+
+/**
+ * @brief Construtor de cópia: compartilha o bloco e incrementa o número de referências.
+ */
+BufferPool::Buffer::Buffer(const Buffer& other) : block(other.block), length(other.length) {
+    if (block != nullptr) {
+        block->references.fetch_add(1);
+    }
+}
+
+
+/**
+ * @brief Construtor de movimento: assume a referência do outro handle.
+ */
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept : block(other.block), length(other.length) {
+    other.block = nullptr;
+    other.length = 0;
+}
+
+
+/**
+ * @brief Atribuição por cópia: solta o bloco atual e compartilha o do outro handle.
+ */
+BufferPool::Buffer& BufferPool::Buffer::operator=(const Buffer& other) {
+    if (this != &other) {
+        if (other.block != nullptr) {
+            other.block->references.fetch_add(1);
+        }
+        reset();
+        block = other.block;
+        length = other.length;
+    }
+    return *this;
+}
+
+
+/**
+ * @brief Atribuição por movimento: solta o bloco atual e assume a referência do outro handle.
+ */
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        block = other.block;
+        length = other.length;
+        other.block = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+
+/**
+ * @brief Solta a referência ao bloco, devolvendo-o ao pool se for a última.
+ */
+void BufferPool::Buffer::reset() {
+    if (block != nullptr && block->references.fetch_sub(1) == 1) {
+        BufferPool::instance().release(block);
+    }
+    block = nullptr;
+    length = 0;
+}
+
+
+/**
+ * @brief Construtor do streambuf sobre a memória do buffer.
+ */
+BufferStream::ViewStreamBuf::ViewStreamBuf(const char* begin, std::size_t size) {
+    char* start = const_cast<char*>(begin);
+    setg(start, start, start + size);
+}
+
+
+/**
+ * @brief Reposiciona a leitura relativamente ao início, à posição atual ou ao fim do buffer.
+ */
+BufferStream::ViewStreamBuf::pos_type BufferStream::ViewStreamBuf::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode) {
+    if (!(mode & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type base = direction == std::ios_base::beg ? 0
+                  : direction == std::ios_base::cur ? gptr() - eback()
+                  : egptr() - eback();
+    off_type position = base + offset;
+    if (position < 0 || position > egptr() - eback()) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), eback() + position, egptr());
+    return pos_type(position);
+}
+
+
+/**
+ * @brief Reposiciona a leitura em uma posição absoluta do buffer.
+ */
+BufferStream::ViewStreamBuf::pos_type BufferStream::ViewStreamBuf::seekpos(pos_type position, std::ios_base::openmode mode) {
+    return seekoff(off_type(position), std::ios_base::beg, mode);
+}
+
+
+/**
+ * @brief Construtor da classe BufferStream.
+ */
+BufferStream::BufferStream(BufferPool::Buffer buffer)
+    : std::istream(nullptr), buffer(std::move(buffer)), stream_buffer(this->buffer.data(), this->buffer.size()) {
+    rdbuf(&stream_buffer);
+}
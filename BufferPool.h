@@ -0,0 +1,235 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/**
+ * @brief Pool de buffers reutilizáveis, organizado em classes de tamanho.
+ *
+ * Os tamanhos são arredondados para a próxima potência de dois entre
+ * Constants::BUFFER_POOL_MIN_CLASS_SIZE e Constants::BUFFER_POOL_MAX_CLASS_SIZE. Cada classe
+ * mantém uma lista de buffers livres por nó NUMA, e o buffer liberado volta para a lista do
+ * nó em que foi alocado. Classes pequenas são recortadas de slabs, e classes a partir de
+ * Constants::BUFFER_POOL_HUGEPAGE_CLASS_SIZE são alocadas com huge pages (MAP_HUGETLB, ou
+ * transparent huge pages quando o sistema não tem huge pages reservadas).
+ *
+ * Os buffers são entregues como Buffer, um handle com contagem de referências: o bloco volta
+ * ao pool quando a última cópia do handle é destruída, assim o mesmo buffer pode passar do
+ * recv até a gravação em disco sem cópias.
+ */
+class BufferPool {
+private:
+    /**
+     * @brief Bloco de memória administrado pelo pool.
+     */
+    struct Block {
+        char* memory;                   ///< Início da memória do bloco.
+        std::size_t capacity;           ///< Capacidade do bloco em bytes.
+        int size_class;                 ///< Classe de tamanho do bloco (-1 para blocos maiores que a maior classe).
+        int node;                       ///< Nó NUMA em que o bloco foi alocado.
+        std::atomic<int> references;    ///< Número de handles que referenciam o bloco.
+    };
+
+    /**
+     * @brief Listas de blocos livres de um nó NUMA, uma por classe de tamanho.
+     */
+    struct NodeCache {
+        std::mutex mutex;                                   ///< Mutex que protege as listas.
+        std::vector<std::vector<Block*>> free_blocks;       ///< Blocos livres, indexados pela classe de tamanho.
+    };
+
+    std::vector<std::unique_ptr<NodeCache>> node_caches;    ///< Listas de blocos livres de cada nó NUMA.
+    std::size_t class_count;                                ///< Número de classes de tamanho.
+    std::atomic<std::uint64_t> acquired;                    ///< Número de buffers entregues.
+    std::atomic<std::uint64_t> reused;                      ///< Número de buffers entregues a partir das listas de livres.
+    std::atomic<std::uint64_t> mapped_bytes;                ///< Total de bytes obtidos do sistema operacional.
+
+    /**
+     * @brief Construtor da classe BufferPool. Detecta os nós NUMA do sistema.
+     */
+    BufferPool();
+
+    /**
+     * @brief Retorna a classe de tamanho que comporta o tamanho informado.
+     *
+     * @param size Tamanho desejado em bytes.
+     * @return Índice da classe, ou -1 se o tamanho for maior que a maior classe.
+     */
+    int getSizeClass(std::size_t size) const;
+
+    /**
+     * @brief Retorna a capacidade dos blocos de uma classe de tamanho.
+     *
+     * @param size_class Índice da classe.
+     * @return Capacidade em bytes.
+     */
+    std::size_t getClassCapacity(int size_class) const;
+
+    /**
+     * @brief Retorna o nó NUMA da CPU em que a thread atual está executando.
+     */
+    int getCurrentNode() const;
+
+    /**
+     * @brief Aloca novos blocos de uma classe e os coloca na lista de livres do nó.
+     *
+     * Classes pequenas são recortadas de um slab de Constants::BUFFER_POOL_SLAB_SIZE bytes, as
+     * demais recebem um mapeamento próprio. Deve ser chamada com o mutex do nó bloqueado.
+     *
+     * @param cache Listas de livres do nó.
+     * @param size_class Índice da classe.
+     * @param node Nó NUMA atual.
+     */
+    void refill(NodeCache& cache, int size_class, int node);
+
+    /**
+     * @brief Mapeia memória anônima, usando huge pages quando solicitado.
+     *
+     * A memória é tocada pela thread atual, assim as páginas ficam no nó NUMA local.
+     *
+     * @param size Tamanho do mapeamento em bytes.
+     * @param huge_pages Indica se deve usar huge pages.
+     * @return Ponteiro para a memória, ou nullptr em caso de erro.
+     */
+    char* mapMemory(std::size_t size, bool huge_pages);
+
+    /**
+     * @brief Devolve um bloco ao pool (ou ao sistema, se for maior que a maior classe).
+     *
+     * @param block Bloco a ser devolvido.
+     */
+    void release(Block* block);
+
+public:
+    /**
+     * @brief Handle com contagem de referências para um buffer do pool.
+     *
+     * Cópias do handle compartilham o mesmo buffer, que volta ao pool quando a última cópia
+     * é destruída.
+     */
+    class Buffer {
+    private:
+        Block* block = nullptr;             ///< Bloco compartilhado entre as cópias do handle.
+        std::size_t length = 0;             ///< Número de bytes válidos no buffer.
+
+        friend class BufferPool;
+
+        Buffer(Block* block, std::size_t length) : block(block), length(length) {}
+
+        /**
+         * @brief Solta a referência ao bloco, devolvendo-o ao pool se for a última.
+         */
+        void reset();
+
+    public:
+        Buffer() = default;
+        Buffer(const Buffer& other);
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(const Buffer& other);
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer() { reset(); }
+
+        char* data() { return block ? block->memory : nullptr; }
+        const char* data() const { return block ? block->memory : nullptr; }
+
+        /**
+         * @brief Retorna o número de bytes válidos no buffer.
+         */
+        std::size_t size() const { return length; }
+
+        /**
+         * @brief Retorna a capacidade do bloco, que pode ser maior que o tamanho solicitado.
+         */
+        std::size_t capacity() const { return block ? block->capacity : 0; }
+
+        /**
+         * @brief Define o número de bytes válidos no buffer, limitado à capacidade.
+         */
+        void resize(std::size_t size) { length = std::min(size, capacity()); }
+
+        /**
+         * @brief Retorna uma visão dos bytes válidos do buffer.
+         */
+        std::string_view view() const { return std::string_view(data(), length); }
+
+        explicit operator bool() const { return block != nullptr; }
+    };
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+
+    /**
+     * @brief Retorna o pool compartilhado pelo processo.
+     */
+    static BufferPool& instance();
+
+
+    /**
+     * @brief Obtém um buffer com pelo menos o tamanho informado.
+     *
+     * @param size Tamanho desejado em bytes. O tamanho válido do buffer começa igual a size.
+     * @return Buffer obtido, ou um Buffer vazio se não houver memória disponível.
+     */
+    Buffer acquire(std::size_t size);
+
+
+    /**
+     * @brief Monta uma linha de log com o uso do pool.
+     *
+     * @return Texto com o número de buffers entregues, a taxa de reutilização e a memória mapeada.
+     */
+    std::string describeStats() const;
+};
+
+
+/**
+ * @brief Stream de leitura sobre os bytes de um Buffer, sem copiá-los.
+ *
+ * Mantém uma cópia do handle, assim o buffer continua válido enquanto o stream existir.
+ * Suporta tellg e seekg.
+ */
+class BufferStream : public std::istream {
+private:
+    /**
+     * @brief streambuf que lê diretamente da memória do buffer.
+     */
+    class ViewStreamBuf : public std::streambuf {
+    public:
+        ViewStreamBuf(const char* begin, std::size_t size);
+
+    protected:
+        pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode) override;
+        pos_type seekpos(pos_type position, std::ios_base::openmode mode) override;
+    };
+
+    BufferPool::Buffer buffer;              ///< Buffer lido pelo stream.
+    ViewStreamBuf stream_buffer;            ///< streambuf sobre os bytes do buffer.
+
+public:
+    /**
+     * @brief Construtor da classe BufferStream.
+     *
+     * @param buffer Buffer a ser lido. Apenas os bytes válidos (size) são lidos.
+     */
+    explicit BufferStream(BufferPool::Buffer buffer);
+
+
+    /**
+     * @brief Retorna o conteúdo do buffer como string, para logs.
+     */
+    std::string str() const { return std::string(buffer.view()); }
+};
+
+#endif // BUFFERPOOL_H
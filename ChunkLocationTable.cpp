@@ -0,0 +1,92 @@
+#include "ChunkLocationTable.h"
+#include <algorithm>
+#include <bit>
+
+
+/**
+ * @brief Cria a tabela vazia de um arquivo.
+ */
+ChunkLocationTable::ChunkLocationTable(ChunkId total_chunks)
+    : total_chunks(std::max<ChunkId>(total_chunks, 0)),
+      words_per_bitmap((static_cast<std::size_t>(this->total_chunks) + 63) / 64),
+      replica_counts(static_cast<std::size_t>(this->total_chunks), 0) {}
+
+
+/**
+ * @brief Registra os chunks que um peer possui.
+ */
+std::size_t ChunkLocationTable::addChunks(PeerId peer, const std::vector<ChunkId>& chunk_ids) {
+    // Mapa de bits dos chunks anunciados
+    std::vector<std::uint64_t> announced(words_per_bitmap, 0);
+    std::size_t out_of_range = 0;
+    for (const ChunkId chunk : chunk_ids) {
+        if (chunk < 0 || chunk >= total_chunks) {
+            out_of_range++;
+            continue;
+        }
+        announced[chunk / 64] |= std::uint64_t{1} << (chunk % 64);
+    }
+
+    // Coluna do peer, criada na primeira resposta dele
+    auto it = std::find(holders.begin(), holders.end(), peer);
+    std::size_t holder_index = it - holders.begin();
+    if (it == holders.end()) {
+        holders.push_back(peer);
+        bitmaps.emplace_back(words_per_bitmap, 0);
+    }
+
+    // OU com o mapa do peer. Apenas os bits que passam de 0 para 1 contam como novas réplicas
+    auto& bitmap = bitmaps[holder_index];
+    for (std::size_t word = 0; word < words_per_bitmap; ++word) {
+        std::uint64_t added = announced[word] & ~bitmap[word];
+        bitmap[word] |= added;
+        while (added != 0) {
+            replica_counts[word * 64 + std::countr_zero(added)]++;
+            added &= added - 1;
+        }
+    }
+    return out_of_range;
+}
+
+
+/**
+ * @brief Retorna o número de peers conhecidos que possuem um chunk (0 se estiver fora do arquivo).
+ */
+std::uint32_t ChunkLocationTable::getReplicaCount(ChunkId chunk) const {
+    return chunk >= 0 && chunk < total_chunks ? replica_counts[chunk] : 0;
+}
+
+
+/**
+ * @brief Retorna os chunks de um intervalo que nenhum peer conhecido possui.
+ */
+std::vector<ChunkId> ChunkLocationTable::getUnlocatedChunks(const ChunkRange& range) const {
+    std::vector<ChunkId> unlocated;
+    ChunkId first = std::max<ChunkId>(range.first, 0);
+    ChunkId end = std::min(range.end, total_chunks);
+    if (first >= end) {
+        return unlocated;
+    }
+
+    for (std::size_t word = first / 64; word <= static_cast<std::size_t>(end - 1) / 64; ++word) {
+        std::uint64_t located = 0;
+        for (const auto& bitmap : bitmaps) {
+            located |= bitmap[word];
+        }
+
+        // Bits dos chunks sem peer, restritos ao intervalo
+        std::uint64_t missing = ~located;
+        ChunkId word_first = static_cast<ChunkId>(word * 64);
+        if (first > word_first) {
+            missing &= ~std::uint64_t{0} << (first - word_first);
+        }
+        if (end < word_first + 64) {
+            missing &= (std::uint64_t{1} << (end - word_first)) - 1;
+        }
+        while (missing != 0) {
+            unlocated.push_back(word_first + std::countr_zero(missing));
+            missing &= missing - 1;
+        }
+    }
+    return unlocated;
+}
@@ -0,0 +1,89 @@
+#ifndef CHUNKLOCATIONTABLE_H
+#define CHUNKLOCATIONTABLE_H
+
+#include "PeerTable.h"
+#include "Utils.h"
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief Localização dos chunks de um arquivo, organizada por peer (estrutura de arrays).
+ *
+ * Cada peer que possui chunks do arquivo ocupa uma coluna: o seu PeerId em holders e um mapa de
+ * bits em bitmaps, com um bit por chunk. replica_counts guarda quantos peers conhecidos possuem
+ * cada chunk. Registrar uma resposta é um OU bit a bit entre o mapa do peer e os chunks
+ * anunciados, e a seleção de peers percorre os bits dos mapas sem montar listas por chunk.
+ *
+ * A tabela não é sincronizada: o FileManager a protege com o mutex do arquivo e entrega à seleção
+ * de peers um ponteiro compartilhado, copiando a tabela apenas se ela for alterada enquanto esse
+ * ponteiro ainda estiver em uso.
+ */
+class ChunkLocationTable {
+private:
+    ChunkId total_chunks;                           ///< Número total de chunks do arquivo.
+    std::size_t words_per_bitmap;                   ///< Número de palavras de 64 bits de cada mapa.
+    std::vector<PeerId> holders;                    ///< PeerId de cada peer que possui chunks do arquivo.
+    std::vector<std::vector<std::uint64_t>> bitmaps; ///< Mapa de bits dos chunks de cada peer, na mesma ordem de holders.
+    std::vector<std::uint32_t> replica_counts;      ///< Número de peers conhecidos que possuem cada chunk.
+
+public:
+    /**
+     * @brief Cria a tabela vazia de um arquivo.
+     *
+     * @param total_chunks Número total de chunks do arquivo.
+     */
+    explicit ChunkLocationTable(ChunkId total_chunks);
+
+
+    /**
+     * @brief Registra os chunks que um peer possui.
+     *
+     * Os chunks são convertidos em um mapa de bits e combinados com o mapa do peer por um OU bit a
+     * bit. Apenas os bits novos incrementam o número de réplicas.
+     *
+     * @param peer PeerId do peer.
+     * @param chunk_ids Chunks anunciados pelo peer.
+     * @return Número de chunks anunciados fora do intervalo do arquivo (ignorados).
+     */
+    std::size_t addChunks(PeerId peer, const std::vector<ChunkId>& chunk_ids);
+
+
+    /**
+     * @brief Retorna o número total de chunks do arquivo.
+     */
+    ChunkId getTotalChunks() const { return total_chunks; }
+
+
+    /**
+     * @brief Retorna os peers que possuem chunks do arquivo.
+     */
+    const std::vector<PeerId>& getHolders() const { return holders; }
+
+
+    /**
+     * @brief Verifica se o peer na posição holder_index de getHolders possui um chunk.
+     */
+    bool holderHasChunk(std::size_t holder_index, ChunkId chunk) const {
+        return (bitmaps[holder_index][chunk / 64] >> (chunk % 64)) & 1;
+    }
+
+
+    /**
+     * @brief Retorna o número de peers conhecidos que possuem um chunk (0 se estiver fora do arquivo).
+     */
+    std::uint32_t getReplicaCount(ChunkId chunk) const;
+
+
+    /**
+     * @brief Retorna os chunks de um intervalo que nenhum peer conhecido possui.
+     *
+     * Percorre o OU dos mapas de todos os peers, uma palavra de 64 chunks por vez.
+     *
+     * @param range Intervalo de chunks de interesse.
+     * @return Chunks do intervalo sem localização, em ordem crescente.
+     */
+    std::vector<ChunkId> getUnlocatedChunks(const ChunkRange& range) const;
+};
+
+#endif // CHUNKLOCATIONTABLE_H
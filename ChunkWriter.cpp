@@ -0,0 +1,141 @@
+#include "ChunkWriter.h"
+#include "Constants.h"
+#include "Utils.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+
+/**
+ * @brief Retorna um sufixo único para o arquivo temporário.
+ */
+static std::string nextTemporarySuffix() {
+    static std::atomic<std::uint64_t> counter{0};
+    return ".part" + std::to_string(counter.fetch_add(1));
+}
+
+
+/**
+ * @brief Construtor da classe ChunkWriter. Cria o arquivo temporário do chunk.
+ */
+ChunkWriter::ChunkWriter(const std::string& path)
+    : path(path), temporary_path(path + nextTemporarySuffix()), bytes_written(0), hash(Constants::CHUNK_HASH_INITIAL_VALUE) {
+    fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Erro ao criar o arquivo temporário do chunk");
+    }
+}
+
+
+/**
+ * @brief Destrutor da classe ChunkWriter. Remove o arquivo temporário se o chunk não foi confirmado.
+ */
+ChunkWriter::~ChunkWriter() {
+    abort();
+}
+
+
+/**
+ * @brief Fecha o arquivo temporário, se estiver aberto.
+ */
+void ChunkWriter::closeFile() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+
+/**
+ * @brief Grava o próximo trecho do chunk e atualiza o hash.
+ */
+bool ChunkWriter::write(const char* data, std::size_t size) {
+    if (fd < 0) {
+        return false;
+    }
+
+    std::size_t total_written = 0;
+    while (total_written < size) {
+        ssize_t written = ::write(fd, data + total_written, size - total_written);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Erro ao gravar o chunk em disco");
+            return false;
+        }
+        total_written += written;
+    }
+
+    hash = updateChunkHash(hash, data, size);
+    bytes_written += size;
+    return true;
+}
+
+
+/**
+ * @brief Grava o chunk copiando os bytes de outro arquivo dentro do kernel.
+ */
+bool ChunkWriter::copyFrom(int source_fd, ByteCount size) {
+    if (fd < 0) {
+        return false;
+    }
+
+    off_t source_offset = 0;
+    bool use_sendfile = false;
+    while (static_cast<ByteCount>(source_offset) < size) {
+        size_t remaining = size - source_offset;
+        ssize_t copied = use_sendfile ? sendfile(fd, source_fd, &source_offset, remaining)
+                                      : copy_file_range(source_fd, &source_offset, fd, nullptr, remaining, 0);
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        // Sistemas de arquivos diferentes ou sem suporte ao copy_file_range: segue com sendfile
+        if (copied < 0 && !use_sendfile && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+            use_sendfile = true;
+            continue;
+        }
+        if (copied < 0) {
+            perror("Erro ao copiar o chunk em disco");
+            return false;
+        }
+        if (copied == 0) {
+            // Arquivo de origem menor que o tamanho informado
+            return false;
+        }
+        bytes_written += copied;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Confirma o chunk, renomeando o arquivo temporário para o caminho final.
+ */
+bool ChunkWriter::commit() {
+    if (fd < 0) {
+        return false;
+    }
+    closeFile();
+
+    if (rename(temporary_path.c_str(), path.c_str()) < 0) {
+        perror("Erro ao confirmar o chunk em disco");
+        unlink(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Descarta o chunk, removendo o arquivo temporário.
+ */
+void ChunkWriter::abort() {
+    if (fd >= 0) {
+        closeFile();
+        unlink(temporary_path.c_str());
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef CHUNKWRITER_H
+#define CHUNKWRITER_H
+
+#include "Utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * @brief Grava um chunk em disco à medida que seus bytes são recebidos.
+ *
+ * Os bytes são gravados em um arquivo temporário (caminho do chunk + ".partN", com N único no
+ * processo, assim duas cópias do mesmo chunk podem ser recebidas ao mesmo tempo) e o hash do
+ * chunk é atualizado a cada gravação. Somente ao ser confirmado (commit) o arquivo temporário
+ * é renomeado para o caminho final, assim um chunk incompleto ou corrompido nunca aparece como
+ * disponível. Se o ChunkWriter for destruído sem confirmação, o arquivo temporário é removido.
+ */
+class ChunkWriter {
+private:
+    std::string path;                   ///< Caminho final do chunk.
+    std::string temporary_path;         ///< Caminho do arquivo temporário em que os bytes são gravados.
+    int fd;                             ///< Descritor do arquivo temporário (-1 se não estiver aberto).
+    ByteCount bytes_written;            ///< Número de bytes gravados até o momento.
+    std::uint64_t hash;                 ///< Hash dos bytes gravados até o momento.
+
+    /**
+     * @brief Fecha o arquivo temporário, se estiver aberto.
+     */
+    void closeFile();
+
+public:
+    /**
+     * @brief Construtor da classe ChunkWriter. Cria o arquivo temporário do chunk.
+     *
+     * @param path Caminho final do chunk.
+     */
+    explicit ChunkWriter(const std::string& path);
+
+
+    /**
+     * @brief Destrutor da classe ChunkWriter. Remove o arquivo temporário se o chunk não foi confirmado.
+     */
+    ~ChunkWriter();
+
+    ChunkWriter(const ChunkWriter&) = delete;
+    ChunkWriter& operator=(const ChunkWriter&) = delete;
+
+
+    /**
+     * @brief Verifica se o arquivo temporário foi criado.
+     *
+     * @return true se o arquivo está aberto para gravação, false caso contrário.
+     */
+    bool isOpen() const { return fd >= 0; }
+
+
+    /**
+     * @brief Grava o próximo trecho do chunk e atualiza o hash.
+     *
+     * @param data Bytes a serem gravados.
+     * @param size Número de bytes.
+     * @return true se todos os bytes foram gravados, false caso contrário.
+     */
+    bool write(const char* data, std::size_t size);
+
+
+    /**
+     * @brief Grava o chunk copiando os bytes de outro arquivo dentro do kernel.
+     *
+     * Usa copy_file_range (ou sendfile, se o sistema de arquivos não suportar) a partir do início
+     * do descritor de origem, sem alterar o seu offset. Os bytes não passam pelo processo, então o
+     * hash não é atualizado.
+     *
+     * @param source_fd Descritor do arquivo de origem.
+     * @param size Número de bytes a copiar.
+     * @return true se todos os bytes foram copiados, false caso contrário.
+     */
+    bool copyFrom(int source_fd, ByteCount size);
+
+
+    /**
+     * @brief Retorna o número de bytes gravados até o momento.
+     */
+    ByteCount getBytesWritten() const { return bytes_written; }
+
+
+    /**
+     * @brief Retorna o hash dos bytes gravados até o momento (somente os gravados por write).
+     */
+    std::uint64_t getHash() const { return hash; }
+
+
+    /**
+     * @brief Confirma o chunk, renomeando o arquivo temporário para o caminho final.
+     *
+     * @return true se o chunk foi confirmado, false caso contrário.
+     */
+    bool commit();
+
+
+    /**
+     * @brief Descarta o chunk, removendo o arquivo temporário.
+     */
+    void abort();
+};
+
+#endif // CHUNKWRITER_H
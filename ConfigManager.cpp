@@ -1,130 +1,400 @@
 #include "ConfigManager.h"
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+    /**
+     * @brief Arquivo mapeado em memória, somente leitura. Desfaz o mapeamento na destruição.
+     */
+    class MappedFile {
+    private:
+        const char* data = nullptr;     ///< Início do conteúdo mapeado (nulo se o arquivo estiver vazio ou não puder ser lido).
+        std::size_t size = 0;           ///< Tamanho do arquivo em bytes.
+        bool opened = false;            ///< Indica se o arquivo foi aberto e mapeado.
+
+    public:
+        explicit MappedFile(const std::string& file_path) {
+            int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+
+            struct stat file_stat{};
+            if (fstat(fd, &file_stat) == 0) {
+                size = static_cast<std::size_t>(file_stat.st_size);
+                if (size == 0) {
+                    opened = true;
+                } else {
+                    void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (memory != MAP_FAILED) {
+                        madvise(memory, size, MADV_SEQUENTIAL);
+                        data = static_cast<const char*>(memory);
+                        opened = true;
+                    }
+                }
+            }
+            close(fd);
+        }
+
+        ~MappedFile() {
+            if (data != nullptr) {
+                munmap(const_cast<char*>(data), size);
+            }
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() const { return opened; }
+        std::string_view content() const { return data != nullptr ? std::string_view(data, size) : std::string_view(); }
+    };
+
+
+    /**
+     * @brief Leitor dos campos de uma linha, que registra a posição do primeiro erro encontrado.
+     */
+    class LineParser {
+    private:
+        const std::string& file_path;   ///< Arquivo lido, para as mensagens de erro.
+        std::size_t line_number;        ///< Número da linha (a partir de 1).
+        const char* line_begin;         ///< Início da linha.
+        const char* position;           ///< Posição atual.
+        const char* line_end;           ///< Fim da linha (sem o '\r' final).
+        bool failed = false;            ///< Indica que um erro já foi reportado nesta linha.
+
+    public:
+        LineParser(const std::string& file_path, std::size_t line_number, std::string_view line)
+            : file_path(file_path), line_number(line_number), line_begin(line.data()), position(line.data()), line_end(line.data() + line.size()) {}
+
+        /**
+         * @brief Reporta um erro na posição atual. Apenas o primeiro erro da linha é reportado.
+         */
+        bool fail(const std::string& message) {
+            if (!failed) {
+                failed = true;
+                logMessage(LogType::ERROR, "Erro em " + file_path + ", linha " + std::to_string(line_number) + ", coluna " +
+                           std::to_string(position - line_begin + 1) + ": " + message);
+            }
+            return false;
+        }
+
+        void skipSpaces() {
+            while (position < line_end && (*position == ' ' || *position == '\t')) {
+                position++;
+            }
+        }
+
+        bool atEnd() {
+            skipSpaces();
+            return position == line_end;
+        }
+
+        bool expect(char expected, const std::string& context) {
+            skipSpaces();
+            if (position == line_end || *position != expected) {
+                return fail(std::string("esperado '") + expected + "' " + context + ".");
+            }
+            position++;
+            return true;
+        }
+
+        template <typename T>
+        bool parseNumber(T& value, const std::string& field) {
+            skipSpaces();
+            auto [end, error] = std::from_chars(position, line_end, value);
+            if (error == std::errc::result_out_of_range) {
+                return fail(field + " fora do intervalo permitido.");
+            }
+            if (error != std::errc()) {
+                return fail("esperado " + field + ".");
+            }
+            position = end;
+            return true;
+        }
+
+        bool parseToken(std::string_view& token, const std::string& field) {
+            skipSpaces();
+            const char* token_begin = position;
+            while (position < line_end && *position != ',' && *position != ' ' && *position != '\t') {
+                position++;
+            }
+            if (position == token_begin) {
+                return fail("esperado " + field + ".");
+            }
+            token = std::string_view(token_begin, position - token_begin);
+            return true;
+        }
+    };
+
+
+    /**
+     * @brief Chama on_line para cada linha não vazia do arquivo, até o fim ou até on_line retornar false.
+     *
+     * @return false se o arquivo não pôde ser aberto ou se alguma linha falhou.
+     */
+    template <typename LineHandler>
+    bool forEachLine(const std::string& file_path, const std::string& description, LineHandler on_line) {
+        MappedFile file(file_path);
+        if (!file.isOpen()) {
+            logMessage(LogType::ERROR, "Erro ao abrir o arquivo de " + description + " (" + file_path + "): " + std::strerror(errno));
+            return false;
+        }
+
+        std::string_view content = file.content();
+        std::size_t line_number = 0;
+        while (!content.empty()) {
+            line_number++;
+            std::size_t newline = content.find('\n');
+            std::string_view line = content.substr(0, newline);
+            content.remove_prefix(newline == std::string_view::npos ? content.size() : newline + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+
+            LineParser parser(file_path, line_number, line);
+            if (parser.atEnd()) {
+                continue;
+            }
+            if (!on_line(parser, line_number)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    /**
+     * @brief Retorna a ordem crescente dos identificadores, ou reporta o primeiro identificador repetido.
+     *
+     * @return Posições das linhas em ordem crescente de identificador, ou vazio se houver repetição.
+     */
+    std::vector<std::size_t> sortById(const std::vector<int>& ids, const std::vector<std::size_t>& line_numbers, const std::string& file_path, bool& duplicated) {
+        std::vector<std::size_t> order(ids.size());
+        std::iota(order.begin(), order.end(), 0);
+        if (!std::is_sorted(ids.begin(), ids.end())) {
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return ids[a] < ids[b]; });
+        }
+
+        duplicated = false;
+        for (std::size_t i = 1; i < order.size(); ++i) {
+            if (ids[order[i]] == ids[order[i - 1]]) {
+                logMessage(LogType::ERROR, "Erro em " + file_path + ": peer " + std::to_string(ids[order[i]]) + " definido nas linhas " +
+                           std::to_string(line_numbers[order[i - 1]]) + " e " + std::to_string(line_numbers[order[i]]) + ".");
+                duplicated = true;
+                break;
+            }
+        }
+        return order;
+    }
+}
+
+
+/**
+ * @brief Retorna a posição de um peer nos arrays, ou size() se ele não existir.
+ */
+std::size_t PeerConfigTable::find(int peer_id) const {
+    auto it = std::lower_bound(peer_ids.begin(), peer_ids.end(), peer_id);
+    return it != peer_ids.end() && *it == peer_id ? static_cast<std::size_t>(it - peer_ids.begin()) : size();
+}
+
+
+/**
+ * @brief Retorna a posição de um peer, ou size() se ele não existir.
+ */
+std::size_t TopologyTable::find(int peer_id) const {
+    auto it = std::lower_bound(peer_ids.begin(), peer_ids.end(), peer_id);
+    return it != peer_ids.end() && *it == peer_id ? static_cast<std::size_t>(it - peer_ids.begin()) : size();
+}
 
 
 /**
  * @brief Carrega as configurações dos peers a partir do arquivo.
  */
-std::map<int, std::tuple<std::string, int, int>> ConfigManager::loadConfig() {
-    std::string file_path = Constants::CONFIG_PATH;
-    std::ifstream file(file_path); // Abre o arquivo para leitura
-    std::map<int, std::tuple<std::string, int, int>> config; // Mapa para armazenar as configurações
-
-    // Verifica se o arquivo foi aberto corretamente
-    if (!file.is_open()) {
-        logMessage(LogType::ERROR, "Erro ao abrir o arquivo de configuração.");
-        return config; // Retorna um mapa vazio em caso de erro
-    }
+PeerConfigTable ConfigManager::loadConfig(const std::string& file_path) {
+    // Campos na ordem do arquivo
+    PeerConfigTable parsed;
+    std::vector<std::size_t> line_numbers;
+    parsed.ip_offsets.push_back(0);
 
-    std::string line;
-    
-    // Lê cada linha do arquivo
-    while (std::getline(file, line)) {
-        std::stringstream ss(line); // Cria um fluxo de string para processamento
+    bool success = forEachLine(file_path, "configuração", [&](LineParser& parser, std::size_t line_number) {
         int peer_id;
-        char colon, comma2; // Variáveis para capturar ':' e ','
-        std::string ip;
+        std::string_view ip;
         int udp_port;
-        int speed;
-
-        // Lê o ID do peer e o caractere ':'
-        ss >> peer_id >> colon;
+        ByteCount speed;
 
-        // Captura o IP e ignora a vírgula
-        std::getline(ss, ip, ','); 
-        ip = trim(ip); // Remove espaços em branco do IP
+        if (!parser.parseNumber(peer_id, "o identificador do peer") ||
+            !parser.expect(':', "após o identificador do peer") ||
+            !parser.parseToken(ip, "o IP do peer") ||
+            !parser.expect(',', "após o IP") ||
+            !parser.parseNumber(udp_port, "a porta UDP") ||
+            !parser.expect(',', "após a porta UDP") ||
+            !parser.parseNumber(speed, "a velocidade de transferência")) {
+            return false;
+        }
+        if (!parser.atEnd()) {
+            return parser.fail("conteúdo inesperado após a velocidade de transferência.");
+        }
+        if (udp_port <= 0 || udp_port > 65535) {
+            return parser.fail("porta UDP " + std::to_string(udp_port) + " inválida.");
+        }
 
-        // Lê os campos restantes (udp_port e speed)
-        ss >> udp_port >> comma2 >> speed;
+        parsed.peer_ids.push_back(peer_id);
+        parsed.udp_ports.push_back(udp_port);
+        parsed.transfer_speeds.push_back(speed);
+        parsed.ip_text.append(ip);
+        parsed.ip_offsets.push_back(static_cast<std::uint32_t>(parsed.ip_text.size()));
+        line_numbers.push_back(line_number);
+        return true;
+    });
+    if (!success) {
+        return PeerConfigTable{};
+    }
 
-        // Armazena os dados no mapa
-        config[peer_id] = std::make_tuple(ip, udp_port, speed);
+    // Ordena pelos identificadores, para a busca binária de find
+    bool duplicated;
+    std::vector<std::size_t> order = sortById(parsed.peer_ids, line_numbers, file_path, duplicated);
+    if (duplicated) {
+        return PeerConfigTable{};
+    }
+    if (std::is_sorted(order.begin(), order.end())) {
+        return parsed;
     }
 
-    file.close(); // Fecha o arquivo após a leitura
-    return config; // Retorna o mapa de configurações
+    PeerConfigTable config;
+    config.peer_ids.reserve(order.size());
+    config.udp_ports.reserve(order.size());
+    config.transfer_speeds.reserve(order.size());
+    config.ip_offsets.reserve(order.size() + 1);
+    config.ip_text.reserve(parsed.ip_text.size());
+    config.ip_offsets.push_back(0);
+    for (const std::size_t index : order) {
+        config.peer_ids.push_back(parsed.peer_ids[index]);
+        config.udp_ports.push_back(parsed.udp_ports[index]);
+        config.transfer_speeds.push_back(parsed.transfer_speeds[index]);
+        config.ip_text.append(parsed.getIp(index));
+        config.ip_offsets.push_back(static_cast<std::uint32_t>(config.ip_text.size()));
+    }
+    return config;
 }
 
 
 /**
  * @brief Carrega a topologia da rede a partir do arquivo.
  */
-std::map<int, std::vector<int>> ConfigManager::loadTopology() {
-    std::string file_path = Constants::TOPOLOGY_PATH;
-    std::ifstream file(file_path); // Abre o arquivo para leitura
-    std::map<int, std::vector<int>> topology; // Mapa para armazenar a topologia
-
-    // Verifica se o arquivo foi aberto corretamente
-    if (!file.is_open()) {
-        logMessage(LogType::ERROR, "Erro ao abrir o arquivo de topologia.");
-        return topology; // Retorna um mapa vazio em caso de erro
+TopologyTable ConfigManager::loadTopology(const std::string& file_path) {
+    // Linhas na ordem do arquivo
+    TopologyTable parsed;
+    std::vector<std::size_t> line_numbers;
+    parsed.offsets.push_back(0);
+
+    bool success = forEachLine(file_path, "topologia", [&](LineParser& parser, std::size_t line_number) {
+        int peer_id;
+        if (!parser.parseNumber(peer_id, "o identificador do peer") || !parser.expect(':', "após o identificador do peer")) {
+            return false;
+        }
+
+        // Lista de vizinhos separados por vírgula (pode ser vazia)
+        if (!parser.atEnd()) {
+            while (true) {
+                int neighbor_id;
+                if (!parser.parseNumber(neighbor_id, "o identificador de um vizinho")) {
+                    return false;
+                }
+                parsed.neighbor_ids.push_back(neighbor_id);
+                if (parser.atEnd()) {
+                    break;
+                }
+                if (!parser.expect(',', "entre os vizinhos")) {
+                    return false;
+                }
+            }
+        }
+
+        parsed.peer_ids.push_back(peer_id);
+        parsed.offsets.push_back(parsed.neighbor_ids.size());
+        line_numbers.push_back(line_number);
+        return true;
+    });
+    if (!success) {
+        return TopologyTable{};
     }
 
-    std::string line;
+    // Ordena pelos identificadores, para a busca binária de find
+    bool duplicated;
+    std::vector<std::size_t> order = sortById(parsed.peer_ids, line_numbers, file_path, duplicated);
+    if (duplicated) {
+        return TopologyTable{};
+    }
+    if (std::is_sorted(order.begin(), order.end())) {
+        return parsed;
+    }
 
-    // Lê cada linha do arquivo
-    while (std::getline(file, line)) {
-        std::stringstream ss(line); // Cria um fluxo de string para processamento
-        int peer_id;
-        char colon; // Variável para capturar o caractere ':' no formato
-
-        // Lê o ID do peer e o caractere ':'
-        ss >> peer_id >> colon;
-
-        std::vector<int> neighbors; // Vetor para armazenar os vizinhos
-        std::string neighbor_list;
-        
-        // Lê a lista de vizinhos após o caractere ':'
-        std::getline(ss, neighbor_list);
-        std::stringstream ss_neighbors(neighbor_list); // Fluxo de string para processar os vizinhos
-        std::string neighbor;
-    
-        // Lê cada vizinho separado por vírgula
-        while (std::getline(ss_neighbors, neighbor, ',')) {
-            int neighbor_id = std::stoi(neighbor); // Converte o vizinho para inteiro
-            neighbors.push_back(neighbor_id); // Adiciona ao vetor de vizinhos
-        }
-
-        topology[peer_id] = neighbors; // Mapeia o peer aos seus vizinhos
+    TopologyTable topology;
+    topology.peer_ids.reserve(order.size());
+    topology.offsets.reserve(order.size() + 1);
+    topology.neighbor_ids.reserve(parsed.neighbor_ids.size());
+    topology.offsets.push_back(0);
+    for (const std::size_t index : order) {
+        auto neighbors = parsed.getNeighbors(index);
+        topology.peer_ids.push_back(parsed.peer_ids[index]);
+        topology.neighbor_ids.insert(topology.neighbor_ids.end(), neighbors.begin(), neighbors.end());
+        topology.offsets.push_back(topology.neighbor_ids.size());
     }
+    return topology;
+}
+
 
-    file.close(); // Fecha o arquivo após a leitura
-    return topology; // Retorna o mapa de topologia
+/**
+ * @brief Obtém o IP e a porta UDP dos vizinhos de um peer.
+ */
+std::vector<std::tuple<std::string, int>> ConfigManager::expandNeighbors(const TopologyTable& topology, const PeerConfigTable& config, int peer_id) {
+    std::vector<std::tuple<std::string, int>> detailed_neighbors;
+
+    std::size_t peer_index = topology.find(peer_id);
+    if (peer_index == topology.size()) {
+        return detailed_neighbors;
+    }
+
+    // Itera sobre os vizinhos deste peer
+    for (const int neighbor_id : topology.getNeighbors(peer_index)) {
+        // Verifica se o vizinho existe na configuração e extrai o seu IP e porta
+        std::size_t neighbor_index = config.find(neighbor_id);
+        if (neighbor_index != config.size()) {
+            detailed_neighbors.emplace_back(std::string(config.getIp(neighbor_index)), config.udp_ports[neighbor_index]);
+        }
+    }
+    return detailed_neighbors;
 }
 
 
 /**
- * @brief Expande a topologia com as informações detalhadas da configuração dos peers.
+ * @brief Seleciona os super-peers: os peers com velocidade de pelo menos Constants::SUPER_PEER_MIN_TRANSFER_SPEED.
  */
-std::map<int, std::vector<std::tuple<std::string, int>>> ConfigManager::expandTopology(
-    const std::map<int, std::vector<int>>& topology, 
-    const std::map<int, std::tuple<std::string, int, int>>& config) 
-{
-    // Mapa que armazenará a topologia expandida com apenas IP e porta UDP
-    std::map<int, std::vector<std::tuple<std::string, int>>> expanded_topology;
-    
-    // Itera sobre cada peer e seus vizinhos na topologia
-    for (const auto& [peer_id, neighbors] : topology) {
-        // Vetor que armazenará os detalhes dos vizinhos (IP, porta UDP)
-        std::vector<std::tuple<std::string, int>> detailed_neighbors;
-
-        // Itera sobre os vizinhos deste peer
-        for (const int& neighbor_id : neighbors) {
-            // Verifica se o vizinho existe na configuração
-            if (config.find(neighbor_id) != config.end()) {
-                // Extrai o IP e a porta do vizinho a partir da configuração
-                auto [neighbor_ip, neighbor_port, _] = config.at(neighbor_id);
-
-                // Adiciona os detalhes do vizinho (IP, porta UDP) ao vetor
-                detailed_neighbors.emplace_back(neighbor_ip, neighbor_port);
-            }
+std::vector<std::tuple<std::string, int>> ConfigManager::selectSuperPeers(const PeerConfigTable& config) {
+    std::vector<std::tuple<std::string, int>> super_peers;
+    if (Constants::SUPER_PEER_MIN_TRANSFER_SPEED == 0) {
+        return super_peers;
+    }
+
+    // Ordena pela velocidade (decrescente); a tabela já deixa os empates na ordem dos identificadores
+    std::vector<std::size_t> candidates;
+    for (std::size_t index = 0; index < config.size(); ++index) {
+        if (config.transfer_speeds[index] >= Constants::SUPER_PEER_MIN_TRANSFER_SPEED) {
+            candidates.push_back(index);
         }
-        // Associa a lista de vizinhos detalhados a este peer na topologia expandida
-        expanded_topology[peer_id] = detailed_neighbors;
     }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [&](std::size_t a, std::size_t b) { return config.transfer_speeds[a] > config.transfer_speeds[b]; });
 
-    // Retorna a topologia expandida com IP e porta
-    return expanded_topology;
+    for (const std::size_t index : candidates) {
+        super_peers.emplace_back(std::string(config.getIp(index)), config.udp_ports[index]);
+    }
+    return super_peers;
 }
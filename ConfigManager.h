@@ -2,58 +2,135 @@
 #define CONFIGMANAGER_H
 
 #include "Utils.h"
-#include <map>
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
 
+/**
+ * @brief Configuração de todos os peers (config.txt), em arrays paralelos ordenados pelo identificador.
+ *
+ * Os IPs ficam concatenados em um único buffer (ip_text), delimitados por ip_offsets, para que um
+ * arquivo com milhões de peers não gere uma alocação por linha.
+ */
+struct PeerConfigTable {
+    std::vector<int> peer_ids;                  ///< Identificadores dos peers, em ordem crescente.
+    std::vector<int> udp_ports;                 ///< Porta UDP de cada peer.
+    std::vector<ByteCount> transfer_speeds;     ///< Velocidade de transferência em bytes/segundo de cada peer.
+    std::vector<std::uint32_t> ip_offsets;      ///< Início do IP de cada peer em ip_text, com uma posição extra para o final do último.
+    std::string ip_text;                        ///< IPs de todos os peers, concatenados.
+
+    /**
+     * @brief Retorna o número de peers.
+     */
+    std::size_t size() const { return peer_ids.size(); }
+
+    /**
+     * @brief Retorna a posição de um peer nos arrays, ou size() se ele não existir.
+     */
+    std::size_t find(int peer_id) const;
+
+    /**
+     * @brief Retorna o IP do peer na posição index.
+     */
+    std::string_view getIp(std::size_t index) const {
+        return std::string_view(ip_text).substr(ip_offsets[index], ip_offsets[index + 1] - ip_offsets[index]);
+    }
+};
+
+
+/**
+ * @brief Topologia da rede (topologia.txt) em formato CSR (compressed sparse row).
+ *
+ * Os vizinhos do peer na posição i de peer_ids são neighbor_ids[offsets[i]] até
+ * neighbor_ids[offsets[i + 1] - 1].
+ */
+struct TopologyTable {
+    std::vector<int> peer_ids;                  ///< Identificadores dos peers, em ordem crescente.
+    std::vector<std::size_t> offsets;           ///< Início da lista de vizinhos de cada peer, com uma posição extra para o final da última.
+    std::vector<int> neighbor_ids;              ///< Listas de vizinhos de todos os peers, concatenadas.
+
+    /**
+     * @brief Retorna o número de peers.
+     */
+    std::size_t size() const { return peer_ids.size(); }
+
+    /**
+     * @brief Retorna a posição de um peer, ou size() se ele não existir.
+     */
+    std::size_t find(int peer_id) const;
+
+    /**
+     * @brief Retorna os vizinhos do peer na posição index.
+     */
+    std::span<const int> getNeighbors(std::size_t index) const {
+        return std::span<const int>(neighbor_ids).subspan(offsets[index], offsets[index + 1] - offsets[index]);
+    }
+};
+
+
 /**
  * @brief Classe responsável por carregar as informações dos arquivos topologia.txt e config.txt.
- * 
+ *
  * Esta classe fornece métodos estáticos para carregar as configurações dos peers e a topologia
  * da rede a partir de arquivos. As configurações incluem informações como IP, porta UDP e
  * velocidade de transferência em bytes/segundo para cada peer, enquanto a topologia fornece
  * informações sobre a sua vizinhança.
+ *
+ * Os arquivos são mapeados em memória (mmap) e lidos sem cópias, com std::from_chars, para
+ * suportar redes com milhões de peers. Uma linha mal formada interrompe a leitura com uma
+ * mensagem indicando o arquivo, a linha, a coluna e o campo esperado.
  */
 class ConfigManager {
 public:
     /**
      * @brief Carrega as configurações dos peers a partir do arquivo.
-     * 
-     * Este método lê um arquivo de configuração e retorna um mapa onde cada chave é o identificador 
-     * de um peer e o valor é uma tupla contendo o IP, porta UDP e velocidade de transferência em bytes/segundo desse peer.
-     * 
-     * @return Mapa com as configurações de cada peer.
+     *
+     * Cada linha tem o formato "<id>: <ip>, <porta UDP>, <velocidade>". Linhas em branco são ignoradas.
+     *
+     * @param file_path Caminho do arquivo de configuração.
+     * @return Configuração de cada peer, ou uma tabela vazia se o arquivo não puder ser lido ou tiver erros.
      */
-    static std::map<int, std::tuple<std::string, int, int>> loadConfig();
+    static PeerConfigTable loadConfig(const std::string& file_path = Constants::CONFIG_PATH);
 
 
     /**
      * @brief Carrega a topologia da rede a partir do arquivo.
-     * 
-     * Este método lê um arquivo de topologia e constrói um mapa onde cada chave é o identificador 
-     * de um peer e o valor é um vetor contendo os identificadores dos seus vizinhos.
-     * 
-     * @return Mapa com a topologia (vizinhos de cada peer).
-     */
-    static std::map<int, std::vector<int>> loadTopology();
-
-
-    /**
-     * @brief Expande a topologia com as informações detalhadas da configuração dos peers.
-     * 
-     * Este método combina a topologia da rede com as informações de configuração de cada peer, 
-     * criando um mapa que associa cada peer a uma lista de tuplas, onde cada tupla contém o IP 
-     * e a porta de comunicação UDP dos seus vizinhos.
-     * 
-     * @param topology Mapa da topologia da rede.
-     * @param config Mapa de configuração dos peers (IP, porta UDP, velocidade em bytes/segundo).
-     * @return Topologia detalhada com as informações dos peers.
-     */
-    static std::map<int, std::vector<std::tuple<std::string, int>>> expandTopology(
-        const std::map<int, std::vector<int>>& topology, 
-        const std::map<int, std::tuple<std::string, int, int>>& config
-    );
+     *
+     * Cada linha tem o formato "<id>: <vizinho>, <vizinho>, ...". A lista de vizinhos pode ser vazia.
+     *
+     * @param file_path Caminho do arquivo de topologia.
+     * @return Topologia (vizinhos de cada peer), ou uma tabela vazia se o arquivo não puder ser lido ou tiver erros.
+     */
+    static TopologyTable loadTopology(const std::string& file_path = Constants::TOPOLOGY_PATH);
+
+
+    /**
+     * @brief Obtém o IP e a porta UDP dos vizinhos de um peer.
+     *
+     * Vizinhos ausentes da configuração são ignorados.
+     *
+     * @param topology Topologia da rede.
+     * @param config Configuração dos peers (IP, porta UDP, velocidade em bytes/segundo).
+     * @param peer_id Identificador do peer.
+     * @return Endereços (IP, porta UDP) dos vizinhos do peer. Vazio se o peer não estiver na topologia.
+     */
+    static std::vector<std::tuple<std::string, int>> expandNeighbors(const TopologyTable& topology, const PeerConfigTable& config, int peer_id);
+
+
+    /**
+     * @brief Seleciona os super-peers: os peers com velocidade de pelo menos Constants::SUPER_PEER_MIN_TRANSFER_SPEED.
+     *
+     * Todos os peers leem o mesmo config.txt, assim todos chegam aos mesmos super-peers sem
+     * trocar mensagens.
+     *
+     * @param config Configuração dos peers (IP, porta UDP, velocidade em bytes/segundo).
+     * @return Endereços (IP, porta UDP) dos super-peers, do mais rápido para o mais lento. Vazio se os super-peers estiverem desativados.
+     */
+    static std::vector<std::tuple<std::string, int>> selectSuperPeers(const PeerConfigTable& config);
 };
 
 #endif // CONFIGMANAGER_H
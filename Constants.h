@@ -1,6 +1,8 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 
@@ -9,6 +11,8 @@ namespace Constants {
     const std::string BASE_PATH = "./src/";                         ///< Caminho base onde os arquivos do projeto estão armazenados.
     const std::string CONFIG_PATH = BASE_PATH + "config.txt";       ///< Caminho para o arquivo de configuração.
     const std::string TOPOLOGY_PATH = BASE_PATH + "topologia.txt";  ///< Caminho para o arquivo de topologia.
+    const std::string LOCAL_SOCKET_FALLBACK_DIR = "/tmp/p2p-";      ///< Pasta dos Unix domain sockets quando XDG_RUNTIME_DIR não está definido (completada com o uid do usuário).
+    const std::string LOCAL_SOCKET_NAME_PREFIX = "p2p-peer-";       ///< Prefixo do nome do Unix domain socket de cada peer (completado com o IP e a porta TCP).
 
     // Cores para log
     const std::string RESET   = "\033[0m";                          ///< Resetar a cor do texto para branco.
@@ -32,6 +36,120 @@ namespace Constants {
     const int WAIT_TIME_FOR_PORTS_RELEASE_SECONDS= 5;               ///< Tempo de espera em segundos para esperar liberação das portas TCP e UDP.
     const int CONTROL_MESSAGE_MAX_SIZE           = 1024;            ///< Tamanho máximo da mensagem de controle.
     const int TCP_MAX_PENDING_CONNECTIONS        = 10;              ///< Número máximo de conexões pendentes na fila de escuta TCP.
+    const int UDP_RECEIVER_SHARDS                = 1;               ///< Número de sockets UDP (SO_REUSEPORT) na mesma porta, cada um com sua thread, que recebe e processa as mensagens. 0 usa um por núcleo.
+    const bool UDP_RECEIVER_PIN_TO_CORE          = true;            ///< Fixa cada thread de recebimento UDP em um núcleo quando há mais de um socket.
+
+    // Runtime de corrotinas e pool de threads
+    const int EXECUTOR_THREADS                   = 0;               ///< Número de threads do pool compartilhado por rede, disco e agendamento. 0 usa uma por núcleo.
+    const int EXECUTOR_METRICS_INTERVAL_SECONDS  = 30;              ///< Intervalo em segundos entre os logs de utilização do pool. 0 desativa os logs.
+    const int ASYNC_MAX_EVENTS_PER_WAIT          = 64;              ///< Número máximo de eventos tratados por chamada ao epoll_wait.
+
+    // Recebimento de chunks em streaming
+    const std::size_t CHUNK_STREAM_WINDOW_SIZE   = 1024 * 1024;     ///< Tamanho da janela em memória: os bytes recebidos são gravados em disco a cada janela completa.
+    const int CHUNK_HASH_TRAILER_SIZE            = 16;              ///< Tamanho do hash (hexadecimal) enviado logo após os bytes de cada chunk.
+    const std::uint64_t CHUNK_HASH_INITIAL_VALUE = 14695981039346656037ULL; ///< Valor inicial do hash FNV-1a dos chunks.
+
+    // Download sequencial
+    const std::int64_t SEQUENTIAL_WINDOW_CHUNKS  = 4;               ///< Número máximo de chunks pedidos ao mesmo tempo no download sequencial, a partir do primeiro que falta.
+    const int SEQUENTIAL_REQUEST_TIMEOUT_SECONDS = 30;              ///< Tempo em segundos até um chunk pedido e não recebido ser pedido novamente.
+    const int SEQUENTIAL_POLL_INTERVAL_MS        = 200;             ///< Intervalo em milissegundos entre as verificações da janela do download sequencial.
+    const int SEQUENTIAL_SOURCE_WAIT_SECONDS     = 120;             ///< Tempo em segundos que o download sequencial espera por uma fonte (anunciada por HAVE) para o primeiro chunk que falta antes de desistir.
+    const int RANGE_READ_RECHECK_INTERVAL_MS     = 1000;            ///< Intervalo máximo em milissegundos entre as verificações de uma leitura que espera um chunk. A espera termina antes quando um chunk é salvo.
+
+    // Anúncios de disponibilidade (HAVE)
+    const int HAVE_ANNOUNCE_INTERVAL_MS          = 1000;            ///< Intervalo em milissegundos entre os envios de HAVE. Os chunks novos do intervalo vão juntos.
+    const int HAVE_INTEREST_TTL_SECONDS          = 120;             ///< Tempo em segundos que um peer que enviou DISCOVERY continua recebendo HAVE do arquivo.
+    const std::size_t HAVE_MAX_INTERESTED_PEERS  = 32;              ///< Número máximo de peers interessados por arquivo (os mais antigos são descartados).
+    const std::size_t HAVE_MAX_CHUNKS_PER_INTERVAL = 256;           ///< Número máximo de chunks anunciados por intervalo. O excedente fica para o próximo.
+
+    // DHT (Kademlia)
+    const std::size_t DHT_BUCKET_SIZE            = 8;               ///< Número máximo de contatos por k-bucket (k), também o número de nós que guardam cada registro de provedor.
+    const std::size_t DHT_LOOKUP_PARALLELISM     = 3;               ///< Número de consultas enviadas em paralelo em cada rodada de uma busca (alfa).
+    const int DHT_RPC_TIMEOUT_MS                 = 500;             ///< Tempo máximo em milissegundos de espera pelas respostas de uma rodada.
+    const int DHT_MAX_LOOKUP_ROUNDS              = 10;              ///< Número máximo de rodadas de uma busca.
+    const int DHT_CONTACT_STALE_SECONDS          = 60;              ///< Tempo sem mensagens após o qual um contato pode ser substituído em um k-bucket cheio.
+    const int DHT_PROVIDER_TTL_SECONDS           = 180;             ///< Validade em segundos de um registro de provedor.
+    const int DHT_REFRESH_INTERVAL_SECONDS       = 60;              ///< Intervalo em segundos entre as buscas do próprio identificador, que preenchem a tabela de roteamento (a primeira é a entrada na DHT).
+    const int DHT_REPUBLISH_INTERVAL_SECONDS     = 60;              ///< Intervalo em segundos entre as republicações dos registros de provedor.
+    const int DHT_PUBLISH_CHECK_INTERVAL_SECONDS = 2;               ///< Intervalo em segundos entre as verificações de arquivos novos a serem publicados.
+    const std::size_t DHT_MAX_PROVIDERS_PER_REPLY = 16;             ///< Número máximo de provedores em uma resposta.
+
+    // Roteamento por filtros de Bloom atenuados
+    const bool BLOOM_ROUTING_ENABLED             = false;           ///< Encaminha DISCOVERY apenas aos vizinhos cujo filtro indica o arquivo ao alcance do TTL (além do horizonte dos filtros, a todos, esses primeiro).
+    const int BLOOM_FILTER_DEPTH                 = 3;               ///< Número de níveis (saltos) resumidos em cada filtro.
+    const std::size_t BLOOM_FILTER_BITS          = 1024;            ///< Bits por nível (múltiplo de 64). A mensagem BLOOM precisa caber em CONTROL_MESSAGE_MAX_SIZE.
+    const int BLOOM_FILTER_HASHES                = 3;               ///< Número de bits marcados por arquivo em cada nível.
+    const int BLOOM_EXCHANGE_INTERVAL_SECONDS    = 2;               ///< Intervalo em segundos entre os envios dos filtros aos vizinhos.
+    const int BLOOM_FILTER_TTL_SECONDS           = 30;              ///< Tempo em segundos após o qual o filtro de um vizinho que parou de enviá-lo é ignorado.
+
+    // Busca por passeios aleatórios (random walk)
+    const int WALK_WALKERS                       = 4;               ///< Número de passeios (walkers) iniciados em cada busca. Mais walkers reduzem a latência e aumentam o número de mensagens.
+    const int WALK_MAX_HOPS                      = 64;              ///< Número máximo de peers visitados por um walker.
+    const int WALK_CHECK_INTERVAL_HOPS           = 4;               ///< A cada quantos saltos o walker pergunta à origem se a busca continua.
+
+    // Super-peers
+    const std::uint64_t SUPER_PEER_MIN_TRANSFER_SPEED = 0;          ///< Velocidade mínima (bytes/segundo em config.txt) para um peer ser super-peer. 0 desativa os super-peers.
+    const int SUPER_PEER_REGISTER_INTERVAL_SECONDS = 3;             ///< Intervalo em segundos entre os registros dos chunks de cada folha no seu super-peer.
+    const int SUPER_PEER_REGISTRATION_TTL_SECONDS = 10;             ///< Tempo em segundos após o qual o registro de uma folha que parou de renová-lo é descartado.
+
+    // Cache de respostas nos peers intermediários
+    const bool RESPONSE_CACHE_ENABLED            = false;           ///< Guarda as respostas vistas e responde pelo cache a DISCOVERY de arquivos populares, sem repassá-las.
+    const int RESPONSE_CACHE_TTL_SECONDS         = 30;              ///< Validade em segundos de uma resposta guardada no cache.
+    const std::size_t RESPONSE_CACHE_MAX_FILES   = 256;             ///< Número máximo de arquivos no cache (os que expiram primeiro são descartados).
+    const std::size_t RESPONSE_CACHE_MAX_HOLDERS_PER_FILE = 32;     ///< Número máximo de peers guardados por arquivo no cache.
+
+    // Respostas pelo caminho inverso
+    const bool REVERSE_PATH_RESPONSES            = false;           ///< Envia as respostas de volta pelo caminho da DISCOVERY, agregadas a cada salto (AGGREGATE), em vez de direto ao solicitante.
+    const int REVERSE_PATH_FLUSH_INTERVAL_MS     = 250;             ///< Intervalo em milissegundos entre os envios do resumo agregado de cada busca ao salto anterior.
+    const int REVERSE_PATH_ROUTE_TTL_SECONDS     = 15;              ///< Tempo em segundos que um peer guarda o salto anterior de uma busca.
+
+    // Agrupamento de buscas simultâneas
+    const bool QUERY_COALESCING_ENABLED          = false;           ///< Agrupa buscas do mesmo arquivo em andamento, para que uma única inundação atenda a todas.
+    const int QUERY_COALESCING_WINDOW_SECONDS    = 10;              ///< Tempo em segundos que uma busca fica na tabela de buscas em andamento.
+    const int QUERY_RESEND_INTERVAL_MS           = 2 * DISCOVERY_MESSAGE_INTERVAL_SECONDS * 1000; ///< Cópias do mesmo solicitante que chegam até este tempo após a anterior são da mesma inundação (espaçada por DISCOVERY_MESSAGE_INTERVAL_SECONDS) e são descartadas. Depois de um silêncio maior, são novas tentativas.
+    const int QUERY_TABLE_SWEEP_INTERVAL_MS      = 1000;            ///< Intervalo mínimo em milissegundos entre as remoções das buscas expiradas da tabela de buscas em andamento.
+
+    // Qualidade dos peers (RTT e vazão medidos)
+    const int PEER_QUALITY_PROBE_INTERVAL_SECONDS = 5;              ///< Intervalo em segundos entre as rodadas de sondas de RTT (PING) aos peers conhecidos.
+    const double PEER_QUALITY_EWMA_WEIGHT        = 0.25;            ///< Peso de cada nova medida nas médias móveis do RTT e da vazão.
+    const double PEER_QUALITY_RTT_REFERENCE_MS   = 50.0;            ///< RTT em milissegundos que reduz à metade a velocidade efetiva de um peer na seleção.
+    const int PEER_QUALITY_MAX_LOST_PROBES       = 3;               ///< Sondas consecutivas sem resposta após as quais o peer só é escolhido se não houver outro.
+    const int PEER_QUALITY_FORGET_SECONDS        = 300;             ///< Tempo em segundos sem notícias de um peer após o qual ele sai da tabela.
+    const std::size_t PEER_QUALITY_MAX_PEERS     = 1024;            ///< Número máximo de peers na tabela de qualidade.
+
+    // Manutenção da vizinhança (troca de vizinhos, PEX)
+    const bool OVERLAY_MAINTENANCE_ENABLED       = false;           ///< Troca listas de vizinhos (PEX) e adiciona ou descarta vizinhos em execução.
+    const int OVERLAY_MAINTENANCE_INTERVAL_SECONDS = 5;             ///< Intervalo em segundos entre as rodadas de manutenção: envio do PEX e ajuste dos vizinhos.
+    const std::size_t OVERLAY_TARGET_DEGREE      = 3;               ///< Número de vizinhos que cada peer procura manter.
+    const std::size_t OVERLAY_MAX_DEGREE         = 6;               ///< Número máximo de vizinhos. Pedidos de novos vizinhos acima dele são recusados.
+    const std::size_t OVERLAY_PEX_MAX_PEERS      = 16;              ///< Número máximo de vizinhos anunciados em cada mensagem PEX.
+    const std::size_t OVERLAY_MAX_CANDIDATES     = 64;              ///< Número máximo de candidatos a vizinho guardados.
+    const int OVERLAY_CANDIDATE_TTL_SECONDS      = 60;              ///< Tempo em segundos que um candidato anunciado por PEX é mantido.
+    const int OVERLAY_DEAD_NEIGHBOR_PROBES       = 6;               ///< Sondas de RTT seguidas sem resposta após as quais um vizinho é descartado.
+    const double OVERLAY_REPLACE_RTT_RATIO       = 0.5;             ///< Um candidato substitui o vizinho adicionado mais lento se o seu RTT for menor que esta fração do RTT dele.
+    const double OVERLAY_REPLACE_MIN_GAIN_MS     = 5.0;             ///< Redução mínima de RTT, em milissegundos, para uma troca de vizinho (evita trocas pelo ruído da medida).
+
+    // Descoberta por multicast na rede local
+    const bool MULTICAST_DISCOVERY_ENABLED       = false;           ///< Antes de buscar pelos vizinhos, envia a busca em um único datagrama ao grupo multicast da rede local.
+    const std::string MULTICAST_GROUP            = "239.255.80.80"; ///< Grupo multicast (escopo local) das buscas.
+    const int MULTICAST_PORT                     = 5999;            ///< Porta UDP do grupo, compartilhada por todos os peers do host.
+    const int MULTICAST_HOPS                     = 1;               ///< TTL IP das buscas: 1 as mantém no segmento local.
+    const int MULTICAST_RESPONSE_MAX_BACKOFF_MS  = 300;             ///< Atraso aleatório máximo, em milissegundos, antes de responder a uma busca do grupo.
+    const int MULTICAST_WAIT_MS                  = 500;             ///< Tempo em milissegundos que o solicitante espera as respostas do grupo antes de buscar pelos vizinhos.
+
+    // Pool de buffers
+    const std::size_t BUFFER_POOL_MIN_CLASS_SIZE          = 1024;                 ///< Capacidade da menor classe de tamanho do pool de buffers.
+    const std::size_t BUFFER_POOL_MAX_CLASS_SIZE          = 64 * 1024 * 1024;     ///< Capacidade da maior classe. Buffers maiores são mapeados e liberados a cada uso.
+    const std::size_t BUFFER_POOL_SLAB_SIZE               = 256 * 1024;           ///< Tamanho dos slabs recortados para as classes menores que ele.
+    const std::size_t BUFFER_POOL_HUGEPAGE_CLASS_SIZE     = 2 * 1024 * 1024;      ///< Capacidade a partir da qual as classes usam huge pages (tamanho de uma huge page).
+    const std::size_t BUFFER_POOL_MAX_CACHED_BYTES_PER_CLASS = 64 * 1024 * 1024;  ///< Máximo de bytes mantidos livres, por nó NUMA, em cada classe acima do slab.
+
+    // Recarga da configuração em execução
+    const bool CONFIG_HOT_RELOAD_ENABLED         = true;            ///< Observa config.txt e topologia.txt (inotify) e aplica as mudanças de velocidade e de vizinhos sem reiniciar o peer. Sem alterações nos arquivos, o peer se comporta como sem ele.
+    const int CONFIG_RELOAD_DEBOUNCE_MS          = 200;             ///< Tempo em milissegundos sem novas alterações nos arquivos antes de recarregá-los (um editor pode gravar em várias etapas).
+
+    // Transporte local
+    const bool LOCAL_TRANSPORT_ENABLED           = false;           ///< Transfere chunks via Unix domain socket (passando o descritor do chunk) quando o destino está no mesmo host.
 }
 
 #endif // CONSTANTS_H
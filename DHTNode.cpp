@@ -0,0 +1,181 @@
+#include "DHTNode.h"
+#include "Constants.h"
+#include <algorithm>
+#include <bit>
+
+
+/**
+ * @brief Construtor da classe DHTNode.
+ */
+DHTNode::DHTNode(const std::string& ip, int port) : self_id(nodeIdFor(ip, port)), buckets(64), next_rpc_id(1) {}
+
+
+/**
+ * @brief Calcula o identificador de um peer a partir do seu endereço UDP.
+ */
+std::uint64_t DHTNode::nodeIdFor(const std::string& ip, int port) {
+    std::string address = ip + ":" + std::to_string(port);
+    return updateChunkHash(Constants::CHUNK_HASH_INITIAL_VALUE, address.data(), address.size());
+}
+
+
+/**
+ * @brief Calcula a chave de um arquivo na DHT a partir do seu nome.
+ */
+std::uint64_t DHTNode::keyFor(const std::string& file_name) {
+    return updateChunkHash(Constants::CHUNK_HASH_INITIAL_VALUE, file_name.data(), file_name.size());
+}
+
+
+/**
+ * @brief Retorna o índice do k-bucket de um identificador.
+ */
+int DHTNode::getBucketIndex(std::uint64_t id) const {
+    std::uint64_t distance = id ^ self_id;
+    return distance == 0 ? -1 : 63 - std::countl_zero(distance);
+}
+
+
+/**
+ * @brief Registra (ou renova) um contato na tabela de roteamento.
+ */
+void DHTNode::addContact(const std::string& ip, int port) {
+    std::uint64_t id = nodeIdFor(ip, port);
+    int bucket_index = getBucketIndex(id);
+    if (bucket_index < 0) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> node_lock(mutex);
+    auto& bucket = buckets[bucket_index];
+
+    // Contato conhecido: vai para o fim do bucket (mais recente)
+    auto it = std::find_if(bucket.begin(), bucket.end(), [&](const DHTContact& contact) { return contact.id == id; });
+    if (it != bucket.end()) {
+        DHTContact contact = *it;
+        contact.last_seen = now;
+        bucket.erase(it);
+        bucket.push_back(contact);
+        return;
+    }
+
+    // Bucket cheio: só substitui o contato mais antigo se ele não dá sinal de vida há algum tempo
+    if (bucket.size() >= Constants::DHT_BUCKET_SIZE) {
+        if (now - bucket.front().last_seen < std::chrono::seconds(Constants::DHT_CONTACT_STALE_SECONDS)) {
+            return;
+        }
+        bucket.erase(bucket.begin());
+    }
+    bucket.push_back(DHTContact{id, ip, port, now});
+}
+
+
+/**
+ * @brief Retorna os contatos conhecidos mais próximos de uma chave (distância XOR).
+ */
+std::vector<DHTContact> DHTNode::getClosestContacts(std::uint64_t target, std::size_t count) {
+    std::vector<DHTContact> contacts;
+    {
+        std::lock_guard<std::mutex> node_lock(mutex);
+        for (const auto& bucket : buckets) {
+            contacts.insert(contacts.end(), bucket.begin(), bucket.end());
+        }
+    }
+
+    std::size_t result_size = std::min(count, contacts.size());
+    std::partial_sort(contacts.begin(), contacts.begin() + result_size, contacts.end(),
+        [target](const DHTContact& a, const DHTContact& b) {
+            return (a.id ^ target) < (b.id ^ target);
+        });
+    contacts.resize(result_size);
+    return contacts;
+}
+
+
+/**
+ * @brief Guarda um registro de provedor, válido por Constants::DHT_PROVIDER_TTL_SECONDS.
+ */
+void DHTNode::addProvider(std::uint64_t key, const std::string& ip, int port) {
+    std::uint64_t id = nodeIdFor(ip, port);
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> node_lock(mutex);
+    auto& key_providers = providers[key];
+    auto it = std::find_if(key_providers.begin(), key_providers.end(), [&](const DHTContact& provider) { return provider.id == id; });
+    if (it != key_providers.end()) {
+        it->last_seen = now;
+    } else {
+        key_providers.push_back(DHTContact{id, ip, port, now});
+    }
+}
+
+
+/**
+ * @brief Retorna os provedores válidos de uma chave, descartando os expirados.
+ */
+std::vector<DHTContact> DHTNode::getProviders(std::uint64_t key) {
+    auto oldest_valid = std::chrono::steady_clock::now() - std::chrono::seconds(Constants::DHT_PROVIDER_TTL_SECONDS);
+
+    std::lock_guard<std::mutex> node_lock(mutex);
+    auto it = providers.find(key);
+    if (it == providers.end()) {
+        return {};
+    }
+
+    std::erase_if(it->second, [&](const DHTContact& provider) { return provider.last_seen < oldest_valid; });
+    if (it->second.empty()) {
+        providers.erase(it);
+        return {};
+    }
+
+    // Os registros mais recentes primeiro
+    std::vector<DHTContact> result(it->second.rbegin(), it->second.rend());
+    result.resize(std::min(result.size(), Constants::DHT_MAX_PROVIDERS_PER_REPLY));
+    return result;
+}
+
+
+/**
+ * @brief Reserva um identificador para uma consulta de uma rodada de busca.
+ */
+std::uint64_t DHTNode::registerRpc(const std::shared_ptr<DHTLookupRound>& round) {
+    std::lock_guard<std::mutex> node_lock(mutex);
+    std::uint64_t rpc_id = next_rpc_id++;
+    pending_rpcs[rpc_id] = round;
+    round->pending++;
+    return rpc_id;
+}
+
+
+/**
+ * @brief Entrega a resposta de uma consulta à sua rodada.
+ */
+bool DHTNode::completeRpc(std::uint64_t rpc_id, DHTReply reply) {
+    std::lock_guard<std::mutex> node_lock(mutex);
+    auto it = pending_rpcs.find(rpc_id);
+    if (it == pending_rpcs.end()) {
+        return false;
+    }
+
+    std::shared_ptr<DHTLookupRound> round = it->second;
+    pending_rpcs.erase(it);
+    round->replies.push_back(std::move(reply));
+
+    // Última resposta da rodada: acorda a busca antes do fim do tempo limite
+    if (--round->pending == 0) {
+        round->all_replied.cancel();
+    }
+    return true;
+}
+
+
+/**
+ * @brief Descarta as consultas de uma rodada encerrada (respondidas ou não).
+ */
+void DHTNode::releaseRpcs(const std::vector<std::uint64_t>& rpc_ids) {
+    std::lock_guard<std::mutex> node_lock(mutex);
+    for (std::uint64_t rpc_id : rpc_ids) {
+        pending_rpcs.erase(rpc_id);
+    }
+}
@@ -0,0 +1,172 @@
+#ifndef DHTNODE_H
+#define DHTNODE_H
+
+#include "AsyncRuntime.h"
+#include "Utils.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Contato da DHT: um peer e seu identificador.
+ *
+ * O identificador é derivado do endereço UDP do peer (ver DHTNode::nodeIdFor), assim qualquer
+ * peer pode calculá-lo a partir do endereço de origem de uma mensagem.
+ */
+struct DHTContact {
+    std::uint64_t id;                                   ///< Identificador de 64 bits do peer.
+    std::string ip;                                     ///< Endereço IP do peer.
+    int port;                                           ///< Porta UDP do peer.
+    std::chrono::steady_clock::time_point last_seen;    ///< Última vez que o peer enviou uma mensagem (ou foi cadastrado).
+};
+
+
+/**
+ * @brief Resposta a uma consulta FIND_NODE ou FIND_PROVIDERS.
+ */
+struct DHTReply {
+    std::vector<DHTContact> providers;                  ///< Peers que possuem chunks do arquivo consultado (vazio em FIND_NODE).
+    std::vector<DHTContact> nodes;                      ///< Contatos mais próximos da chave conhecidos por quem respondeu.
+};
+
+
+/**
+ * @brief Rodada de uma busca iterativa: as consultas enviadas em paralelo e suas respostas.
+ *
+ * A corrotina da busca espera com um timer cancelado pelo token, que é cancelado quando a
+ * última resposta esperada chega.
+ */
+struct DHTLookupRound {
+    CancellationToken all_replied;                      ///< Cancelado quando todas as respostas chegaram.
+    std::size_t pending = 0;                            ///< Número de respostas que ainda faltam.
+    std::vector<DHTReply> replies;                      ///< Respostas recebidas.
+};
+
+
+/**
+ * @brief Estado local de um nó da DHT no estilo Kademlia.
+ *
+ * Guarda a tabela de roteamento (um k-bucket por bit de distância XOR, com até
+ * Constants::DHT_BUCKET_SIZE contatos cada), os registros de provedores (chave do arquivo ->
+ * peers que possuem chunks dele) e as rodadas de busca em andamento. Não envia mensagens: o
+ * transporte e as buscas iterativas ficam no UDPServer.
+ */
+class DHTNode {
+private:
+    const std::uint64_t self_id;                                            ///< Identificador deste peer.
+    std::vector<std::vector<DHTContact>> buckets;                           ///< k-buckets indexados pelo bit mais significativo da distância.
+    std::unordered_map<std::uint64_t, std::vector<DHTContact>> providers;   ///< Provedores de cada chave. last_seen guarda a última publicação do registro.
+    std::unordered_map<std::uint64_t, std::shared_ptr<DHTLookupRound>> pending_rpcs; ///< Rodada de cada consulta enviada, pelo identificador da consulta.
+    std::uint64_t next_rpc_id;                                              ///< Próximo identificador de consulta.
+    std::mutex mutex;                                                       ///< Mutex que protege todo o estado do nó.
+
+    /**
+     * @brief Retorna o índice do k-bucket de um identificador.
+     *
+     * @param id Identificador do contato.
+     * @return Índice do bit mais significativo da distância, ou -1 para o próprio peer.
+     */
+    int getBucketIndex(std::uint64_t id) const;
+
+public:
+    /**
+     * @brief Construtor da classe DHTNode.
+     *
+     * @param ip Endereço IP deste peer.
+     * @param port Porta UDP deste peer.
+     */
+    DHTNode(const std::string& ip, int port);
+
+
+    /**
+     * @brief Calcula o identificador de um peer a partir do seu endereço UDP.
+     */
+    static std::uint64_t nodeIdFor(const std::string& ip, int port);
+
+
+    /**
+     * @brief Calcula a chave de um arquivo na DHT a partir do seu nome.
+     */
+    static std::uint64_t keyFor(const std::string& file_name);
+
+
+    /**
+     * @brief Retorna o identificador deste peer.
+     */
+    std::uint64_t getSelfId() const { return self_id; }
+
+
+    /**
+     * @brief Registra (ou renova) um contato na tabela de roteamento.
+     *
+     * Se o k-bucket estiver cheio, o contato mais antigo só é substituído se não for visto há
+     * Constants::DHT_CONTACT_STALE_SECONDS, assim contatos estáveis são preservados.
+     *
+     * @param ip Endereço IP do contato.
+     * @param port Porta UDP do contato.
+     */
+    void addContact(const std::string& ip, int port);
+
+
+    /**
+     * @brief Retorna os contatos conhecidos mais próximos de uma chave (distância XOR).
+     *
+     * @param target Chave ou identificador buscado.
+     * @param count Número máximo de contatos.
+     * @return Contatos ordenados do mais próximo para o mais distante.
+     */
+    std::vector<DHTContact> getClosestContacts(std::uint64_t target, std::size_t count);
+
+
+    /**
+     * @brief Guarda um registro de provedor, válido por Constants::DHT_PROVIDER_TTL_SECONDS.
+     *
+     * @param key Chave do arquivo.
+     * @param ip Endereço IP do provedor.
+     * @param port Porta UDP do provedor.
+     */
+    void addProvider(std::uint64_t key, const std::string& ip, int port);
+
+
+    /**
+     * @brief Retorna os provedores válidos de uma chave, descartando os expirados.
+     *
+     * @param key Chave do arquivo.
+     * @return Até Constants::DHT_MAX_PROVIDERS_PER_REPLY provedores.
+     */
+    std::vector<DHTContact> getProviders(std::uint64_t key);
+
+
+    /**
+     * @brief Reserva um identificador para uma consulta de uma rodada de busca.
+     *
+     * @param round Rodada a que a consulta pertence.
+     * @return Identificador da consulta, enviado na mensagem e devolvido na resposta.
+     */
+    std::uint64_t registerRpc(const std::shared_ptr<DHTLookupRound>& round);
+
+
+    /**
+     * @brief Entrega a resposta de uma consulta à sua rodada.
+     *
+     * @param rpc_id Identificador da consulta.
+     * @param reply Resposta recebida.
+     * @return true se a consulta estava pendente, false se for desconhecida ou já tiver expirado.
+     */
+    bool completeRpc(std::uint64_t rpc_id, DHTReply reply);
+
+
+    /**
+     * @brief Descarta as consultas de uma rodada encerrada (respondidas ou não).
+     *
+     * @param rpc_ids Identificadores das consultas da rodada.
+     */
+    void releaseRpcs(const std::vector<std::uint64_t>& rpc_ids);
+};
+
+#endif // DHTNODE_H
@@ -0,0 +1,212 @@
+#include "Executor.h"
+#include <sstream>
+#include <iomanip>
+
+
+namespace {
+    thread_local Executor* current_executor = nullptr;      ///< Pool ao qual a thread atual pertence.
+    thread_local std::size_t current_worker_index = 0;      ///< Índice da thread atual no pool.
+}
+
+
+/**
+ * @brief Construtor da classe Executor.
+ */
+Executor::Executor(const std::string& name, int thread_count)
+    : name(name), pending_tasks(0), next_worker(0), stopping(false) {
+    std::size_t worker_count = thread_count > 0
+        ? static_cast<std::size_t>(thread_count)
+        : std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < worker_count; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+}
+
+
+/**
+ * @brief Destrutor da classe Executor. Encerra as threads do pool.
+ */
+Executor::~Executor() {
+    stop();
+}
+
+
+/**
+ * @brief Cria as threads do pool.
+ */
+void Executor::start() {
+    stopping.store(false);
+    start_time = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        threads.emplace_back(&Executor::runWorker, this, i);
+    }
+}
+
+
+/**
+ * @brief Encerra o pool depois que as tarefas enfileiradas forem executadas.
+ */
+void Executor::stop() {
+    {
+        std::lock_guard<std::mutex> park_lock(park_mutex);
+        stopping.store(true);
+    }
+    park_condition.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable() && thread.get_id() != std::this_thread::get_id()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+}
+
+
+/**
+ * @brief Envia uma tarefa para ser executada pelo pool.
+ */
+void Executor::submit(std::function<void()> task, TaskPriority priority) {
+    // De dentro do pool, a tarefa fica com a própria thread (é a mais provável de ter os dados em cache)
+    std::size_t worker_index = current_executor == this
+        ? current_worker_index
+        : next_worker.fetch_add(1) % workers.size();
+
+    // Conta a tarefa antes de enfileirá-la, assim o contador nunca fica abaixo do número de tarefas nas filas.
+    // O incremento é feito sob o mutex para que uma thread prestes a dormir não perca a notificação
+    {
+        std::lock_guard<std::mutex> park_lock(park_mutex);
+        pending_tasks.fetch_add(1);
+    }
+
+    {
+        Worker& worker = *workers[worker_index];
+        std::lock_guard<std::mutex> worker_lock(worker.mutex);
+        worker.queues[static_cast<int>(priority)].push_back(std::move(task));
+    }
+    park_condition.notify_one();
+}
+
+
+/**
+ * @brief Retira a próxima tarefa para uma thread: primeiro das próprias filas, depois roubando das outras.
+ */
+bool Executor::takeTask(std::size_t worker_index, std::function<void()>& task) {
+    for (int priority = 0; priority < 3; ++priority) {
+        // Fim da própria fila (a tarefa mais recente)
+        {
+            Worker& own = *workers[worker_index];
+            std::lock_guard<std::mutex> worker_lock(own.mutex);
+            auto& queue = own.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.back());
+                queue.pop_back();
+                return true;
+            }
+        }
+
+        // Início da fila das outras threads (a tarefa mais antiga)
+        for (std::size_t offset = 1; offset < workers.size(); ++offset) {
+            bool stolen = false;
+            {
+                Worker& victim = *workers[(worker_index + offset) % workers.size()];
+                std::lock_guard<std::mutex> victim_lock(victim.mutex);
+                auto& queue = victim.queues[priority];
+                if (!queue.empty()) {
+                    task = std::move(queue.front());
+                    queue.pop_front();
+                    stolen = true;
+                }
+            }
+
+            // A métrica é atualizada fora do mutex da vítima para nunca segurar dois mutexes de filas
+            if (stolen) {
+                Worker& own = *workers[worker_index];
+                std::lock_guard<std::mutex> worker_lock(own.mutex);
+                own.metrics.tasks_stolen++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Loop de uma thread do pool.
+ */
+void Executor::runWorker(std::size_t worker_index) {
+    current_executor = this;
+    current_worker_index = worker_index;
+
+    while (true) {
+        std::function<void()> task;
+
+        if (takeTask(worker_index, task)) {
+            pending_tasks.fetch_sub(1);
+
+            auto task_start = std::chrono::steady_clock::now();
+            task();
+            auto task_duration = std::chrono::steady_clock::now() - task_start;
+
+            Worker& own = *workers[worker_index];
+            std::lock_guard<std::mutex> worker_lock(own.mutex);
+            own.metrics.tasks_executed++;
+            own.metrics.busy_time += std::chrono::duration_cast<std::chrono::nanoseconds>(task_duration);
+            continue;
+        }
+
+        // Sem trabalho: dorme até chegar uma tarefa ou o pool ser encerrado
+        std::unique_lock<std::mutex> park_lock(park_mutex);
+        park_condition.wait(park_lock, [this] { return pending_tasks.load() > 0 || stopping.load(); });
+
+        // Ao encerrar, termina apenas depois que todas as tarefas forem executadas
+        if (stopping.load() && pending_tasks.load() == 0) {
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Retorna uma cópia das métricas de cada thread do pool.
+ */
+std::vector<WorkerMetrics> Executor::getMetrics() {
+    std::vector<WorkerMetrics> metrics;
+    for (auto& worker : workers) {
+        std::lock_guard<std::mutex> worker_lock(worker->mutex);
+        metrics.push_back(worker->metrics);
+    }
+    return metrics;
+}
+
+
+/**
+ * @brief Monta uma linha de log com a utilização do pool e de cada thread.
+ */
+std::string Executor::describeMetrics() {
+    auto metrics = getMetrics();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time);
+    double elapsed_ns = std::max<double>(1.0, static_cast<double>(elapsed.count()));
+
+    std::uint64_t total_executed = 0, total_stolen = 0;
+    double total_busy_ns = 0;
+    std::stringstream per_worker;
+    per_worker << std::fixed << std::setprecision(1);
+
+    for (std::size_t i = 0; i < metrics.size(); ++i) {
+        total_executed += metrics[i].tasks_executed;
+        total_stolen += metrics[i].tasks_stolen;
+        total_busy_ns += metrics[i].busy_time.count();
+        per_worker << " [" << i << ": " << metrics[i].tasks_executed << " tarefas, "
+                   << metrics[i].tasks_stolen << " roubadas, "
+                   << 100.0 * metrics[i].busy_time.count() / elapsed_ns << "%]";
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "Pool '" << name << "' (" << metrics.size() << " threads): " << total_executed << " tarefas, "
+       << total_stolen << " roubadas, utilização " << 100.0 * total_busy_ns / (elapsed_ns * metrics.size()) << "%,"
+       << " pendentes " << pending_tasks.load() << "." << per_worker.str();
+    return ss.str();
+}
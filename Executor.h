@@ -0,0 +1,146 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief Prioridade de uma tarefa no Executor.
+ *
+ * Tarefas de maior prioridade são sempre retiradas antes, tanto da fila da própria
+ * thread quanto das filas roubadas de outras threads.
+ */
+enum class TaskPriority {
+    HIGH,       ///< Rede: corrotinas retomadas por eventos de socket e timers.
+    NORMAL,     ///< Tarefas comuns, como novas corrotinas e o agendamento de downloads.
+    LOW         ///< Disco: gravação de chunks e montagem de arquivos.
+};
+
+
+/**
+ * @brief Estrutura com as métricas de utilização de uma thread do Executor.
+ */
+struct WorkerMetrics {
+    std::uint64_t tasks_executed = 0;               ///< Número de tarefas executadas pela thread.
+    std::uint64_t tasks_stolen = 0;                 ///< Número de tarefas roubadas das filas de outras threads.
+    std::chrono::nanoseconds busy_time{0};          ///< Tempo total gasto executando tarefas.
+};
+
+
+/**
+ * @brief Pool de threads com roubo de tarefas (work stealing), compartilhado por rede, disco e agendamento.
+ *
+ * Cada thread possui suas próprias filas (uma por prioridade). Tarefas enviadas de dentro de uma
+ * thread do pool vão para as filas dela, e tarefas enviadas de fora são distribuídas em rodízio.
+ * A thread retira tarefas do fim das próprias filas e, quando elas estão vazias, rouba do início
+ * das filas das outras threads. Sem trabalho disponível, a thread dorme até uma nova tarefa chegar.
+ */
+class Executor {
+private:
+    /**
+     * @brief Filas e métricas de uma thread do pool.
+     */
+    struct Worker {
+        std::mutex mutex;                                                   ///< Mutex que protege as filas e as métricas.
+        std::deque<std::function<void()>> queues[3];                        ///< Filas de tarefas, indexadas por TaskPriority.
+        WorkerMetrics metrics;                                              ///< Métricas de utilização da thread.
+    };
+
+    const std::string name;                                                 ///< Nome do pool, usado nos logs de métricas.
+    std::vector<std::unique_ptr<Worker>> workers;                           ///< Filas de cada thread do pool.
+    std::vector<std::thread> threads;                                       ///< Threads do pool.
+    std::atomic<std::size_t> pending_tasks;                                 ///< Número de tarefas enfileiradas e ainda não retiradas.
+    std::atomic<std::size_t> next_worker;                                   ///< Próxima thread que recebe tarefas enviadas de fora do pool.
+    std::atomic<bool> stopping;                                             ///< Indica que o pool está sendo encerrado.
+    std::mutex park_mutex;                                                  ///< Mutex usado pelas threads que dormem sem trabalho.
+    std::condition_variable park_condition;                                 ///< Acorda as threads quando chegam novas tarefas.
+    std::chrono::steady_clock::time_point start_time;                       ///< Momento em que o pool foi iniciado.
+
+    /**
+     * @brief Loop de uma thread do pool.
+     *
+     * @param worker_index Índice da thread em workers.
+     */
+    void runWorker(std::size_t worker_index);
+
+    /**
+     * @brief Retira a próxima tarefa para uma thread: primeiro das próprias filas, depois roubando das outras.
+     *
+     * @param worker_index Índice da thread em workers.
+     * @param task Tarefa retirada.
+     * @return true se alguma tarefa foi retirada, false caso contrário.
+     */
+    bool takeTask(std::size_t worker_index, std::function<void()>& task);
+
+public:
+    /**
+     * @brief Construtor da classe Executor.
+     *
+     * @param name Nome do pool, usado nos logs de métricas.
+     * @param thread_count Número de threads do pool. 0 usa uma thread por núcleo.
+     */
+    Executor(const std::string& name, int thread_count);
+
+
+    /**
+     * @brief Destrutor da classe Executor. Encerra as threads do pool.
+     */
+    ~Executor();
+
+
+    /**
+     * @brief Cria as threads do pool.
+     */
+    void start();
+
+
+    /**
+     * @brief Encerra o pool depois que as tarefas enfileiradas forem executadas.
+     */
+    void stop();
+
+
+    /**
+     * @brief Envia uma tarefa para ser executada pelo pool.
+     *
+     * @param task Tarefa a ser executada.
+     * @param priority Prioridade da tarefa.
+     */
+    void submit(std::function<void()> task, TaskPriority priority = TaskPriority::NORMAL);
+
+
+    /**
+     * @brief Retorna o número de threads do pool.
+     */
+    std::size_t size() const { return workers.size(); }
+
+
+    /**
+     * @brief Retorna uma cópia das métricas de cada thread do pool.
+     *
+     * @return Vetor com as métricas, indexado pela thread.
+     */
+    std::vector<WorkerMetrics> getMetrics();
+
+
+    /**
+     * @brief Monta uma linha de log com a utilização do pool e de cada thread.
+     *
+     * A utilização é a fração do tempo, desde o início do pool, gasta executando tarefas.
+     *
+     * @return Texto com as métricas do pool.
+     */
+    std::string describeMetrics();
+};
+
+#endif // EXECUTOR_H
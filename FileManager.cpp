@@ -1,13 +1,69 @@
 #include "FileManager.h"
+#include "BufferPool.h"
+#include <cerrno>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <numeric>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 /**
  * @brief Construtor da classe FileManager.
  */
-FileManager::FileManager(const std::string& peer_id) : peer_id(peer_id) {}
+FileManager::FileManager(const std::string& peer_id, PeerQuality& peer_quality, PeerTable& peer_table)
+    : peer_id(peer_id), peer_quality(peer_quality), peer_table(peer_table) {}
+
+
+/**
+ * @brief Retorna o mutex que protege os chunks locais de um arquivo, criando-o se necessário.
+ */
+std::mutex& FileManager::getLocalChunksMutex(const std::string& file_name) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    return local_chunks_mutex[file_name];
+}
+
+
+/**
+ * @brief Retorna o conjunto de chunks locais de um arquivo, criando-o se necessário.
+ */
+std::set<ChunkId>& FileManager::getLocalChunkSet(const std::string& file_name) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    return local_chunks[file_name];
+}
+
+
+/**
+ * @brief Retorna o mutex que protege a localização dos chunks de um arquivo, criando-o se necessário.
+ */
+std::mutex& FileManager::getChunkLocationInfoMutex(const std::string& file_name) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    return chunk_location_info_mutex[file_name];
+}
+
+
+/**
+ * @brief Retorna a tabela de localização dos chunks de um arquivo, sem copiá-la.
+ */
+std::shared_ptr<const ChunkLocationTable> FileManager::getChunkLocationSnapshot(const std::string& file_name) {
+    std::lock_guard<std::mutex> file_lock(getChunkLocationInfoMutex(file_name));
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    auto it = chunk_location_info.find(file_name);
+    return it != chunk_location_info.end() ? it->second : nullptr;
+}
+
+
+/**
+ * @brief Retorna o número total de chunks de um arquivo.
+ */
+ChunkId FileManager::getTotalChunks(const std::string& file_name) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    auto it = file_chunks.find(file_name);
+    return it != file_chunks.end() ? it->second : 0;
+}
 
 
 /**
@@ -27,11 +83,16 @@ void FileManager::loadLocalChunks() {
     for (const auto& entry : fs::directory_iterator(directory)) {
         std::string filename = entry.path().filename().string();
 
+        // Ignora chunks incompletos que sobraram de um recebimento interrompido (<nome>.ch<chunk>.partN)
+        if (filename.find(".part") != std::string::npos) {
+            continue;
+        }
+
         // Formato esperado: <nome>.ch<chunk>
         size_t pos = filename.find(".ch");
         if (pos != std::string::npos) {
             std::string file_name = filename.substr(0, pos);
-            int chunk_id = std::stoi(filename.substr(pos + 3));
+            ChunkId chunk_id = std::stoll(filename.substr(pos + 3));
             local_chunks[file_name].insert(chunk_id);
 
              unique_file_names.insert(file_name);
@@ -47,34 +108,77 @@ void FileManager::loadLocalChunks() {
 /**
  * @brief Carrega os metadados de um arquivo e retorna as informações.
  */ 
-std::tuple<std::string, int, int> FileManager::loadMetadata(const std::string& file_name) {
+std::tuple<std::string, ChunkId, int, ByteCount> FileManager::loadMetadata(const std::string& file_name) {
     std::string metadata_path = Constants::BASE_PATH + file_name + ".p2p";
     std::ifstream meta_file(metadata_path);
     
     if (!meta_file.is_open()) {
         logMessage(LogType::ERROR, "Erro ao abrir o arquivo de metadados para " + file_name + ". Verifique se o arquivo de metadados " + file_name + ".p2p se encontra em " + Constants::BASE_PATH);
-        return {"", -1, -1}; // Retorno padrão em caso de erro
+        return {"", -1, -1, 0}; // Retorno padrão em caso de erro
     }
 
     std::string file_name_returned;
-    int total_chunks;
-    int initial_ttl;
+    ChunkId total_chunks = -1;
+    int initial_ttl = -1;
+    ByteCount chunk_size = 0;
 
     // Lê os dados do arquivo de metadados
     std::getline(meta_file, file_name_returned);
     meta_file >> total_chunks;
     meta_file >> initial_ttl;
+
+    // Linha opcional com o tamanho dos chunks (metadados antigos não a possuem)
+    if (!(meta_file >> chunk_size)) {
+        chunk_size = 0;
+    }
     meta_file.close();
 
-    return {file_name_returned, total_chunks, initial_ttl}; // Retorna os valores em uma tupla
+    return {file_name_returned, total_chunks, initial_ttl, chunk_size}; // Retorna os valores em uma tupla
 }
 
 
 /**
  * @brief Inicializa o número de chunks de um arquivo.
  */
-void FileManager::initializeFileChunks(const std::string& file_name, int total_chunks) {
+void FileManager::initializeFileChunks(const std::string& file_name, ChunkId total_chunks, ByteCount chunk_size) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
     file_chunks[file_name] = total_chunks;
+    if (chunk_size > 0) {
+        file_chunk_sizes[file_name] = chunk_size;
+    }
+}
+
+
+/**
+ * @brief Restringe o download de um arquivo aos chunks de um intervalo.
+ */
+void FileManager::setRequestedRange(const std::string& file_name, const ChunkRange& range) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    requested_ranges[file_name] = range;
+}
+
+
+/**
+ * @brief Retorna o intervalo de chunks pedido para um arquivo.
+ */
+ChunkRange FileManager::getRequestedRange(const std::string& file_name) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    auto it = requested_ranges.find(file_name);
+    if (it != requested_ranges.end()) {
+        return it->second;
+    }
+    auto total_it = file_chunks.find(file_name);
+    return ChunkRange{0, total_it != file_chunks.end() ? total_it->second : 0};
+}
+
+
+/**
+ * @brief Retorna o tamanho dos chunks de um arquivo informado nos metadados.
+ */
+ByteCount FileManager::getChunkSize(const std::string& file_name) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    auto it = file_chunk_sizes.find(file_name);
+    return it != file_chunk_sizes.end() ? it->second : 0;
 }
 
 
@@ -82,15 +186,16 @@ void FileManager::initializeFileChunks(const std::string& file_name, int total_c
  * @brief Inicializa a estrutura para armazenar informações sobre onde encontrar cada chunk.
  */
 void FileManager::initializeChunkLocationInfo(const std::string& file_name) {
-    int total_chunks = file_chunks[file_name];
+    ChunkId total_chunks = getTotalChunks(file_name);
+
+    // Inicializa os mutexes responsáveis por sincronizar o acesso ao mapa da localização dos chunks de um arquivo
+    std::lock_guard<std::mutex> file_lock(getChunkLocationInfoMutex(file_name));
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
 
     // Verifica se já existe uma entrada para o file_name
     if (chunk_location_info.find(file_name) == chunk_location_info.end()) {
-        chunk_location_info[file_name].resize(total_chunks); // Inicializa com vetores vazios para cada chunk
+        chunk_location_info[file_name] = std::make_shared<ChunkLocationTable>(total_chunks); // Nenhum peer conhecido
     }
-
-    // Inicializa os mutexes responsáveis por sincronizar o acesso ao mapa da localização dos chunks de um arquivo
-    chunk_location_info_mutex.try_emplace(file_name);
 }
 
 
@@ -98,76 +203,97 @@ void FileManager::initializeChunkLocationInfo(const std::string& file_name) {
  * @brief Limpa as informações de localização dos chunks e remove o mutex associado a um arquivo específico.
  */
 void FileManager::clearChunkLocationInfo(const std::string& file_name) {
+    std::lock_guard<std::mutex> file_lock(getChunkLocationInfoMutex(file_name));
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+
     // Verifica se o arquivo existe no mapa
     auto it = chunk_location_info.find(file_name);
     if (it != chunk_location_info.end()) {
-        // Limpa cada vetor de ChunkLocationInfo para garantir que a memória seja liberada
-        for (auto& chunk_info : it->second) {
-            chunk_info.clear();
-        }
-        // Apaga a entrada completa do map
+        // Apaga a entrada completa do map. A tabela é liberada quando a última seleção de peers que a usa terminar
         chunk_location_info.erase(it);
     }
-
-    // Remove o mutex associado ao file_name
-    auto mutex_it = chunk_location_info_mutex.find(file_name);
-    if (mutex_it != chunk_location_info_mutex.end()) {
-        chunk_location_info_mutex.erase(mutex_it);
-    }
 }
 
 
 /**
  * @brief Seleciona peers para o download de chunks com base na velocidade de transferência e balanceamento de carga.
  */
-std::unordered_map<std::string, std::vector<int>> FileManager::selectPeersForChunkDownload(const std::string& file_name) {
-    std::unordered_map<std::string, std::vector<int>> chunks_by_peer_map;
-    
-     std::vector<std::vector<ChunkLocationInfo>> chunks_with_peer_info;
+std::unordered_map<PeerId, std::vector<ChunkId>> FileManager::selectPeersForChunkDownload(const std::string& file_name) {
+    ChunkRange range = getRequestedRange(file_name);
+    std::vector<ChunkId> chunk_ids(range.size());
+    std::iota(chunk_ids.begin(), chunk_ids.end(), range.first);
+    return selectPeersForChunkDownload(file_name, chunk_ids);
+}
 
-    {
-        std::lock_guard file_lock(chunk_location_info_mutex[file_name]);
-        chunks_with_peer_info = chunk_location_info.at(file_name);
-    }
-
-    std::size_t total_chunks_in_file = chunks_with_peer_info.size();
-
-    // Itera sobre cada chunk do arquivo
-    for (std::size_t chunk_index = 0; chunk_index < total_chunks_in_file; ++chunk_index) {
-        const auto& available_peers_for_chunk = chunks_with_peer_info[chunk_index];
-
-        // Verifica se há peers disponíveis para o chunk atual
-        if (!available_peers_for_chunk.empty()) {
-            // Copia a lista de peers disponíveis e ordena pela velocidade de transferência (decrescente)
-            auto sorted_peers_by_speed = available_peers_for_chunk;
-            std::sort(sorted_peers_by_speed.begin(), sorted_peers_by_speed.end(), 
-                [](const ChunkLocationInfo& a, const ChunkLocationInfo& b) {
-                    return a.transfer_speed > b.transfer_speed;
-                });
-
-            // Inicializa o peer selecionado como o mais rápido e define a carga mínima como o número de chunks atribuídos a ele
-            ChunkLocationInfo selected_peer = sorted_peers_by_speed[0];
-            std::string selected_peer_key = selected_peer.ip + ":" + std::to_string(selected_peer.port);
-            int min_chunks_assigned = chunks_by_peer_map[selected_peer_key].size();
-
-            // Itera sobre os peers ordenados para encontrar o mais rápido com menos chunks atribuídos
-            for (const auto& peer : sorted_peers_by_speed) {
-                std::string current_peer_key = peer.ip + ":" + std::to_string(peer.port);
-                int chunks_assigned_to_current_peer = chunks_by_peer_map[current_peer_key].size();
-
-                // Se o peer atual tem menos chunks atribuídos, seleciona-o, em caso de empate, mantém a ordem de velocidade
-                if (chunks_assigned_to_current_peer < min_chunks_assigned) {
-                    selected_peer = peer;
-                    selected_peer_key = current_peer_key;
-                    min_chunks_assigned = chunks_assigned_to_current_peer;
+
+/**
+ * @brief Seleciona peers para o download de apenas alguns chunks de um arquivo.
+ */
+std::unordered_map<PeerId, std::vector<ChunkId>> FileManager::selectPeersForChunkDownload(const std::string& file_name, const std::vector<ChunkId>& chunk_ids) {
+    std::unordered_map<PeerId, std::vector<ChunkId>> chunks_by_peer_map;
+
+    // Usa a tabela atual sem copiá-la: ela só é copiada se receber novos peers durante a seleção
+    std::shared_ptr<const ChunkLocationTable> table = getChunkLocationSnapshot(file_name);
+    if (!table) {
+        return chunks_by_peer_map;
+    }
+    const std::vector<PeerId>& holders = table->getHolders();
+
+    // Ordena os peers uma única vez pela velocidade efetiva (decrescente), consultada uma vez por peer
+    std::vector<ByteCount> effective_speeds(holders.size());
+    for (std::size_t holder = 0; holder < holders.size(); ++holder) {
+        effective_speeds[holder] = peer_quality.getEffectiveSpeed(peer_table.getEndpoint(holders[holder]), peer_table.getClaimedSpeed(holders[holder]));
+    }
+    std::vector<std::size_t> holders_by_speed(holders.size());
+    std::iota(holders_by_speed.begin(), holders_by_speed.end(), 0);
+    std::stable_sort(holders_by_speed.begin(), holders_by_speed.end(),
+        [&](std::size_t a, std::size_t b) { return effective_speeds[a] > effective_speeds[b]; });
+
+    // Chunks solicitados que possuem peers conhecidos, dos mais raros para os mais comuns
+    std::vector<ChunkId> chunks_to_assign;
+    chunks_to_assign.reserve(chunk_ids.size());
+    std::copy_if(chunk_ids.begin(), chunk_ids.end(), std::back_inserter(chunks_to_assign),
+                 [&](ChunkId chunk) { return table->getReplicaCount(chunk) > 0; });
+    std::stable_sort(chunks_to_assign.begin(), chunks_to_assign.end(),
+        [&](ChunkId a, ChunkId b) { return table->getReplicaCount(a) < table->getReplicaCount(b); });
+
+    std::vector<std::size_t> chunks_assigned(holders.size(), 0);
+    for (const ChunkId chunk_index : chunks_to_assign) {
+        // Percorre os peers que possuem o chunk, do mais rápido para o mais lento, e seleciona o que terminaria
+        // antes de receber mais este chunk: o menor (chunks atribuídos + 1) / velocidade efetiva. Em caso de
+        // empate, mantém a ordem de velocidade. Peers com velocidade efetiva 0 (sem resposta às sondas) só são
+        // escolhidos se forem os únicos que possuem o chunk, e então o de menos chunks atribuídos
+        std::size_t selected_holder = holders.size();
+        std::size_t unresponsive_holder = holders.size();
+        for (const std::size_t holder : holders_by_speed) {
+            if (!table->holderHasChunk(holder, chunk_index)) {
+                continue;
+            }
+            if (effective_speeds[holder] <= 0) {
+                if (unresponsive_holder == holders.size() || chunks_assigned[holder] < chunks_assigned[unresponsive_holder]) {
+                    unresponsive_holder = holder;
                 }
+                continue;
+            }
+            // (a + 1) / sa < (b + 1) / sb, sem divisão
+            if (selected_holder == holders.size() ||
+                static_cast<unsigned __int128>(chunks_assigned[holder] + 1) * effective_speeds[selected_holder] <
+                static_cast<unsigned __int128>(chunks_assigned[selected_holder] + 1) * effective_speeds[holder]) {
+                selected_holder = holder;
             }
-
-            // Atribui o chunk ao peer selecionado, adicionando-o ao mapa de chunks para esse peer
-            chunks_by_peer_map[selected_peer_key].push_back(static_cast<int>(chunk_index));
         }
+        if (selected_holder == holders.size()) {
+            selected_holder = unresponsive_holder;
+        }
+
+        // Atribui o chunk ao peer selecionado, adicionando-o ao mapa de chunks para esse peer
+        chunks_assigned[selected_holder]++;
+        chunks_by_peer_map[holders[selected_holder]].push_back(chunk_index);
     }
 
+    for (auto& [peer, chunks] : chunks_by_peer_map) {
+        std::sort(chunks.begin(), chunks.end());
+    }
     return chunks_by_peer_map;
 }
 
@@ -175,54 +301,99 @@ std::unordered_map<std::string, std::vector<int>> FileManager::selectPeersForChu
 /**
  * @brief Armazena informações recebidas sobre a localização dos chunks.
  */
-void FileManager::storeChunkLocationInfo(const std::string& file_name, const std::vector<int>& chunk_ids, const std::string& ip, int port, int transfer_speed) {
+void FileManager::storeChunkLocationInfo(const std::string& file_name, const std::vector<ChunkId>& chunk_ids, const std::string& ip, int port, ByteCount transfer_speed) {
+    PeerId peer = peer_table.intern(ip, port);
+    if (peer == INVALID_PEER_ID) {
+        logMessage(LogType::ERROR, "Endereço inválido " + ip + ":" + std::to_string(port) + " na localização dos chunks de " + file_name);
+        return;
+    }
+    peer_table.setClaimedSpeed(peer, transfer_speed);
+
     // Bloqueia o mutex do arquivo uma vez até o final do escopo desse método
-    std::lock_guard<std::mutex> file_lock(chunk_location_info_mutex[file_name]);
-
-    // Para cada chunk_id, manipula a lista de peers
-    for (const int chunk_id : chunk_ids) {
-        // Verifica se o chunk_id está dentro do intervalo
-        if (static_cast<size_t>(chunk_id) < chunk_location_info[file_name].size()) {
-            // Pega referência direta da lista de chunks e verifica se o peer existe
-            auto& chunk_list = chunk_location_info[file_name][chunk_id];
-            bool peer_exists = std::any_of(chunk_list.begin(), chunk_list.end(), 
-                                           [&](const ChunkLocationInfo& cli) {
-                                               return cli.ip == ip && cli.port == port;
-                                           });
-            // Adiciona o peer caso ele não exista
-            if (!peer_exists) {
-                chunk_list.emplace_back(ip, port, transfer_speed);
-            }
-        } else {
-            logMessage(LogType::ERROR, "chunk_id " + std::to_string(chunk_id) + " está fora do intervalo para o arquivo: " + file_name);
+    std::lock_guard<std::mutex> file_lock(getChunkLocationInfoMutex(file_name));
+
+    // Busca a localização dos chunks do arquivo, que só existe enquanto ele está sendo baixado
+    std::shared_ptr<ChunkLocationTable>* table = nullptr;
+    {
+        std::lock_guard<std::mutex> registry_lock(registry_mutex);
+        auto it = chunk_location_info.find(file_name);
+        if (it == chunk_location_info.end()) {
+            return;
         }
+        table = &it->second;
+    }
+
+    // Uma seleção de peers ainda usa a tabela atual: as alterações vão para uma cópia
+    if (table->use_count() > 1) {
+        *table = std::make_shared<ChunkLocationTable>(**table);
+    }
+
+    // OU dos chunks anunciados com o mapa de bits do peer
+    std::size_t out_of_range = (*table)->addChunks(peer, chunk_ids);
+    if (out_of_range > 0) {
+        logMessage(LogType::ERROR, std::to_string(out_of_range) + " chunk(s) fora do intervalo para o arquivo: " + file_name);
     }
 }
 
 
+/**
+ * @brief Conta os chunks de um intervalo que o peer não possui e para os quais nenhum peer é conhecido.
+ */
+ChunkId FileManager::countUnlocatedChunks(const std::string& file_name, const ChunkRange& range) {
+    std::shared_ptr<const ChunkLocationTable> table = getChunkLocationSnapshot(file_name);
+    if (!table) {
+        return 0;
+    }
+
+    // hasChunk bloqueia o mutex dos chunks locais, por isso é chamado fora do mutex da localização
+    std::vector<ChunkId> without_location = table->getUnlocatedChunks(range);
+    return std::count_if(without_location.begin(), without_location.end(),
+                         [&](ChunkId chunk) { return !hasChunk(file_name, chunk); });
+}
+
+
 /**
  * @brief Retorna os chunks disponíveis para um arquivo específico.
  */
-std::vector<int> FileManager::getAvailableChunks(const std::string& file_name) {
-    std::vector<int> available_chunks;
+std::vector<ChunkId> FileManager::getAvailableChunks(const std::string& file_name) {
+    std::vector<ChunkId> available_chunks;
 
     // Bloqueia o mutex do arquivo uma vez até o final do escopo desse método
-    std::lock_guard<std::mutex> file_lock(local_chunks_mutex[file_name]);
+    std::lock_guard<std::mutex> file_lock(getLocalChunksMutex(file_name));
 
-    // Verifica se o arquivo está no mapa de chunks locais
-    if (local_chunks.find(file_name) != local_chunks.end()) {
-        // Copia os chunks disponíveis para o vetor
-        available_chunks.assign(local_chunks[file_name].begin(), local_chunks[file_name].end());
-    }
+    // Copia os chunks disponíveis para o vetor
+    const std::set<ChunkId>& chunks = getLocalChunkSet(file_name);
+    available_chunks.assign(chunks.begin(), chunks.end());
 
     return available_chunks;
 }
 
 
+/**
+ * @brief Retorna os nomes dos arquivos dos quais o peer possui pelo menos um chunk.
+ */
+std::vector<std::string> FileManager::getLocalFileNames() {
+    std::vector<std::string> file_names;
+    {
+        std::lock_guard<std::mutex> registry_lock(registry_mutex);
+        for (const auto& [file_name, chunks] : local_chunks) {
+            file_names.push_back(file_name);
+        }
+    }
+
+    // O conjunto de chunks de cada arquivo só é lido com o mutex do arquivo bloqueado
+    std::erase_if(file_names, [this](const std::string& file_name) {
+        std::lock_guard<std::mutex> file_lock(getLocalChunksMutex(file_name));
+        return getLocalChunkSet(file_name).empty();
+    });
+    return file_names;
+}
+
+
 /**
  * @brief Retorna o caminho do chunk solicitado.
  */
-std::string FileManager::getChunkPath(const std::string& file_name, int chunk) {
+std::string FileManager::getChunkPath(const std::string& file_name, ChunkId chunk) {
     return directory + "/" + file_name + ".ch" + std::to_string(chunk);
 }
 
@@ -230,39 +401,212 @@ std::string FileManager::getChunkPath(const std::string& file_name, int chunk) {
 /**
  * @brief Verifica se possui um chunk específico de um arquivo.
  */
-bool FileManager::hasChunk(const std::string& file_name, int chunk) {
+bool FileManager::hasChunk(const std::string& file_name, ChunkId chunk) {
     // Bloqueia o mutex do arquivo uma vez até o final do escopo desse método
-    std::lock_guard<std::mutex> file_lock(local_chunks_mutex[file_name]);
+    std::lock_guard<std::mutex> file_lock(getLocalChunksMutex(file_name));
 
-    auto result = local_chunks[file_name].find(chunk) != local_chunks[file_name].end();
+    const std::set<ChunkId>& chunks = getLocalChunkSet(file_name);
+    auto result = chunks.find(chunk) != chunks.end();
 
     return result;
 }
 
 
 /**
- * @brief Salva um chunk recebido no diretório do peer.
+ * @brief Salva um chunk copiando os dados de um descritor de arquivo.
+ */
+bool FileManager::saveChunkFromFd(const std::string& file_name, ChunkId chunk, int source_fd, ByteCount size) {
+    // Grava em um arquivo temporário, que só aparece no caminho final depois de copiado por completo
+    ChunkWriter chunk_writer(getChunkPath(file_name, chunk));
+    if (!chunk_writer.isOpen()) {
+        logMessage(LogType::ERROR, "Não foi possível criar o arquivo para o chunk " + std::to_string(chunk));
+        return false;
+    }
+
+    // Em caso de falha o ChunkWriter remove o arquivo temporário
+    if (!chunk_writer.copyFrom(source_fd, size)) {
+        logMessage(LogType::ERROR, "Falha ao copiar o chunk " + std::to_string(chunk) + " do arquivo " + file_name + ". Bytes esperados: " + std::to_string(size) + ", copiados: " + std::to_string(chunk_writer.getBytesWritten()));
+        return false;
+    }
+
+    return commitChunk(file_name, chunk, chunk_writer);
+}
+
+
+/**
+ * @brief Confirma um chunk gravado em streaming e o registra como disponível.
  */
-void FileManager::saveChunk(const std::string& file_name, int chunk, const char* data, size_t size) {
+bool FileManager::commitChunk(const std::string& file_name, ChunkId chunk, ChunkWriter& writer) {
     // Bloqueia o mutex do arquivo uma vez até o final do escopo desse método
-    std::lock_guard<std::mutex> file_lock(local_chunks_mutex[file_name]);
+    std::lock_guard<std::mutex> file_lock(getLocalChunksMutex(file_name));
 
-    std::string path = getChunkPath(file_name, chunk);
+    if (!writer.commit()) {
+        logMessage(LogType::ERROR, "Não foi possível confirmar o chunk " + std::to_string(chunk) + " do arquivo " + file_name);
+        return false;
+    }
 
-    std::ofstream outfile(path, std::ios::binary);
-    if (!outfile.is_open()) {
-        logMessage(LogType::ERROR, "Não foi possível criar o arquivo para o chunk " + std::to_string(chunk));
-        return;
+    getLocalChunkSet(file_name).insert(chunk); // Armazena o chunk salvo na lista de chunks que possuo
+    notifyChunksChanged(file_name, chunk); // Acorda as leituras que esperam chunks e anuncia o chunk aos interessados
+    assembleFile(file_name); // Tenta montar o arquivo
+    return true;
+}
+
+
+/**
+ * @brief Acorda as leituras que esperam chunks e guarda o chunk para ser anunciado (HAVE).
+ */
+void FileManager::notifyChunksChanged(const std::string& file_name, ChunkId chunk) {
+    {
+        std::lock_guard<std::mutex> new_chunks_lock(new_chunks_mutex);
+        new_chunks[file_name].push_back(chunk);
     }
+    // Troca o token antes de cancelá-lo: quem obtiver o token depois deste ponto espera pelo próximo chunk
+    CancellationToken changed_token;
+    {
+        std::lock_guard<std::mutex> changed_lock(chunks_changed_mutex);
+        std::swap(changed_token, chunks_changed);
+    }
+    changed_token.cancel();
+}
+
+
+/**
+ * @brief Retorna o token cancelado quando o próximo chunk for salvo.
+ */
+CancellationToken FileManager::getChunksChangedToken() {
+    std::lock_guard<std::mutex> changed_lock(chunks_changed_mutex);
+    return chunks_changed;
+}
 
-    // Escreve no arquivo                
-    outfile.write(data, size);
 
-    // Fecha o arquivo
-    outfile.close();
+/**
+ * @brief Obtém o tamanho dos chunks de um arquivo, dos metadados ou dos chunks locais.
+ */
+ByteCount FileManager::findChunkSize(const std::string& file_name) {
+    ByteCount chunk_size = getChunkSize(file_name);
+    if (chunk_size > 0) {
+        return chunk_size;
+    }
 
-    local_chunks[file_name].insert(chunk); // Armazena o chunk salvo na lista de chunks que possuo
-    assembleFile(file_name); // Tenta montar o arquivo
+    // Primeiro chunk local que não é o último: o seu tamanho é o de todos os outros
+    ChunkId total_chunks = getTotalChunks(file_name);
+    ChunkId full_chunk = -1;
+    {
+        std::lock_guard<std::mutex> file_lock(getLocalChunksMutex(file_name));
+        const std::set<ChunkId>& chunks = getLocalChunkSet(file_name);
+        if (!chunks.empty() && *chunks.begin() < total_chunks - 1) {
+            full_chunk = *chunks.begin();
+        }
+    }
+    if (full_chunk < 0) {
+        return 0;
+    }
+
+    std::error_code error;
+    chunk_size = std::filesystem::file_size(getChunkPath(file_name, full_chunk), error);
+    if (error || chunk_size == 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> registry_lock(registry_mutex);
+    file_chunk_sizes[file_name] = chunk_size;
+    return chunk_size;
+}
+
+
+/**
+ * @brief Lê a parte de um trecho do arquivo que já está disponível, sem esperar por chunks.
+ */
+ByteCount FileManager::readFileRange(const std::string& file_name, ByteCount offset, char* buffer, ByteCount length, bool& missing_chunk) {
+    missing_chunk = false;
+    ChunkId total_chunks = getTotalChunks(file_name);
+    ByteCount chunk_size = getChunkSize(file_name);
+
+    // Sem o tamanho nos metadados, ele é obtido do primeiro chunk recebido, em vez de esperar pelos chunks anteriores ao trecho
+    if (chunk_size == 0 && total_chunks > 1) {
+        chunk_size = findChunkSize(file_name);
+        if (chunk_size == 0) {
+            missing_chunk = true;
+            return 0;
+        }
+    }
+
+    // Com o tamanho dos chunks conhecido, começa direto no chunk que contém o offset
+    ChunkId chunk = 0;
+    ByteCount chunk_start = 0;
+    if (chunk_size > 0) {
+        chunk = static_cast<ChunkId>(offset / chunk_size);
+        chunk_start = static_cast<ByteCount>(chunk) * chunk_size;
+    }
+
+    ByteCount total_read = 0;
+    for (; chunk < total_chunks && total_read < length; ++chunk) {
+        if (!hasChunk(file_name, chunk)) {
+            missing_chunk = true;
+            break;
+        }
+
+        std::string chunk_path = getChunkPath(file_name, chunk);
+        int chunk_fd = open(chunk_path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat chunk_stat{};
+        if (chunk_fd < 0 || fstat(chunk_fd, &chunk_stat) < 0) {
+            logMessage(LogType::ERROR, "Não foi possível ler o chunk " + std::to_string(chunk) + " do arquivo " + file_name);
+            if (chunk_fd >= 0) {
+                close(chunk_fd);
+            }
+            break;
+        }
+        ByteCount current_chunk_size = chunk_stat.st_size;
+
+        // Chunks inteiramente antes do trecho solicitado só avançam a posição
+        ByteCount position = offset + total_read;
+        if (position >= chunk_start + current_chunk_size) {
+            close(chunk_fd);
+            chunk_start += current_chunk_size;
+            continue;
+        }
+
+        ByteCount bytes_to_read = std::min(length - total_read, chunk_start + current_chunk_size - position);
+        ByteCount chunk_bytes_read = 0;
+        while (chunk_bytes_read < bytes_to_read) {
+            ssize_t bytes_read = pread(chunk_fd, buffer + total_read, bytes_to_read - chunk_bytes_read, position - chunk_start + chunk_bytes_read);
+            if (bytes_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes_read <= 0) {
+                break;
+            }
+            chunk_bytes_read += bytes_read;
+            total_read += bytes_read;
+        }
+        close(chunk_fd);
+        if (chunk_bytes_read < bytes_to_read) {
+            logMessage(LogType::ERROR, "Leitura incompleta do chunk " + std::to_string(chunk) + " do arquivo " + file_name);
+            break;
+        }
+        chunk_start += current_chunk_size;
+    }
+
+    return total_read;
+}
+
+
+/**
+ * @brief Retira os chunks salvos desde a última chamada, para serem anunciados.
+ */
+std::unordered_map<std::string, std::vector<ChunkId>> FileManager::takeNewChunks(std::size_t max_chunks) {
+    std::unordered_map<std::string, std::vector<ChunkId>> taken_chunks;
+    std::lock_guard<std::mutex> new_chunks_lock(new_chunks_mutex);
+
+    for (auto it = new_chunks.begin(); it != new_chunks.end() && max_chunks > 0;) {
+        auto& chunks = it->second;
+        std::size_t count = std::min(max_chunks, chunks.size());
+        taken_chunks[it->first].assign(chunks.begin(), chunks.begin() + count);
+        chunks.erase(chunks.begin(), chunks.begin() + count);
+        max_chunks -= count;
+        it = chunks.empty() ? new_chunks.erase(it) : std::next(it);
+    }
+
+    return taken_chunks;
 }
 
 
@@ -270,17 +614,15 @@ void FileManager::saveChunk(const std::string& file_name, int chunk, const char*
  * @brief Concatena todos os chunks para formar o arquivo completo.
  */
 bool FileManager::assembleFile(const std::string& file_name) {
-    // Sob o bloqueio utilizado em saveChunk
-    int total_chunks = file_chunks[file_name];
-    bool has_all_chunks = local_chunks[file_name].size() == static_cast<size_t>(total_chunks);
+    // Sob o bloqueio utilizado em commitChunk
+    ChunkId total_chunks = getTotalChunks(file_name);
+    bool has_all_chunks = getLocalChunkSet(file_name).size() == static_cast<size_t>(total_chunks);
 
     if (has_all_chunks) {
-        int total_chunks = file_chunks[file_name];
-
         std::string output_path = directory + "/" + file_name;
         std::ofstream output_file(output_path, std::ios::binary);
 
-        for (int i = 0; i < total_chunks; ++i) {
+        for (ChunkId i = 0; i < total_chunks; ++i) {
             std::string chunk_path = getChunkPath(file_name, i);
             std::ifstream chunk_file(chunk_path, std::ios::binary | std::ios::in);
 
@@ -298,5 +640,74 @@ bool FileManager::assembleFile(const std::string& file_name) {
         clearChunkLocationInfo(file_name);
         return true;
     }
+
+    // Download parcial: monta o arquivo esparso quando todos os chunks do intervalo estiverem disponíveis
+    ChunkRange range = getRequestedRange(file_name);
+    if (range.size() > 0 && range.size() < total_chunks) {
+        const std::set<ChunkId>& chunks = getLocalChunkSet(file_name);
+        auto range_begin = chunks.lower_bound(range.first);
+        auto range_end = chunks.lower_bound(range.end);
+        if (static_cast<ChunkId>(std::distance(range_begin, range_end)) == range.size()) {
+            return assembleRange(file_name, range);
+        }
+    }
     return false;
 }
+
+
+/**
+ * @brief Grava os chunks de um download parcial nas suas posições do arquivo de saída.
+ */
+bool FileManager::assembleRange(const std::string& file_name, const ChunkRange& range) {
+    ByteCount chunk_size = getChunkSize(file_name);
+    if (chunk_size == 0) {
+        logMessage(LogType::ERROR, "Tamanho dos chunks de " + file_name + " desconhecido. Não é possível montar o trecho pedido.");
+        return false;
+    }
+
+    // Sem O_TRUNC: o que já existir fora do intervalo é mantido, e o restante fica como buraco
+    std::string output_path = directory + "/" + file_name;
+    int output_fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (output_fd < 0) {
+        logMessage(LogType::ERROR, "Não foi possível criar o arquivo " + output_path);
+        return false;
+    }
+
+    bool success = true;
+    for (ChunkId chunk = range.first; chunk < range.end && success; ++chunk) {
+        std::string chunk_path = getChunkPath(file_name, chunk);
+        int chunk_fd = open(chunk_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (chunk_fd < 0) {
+            logMessage(LogType::ERROR, "Erro ao abrir o chunk " + chunk_path);
+            success = false;
+            break;
+        }
+
+        // Copia o chunk no kernel para a sua posição no arquivo de saída
+        ByteCount current_chunk_size = std::filesystem::file_size(chunk_path);
+        off_t input_offset = 0;
+        lseek(output_fd, static_cast<off_t>(chunk * chunk_size), SEEK_SET);
+        ByteCount total_bytes_copied = 0;
+        while (total_bytes_copied < current_chunk_size) {
+            ssize_t bytes_copied = sendfile(output_fd, chunk_fd, &input_offset, current_chunk_size - total_bytes_copied);
+            if (bytes_copied <= 0) {
+                break;
+            }
+            total_bytes_copied += bytes_copied;
+        }
+        close(chunk_fd);
+
+        if (total_bytes_copied < current_chunk_size) {
+            logMessage(LogType::ERROR, "Falha ao copiar o chunk " + std::to_string(chunk) + " para " + output_path);
+            success = false;
+        }
+    }
+    close(output_fd);
+
+    if (success) {
+        logMessage(LogType::SUCCESS, "Chunks " + std::to_string(range.first) + " a " + std::to_string(range.end - 1) + " de " + file_name +
+                   " gravados em " + output_path + " (bytes " + std::to_string(range.first * chunk_size) + " em diante).");
+        clearChunkLocationInfo(file_name);
+    }
+    return success;
+}
@@ -1,8 +1,14 @@
 #ifndef FILEMANAGER_H
 #define FILEMANAGER_H
 
+#include "AsyncRuntime.h"
+#include "ChunkLocationTable.h"
+#include "ChunkWriter.h"
+#include "PeerQuality.h"
+#include "PeerTable.h"
 #include "Utils.h"
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <string>
@@ -10,32 +16,6 @@
 #include <vector>
 
 
-/**
- * @brief Estrutura que armazena as informações sobre um peer.
- * 
- * A estrutura ChunkLocationInfo guarda os dados essenciais para localizar um peer, como endereço
- * IP, porta UDP de comunicação e a velocidade de transferência em bytes/segundo oferecida.
- */
-struct ChunkLocationInfo {
-    std::string ip;          ///< Endereço IP do peer.
-    int port;                ///< Porta UDP do peer.
-    int transfer_speed;      ///< Velocidade de transferência em bytes/segundo do peer.
-
-    /**
-     * @brief Construtor da estrutura ChunkLocationInfo.
-     * 
-     * Inicializa os membros da estrutura com os valores fornecidos ou, caso não sejam fornecidos, 
-     * usa valores padrão.
-     * 
-     * @param ip Endereço IP do peer (padrão: string vazia).
-     * @param port Porta UDP do peer (padrão: 0).
-     * @param transfer_speed Velocidade de transferência em bytes/segundo do peer (padrão: 0).
-     */
-    ChunkLocationInfo(const std::string& ip = "", int port = 0, int transfer_speed = 0)
-        : ip(ip), port(port), transfer_speed(transfer_speed) {}
-};
-
-
 /**
  * @brief A classe FileManager é responsável pela gestão dos arquivos e chunks disponíveis para um peer em uma rede P2P.
  * 
@@ -50,7 +30,13 @@ private:
     std::string peer_id;  
     ///< ID do peer.
 
-    std::map<std::string, std::set<int>> local_chunks;
+    PeerQuality& peer_quality;
+    ///< Tabela com o RTT e a vazão medidos de cada peer, consultada na seleção de peers para download.
+
+    PeerTable& peer_table;
+    ///< Tabela que atribui um PeerId a cada peer. A localização dos chunks guarda apenas os PeerId.
+
+    std::map<std::string, std::set<ChunkId>> local_chunks;
     ///< Mapa que armazena os chunks locais disponíveis para cada arquivo.
     ///< A chave é o nome do arquivo.
     ///< O valor é um conjunto contendo cada ID dos chunks que o peer já possui para aquele arquivo.
@@ -58,16 +44,36 @@ private:
     std::map<std::string,std::mutex> local_chunks_mutex;
     ///< Mutexes para proteger o acesso a local_chunks.
 
-    std::unordered_map<std::string, int> file_chunks;
+    std::unordered_map<std::string, ChunkId> file_chunks;
     ///< Mapa que armazena o nome do arquivo que o peer quer buscar como chave
     ///< e o número total de chunks que ele possui como valor.
 
-    std::unordered_map<std::string, std::vector<std::vector<ChunkLocationInfo>>> chunk_location_info;
+    std::unordered_map<std::string, ByteCount> file_chunk_sizes;
+    ///< Tamanho dos chunks (exceto o último) de cada arquivo, quando informado nos metadados.
+    ///< Usado para localizar o chunk de um offset sem esperar pelos chunks anteriores.
+
+    std::unordered_map<std::string, ChunkRange> requested_ranges;
+    ///< Intervalo de chunks pedido nos downloads parciais. Arquivos sem entrada são baixados inteiros.
+
+    std::unordered_map<std::string, std::vector<ChunkId>> new_chunks;
+    ///< Chunks salvos que ainda não foram anunciados aos peers interessados (mensagens HAVE).
+
+    std::mutex new_chunks_mutex;
+    ///< Mutex que protege new_chunks.
+
+    std::mutex chunks_changed_mutex;
+    ///< Mutex que protege chunks_changed.
+
+    CancellationToken chunks_changed;
+    ///< Cancelado quando um novo chunk é salvo, acordando as leituras que esperam chunks (Peer::readFileRange).
+    ///< Substituído por um novo token a cada chunk salvo.
+
+    std::unordered_map<std::string, std::shared_ptr<ChunkLocationTable>> chunk_location_info;
     ///< Mapa que armazena informações sobre os peers que possuem cada chunk de um arquivo.
     ///< A chave é o nome do arquivo.
-    ///< O valor é um vetor onde cada índice representa um chunk do arquivo.
-    ///< Cada índice contém um vetor de ChunkLocationInfo, onde cada ChunkLocationInfo descreve um peer.
-    ///< que possui o chunk, incluindo seu IP, porta UDP e velocidade de transferência em bytes/segundo.
+    ///< O valor é a tabela com o mapa de bits dos chunks de cada peer e o número de réplicas de cada chunk.
+    ///< A seleção de peers recebe uma cópia do ponteiro, e a tabela só é copiada se for alterada enquanto
+    ///< essa cópia ainda estiver em uso. O IP, a porta UDP e a velocidade informada de cada peer ficam na PeerTable.
 
     std::unordered_map<std::string, std::mutex> chunk_location_info_mutex;
     ///< Mutex para garantir acesso seguro a chunk_location_info.
@@ -75,6 +81,86 @@ private:
     std::string directory;  
     ///< Diretório responsável pelo armazenamento dos arquivos do peer, incluindo o local onde novos chunks serão salvos.
 
+    std::mutex registry_mutex;
+    ///< Mutex que protege a estrutura dos mapas indexados por nome de arquivo (inserção e busca de entradas).
+    ///< Os dados de cada entrada continuam protegidos pelos mutexes do próprio arquivo.
+
+    /**
+     * @brief Retorna o mutex que protege os chunks locais de um arquivo, criando-o se necessário.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Referência ao mutex do arquivo em local_chunks_mutex.
+     */
+    std::mutex& getLocalChunksMutex(const std::string& file_name);
+
+    /**
+     * @brief Retorna o conjunto de chunks locais de um arquivo, criando-o se necessário.
+     * 
+     * Deve ser chamado com o mutex retornado por getLocalChunksMutex bloqueado.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Referência ao conjunto de chunks locais do arquivo.
+     */
+    std::set<ChunkId>& getLocalChunkSet(const std::string& file_name);
+
+    /**
+     * @brief Retorna o mutex que protege a localização dos chunks de um arquivo, criando-o se necessário.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Referência ao mutex do arquivo em chunk_location_info_mutex.
+     */
+    std::mutex& getChunkLocationInfoMutex(const std::string& file_name);
+
+    /**
+     * @brief Retorna a tabela de localização dos chunks de um arquivo, sem copiá-la.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Ponteiro compartilhado para a tabela, ou nulo se o arquivo não estiver sendo baixado.
+     */
+    std::shared_ptr<const ChunkLocationTable> getChunkLocationSnapshot(const std::string& file_name);
+
+    /**
+     * @brief Retorna o número total de chunks de um arquivo.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Número total de chunks ou 0 se o arquivo não foi inicializado.
+     */
+    ChunkId getTotalChunks(const std::string& file_name);
+
+    /**
+     * @brief Acorda as leituras que esperam chunks e guarda o chunk para ser anunciado (HAVE).
+     * 
+     * Chamado depois que um chunk é registrado. Pode ser chamado com o mutex do arquivo bloqueado.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param chunk Número do chunk registrado.
+     */
+    void notifyChunksChanged(const std::string& file_name, ChunkId chunk);
+
+    /**
+     * @brief Obtém o tamanho dos chunks de um arquivo, dos metadados ou dos chunks locais.
+     * 
+     * Todos os chunks, exceto o último, têm o mesmo tamanho: se os metadados não o informam, o
+     * primeiro chunk local que não é o último o determina, e o valor é guardado para as próximas
+     * leituras.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Tamanho dos chunks em bytes, ou 0 se ainda não for possível determiná-lo.
+     */
+    ByteCount findChunkSize(const std::string& file_name);
+
+    /**
+     * @brief Grava os chunks de um download parcial nas suas posições do arquivo de saída.
+     * 
+     * As partes do arquivo fora do intervalo não são gravadas e ficam como buracos (arquivo esparso).
+     * Deve ser chamado com o mutex do arquivo bloqueado.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param range Intervalo de chunks a ser gravado.
+     * @return true se todos os chunks do intervalo foram gravados, false caso contrário.
+     */
+    bool assembleRange(const std::string& file_name, const ChunkRange& range);
+
 public:
     /**
      * @brief Construtor da classe FileManager.
@@ -84,8 +170,10 @@ public:
      * diretório final.
      * 
      * @param peer_id ID do peer.
+     * @param peer_quality Tabela com o RTT e a vazão medidos de cada peer.
+     * @param peer_table Tabela que atribui um PeerId a cada peer.
      */
-    FileManager(const std::string& peer_id);
+    FileManager(const std::string& peer_id, PeerQuality& peer_quality, PeerTable& peer_table);
 
 
     /**
@@ -101,13 +189,15 @@ public:
     /**
      * @brief Carrega os metadados de um arquivo e retorna as informações.
      * 
-     * Lê um arquivo de metadados específico e extrai o nome do arquivo, o número total de chunks
-     * e o valor inicial de TTL. Retorna essas informações como uma tupla.
+     * Lê um arquivo de metadados específico e extrai o nome do arquivo, o número total de chunks,
+     * o valor inicial de TTL e, se houver uma quarta linha, o tamanho dos chunks. Retorna essas
+     * informações como uma tupla.
      * 
      * @param file_name Nome do arquivo que se deseja fazer a busca para carregar os metadados.
-     * @return Tupla contendo o nome do arquivo, total de chunks e TTL inicial. Retorna {"", -1, -1} se ocorrer um erro ao abrir o arquivo.
+     * @return Tupla contendo o nome do arquivo, total de chunks, TTL inicial e tamanho dos chunks (0 se não informado).
+     *         Retorna {"", -1, -1, 0} se ocorrer um erro ao abrir o arquivo.
      */
-    std::tuple<std::string, int, int> loadMetadata(const std::string& file_name);
+    std::tuple<std::string, ChunkId, int, ByteCount> loadMetadata(const std::string& file_name);
 
 
     /**
@@ -117,8 +207,39 @@ public:
      * 
      * @param file_name Nome do arquivo que o peer deseja buscar.
      * @param total_chunks Número total de chunks que compõem o arquivo.
+     * @param chunk_size Tamanho dos chunks em bytes (0 se não for conhecido).
      */
-    void initializeFileChunks(const std::string& file_name, int total_chunks);
+    void initializeFileChunks(const std::string& file_name, ChunkId total_chunks, ByteCount chunk_size = 0);
+
+
+    /**
+     * @brief Restringe o download de um arquivo aos chunks de um intervalo.
+     * 
+     * A seleção de peers passa a considerar apenas os chunks do intervalo, e o arquivo de saída é
+     * montado (de forma esparsa) assim que todos eles estiverem disponíveis.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param range Intervalo de chunks que deve ser baixado.
+     */
+    void setRequestedRange(const std::string& file_name, const ChunkRange& range);
+
+
+    /**
+     * @brief Retorna o intervalo de chunks pedido para um arquivo.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Intervalo pedido, ou todos os chunks do arquivo se não houver download parcial.
+     */
+    ChunkRange getRequestedRange(const std::string& file_name);
+
+
+    /**
+     * @brief Retorna o tamanho dos chunks de um arquivo informado nos metadados.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Tamanho dos chunks em bytes, ou 0 se não for conhecido.
+     */
+    ByteCount getChunkSize(const std::string& file_name);
 
 
     /**
@@ -134,11 +255,12 @@ public:
 
 
     /**
-     * @brief Limpa as informações de localização dos chunks e remove o mutex associado a um arquivo específico.
+     * @brief Limpa as informações de localização dos chunks de um arquivo específico.
      * 
      * Remove o file_name do mapa chunk_location_info e apaga os dados de localização de cada chunk,
-     * garantindo que a memória associada aos vetores internos seja liberada. Em seguida, remove o mutex 
-     * correspondente do mapa chunk_location_info_mutex. É chamado após um assembleFile bem sucedido.
+     * garantindo que a memória associada aos vetores internos seja liberada. O mutex correspondente
+     * em chunk_location_info_mutex é mantido, pois outras threads ainda podem estar aguardando por ele.
+     * É chamado após um assembleFile bem sucedido.
      * 
      * @param file_name Nome do arquivo cujas informações de localização dos chunks devem ser limpas.
      */
@@ -152,20 +274,37 @@ public:
      * a velocidade de transferência e a quantidade de chunks já atribuída a cada peer. O objetivo é minimizar o tempo total
      * de download ao selecionar o peer mais rápido disponível para cada chunk, ajustando para evitar sobrecarga em um único peer.
      * 
-     * A função prioriza os peers com maior velocidade de transferência e, em caso de empate, atribui o chunk ao peer com menos
-     * chunks já alocados, garantindo uma distribuição equilibrada e eficiente. Essa abordagem é independente do tamanho real dos chunks.
+     * Cada chunk vai para o peer que terminaria antes de recebê-lo, ou seja, o de menor (chunks já alocados + 1) / velocidade:
+     * um peer duas vezes mais rápido recebe cerca do dobro de chunks, e em caso de empate vence o mais rápido. Peers com
+     * velocidade efetiva 0 só recebem os chunks que nenhum outro peer possui. Essa abordagem é independente do tamanho real dos chunks.
+     * Os chunks com menos réplicas são distribuídos primeiro, enquanto há mais peers livres, e a lista de cada peer é devolvida em ordem crescente.
+     * A velocidade considerada é a efetiva (ver PeerQuality::getEffectiveSpeed): a vazão medida e o RTT do peer prevalecem sobre
+     * a velocidade informada por ele. A seleção usa apenas os PeerId: os endereços são resolvidos na PeerTable por quem envia os pedidos.
+     * 
+     * @param file_name O nome do arquivo para o qual os chunks serão distribuídos entre os peers.
+     * @return Um mapa associando cada peer (PeerId) a uma lista de chunks que ele deve solicitar.
+     */
+    std::unordered_map<PeerId, std::vector<ChunkId>> selectPeersForChunkDownload(const std::string& file_name);
+
+
+    /**
+     * @brief Seleciona peers para o download de apenas alguns chunks de um arquivo.
+     * 
+     * Usa os mesmos critérios da versão que considera todos os chunks. Usado pelo download
+     * sequencial, que pede apenas os chunks da janela atual.
      * 
      * @param file_name O nome do arquivo para o qual os chunks serão distribuídos entre os peers.
-     * @return Um mapa associando cada peer (identificado por "ip:port") a uma lista de chunks que ele deve solicitar.
+     * @param chunk_ids Chunks a serem distribuídos. Chunks sem peers conhecidos são ignorados.
+     * @return Um mapa associando cada peer (PeerId) a uma lista de chunks que ele deve solicitar.
      */
-    std::unordered_map<std::string, std::vector<int>> selectPeersForChunkDownload(const std::string& file_name);
+    std::unordered_map<PeerId, std::vector<ChunkId>> selectPeersForChunkDownload(const std::string& file_name, const std::vector<ChunkId>& chunk_ids);
 
 
     /**
      * @brief Armazena informações recebidas sobre a localização dos chunks.
      * 
-     * Insere as informações de um peer no mapa chunk_location_info.
-     * Essas informações incluem o IP, porta UDP e velocidade de transferência em bytes/segundo do peer que possui tais chunks.
+     * Combina os chunks anunciados com o mapa de bits do peer em chunk_location_info, atribuindo um novo
+     * PeerId se o peer ainda não for conhecido. A velocidade de transferência em bytes/segundo informada é guardada na PeerTable.
      * A função usa mutexes para garantir que múltiplas threads possam acessar o mapa com segurança.
      * 
      * @param file_name O nome do arquivo associado aos chunks.
@@ -174,7 +313,19 @@ public:
      * @param port A porta UDP do peer que enviou a resposta.
      * @param transfer_speed A velocidade de transferência em bytes/segundo do peer que enviou a resposta.
      */
-    void storeChunkLocationInfo(const std::string& file_name, const std::vector<int>& chunk_ids, const std::string& ip, int port, int transfer_speed);
+    void storeChunkLocationInfo(const std::string& file_name, const std::vector<ChunkId>& chunk_ids, const std::string& ip, int port, ByteCount transfer_speed);
+
+
+    /**
+     * @brief Conta os chunks de um intervalo que o peer não possui e para os quais nenhum peer é conhecido.
+     * 
+     * Usado para encerrar as buscas por passeios aleatórios assim que todos os chunks têm uma fonte.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param range Intervalo de chunks de interesse.
+     * @return Número de chunks ainda sem localização (0 se o arquivo não estiver sendo baixado).
+     */
+    ChunkId countUnlocatedChunks(const std::string& file_name, const ChunkRange& range);
 
 
     /**
@@ -186,7 +337,15 @@ public:
      * @param file_name Nome do arquivo.
      * @return Vetor contendo os chunks disponíveis localmente.
      */
-    std::vector<int> getAvailableChunks(const std::string& file_name);
+    std::vector<ChunkId> getAvailableChunks(const std::string& file_name);
+
+
+    /**
+     * @brief Retorna os nomes dos arquivos dos quais o peer possui pelo menos um chunk.
+     * 
+     * @return Nomes dos arquivos.
+     */
+    std::vector<std::string> getLocalFileNames();
 
 
     /**
@@ -199,7 +358,7 @@ public:
      * @param chunk Número do chunk.
      * @return Caminho completo do chunk.
      */
-    std::string getChunkPath(const std::string& file_name, int chunk);
+    std::string getChunkPath(const std::string& file_name, ChunkId chunk);
 
 
     /**
@@ -212,30 +371,90 @@ public:
      * @param chunk Número do chunk.
      * @return true se possuir o chunk, false caso contrário.
      */
-    bool hasChunk(const std::string& file_name, int chunk);
+    bool hasChunk(const std::string& file_name, ChunkId chunk);
+
+
+    /**
+     * @brief Salva um chunk copiando os dados de um descritor de arquivo.
+     * 
+     * Usado pelo transporte local, em que o peer remetente está no mesmo host e envia o descritor
+     * do seu próprio arquivo de chunk. Os dados são copiados desse descritor para o arquivo
+     * temporário do ChunkWriter dentro do kernel (copy_file_range), e o chunk só aparece no
+     * caminho final depois de copiado por completo. Não há hash: os bytes vêm do próprio
+     * arquivo do remetente, sem passar pela rede.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param chunk Número do chunk.
+     * @param source_fd Descritor do arquivo de chunk do peer remetente.
+     * @param size Tamanho do chunk em bytes.
+     * @return true se o chunk foi copiado por completo e confirmado, false caso contrário.
+     */
+    bool saveChunkFromFd(const std::string& file_name, ChunkId chunk, int source_fd, ByteCount size);
 
 
     /**
-     * @brief Salva um chunk recebido no diretório do peer.
+     * @brief Confirma um chunk gravado em streaming e o registra como disponível.
      * 
-     * Salva os dados recebidos de um chunk no diretório designado do peer. O chunk é gravado
-     * no sistema de arquivos para que o peer possa armazená-lo e acessá-lo mais tarde.
+     * O chunk é gravado aos poucos por um ChunkWriter enquanto é recebido. Depois que todos
+     * os bytes chegam e o hash é conferido, este método torna o chunk visível no caminho final,
+     * o adiciona aos chunks locais e tenta montar o arquivo.
      * 
      * @param file_name Nome do arquivo.
      * @param chunk Número do chunk.
-     * @param data Dados do chunk.
-     * @param size Tamanho dos dados.
+     * @param writer ChunkWriter com os bytes do chunk já gravados.
+     * @return true se o chunk foi confirmado, false caso contrário.
+     */
+    bool commitChunk(const std::string& file_name, ChunkId chunk, ChunkWriter& writer);
+
+
+    /**
+     * @brief Lê a parte de um trecho do arquivo que já está disponível, sem esperar por chunks.
+     * 
+     * Lê a partir de offset até o fim do trecho, do arquivo, ou até o primeiro chunk que ainda
+     * não foi recebido. Se o tamanho dos chunks não constar nos metadados, ele é obtido do
+     * primeiro chunk recebido (ver findChunkSize), e os chunks anteriores ao trecho não precisam
+     * estar disponíveis. A espera pelos chunks que faltam é feita por Peer::readFileRange.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param offset Posição inicial do trecho em bytes.
+     * @param buffer Destino dos bytes lidos.
+     * @param length Número de bytes a serem lidos.
+     * @param missing_chunk Indica, no retorno, se a leitura parou num chunk que ainda não foi recebido
+     *                      (ou porque o tamanho dos chunks ainda não é conhecido).
+     * @return Número de bytes lidos.
+     */
+    ByteCount readFileRange(const std::string& file_name, ByteCount offset, char* buffer, ByteCount length, bool& missing_chunk);
+
+
+    /**
+     * @brief Retorna o token cancelado quando o próximo chunk for salvo.
+     * 
+     * As leituras obtêm o token antes de verificar os chunks e esperam por ele, assim um chunk
+     * salvo entre a verificação e a espera não é perdido.
+     * 
+     * @return Token do próximo chunk salvo.
+     */
+    CancellationToken getChunksChangedToken();
+
+
+    /**
+     * @brief Retira os chunks salvos desde a última chamada, para serem anunciados.
+     * 
+     * @param max_chunks Número máximo de chunks retirados. Os demais continuam guardados para a próxima chamada.
+     * @return Chunks novos agrupados por arquivo.
      */
-    void saveChunk(const std::string& file_name, int chunk, const char* data, size_t size);
+    std::unordered_map<std::string, std::vector<ChunkId>> takeNewChunks(std::size_t max_chunks);
 
 
     /**
      * @brief Concatena todos os chunks para formar o arquivo completo.
      * 
      * Combina todos os chunks de um arquivo que foram baixados para formar o arquivo original.
+     * Em um download parcial, monta o arquivo esparso assim que os chunks do intervalo estiverem
+     * disponíveis (ver assembleRange).
      * 
      * @param file_name Nome do arquivo.
-     * @return true se conseguiu criar o novo arquivo com base em todos os chunks ou false, do contrário.
+     * @return true se conseguiu criar o novo arquivo com base em todos os chunks (ou nos chunks do intervalo pedido) ou false, do contrário.
      */
     bool assembleFile(const std::string& file_name);
 };
@@ -1,75 +1,286 @@
 #include "Peer.h"
+#include <chrono>
 #include <thread>
 #include <iostream>
 #include <fstream>
+#include <csignal>
+#include <fcntl.h>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 
 /**
  * @brief Construtor da classe Peer. Também inicializa os servidores UDP e TCP e o gerenciador de arquivos.
  */
-Peer::Peer(int id, const std::string& ip, int udp_port, int tcp_port, int transfer_speed, const std::vector<std::tuple<std::string, int>> neighbors)
-    : id(id), ip(ip), udp_port(udp_port), tcp_port(tcp_port), transfer_speed(transfer_speed), neighbors(neighbors),
-      file_manager(std::to_string(id)),
-      tcp_server(ip, tcp_port, id, transfer_speed, file_manager),
-      udp_server(ip, udp_port, tcp_port, id, transfer_speed, file_manager, tcp_server) {}
+Peer::Peer(int id, const std::string& ip, int udp_port, int tcp_port, ByteCount transfer_speed, const std::vector<std::tuple<std::string, int>> neighbors,
+           const std::vector<std::tuple<std::string, int>> super_peers)
+    : id(id), ip(ip), udp_port(udp_port), tcp_port(tcp_port), transfer_speed(transfer_speed), neighbors(neighbors), super_peers(super_peers),
+      executor("peer-" + std::to_string(id), Constants::EXECUTOR_THREADS),
+      event_loop(executor),
+      file_manager(std::to_string(id), peer_quality, peer_table),
+      tcp_server(ip, tcp_port, udp_port, id, transfer_speed, file_manager, peer_quality, event_loop),
+      udp_server(ip, udp_port, tcp_port, id, transfer_speed, file_manager, tcp_server, peer_quality, peer_table, event_loop) {}
 
 
 /**
  * @brief Inicia os servidores TCP e UDP.
  */
-void Peer::start(const std::vector<std::string>& file_names) {
+void Peer::start(const std::vector<std::string>& file_names, bool sequential, bool dht, bool walk, const std::string& stream_dir) {
+    sequential_download = sequential;
+    dht_lookup = dht;
+    random_walk = walk;
+    stream_directory = stream_dir;
+
     // Inicializa os vizinhos na lista do servidor UDP
     udp_server.setUDPNeighbors(neighbors);
 
+    // Define o papel do peer (super-peer ou folha) se a rede usar super-peers
+    udp_server.setSuperPeers(super_peers);
+
     // Carrega os chunks locais do peer
     file_manager.loadLocalChunks();
 
-    // Inicia o servidor TCP em uma thread separada
-    std::thread tcp_thread(&TCPServer::run, &tcp_server);
+    // Bloqueia SIGINT e SIGTERM antes de criar as threads (que herdam a máscara) e os lê por um signalfd
+    sigset_t signal_mask;
+    sigemptyset(&signal_mask);
+    sigaddset(&signal_mask, SIGINT);
+    sigaddset(&signal_mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signal_mask, nullptr);
+    int signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
 
-    // Inicia o servidor UDP em uma thread separada
+    // Inicia o servidor UDP em uma thread separada (as mensagens são processadas no EventLoop)
     std::thread udp_thread(&UDPServer::run, &udp_server);
 
-    // Espera para dar tempo de inicializar todos os servidores dos outros peers
-    std::this_thread::sleep_for(std::chrono::seconds(Constants::SERVER_STARTUP_DELAY_SECONDS));
+    // Inicia o servidor TCP e o do transporte local (peers no mesmo host)
+    event_loop.spawn(tcp_server.run());
+    event_loop.spawn(tcp_server.runLocal());
+
+    // Anuncia os chunks novos aos peers que buscaram o arquivo recentemente
+    event_loop.spawn(udp_server.runHaveAnnouncer(), TaskPriority::LOW);
+
+    // Troca com os vizinhos os filtros de Bloom que guiam o encaminhamento de DISCOVERY
+    event_loop.spawn(udp_server.runBloomExchange(), TaskPriority::LOW);
+
+    // Mede o RTT dos vizinhos e dos peers que possuem chunks
+    event_loop.spawn(udp_server.runQualityProber(), TaskPriority::LOW);
+
+    // Troca listas de vizinhos e ajusta a vizinhança em execução
+    event_loop.spawn(udp_server.runOverlayMaintenance(), TaskPriority::LOW);
+
+    // Envia as respostas agregadas pelo caminho inverso das buscas
+    event_loop.spawn(udp_server.runAggregateFlusher(), TaskPriority::LOW);
+
+    // Registra os chunks da folha no seu super-peer
+    event_loop.spawn(udp_server.runSuperPeerRegistration(), TaskPriority::LOW);
+
+    // Publica na DHT os arquivos dos quais o peer possui chunks (mesmo sem usar a DHT nas próprias buscas)
+    event_loop.spawn(udp_server.runDHTPublisher(), TaskPriority::LOW);
+
+    // Trata o encerramento do peer
+    event_loop.spawn(handleSignals(signal_fd));
+
+    // Aplica as alterações de config.txt e topologia.txt sem reiniciar o peer
+    int inotify_fd = -1;
+    if (Constants::CONFIG_HOT_RELOAD_ENABLED) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0 || inotify_add_watch(inotify_fd, Constants::BASE_PATH.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            perror("Erro ao observar os arquivos de configuração");
+        } else {
+            event_loop.spawn(watchConfiguration(inotify_fd), TaskPriority::LOW);
+        }
+    }
+
+    // Registra a utilização do pool de threads e do pool de buffers, os contadores de buscas e a qualidade dos peers
+    if (Constants::EXECUTOR_METRICS_INTERVAL_SECONDS > 0) {
+        event_loop.spawn(logRuntimeMetrics(), TaskPriority::LOW);
+    }
 
-    // Threads para busca de cada arquivo
-    std::vector<std::thread> threads;
+    // Inicia a busca dos arquivos
+    event_loop.spawn(searchFiles(file_names));
 
-    // Cria uma thread para cada file_name chamando Peer::searchFile e adiciona ao vetor
+    // Executa o EventLoop até o peer ser encerrado
+    event_loop.run();
+
+    // Espera a finalização da thread do servidor UDP
+    udp_server.stop();
+    udp_thread.join();
+    close(signal_fd);
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+}
+
+
+/**
+ * @brief Aguarda a inicialização dos outros peers e inicia a busca de cada arquivo.
+ */
+Task<void> Peer::searchFiles(std::vector<std::string> file_names) {
+    // Espera para dar tempo de inicializar todos os servidores dos outros peers
+    co_await event_loop.sleep(std::chrono::seconds(Constants::SERVER_STARTUP_DELAY_SECONDS));
+
+    // Cria uma corrotina para cada file_name chamando Peer::searchFile
     for (const auto& file_name : file_names) {
-        threads.emplace_back(&Peer::searchFile, this, file_name);
+        event_loop.spawn(searchFile(file_name));
     }
+}
+
 
-    // Aguarda todas as threads de busca terminarem (join)
-    for (auto& th : threads) {
-        if (th.joinable()) {
-            th.join();
+/**
+ * @brief Aguarda SIGINT ou SIGTERM e encerra o EventLoop.
+ */
+Task<void> Peer::handleSignals(int signal_fd) {
+    while (co_await event_loop.readable(signal_fd)) {
+        struct signalfd_siginfo signal_info{};
+        if (read(signal_fd, &signal_info, sizeof(signal_info)) == sizeof(signal_info)) {
+            logMessage(LogType::INFO, "Sinal " + std::to_string(signal_info.ssi_signo) + " recebido. Encerrando o peer " + std::to_string(id) + "...");
+            event_loop.stop();
+            co_return;
         }
     }
+}
 
-    // Espera a finalização das thread do servidor TCP e UDP
-    tcp_thread.join();
-    udp_thread.join();
+
+/**
+ * @brief Observa config.txt e topologia.txt e aplica as alterações sem reiniciar o peer.
+ */
+Task<void> Peer::watchConfiguration(int inotify_fd) {
+    const std::string config_name = std::filesystem::path(Constants::CONFIG_PATH).filename();
+    const std::string topology_name = std::filesystem::path(Constants::TOPOLOGY_PATH).filename();
+
+    // Lê as notificações pendentes e indica se alguma é de um dos arquivos observados
+    auto drainEvents = [&]() {
+        alignas(struct inotify_event) char buffer[4096];
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char* position = buffer; position < buffer + length;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(position);
+                if (event->len > 0 && (event->name == config_name || event->name == topology_name)) {
+                    changed = true;
+                }
+                position += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return changed;
+    };
+
+    while (co_await event_loop.readable(inotify_fd)) {
+        if (!drainEvents()) {
+            continue;
+        }
+
+        // Espera os arquivos pararem de mudar antes de lê-los
+        do {
+            if (!co_await event_loop.sleep(std::chrono::milliseconds(Constants::CONFIG_RELOAD_DEBOUNCE_MS))) {
+                co_return;
+            }
+        } while (drainEvents());
+
+        reloadConfiguration();
+    }
+}
+
+
+/**
+ * @brief Recarrega config.txt e topologia.txt e aplica as diferenças em execução.
+ */
+void Peer::reloadConfiguration() {
+    auto config = ConfigManager::loadConfig();
+    auto topology = ConfigManager::loadTopology();
+    if (config.size() == 0 || topology.size() == 0) {
+        logMessage(LogType::ERROR, "Configuração não recarregada: corrija os erros acima. A configuração atual foi mantida.");
+        return;
+    }
+
+    std::size_t config_index = config.find(id);
+    if (config_index == config.size() || topology.find(id) == topology.size()) {
+        logMessage(LogType::ERROR, "Peer " + std::to_string(id) + " ausente da nova configuração ou topologia. A configuração atual foi mantida.");
+        return;
+    }
+    if (config.getIp(config_index) != ip || config.udp_ports[config_index] != udp_port) {
+        logMessage(LogType::ERROR, "O IP e a porta do peer " + std::to_string(id) + " só mudam ao reiniciá-lo. As demais alterações serão aplicadas.");
+    }
+
+    // Velocidade de transferência: vale para os próximos blocos dos envios em andamento e para as próximas respostas
+    ByteCount new_speed = config.transfer_speeds[config_index];
+    if (new_speed != transfer_speed) {
+        logMessage(LogType::INFO, "Velocidade de transferência alterada de " + std::to_string(transfer_speed) + " para " + std::to_string(new_speed) + " bytes/segundo.");
+        transfer_speed = new_speed;
+        tcp_server.setTransferSpeed(new_speed);
+        udp_server.setTransferSpeed(new_speed);
+    }
+
+    // Vizinhos de topologia.txt
+    udp_server.reloadUDPNeighbors(ConfigManager::expandNeighbors(topology, config, id));
+    logMessage(LogType::INFO, "Configuração recarregada de " + Constants::CONFIG_PATH + " e " + Constants::TOPOLOGY_PATH + ".");
+}
+
+
+/**
+ * @brief Registra periodicamente no log a utilização do pool de threads e do pool de buffers, os contadores de buscas e a qualidade dos peers.
+ */
+Task<void> Peer::logRuntimeMetrics() {
+    const auto interval = std::chrono::seconds(Constants::EXECUTOR_METRICS_INTERVAL_SECONDS);
+    while (!event_loop.isStopping()) {
+        bool completed = co_await event_loop.sleep(interval);
+        if (!completed) {
+            break;
+        }
+        logMessage(LogType::INFO, executor.describeMetrics());
+        logMessage(LogType::INFO, BufferPool::instance().describeStats());
+        logMessage(LogType::INFO, udp_server.describeQueryStats());
+        logMessage(LogType::INFO, peer_quality.describe());
+    }
 }
 
 
 /**
  * @brief Inicia a busca por chunks de um arquivo na rede.
  */
-void Peer::searchFile(const std::string& file_name) {
+Task<void> Peer::searchFile(std::string file_name) {
+    // Download parcial: "<nome>@<offset>+<tamanho>"
+    ByteCount range_offset = 0, range_length = 0;
+    bool partial = parseByteRangeSpec(file_name, file_name, range_offset, range_length);
+
     // Carrega as informações do arquivo de metadados (nome do arquivo, número total de chunks, e TTL inicial)
-    auto [file_name_returned, total_chunks, initial_ttl] = file_manager.loadMetadata(file_name);
+    auto [file_name_returned, total_chunks, initial_ttl, chunk_size] = file_manager.loadMetadata(file_name);
 
     // Verifica se a leitura foi bem-sucedida
     if (total_chunks != -1 && initial_ttl != -1) {
        // Inicializa a estrutura responsável por armazenar as informações de número total de chunks para um arquivo
-        file_manager.initializeFileChunks(file_name_returned, total_chunks);
+        file_manager.initializeFileChunks(file_name_returned, total_chunks, chunk_size);
+
+        // Converte o trecho pedido nos chunks que o contêm
+        if (partial) {
+            if (chunk_size == 0) {
+                logMessage(LogType::ERROR, "Download parcial de " + file_name_returned + " requer o tamanho dos chunks na quarta linha de " + file_name + ".p2p.");
+                co_return;
+            }
+            ChunkRange range{static_cast<ChunkId>(range_offset / chunk_size),
+                             static_cast<ChunkId>(std::min<ByteCount>(total_chunks, (range_offset + range_length + chunk_size - 1) / chunk_size))};
+            if (range.size() == 0) {
+                logMessage(LogType::ERROR, "Trecho pedido de " + file_name_returned + " está além do fim do arquivo.");
+                co_return;
+            }
+            file_manager.setRequestedRange(file_name_returned, range);
+            logMessage(LogType::INFO, "Download parcial de " + file_name_returned + ": bytes " + std::to_string(range_offset) + " a " +
+                       std::to_string(range_offset + range_length - 1) + " (chunks " + std::to_string(range.first) + " a " + std::to_string(range.end - 1) + ").");
+        }
 
         // Inicializa a estrutura responsável por armazenar informações de localização dos chunks
         file_manager.initializeChunkLocationInfo(file_name_returned);
 
+        // Grava o arquivo (ou o trecho pedido) à medida que os chunks chegam
+        if (!stream_directory.empty()) {
+            ByteCount stream_length = partial ? range_length : std::numeric_limits<ByteCount>::max() - range_offset;
+            event_loop.spawn(streamFile(file_name_returned, range_offset, stream_length));
+        }
+
         // Começa a descoberta dos chunks
-        discoverAndRequestChunks(file_name_returned, total_chunks, initial_ttl);
+        co_await discoverAndRequestChunks(file_name_returned, total_chunks, initial_ttl);
     }
 }
 
@@ -77,7 +288,7 @@ void Peer::searchFile(const std::string& file_name) {
 /**
  * @brief Inicia o processo de descoberta e solicitação de chunks.
  */
-void Peer::discoverAndRequestChunks(const std::string& file_name, int total_chunks, int initial_ttl) {
+Task<void> Peer::discoverAndRequestChunks(std::string file_name, ChunkId total_chunks, int initial_ttl) {
     // Monta um PeerInfo para o peer original que está enviando a solicitação
     PeerInfo original_sender_info(ip, udp_port);
 
@@ -90,15 +301,210 @@ void Peer::discoverAndRequestChunks(const std::string& file_name, int total_chun
 
     // Se não conseguir montar o arquivo, envia uma solicitação de descoberta e espera por respostas
     if (!assembler) {
-        // Envia a mensagem de descoberta para seus vizinhos
-        udp_server.sendChunkDiscoveryMessage(file_name, total_chunks, initial_ttl, original_sender_info);
+        ChunkRange range = file_manager.getRequestedRange(file_name);
+
+        // Outra busca local do mesmo arquivo já está em andamento e baixa os mesmos chunks
+        if (udp_server.coalesceQuery(file_name, original_sender_info, range, initial_ttl) == QueryCoalescing::DUPLICATE) {
+            logMessage(LogType::INFO, "Busca de " + file_name + " agrupada com a busca em andamento do mesmo arquivo.");
+            co_return;
+        }
+
+        // Modo DHT: pergunta diretamente aos provedores encontrados
+        std::vector<PeerInfo> providers;
+        if (dht_lookup) {
+            providers = co_await udp_server.findProviders(file_name);
+            for (const auto& provider : providers) {
+                udp_server.sendDirectDiscoveryMessage(file_name, total_chunks, provider, range);
+            }
+            if (providers.empty()) {
+                logMessage(LogType::INFO, "Nenhum provedor de " + file_name + " encontrado na DHT. Usando a inundação.");
+            }
+        }
+
+        // Pergunta primeiro aos peers da rede local, com um único datagrama ao grupo multicast
+        bool located = !providers.empty();
+        if (!located && udp_server.isMulticastEnabled()) {
+            udp_server.sendMulticastDiscoveryMessage(file_name, total_chunks, range);
+            co_await event_loop.sleep(std::chrono::milliseconds(Constants::MULTICAST_WAIT_MS));
+            located = file_manager.countUnlocatedChunks(file_name, range) == 0;
+            if (located) {
+                logMessage(LogType::INFO, "Todos os chunks de " + file_name + " localizados na rede local. A busca pelos vizinhos não é necessária.");
+            }
+        }
+
+        // Envia walkers, a busca pela camada de super-peers ou a mensagem de descoberta para seus vizinhos
+        if (!located && random_walk) {
+            udp_server.startRandomWalk(file_name, total_chunks, range);
+        } else if (!located && udp_server.hasSuperPeers()) {
+            udp_server.sendSuperPeerDiscoveryMessage(file_name, total_chunks, range);
+        } else if (!located) {
+            co_await udp_server.sendChunkDiscoveryMessage(file_name, total_chunks, initial_ttl, original_sender_info, range);
+        }
 
         // Espera por respostas
-        udp_server.waitForResponses(file_name);
+        co_await udp_server.waitForResponses(file_name);
     
-        // Envia solicitações de chunks aos peers selecionados
-        udp_server.sendChunkRequestMessage(file_name);
+        // Envia solicitações de chunks aos peers selecionados (todos de uma vez ou em ordem)
+        if (sequential_download) {
+            co_await downloadSequentially(file_name);
+        } else {
+            udp_server.sendChunkRequestMessage(file_name);
+        }
     } else {
         logMessage(LogType::INFO, "O peer " + std::to_string(id) + " (" + ip + ":" + std::to_string(udp_port) + ") já possuí todos os chunks para " + file_name + ".");
     }
 }
+
+
+/**
+ * @brief Baixa os chunks de um arquivo em ordem, com uma janela deslizante.
+ */
+Task<void> Peer::downloadSequentially(std::string file_name) {
+    using Clock = std::chrono::steady_clock;
+    const auto request_timeout = std::chrono::seconds(Constants::SEQUENTIAL_REQUEST_TIMEOUT_SECONDS);
+    const auto poll_interval = std::chrono::milliseconds(Constants::SEQUENTIAL_POLL_INTERVAL_MS);
+    const auto source_wait_timeout = std::chrono::seconds(Constants::SEQUENTIAL_SOURCE_WAIT_SECONDS);
+
+    const ChunkRange range = file_manager.getRequestedRange(file_name); // Todos os chunks, ou apenas os de um download parcial
+    std::map<ChunkId, Clock::time_point> in_flight;                     // Chunks pedidos e o momento do pedido
+    ChunkId first_missing = range.first;                                // Início da janela: tudo antes dele já está em disco
+    std::optional<Clock::time_point> waiting_for_source_since;          // Momento em que o primeiro chunk que falta ficou sem fonte conhecida
+
+    logMessage(LogType::INFO, "Download sequencial de " + file_name + " iniciado (janela de " + std::to_string(Constants::SEQUENTIAL_WINDOW_CHUNKS) + " chunks).");
+
+    while (!event_loop.isStopping()) {
+        // Avança o início da janela sobre os chunks já recebidos
+        ChunkId previous_first_missing = first_missing;
+        while (first_missing < range.end && file_manager.hasChunk(file_name, first_missing)) {
+            in_flight.erase(first_missing);
+            first_missing++;
+        }
+        if (first_missing != previous_first_missing) {
+            logMessage(LogType::INFO, "Download sequencial de " + file_name + ": chunks " + std::to_string(range.first) + " a " + std::to_string(first_missing - 1) + " disponíveis para leitura.");
+        }
+        if (first_missing >= range.end) {
+            break;
+        }
+
+        // Seleciona os chunks da janela que ainda não foram pedidos ou cujo pedido expirou
+        auto now = Clock::now();
+        std::vector<ChunkId> to_request;
+        ChunkId window_end = std::min(range.end, first_missing + Constants::SEQUENTIAL_WINDOW_CHUNKS);
+        for (ChunkId chunk = first_missing; chunk < window_end; ++chunk) {
+            if (file_manager.hasChunk(file_name, chunk)) {
+                in_flight.erase(chunk);
+                continue;
+            }
+            auto it = in_flight.find(chunk);
+            if (it == in_flight.end() || now - it->second >= request_timeout) {
+                to_request.push_back(chunk);
+            }
+        }
+
+        if (!to_request.empty()) {
+            for (const ChunkId chunk : udp_server.sendChunkRequestMessage(file_name, to_request)) {
+                in_flight[chunk] = now;
+            }
+        }
+
+        // Nenhuma fonte conhecida para o primeiro chunk que falta: continua verificando, pois uma fonte pode
+        // ser anunciada depois (HAVE), e só desiste se nenhuma aparecer dentro do tempo limite
+        if (in_flight.find(first_missing) == in_flight.end()) {
+            if (!waiting_for_source_since) {
+                waiting_for_source_since = now;
+                logMessage(LogType::INFO, "Download sequencial de " + file_name + ": nenhum peer conhecido possui o chunk " + std::to_string(first_missing) + ". Aguardando uma fonte.");
+            } else if (now - *waiting_for_source_since >= source_wait_timeout) {
+                logMessage(LogType::ERROR, "Download sequencial de " + file_name + " interrompido: nenhum peer anunciou o chunk " + std::to_string(first_missing) + " em " + std::to_string(Constants::SEQUENTIAL_SOURCE_WAIT_SECONDS) + " segundos.");
+                break;
+            }
+        } else {
+            waiting_for_source_since.reset();
+        }
+
+        bool completed = co_await event_loop.sleep(poll_interval);
+        if (!completed) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Lê um trecho de um arquivo, esperando apenas pelos chunks que contêm o trecho.
+ */
+Task<ByteCount> Peer::readFileRange(std::string file_name, ByteCount offset, char* buffer, ByteCount length) {
+    const auto recheck_interval = std::chrono::milliseconds(Constants::RANGE_READ_RECHECK_INTERVAL_MS);
+
+    ByteCount total_read = 0;
+    while (total_read < length && !event_loop.isStopping()) {
+        // O token é obtido antes da leitura: um chunk salvo depois dela encerra a espera imediatamente
+        CancellationToken chunks_changed = file_manager.getChunksChangedToken();
+        bool missing_chunk = false;
+        total_read += file_manager.readFileRange(file_name, offset + total_read, buffer + total_read, length - total_read, missing_chunk);
+
+        // Fim do arquivo ou erro de leitura
+        if (!missing_chunk) {
+            break;
+        }
+        co_await event_loop.sleep(recheck_interval, chunks_changed);
+    }
+    co_return total_read;
+}
+
+
+/**
+ * @brief Grava um arquivo (ou o trecho pedido) em stream_directory à medida que é baixado.
+ */
+Task<void> Peer::streamFile(std::string file_name, ByteCount offset, ByteCount length) {
+    std::string output_path = stream_directory + "/" + file_name;
+    int output_fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (output_fd < 0) {
+        perror("Erro ao criar o arquivo da leitura em streaming");
+        co_return;
+    }
+
+    BufferPool::Buffer window_buffer = BufferPool::instance().acquire(Constants::CHUNK_STREAM_WINDOW_SIZE);
+    if (!window_buffer) {
+        logMessage(LogType::ERROR, "Sem memória para a leitura em streaming de " + file_name + ".");
+        close(output_fd);
+        co_return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsedMilliseconds = [&]() {
+        return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    };
+
+    ByteCount total_streamed = 0;
+    while (total_streamed < length) {
+        ByteCount window_length = std::min<ByteCount>(Constants::CHUNK_STREAM_WINDOW_SIZE, length - total_streamed);
+        ByteCount bytes_read = co_await readFileRange(file_name, offset + total_streamed, window_buffer.data(), window_length);
+
+        // Grava a janela lida no arquivo de saída
+        ByteCount bytes_written = 0;
+        while (bytes_written < bytes_read) {
+            ssize_t written = write(output_fd, window_buffer.data() + bytes_written, bytes_read - bytes_written);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0) {
+                perror("Erro ao gravar a leitura em streaming");
+                break;
+            }
+            bytes_written += written;
+        }
+
+        if (total_streamed == 0 && bytes_written > 0) {
+            logMessage(LogType::INFO, "Leitura em streaming de " + file_name + ": primeiros " + std::to_string(bytes_written) + " bytes disponíveis em " + elapsedMilliseconds() + " ms.");
+        }
+        total_streamed += bytes_written;
+
+        // Fim do arquivo, erro de gravação ou encerramento do peer
+        if (bytes_written < window_length) {
+            break;
+        }
+    }
+
+    close(output_fd);
+    logMessage(LogType::INFO, "Leitura em streaming de " + file_name + " encerrada: " + std::to_string(total_streamed) + " bytes gravados em " + output_path + " em " + elapsedMilliseconds() + " ms.");
+}
@@ -1,6 +1,7 @@
 #ifndef PEER_H
 #define PEER_H
 
+#include "AsyncRuntime.h"
 #include "ConfigManager.h"
 #include "FileManager.h"
 #include "TCPServer.h"
@@ -25,11 +26,20 @@ private:
     const std::string ip;                                               ///< Endereço IP atribuído ao peer.
     const int udp_port;                                                 ///< Porta UDP usada para descoberta de chunks de um arquivo.
     const int tcp_port;                                                 ///< Porta TCP usada para transferência de chunks de um arquivo.
-    const int transfer_speed;                                           ///< Capacidade de transferência de dados do peer em bytes/segundo.
+    ByteCount transfer_speed;                                           ///< Capacidade de transferência de dados do peer em bytes/segundo. Atualizada quando config.txt muda.
     const std::vector<std::tuple<std::string, int>> neighbors;          ///< Lista de vizinhos diretos do peer, incluindo seus IPs e portas UDP.
+    const std::vector<std::tuple<std::string, int>> super_peers;        ///< Super-peers da rede (IPs e portas UDP). Vazio se os super-peers estiverem desativados.
+    Executor executor;                                                  ///< Pool de threads compartilhado por rede, disco e agendamento.
+    EventLoop event_loop;                                               ///< Runtime de corrotinas que executa a descoberta, as transferências e o processamento de mensagens.
+    PeerQuality peer_quality;                                           ///< Tabela com o RTT e a vazão medidos de cada peer conhecido.
+    PeerTable peer_table;                                               ///< Tabela que atribui um PeerId compacto a cada peer com chunks conhecido.
     FileManager file_manager;                                           ///< Gerenciador responsável por lidar com os arquivos e chunks do peer.
     TCPServer tcp_server;                                               ///< Servidor TCP usado para transferir chunks de arquivos entre peers.
     UDPServer udp_server;                                               ///< Servidor UDP usado para descoberta de chunks de arquivos na rede P2P.
+    bool sequential_download = false;                                   ///< Baixa os chunks em ordem, com uma janela deslizante, em vez de pedir todos de uma vez.
+    bool dht_lookup = false;                                            ///< Localiza os peers com chunks pela DHT em vez de inundar a rede com DISCOVERY.
+    bool random_walk = false;                                           ///< Localiza os peers com chunks por passeios aleatórios (WALK) em vez de inundar a rede com DISCOVERY.
+    std::string stream_directory;                                       ///< Pasta em que os arquivos buscados são gravados à medida que são baixados (ver streamFile). Vazia se desativado.
 
 public:
     /**
@@ -44,10 +54,12 @@ public:
      * @param tcp_port Porta TCP para transferência de chunks de um arquivo.
      * @param transfer_speed Capacidade de transferência em bytes/segundo.
      * @param neighbors Informações dos vizinhos do peer (IP, porta UDP).
+     * @param super_peers Super-peers da rede (IP, porta UDP), ver ConfigManager::selectSuperPeers.
      */
     Peer(int id, const std::string& ip, int udp_port, 
-         int tcp_port, int transfer_speed, 
-         const std::vector<std::tuple<std::string, int>> neighbors);
+         int tcp_port, ByteCount transfer_speed, 
+         const std::vector<std::tuple<std::string, int>> neighbors,
+         const std::vector<std::tuple<std::string, int>> super_peers = {});
 
 
     /**
@@ -55,11 +67,85 @@ public:
      * 
      * Ativa e inicia os servidores TCP e UDP, permitindo que o peer se comunique 
      * na rede P2P para descoberta e transferência de chunks. Dá início a descoberta
-     * de chunks de um arquivo.
+     * de chunks de um arquivo. Executa o EventLoop na thread atual e só retorna quando
+     * o peer é encerrado por SIGINT ou SIGTERM.
+     * 
+     * @param file_names Nomes dos arquivos que se deseja fazer a busca. Um nome no formato
+     *                   "<nome>@<offset>+<tamanho>" baixa apenas os chunks que contêm o trecho.
+     * @param sequential Indica se os arquivos devem ser baixados em ordem (ver downloadSequentially).
+     * @param dht Indica se os peers com chunks devem ser localizados pela DHT (ver discoverAndRequestChunks).
+     * @param walk Indica se os peers com chunks devem ser localizados por passeios aleatórios (ver discoverAndRequestChunks).
+     * @param stream_dir Pasta em que os arquivos buscados são gravados à medida que são baixados (ver streamFile). Vazia desativa.
+     */
+    void start(const std::vector<std::string>& file_names, bool sequential = false, bool dht = false, bool walk = false, const std::string& stream_dir = "");
+
+
+    /**
+     * @brief Lê um trecho de um arquivo, esperando apenas pelos chunks que contêm o trecho.
+     * 
+     * Permite consumir o início de um arquivo enquanto o restante ainda é baixado. Os bytes
+     * disponíveis são lidos por FileManager::readFileRange e, se faltar um chunk, a corrotina
+     * espera pelo token de FileManager::getChunksChangedToken, cancelado a cada chunk salvo, sem
+     * ocupar uma thread do Executor. Um chunk que nunca chega (fora do trecho de um download
+     * parcial, por exemplo) é esperado até o encerramento do peer.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param offset Posição inicial do trecho em bytes.
+     * @param buffer Destino dos bytes lidos, que deve continuar válido até o fim da corrotina.
+     * @param length Número de bytes a serem lidos.
+     * @return Número de bytes lidos, menor que length se o arquivo terminar antes ou se o peer for encerrado.
+     */
+    Task<ByteCount> readFileRange(std::string file_name, ByteCount offset, char* buffer, ByteCount length);
+
+
+    /**
+     * @brief Aguarda a inicialização dos outros peers e inicia a busca de cada arquivo.
      * 
      * @param file_names Nomes dos arquivos que se deseja fazer a busca.
      */
-    void start(const std::vector<std::string>& file_names);
+    Task<void> searchFiles(std::vector<std::string> file_names);
+
+
+    /**
+     * @brief Aguarda SIGINT ou SIGTERM e encerra o EventLoop.
+     * 
+     * Os sinais são bloqueados em todas as threads e lidos por um signalfd, que é
+     * aguardado como qualquer outro descritor pelo EventLoop.
+     * 
+     * @param signal_fd Descritor do signalfd (não bloqueante).
+     */
+    Task<void> handleSignals(int signal_fd);
+
+
+    /**
+     * @brief Observa config.txt e topologia.txt e aplica as alterações sem reiniciar o peer.
+     * 
+     * O diretório dos arquivos é observado por um inotify, para que arquivos substituídos por um
+     * editor (gravação em um arquivo temporário seguida de rename) também sejam detectados. As
+     * alterações são aplicadas Constants::CONFIG_RELOAD_DEBOUNCE_MS depois da última notificação.
+     * 
+     * @param inotify_fd Descritor do inotify (não bloqueante).
+     */
+    Task<void> watchConfiguration(int inotify_fd);
+
+
+    /**
+     * @brief Recarrega config.txt e topologia.txt e aplica as diferenças em execução.
+     * 
+     * Atualiza a velocidade de transferência nos servidores TCP (inclusive nos envios em andamento)
+     * e UDP e a lista de vizinhos de topologia.txt. A localização dos chunks, as buscas e as
+     * transferências em andamento são mantidas. Arquivos com erros são ignorados, mantendo a
+     * configuração atual, e mudanças no IP ou na porta do próprio peer exigem reiniciá-lo.
+     */
+    void reloadConfiguration();
+
+
+    /**
+     * @brief Registra periodicamente no log a utilização do pool de threads e do pool de buffers, os contadores de buscas e a qualidade dos peers.
+     * 
+     * O intervalo é definido por Constants::EXECUTOR_METRICS_INTERVAL_SECONDS.
+     */
+    Task<void> logRuntimeMetrics();
 
 
     /**
@@ -70,7 +156,7 @@ public:
      * 
      * @param file_name Nome do arquivo que se deseja fazer a busca.
      */
-    void searchFile(const std::string& file_name);
+    Task<void> searchFile(std::string file_name);
 
 
     /**
@@ -78,13 +164,46 @@ public:
      * 
      * Este método envia uma mensagem de descoberta de chunks para encontrar peers 
      * que possuam chunks de um arquivo específico. Em seguida, aguarda 
-     * pelas respostas e solicita os chunks disponíveis.
+     * pelas respostas e solicita os chunks disponíveis. Todas as esperas são feitas
+     * com co_await, sem bloquear threads. No modo DHT, a mensagem de descoberta é enviada
+     * (com TTL 0) apenas aos provedores encontrados na DHT, e a inundação só é usada se
+     * nenhum provedor for encontrado. No modo de passeios aleatórios, walkers substituem a inundação.
+     * Em redes com super-peers, a busca é feita pela camada de super-peers.
      * 
      * @param file_name Nome do arquivo cujos chunks estão sendo solicitados.
      * @param total_chunks Número total de chunks do arquivo.
      * @param initial_ttl Valor inicial do TTL (time-to-Live) da mensagem de descoberta.
      */
-    void discoverAndRequestChunks(const std::string& file_name, int total_chunks, int initial_ttl);
+    Task<void> discoverAndRequestChunks(std::string file_name, ChunkId total_chunks, int initial_ttl);
+
+
+    /**
+     * @brief Baixa os chunks de um arquivo em ordem, com uma janela deslizante.
+     * 
+     * Mantém pedidos no máximo Constants::SEQUENTIAL_WINDOW_CHUNKS chunks a partir do primeiro
+     * que falta, assim o início do arquivo chega primeiro e pode ser lido com
+     * readFileRange enquanto o restante é baixado. Chunks pedidos e não recebidos em
+     * Constants::SEQUENTIAL_REQUEST_TIMEOUT_SECONDS são pedidos novamente.
+     * 
+     * Em um download parcial, a janela percorre apenas os chunks do intervalo pedido.
+     * 
+     * @param file_name Nome do arquivo cujos chunks estão sendo solicitados.
+     */
+    Task<void> downloadSequentially(std::string file_name);
+
+
+    /**
+     * @brief Grava um arquivo (ou o trecho pedido) em stream_directory à medida que é baixado.
+     * 
+     * Lê o trecho com readFileRange, uma janela de Constants::CHUNK_STREAM_WINDOW_SIZE bytes por
+     * vez, e grava cada janela em stream_directory/<nome do arquivo> assim que ela está disponível.
+     * Com o download sequencial, o início do arquivo é gravado antes de o download terminar.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param offset Posição inicial do trecho em bytes.
+     * @param length Número de bytes do trecho (o arquivo inteiro se passar do fim).
+     */
+    Task<void> streamFile(std::string file_name, ByteCount offset, ByteCount length);
 };
 
 #endif // PEER_H
@@ -0,0 +1,214 @@
+#include "PeerQuality.h"
+#include "Constants.h"
+#include <algorithm>
+
+
+/**
+ * @brief Inicia uma sonda para um peer já cadastrado. Deve ser chamado com o mutex bloqueado.
+ */
+std::uint64_t PeerQuality::startProbeLocked(PeerQualityEntry& entry, std::chrono::steady_clock::time_point now) {
+    entry.pending_nonce = next_nonce++;
+    entry.probe_sent_at = now;
+    return entry.pending_nonce;
+}
+
+
+/**
+ * @brief Cadastra um peer, ou renova o cadastro de um peer conhecido.
+ */
+bool PeerQuality::addPeer(const std::tuple<std::string, int>& peer) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> quality_lock(mutex);
+
+    auto it = peers.find(peer);
+    if (it != peers.end()) {
+        it->second.last_seen = now;
+        return false;
+    }
+    if (peers.size() >= Constants::PEER_QUALITY_MAX_PEERS) {
+        return false;
+    }
+
+    PeerQualityEntry entry;
+    entry.last_seen = now;
+    peers.emplace(peer, entry);
+    return true;
+}
+
+
+/**
+ * @brief Inicia uma sonda para um peer cadastrado.
+ */
+std::uint64_t PeerQuality::startProbe(const std::tuple<std::string, int>& peer) {
+    std::lock_guard<std::mutex> quality_lock(mutex);
+    auto it = peers.find(peer);
+    if (it == peers.end()) {
+        return 0;
+    }
+    return startProbeLocked(it->second, std::chrono::steady_clock::now());
+}
+
+
+/**
+ * @brief Inicia uma rodada de sondas para todos os peers cadastrados.
+ */
+std::vector<std::pair<std::tuple<std::string, int>, std::uint64_t>> PeerQuality::startProbeRound() {
+    auto now = std::chrono::steady_clock::now();
+    auto oldest_valid = now - std::chrono::seconds(Constants::PEER_QUALITY_FORGET_SECONDS);
+    std::vector<std::pair<std::tuple<std::string, int>, std::uint64_t>> probes;
+
+    std::lock_guard<std::mutex> quality_lock(mutex);
+    std::erase_if(peers, [&](const auto& item) { return item.second.last_seen < oldest_valid; });
+
+    for (auto& [peer, entry] : peers) {
+        // A sonda da rodada anterior não foi respondida
+        if (entry.pending_nonce != 0) {
+            entry.lost_probes++;
+        }
+        probes.emplace_back(peer, startProbeLocked(entry, now));
+    }
+    return probes;
+}
+
+
+/**
+ * @brief Registra a resposta (PONG) a uma sonda e atualiza o RTT do peer.
+ */
+bool PeerQuality::recordPong(const std::tuple<std::string, int>& peer, std::uint64_t nonce) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> quality_lock(mutex);
+
+    auto it = peers.find(peer);
+    if (it == peers.end() || nonce == 0 || it->second.pending_nonce != nonce) {
+        return false;
+    }
+
+    PeerQualityEntry& entry = it->second;
+    double sample_ms = std::chrono::duration<double, std::milli>(now - entry.probe_sent_at).count();
+    entry.rtt_ms = entry.rtt_ms == 0 ? sample_ms : entry.rtt_ms + Constants::PEER_QUALITY_EWMA_WEIGHT * (sample_ms - entry.rtt_ms);
+    entry.pending_nonce = 0;
+    entry.lost_probes = 0;
+    entry.last_seen = now;
+    return true;
+}
+
+
+/**
+ * @brief Registra a vazão observada no recebimento de um chunk.
+ */
+void PeerQuality::recordTransfer(const std::tuple<std::string, int>& peer, ByteCount bytes, std::chrono::steady_clock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    if (bytes == 0 || seconds <= 0) {
+        return;
+    }
+    double sample = bytes / seconds;
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> quality_lock(mutex);
+
+    auto it = peers.find(peer);
+    if (it == peers.end()) {
+        if (peers.size() >= Constants::PEER_QUALITY_MAX_PEERS) {
+            return;
+        }
+        it = peers.emplace(peer, PeerQualityEntry{}).first;
+    }
+
+    PeerQualityEntry& entry = it->second;
+    entry.throughput = entry.throughput == 0 ? sample : entry.throughput + Constants::PEER_QUALITY_EWMA_WEIGHT * (sample - entry.throughput);
+    entry.last_seen = now;
+}
+
+
+/**
+ * @brief Calcula a velocidade efetiva de um peer, usada para escolher de quem baixar cada chunk.
+ */
+ByteCount PeerQuality::getEffectiveSpeed(const std::tuple<std::string, int>& peer, ByteCount claimed_speed) const {
+    std::lock_guard<std::mutex> quality_lock(mutex);
+
+    auto it = peers.find(peer);
+    if (it == peers.end()) {
+        return claimed_speed;
+    }
+
+    const PeerQualityEntry& entry = it->second;
+    if (entry.lost_probes >= Constants::PEER_QUALITY_MAX_LOST_PROBES) {
+        return 0;
+    }
+
+    double speed = entry.throughput > 0 ? entry.throughput : static_cast<double>(claimed_speed);
+    if (entry.rtt_ms > 0) {
+        speed *= Constants::PEER_QUALITY_RTT_REFERENCE_MS / (Constants::PEER_QUALITY_RTT_REFERENCE_MS + entry.rtt_ms);
+    }
+    return static_cast<ByteCount>(speed);
+}
+
+
+/**
+ * @brief Retorna o RTT suavizado de um peer.
+ */
+double PeerQuality::getRttMs(const std::tuple<std::string, int>& peer) const {
+    std::lock_guard<std::mutex> quality_lock(mutex);
+    auto it = peers.find(peer);
+    return it != peers.end() ? it->second.rtt_ms : 0;
+}
+
+
+/**
+ * @brief Retorna o número de sondas consecutivas que um peer deixou sem resposta.
+ */
+int PeerQuality::getLostProbes(const std::tuple<std::string, int>& peer) const {
+    std::lock_guard<std::mutex> quality_lock(mutex);
+    auto it = peers.find(peer);
+    return it != peers.end() ? it->second.lost_probes : 0;
+}
+
+
+/**
+ * @brief Ordena peers pelo RTT medido (menor primeiro).
+ */
+std::vector<std::tuple<std::string, int>> PeerQuality::rankByLatency(std::vector<std::tuple<std::string, int>> candidates) const {
+    // Chave de ordenação: (sem resposta, sem RTT, RTT)
+    std::map<std::tuple<std::string, int>, std::tuple<bool, bool, double>> keys;
+    {
+        std::lock_guard<std::mutex> quality_lock(mutex);
+        for (const auto& candidate : candidates) {
+            auto it = peers.find(candidate);
+            if (it == peers.end()) {
+                keys[candidate] = {false, true, 0};
+            } else {
+                keys[candidate] = {it->second.lost_probes >= Constants::PEER_QUALITY_MAX_LOST_PROBES, it->second.rtt_ms == 0, it->second.rtt_ms};
+            }
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [&](const auto& a, const auto& b) { return keys[a] < keys[b]; });
+    return candidates;
+}
+
+
+/**
+ * @brief Monta uma linha de log com o resumo da tabela.
+ */
+std::string PeerQuality::describe() const {
+    std::size_t with_rtt = 0, with_throughput = 0, unresponsive = 0;
+    double rtt_sum = 0;
+
+    std::lock_guard<std::mutex> quality_lock(mutex);
+    for (const auto& [peer, entry] : peers) {
+        if (entry.rtt_ms > 0) {
+            with_rtt++;
+            rtt_sum += entry.rtt_ms;
+        }
+        if (entry.throughput > 0) {
+            with_throughput++;
+        }
+        if (entry.lost_probes >= Constants::PEER_QUALITY_MAX_LOST_PROBES) {
+            unresponsive++;
+        }
+    }
+
+    std::string average_rtt = with_rtt > 0 ? std::to_string(rtt_sum / with_rtt) : "-";
+    return "Qualidade dos peers: " + std::to_string(peers.size()) + " conhecidos, " + std::to_string(with_rtt) + " com RTT (média " +
+           average_rtt + " ms), " + std::to_string(with_throughput) + " com vazão medida, " + std::to_string(unresponsive) + " sem resposta.";
+}
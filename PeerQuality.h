@@ -0,0 +1,152 @@
+#ifndef PEERQUALITY_H
+#define PEERQUALITY_H
+
+#include "Utils.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Medidas de um peer: RTT das sondas (PING/PONG) e vazão observada nas transferências.
+ */
+struct PeerQualityEntry {
+    double rtt_ms = 0;                                  ///< RTT suavizado em milissegundos. 0 se ainda não foi medido.
+    double throughput = 0;                              ///< Vazão suavizada em bytes/segundo dos chunks recebidos do peer. 0 se ainda não foi medida.
+    int lost_probes = 0;                                ///< Sondas consecutivas sem resposta.
+    std::uint64_t pending_nonce = 0;                    ///< Identificador da sonda aguardando resposta (0 se nenhuma).
+    std::chrono::steady_clock::time_point probe_sent_at; ///< Momento em que a sonda pendente foi enviada.
+    std::chrono::steady_clock::time_point last_seen;    ///< Última vez que o peer foi cadastrado, respondeu a uma sonda ou enviou um chunk.
+};
+
+
+/**
+ * @brief Tabela de qualidade dos peers conhecidos (vizinhos e peers que possuem chunks).
+ *
+ * O RTT vem das sondas PING/PONG enviadas pelo UDPServer e a vazão é medida pelo TCPServer a
+ * cada chunk recebido. As duas medidas são médias móveis exponenciais com peso
+ * Constants::PEER_QUALITY_EWMA_WEIGHT. A seleção de peers para download usa a velocidade
+ * efetiva (ver getEffectiveSpeed) no lugar da velocidade informada pelo próprio peer, e o
+ * encaminhamento de DISCOVERY ordena os vizinhos pelo RTT (ver rankByLatency).
+ */
+class PeerQuality {
+private:
+    std::map<std::tuple<std::string, int>, PeerQualityEntry> peers; ///< Medidas de cada peer (IP e porta UDP).
+    std::uint64_t next_nonce = 1;                                   ///< Próximo identificador de sonda.
+    mutable std::mutex mutex;                                       ///< Mutex que protege peers e next_nonce.
+
+    /**
+     * @brief Inicia uma sonda para um peer já cadastrado. Deve ser chamado com o mutex bloqueado.
+     */
+    std::uint64_t startProbeLocked(PeerQualityEntry& entry, std::chrono::steady_clock::time_point now);
+
+public:
+    /**
+     * @brief Cadastra um peer, ou renova o cadastro de um peer conhecido.
+     *
+     * A tabela guarda no máximo Constants::PEER_QUALITY_MAX_PEERS peers: com a tabela cheia,
+     * peers novos não são cadastrados.
+     *
+     * @param peer IP e porta UDP do peer.
+     * @return true se o peer foi cadastrado agora, false se já era conhecido ou a tabela está cheia.
+     */
+    bool addPeer(const std::tuple<std::string, int>& peer);
+
+
+    /**
+     * @brief Inicia uma sonda para um peer cadastrado.
+     *
+     * @param peer IP e porta UDP do peer.
+     * @return Identificador da sonda, enviado no PING e devolvido no PONG, ou 0 se o peer não está na tabela.
+     */
+    std::uint64_t startProbe(const std::tuple<std::string, int>& peer);
+
+
+    /**
+     * @brief Inicia uma rodada de sondas para todos os peers cadastrados.
+     *
+     * A sonda anterior de um peer que ainda não respondeu conta como perdida. Peers sem notícias
+     * há Constants::PEER_QUALITY_FORGET_SECONDS saem da tabela.
+     *
+     * @return Peers a sondar, com o identificador de cada sonda.
+     */
+    std::vector<std::pair<std::tuple<std::string, int>, std::uint64_t>> startProbeRound();
+
+
+    /**
+     * @brief Registra a resposta (PONG) a uma sonda e atualiza o RTT do peer.
+     *
+     * @param peer IP e porta UDP do peer que respondeu.
+     * @param nonce Identificador da sonda.
+     * @return true se a sonda estava pendente, false se for desconhecida ou repetida.
+     */
+    bool recordPong(const std::tuple<std::string, int>& peer, std::uint64_t nonce);
+
+
+    /**
+     * @brief Registra a vazão observada no recebimento de um chunk.
+     *
+     * @param peer IP e porta UDP do peer que enviou o chunk.
+     * @param bytes Tamanho do chunk em bytes.
+     * @param elapsed Tempo entre a mensagem de controle e o último byte do chunk.
+     */
+    void recordTransfer(const std::tuple<std::string, int>& peer, ByteCount bytes, std::chrono::steady_clock::duration elapsed);
+
+
+    /**
+     * @brief Calcula a velocidade efetiva de um peer, usada para escolher de quem baixar cada chunk.
+     *
+     * Parte da vazão medida, ou da velocidade informada pelo peer enquanto não houver medida, e a
+     * reduz pelo RTT: um RTT igual a Constants::PEER_QUALITY_RTT_REFERENCE_MS a divide por dois.
+     * Um peer que deixou de responder a Constants::PEER_QUALITY_MAX_LOST_PROBES sondas tem
+     * velocidade efetiva 0 e só é escolhido se não houver outro.
+     *
+     * @param peer IP e porta UDP do peer.
+     * @param claimed_speed Velocidade em bytes/segundo informada pelo peer na RESPONSE.
+     * @return Velocidade efetiva em bytes/segundo.
+     */
+    ByteCount getEffectiveSpeed(const std::tuple<std::string, int>& peer, ByteCount claimed_speed) const;
+
+
+    /**
+     * @brief Retorna o RTT suavizado de um peer.
+     *
+     * @param peer IP e porta UDP do peer.
+     * @return RTT em milissegundos, ou 0 se ainda não foi medido.
+     */
+    double getRttMs(const std::tuple<std::string, int>& peer) const;
+
+
+    /**
+     * @brief Retorna o número de sondas consecutivas que um peer deixou sem resposta.
+     *
+     * @param peer IP e porta UDP do peer.
+     * @return Sondas perdidas desde a última resposta (0 se o peer não está na tabela).
+     */
+    int getLostProbes(const std::tuple<std::string, int>& peer) const;
+
+
+    /**
+     * @brief Ordena peers pelo RTT medido (menor primeiro).
+     *
+     * Peers ainda sem RTT vêm depois dos medidos e os que deixaram de responder às sondas vêm
+     * por último. A ordem original é mantida entre peers equivalentes.
+     *
+     * @param candidates Peers a ordenar (IP e porta UDP).
+     * @return Os mesmos peers, ordenados.
+     */
+    std::vector<std::tuple<std::string, int>> rankByLatency(std::vector<std::tuple<std::string, int>> candidates) const;
+
+
+    /**
+     * @brief Monta uma linha de log com o resumo da tabela.
+     */
+    std::string describe() const;
+};
+
+#endif // PEERQUALITY_H
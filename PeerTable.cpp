@@ -0,0 +1,87 @@
+#include "PeerTable.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+
+/**
+ * @brief Função de hash de PeerAddress, para o índice da PeerTable.
+ */
+std::size_t PeerAddressHash::operator()(const PeerAddress& address) const {
+    std::size_t length = address.family == AF_INET6 ? 16 : 4;
+    std::size_t hash = std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(address.bytes.data()), length));
+    return hash ^ (static_cast<std::size_t>(address.port) * 0x9E3779B97F4A7C15ULL);
+}
+
+
+/**
+ * @brief Converte IP em texto e porta para o endereço binário.
+ */
+bool PeerTable::parseAddress(const std::string& ip, int port, PeerAddress& address) {
+    address = PeerAddress{};
+    address.port = static_cast<std::uint16_t>(port);
+
+    if (inet_pton(AF_INET, ip.c_str(), address.bytes.data()) == 1) {
+        address.family = AF_INET;
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), address.bytes.data()) == 1) {
+        address.family = AF_INET6;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * @brief Retorna o PeerId de um peer, atribuindo um novo se ele ainda não for conhecido.
+ */
+PeerId PeerTable::intern(const std::string& ip, int port) {
+    PeerAddress address;
+    if (!parseAddress(ip, port, address)) {
+        return INVALID_PEER_ID;
+    }
+
+    std::lock_guard<std::mutex> table_lock(mutex);
+    auto it = ids.find(address);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    PeerId peer = static_cast<PeerId>(endpoints.size());
+    ids.emplace(address, peer);
+    endpoints.emplace_back(ip, port);
+    claimed_speeds.push_back(0);
+    return peer;
+}
+
+
+/**
+ * @brief Retorna o IP e a porta UDP de um peer.
+ */
+const std::tuple<std::string, int>& PeerTable::getEndpoint(PeerId peer) const {
+    // Os elementos de um deque não mudam de lugar quando novos peers são adicionados ao final
+    std::lock_guard<std::mutex> table_lock(mutex);
+    return endpoints.at(peer);
+}
+
+
+/**
+ * @brief Registra a velocidade informada por um peer.
+ */
+void PeerTable::setClaimedSpeed(PeerId peer, ByteCount transfer_speed) {
+    std::lock_guard<std::mutex> table_lock(mutex);
+    if (peer < claimed_speeds.size()) {
+        claimed_speeds[peer] = transfer_speed;
+    }
+}
+
+
+/**
+ * @brief Retorna a última velocidade informada por um peer (0 se nunca informada).
+ */
+ByteCount PeerTable::getClaimedSpeed(PeerId peer) const {
+    std::lock_guard<std::mutex> table_lock(mutex);
+    return peer < claimed_speeds.size() ? claimed_speeds[peer] : 0;
+}
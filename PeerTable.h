@@ -0,0 +1,105 @@
+#ifndef PEERTABLE_H
+#define PEERTABLE_H
+
+#include "Utils.h"
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Identificador compacto de um peer (endereço e porta UDP), atribuído pela PeerTable.
+ */
+using PeerId = std::uint32_t;
+
+/**
+ * @brief Valor de PeerId que não corresponde a nenhum peer.
+ */
+constexpr PeerId INVALID_PEER_ID = std::numeric_limits<PeerId>::max();
+
+
+/**
+ * @brief Endereço binário de um peer: família (AF_INET ou AF_INET6), endereço e porta UDP.
+ */
+struct PeerAddress {
+    std::array<std::uint8_t, 16> bytes{}; ///< Endereço em ordem de rede. Endereços IPv4 ocupam os 4 primeiros bytes.
+    std::uint16_t port = 0;               ///< Porta UDP.
+    std::uint8_t family = 0;              ///< AF_INET ou AF_INET6.
+
+    bool operator==(const PeerAddress& other) const = default;
+};
+
+
+/**
+ * @brief Função de hash de PeerAddress, para o índice da PeerTable.
+ */
+struct PeerAddressHash {
+    std::size_t operator()(const PeerAddress& address) const;
+};
+
+
+/**
+ * @brief Tabela que atribui um PeerId a cada peer conhecido (endereço binário e porta UDP).
+ *
+ * A localização dos chunks guarda apenas os PeerId dos peers que possuem cada chunk (4 bytes por
+ * peer), e a seleção de peers para download trabalha só com eles: o endereço em texto é consultado
+ * uma única vez por peer, no envio do REQUEST. Os identificadores são sequenciais e nunca são
+ * reutilizados, por isso as referências devolvidas por getEndpoint continuam válidas.
+ */
+class PeerTable {
+private:
+    std::unordered_map<PeerAddress, PeerId, PeerAddressHash> ids; ///< Índice do endereço binário para o PeerId.
+    std::deque<std::tuple<std::string, int>> endpoints;           ///< IP (em texto) e porta UDP de cada PeerId.
+    std::vector<ByteCount> claimed_speeds;                        ///< Velocidade em bytes/segundo informada por cada peer na última RESPONSE.
+    mutable std::mutex mutex;                                     ///< Mutex que protege ids, endpoints e claimed_speeds.
+
+public:
+    /**
+     * @brief Converte IP em texto e porta para o endereço binário.
+     *
+     * @param ip Endereço IPv4 ou IPv6 em texto.
+     * @param port Porta UDP.
+     * @param address Endereço binário preenchido em caso de sucesso.
+     * @return true se o IP é válido, false caso contrário.
+     */
+    static bool parseAddress(const std::string& ip, int port, PeerAddress& address);
+
+
+    /**
+     * @brief Retorna o PeerId de um peer, atribuindo um novo se ele ainda não for conhecido.
+     *
+     * @param ip Endereço IP do peer.
+     * @param port Porta UDP do peer.
+     * @return PeerId do peer, ou INVALID_PEER_ID se o IP for inválido.
+     */
+    PeerId intern(const std::string& ip, int port);
+
+
+    /**
+     * @brief Retorna o IP e a porta UDP de um peer.
+     *
+     * @param peer PeerId atribuído por intern.
+     * @return Referência ao endereço do peer, válida enquanto a tabela existir.
+     */
+    const std::tuple<std::string, int>& getEndpoint(PeerId peer) const;
+
+
+    /**
+     * @brief Registra a velocidade informada por um peer.
+     */
+    void setClaimedSpeed(PeerId peer, ByteCount transfer_speed);
+
+
+    /**
+     * @brief Retorna a última velocidade informada por um peer (0 se nunca informada).
+     */
+    ByteCount getClaimedSpeed(PeerId peer) const;
+};
+
+#endif // PEERTABLE_H
@@ -1,10 +1,14 @@
 #include "TCPServer.h"
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <cstdlib>
 #include <cstring>
+#include <cerrno>
 #include <iostream>
-#include <thread>
 #include <chrono>
 #include <arpa/inet.h>
 #include <sstream>
@@ -13,12 +17,13 @@
 /**
  * @brief Construtor da classe TCPServer.
  */
-TCPServer::TCPServer(const std::string& ip, int port, int peer_id, int transfer_speed, FileManager& file_manager)
-    : ip(ip), port(port), peer_id(peer_id), transfer_speed(transfer_speed), file_manager(file_manager) {
+TCPServer::TCPServer(const std::string& ip, int port, int udp_port, int peer_id, ByteCount transfer_speed, FileManager& file_manager, PeerQuality& peer_quality, EventLoop& event_loop)
+    : ip(ip), port(port), udp_port(udp_port), peer_id(peer_id), transfer_speed(transfer_speed), local_server_sockfd(-1), local_socket_inode(0), file_manager(file_manager), peer_quality(peer_quality), event_loop(event_loop) {
     
     // Cria um socket TCP IPv4 (SOCK_STREAM) especificando explicitamente o protocolo TCP (IPPROTO_TCP)
     // Nota: SOCK_STREAM já indica o uso de TCP, mas IPPROTO_TCP é passado para maior clareza e compatibilidade
-    server_sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    // O socket é não bloqueante, as conexões são aceitas pelo EventLoop
+    server_sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
     
     // Prepara uma estrutura sockaddr_in para armazenar o endereço IP e a porta
     struct sockaddr_in my_addr = createSockAddr(ip.c_str(), port);
@@ -37,71 +42,148 @@ TCPServer::TCPServer(const std::string& ip, int port, int peer_id, int transfer_
     }
 
     logMessage(LogType::INFO, "Servidor TCP inicializado em " + ip + ":" + std::to_string(port));
+
+    if (Constants::LOCAL_TRANSPORT_ENABLED) {
+        std::string local_path = getLocalSocketPath(ip, port);
+        struct sockaddr_un local_addr{};
+        local_addr.sun_family = AF_UNIX;
+
+        if (local_path.empty() || local_path.size() >= sizeof(local_addr.sun_path)) {
+            logMessage(LogType::ERROR, "Transporte local desabilitado: caminho do socket indisponível ou longo demais ('" + local_path + "').");
+        } else {
+            std::strncpy(local_addr.sun_path, local_path.c_str(), sizeof(local_addr.sun_path) - 1);
+
+            if (isLocalSocketInUse(local_addr)) {
+                // Outro processo está escutando neste endereço: o socket dele não é removido
+                logMessage(LogType::ERROR, "Transporte local desabilitado: " + local_path + " já está em uso por outro processo.");
+            } else {
+                // Remove um socket que sobrou de uma execução anterior
+                unlink(local_path.c_str());
+
+                // Cria o Unix domain socket do transporte local, usado por peers no mesmo host. SOCK_SEQPACKET preserva
+                // os limites das mensagens: cada recvmsg devolve exatamente um PUT, com o descritor do seu chunk
+                local_server_sockfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                struct stat local_stat{};
+                if (local_server_sockfd < 0 ||
+                    bind(local_server_sockfd, (struct sockaddr*)&local_addr, sizeof(local_addr)) < 0 ||
+                    listen(local_server_sockfd, Constants::TCP_MAX_PENDING_CONNECTIONS) < 0 ||
+                    stat(local_path.c_str(), &local_stat) < 0) {
+                    // Sem o transporte local os chunks continuam sendo recebidos via TCP
+                    perror("Erro ao inicializar o transporte local");
+                    if (local_server_sockfd >= 0) {
+                        close(local_server_sockfd);
+                    }
+                    local_server_sockfd = -1;
+                } else {
+                    local_socket_inode = local_stat.st_ino;
+                    logMessage(LogType::INFO, "Transporte local inicializado em " + local_path);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Destrutor da classe TCPServer. Fecha os sockets de escuta e remove o socket do transporte local.
+ */
+TCPServer::~TCPServer() {
+    close(server_sockfd);
+    if (local_server_sockfd >= 0) {
+        close(local_server_sockfd);
+
+        // Remove o arquivo apenas se ainda for o socket criado por este peer
+        std::string local_path = getLocalSocketPath(ip, port);
+        struct stat local_stat{};
+        if (stat(local_path.c_str(), &local_stat) == 0 && local_stat.st_ino == local_socket_inode) {
+            unlink(local_path.c_str());
+        }
+    }
 }
 
 
 /**
  * @brief Inicia o servidor TCP para aceitar conexões.
  */
-void TCPServer::run() {
-    while (true) {
-        // Informações para o socket do cliente
-        struct sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
-        
+Task<void> TCPServer::run() {
+    while (!event_loop.isStopping()) {
         // Aceita a conexão do cliente
-        int client_sockfd = accept(server_sockfd, (struct sockaddr*)&client_addr, &addr_len);
+        int client_sockfd = co_await event_loop.accept(server_sockfd);
 
         if (client_sockfd >= 0) {
-            // Cria uma thread para lidar com o recebimento dos chunks
-            std::thread(&TCPServer::receiveChunks, this, client_sockfd).detach();
-        } else {
+            // Cria uma corrotina para lidar com o recebimento dos chunks
+            event_loop.spawn(receiveChunks(client_sockfd));
+        } else if (errno != ECANCELED) {
             perror("Erro ao aceitar conexão TCP");
         }
     }
 }
 
 
+/**
+ * @brief Inicia o servidor do transporte local para aceitar conexões de peers no mesmo host.
+ */
+Task<void> TCPServer::runLocal() {
+    // Transporte local desabilitado ou não inicializado
+    if (local_server_sockfd < 0) {
+        co_return;
+    }
+
+    while (!event_loop.isStopping()) {
+        // Aceita a conexão do peer local
+        int client_sockfd = co_await event_loop.accept(local_server_sockfd);
+
+        if (client_sockfd >= 0) {
+            // Cria uma corrotina para lidar com o recebimento dos chunks
+            event_loop.spawn(receiveLocalChunks(client_sockfd));
+        } else if (errno != ECANCELED) {
+            perror("Erro ao aceitar conexão do transporte local");
+        }
+    }
+}
+
+
 /**
  * @brief Recebe chunks enviados por um peer e ao receber todos, monta o arquivo final.
  */
-void TCPServer::receiveChunks(int client_sockfd) {
+Task<void> TCPServer::receiveChunks(int client_sockfd) {
     // Obtém o IP e a porta TCP do cliente
     auto [client_ip, client_port] = getClientAddressInfo(client_sockfd);
     
     // Continua a leitura até o cliente fechar a conexão
     while (true) {
-        // Armazena a mensagem de controle recebida
-        std::string control_message = "";
-
         // Quantidade de quantos bytes da mensagem de controle foram recebidos
         size_t control_message_total_bytes_received = 0;
 
         // Quantidade de bytes realmente recebido no recv
         ssize_t control_message_size = 0;
 
-        // Buffer para armazenar os dados da mensagem de controle
-        char control_message_buffer[Constants::CONTROL_MESSAGE_MAX_SIZE] = {0};
+        // Buffer do pool para armazenar a mensagem de controle
+        BufferPool::Buffer control_message_buffer = BufferPool::instance().acquire(Constants::CONTROL_MESSAGE_MAX_SIZE);
+        if (!control_message_buffer) {
+            logMessage(LogType::ERROR, "Sem memória para receber a mensagem de controle.");
+            close(client_sockfd);
+            co_return;
+        }
 
-        // Recebe a mensagem de controle em pedaços
+        // Recebe a mensagem de controle em pedaços, diretamente no buffer
         do {
             // Recebe os dados
-            control_message_size = recv(client_sockfd, control_message_buffer, Constants::CONTROL_MESSAGE_MAX_SIZE, 0);
+            control_message_size = co_await event_loop.recv(client_sockfd, control_message_buffer.data() + control_message_total_bytes_received, Constants::CONTROL_MESSAGE_MAX_SIZE - control_message_total_bytes_received);
 
             // Verifica se houve erro ou o cliente fechou a conexão
             if (control_message_size < 0) {
                 perror("Erro ao receber a mensagem de controle");
                 close(client_sockfd);
-                return;
+                co_return;
             } else if (control_message_size == 0) {
                 logMessage(LogType::INFO, "Conexão fechada pelo cliente.");
                 close(client_sockfd);
-                return;
+                co_return;
             }
 
             if (control_message_size > 0) {
-                // Adiciona os bytes recebidos à mensagem de controle
-                control_message.append(control_message_buffer, control_message_size);
+                // Contabiliza os bytes recebidos da mensagem de controle
                 control_message_total_bytes_received += control_message_size;
             
                 logMessage(LogType::INFO, "Recebido " + std::to_string(control_message_size) + " bytes da mensagem de controle de " + client_ip + ":" + std::to_string(client_port) + " (" + std::to_string(control_message_total_bytes_received) + "/" + std::to_string(Constants::CONTROL_MESSAGE_MAX_SIZE) + " bytes).");
@@ -109,69 +191,224 @@ void TCPServer::receiveChunks(int client_sockfd) {
 
         } while (control_message_total_bytes_received < Constants::CONTROL_MESSAGE_MAX_SIZE); // Continua recebendo até que a mensagem de controle esteja completa
 
-        logMessage(LogType::INFO, "Mensagem de controle '" + control_message + "' recebida de " + client_ip + ":" + std::to_string(client_port));
-        
-        // Transforma a string da mensagem de controle em um stream para extração
-        std::stringstream control_message_stream(control_message);
+        // A mensagem de controle é completada com zeros até o tamanho máximo
+        control_message_buffer.resize(strnlen(control_message_buffer.data(), Constants::CONTROL_MESSAGE_MAX_SIZE));
+
+        // Transforma a mensagem de controle em um stream para extração, sem copiar o buffer
+        BufferStream control_message_stream(control_message_buffer);
+
+        logMessage(LogType::INFO, "Mensagem de controle '" + control_message_stream.str() + "' recebida de " + client_ip + ":" + std::to_string(client_port));
 
         // Variáveis para armazenar os valores da mensagem de controle
         std::string command, file_name;
-        int chunk_id, transfer_speed;
-        size_t chunk_size;
+        ChunkId chunk_id = -1;
+        ByteCount transfer_speed = 0, chunk_size = 0;
 
         // Extrai os valores da mensagem de controle
         control_message_stream >> command >> file_name >> chunk_id >> transfer_speed >> chunk_size;
 
+        // Campos inválidos deixam o restante da conexão sem enquadramento conhecido
+        if (command == "PUT" && (control_message_stream.fail() || chunk_id < 0 || transfer_speed == 0)) {
+            logMessage(LogType::ERROR, "Mensagem de controle inválida recebida de " + client_ip + ":" + std::to_string(client_port) + ": '" + control_message_stream.str() + "'");
+            break;
+        }
+
         // Verifica se o comando é "PUT", que indica recebimento de chunk de arquivo
         if (command == "PUT") {
-            // Cria um buffer para armazenar o chunk completo
-            char chunk_buffer[chunk_size] = {0};
+            // Porta UDP do remetente, que identifica o peer na tabela de qualidade (0 se não informada)
+            int sender_udp_port = 0;
+            control_message_stream >> sender_udp_port;
+            auto transfer_started_at = std::chrono::steady_clock::now();
+
+            // O chunk é gravado em disco à medida que chega, assim seu tamanho não é limitado pela memória
+            ChunkWriter chunk_writer(file_manager.getChunkPath(file_name, chunk_id));
+            if (!chunk_writer.isOpen()) {
+                break;
+            }
+
+            // Obtém do pool a janela em memória que acumula os bytes antes de cada gravação
+            size_t window_size = std::max<ByteCount>(1, std::min<ByteCount>(chunk_size, Constants::CHUNK_STREAM_WINDOW_SIZE));
+            BufferPool::Buffer window_buffer = BufferPool::instance().acquire(window_size);
+            if (!window_buffer) {
+                logMessage(LogType::ERROR, "Sem memória para receber o chunk " + std::to_string(chunk_id) + ".");
+                break;
+            }
 
             // Quantidade de quantos bytes do chunk foram recebidos
-            size_t chunk_total_bytes_received = 0;
+            ByteCount chunk_total_bytes_received = 0;
+
+            // Quantidade de bytes na janela ainda não gravados em disco
+            size_t window_bytes = 0;
 
             // Continua recebendo o chunk até alcançar o tamanho esperado
             while (chunk_total_bytes_received < chunk_size) {
                 // Quantidade de bytes realmente recebido no recv
                 ssize_t chunk_bytes_received = 0;
 
-                // Buffer temporário para armazenar os dados recebidos
-                char chunk_temp_buffer[transfer_speed] = {0};
-
-                // Recebe os dados do chunk
-                chunk_bytes_received = recv(client_sockfd, chunk_temp_buffer, transfer_speed, 0);
+                // Recebe os dados do chunk diretamente na janela, no máximo um bloco por vez
+                size_t bytes_to_receive = std::min<ByteCount>({transfer_speed, chunk_size - chunk_total_bytes_received, window_size - window_bytes});
+                chunk_bytes_received = co_await event_loop.recv(client_sockfd, window_buffer.data() + window_bytes, bytes_to_receive);
 
                 // Verifica se houve erro ou o cliente fechou a conexão
                 if (chunk_bytes_received < 0) {
                     perror("Erro ao receber o chunk.");
                     close(client_sockfd);
-                    return;
+                    co_return;
                 } else if (chunk_bytes_received == 0) {
                     logMessage(LogType::INFO, "Conexão fechada pelo cliente.");
                     close(client_sockfd);
-                    return;
+                    co_return;
                 }
 
                 if (chunk_bytes_received > 0) {
-                    // Copia os dados recebidos para o buffer principal do chunk
-                    std::memcpy(chunk_buffer + chunk_total_bytes_received, chunk_temp_buffer, chunk_bytes_received);
-
                     // Atualiza o total de bytes recebidos
                     chunk_total_bytes_received += chunk_bytes_received;
+                    window_bytes += chunk_bytes_received;
 
                     logMessage(LogType::CHUNK_RECEIVED, "Recebido " + std::to_string(chunk_bytes_received) + " bytes do chunk " + std::to_string(chunk_id) + " de " + client_ip + ":" + std::to_string(client_port) + " (" + std::to_string(chunk_total_bytes_received) + "/" + std::to_string(chunk_size) + " bytes).");
                 }
+
+                // Grava a janela quando ela enche ou o chunk termina, com prioridade baixa para não atrasar as corrotinas de rede
+                if (window_bytes == window_size || chunk_total_bytes_received == chunk_size) {
+                    co_await event_loop.schedule(TaskPriority::LOW);
+                    if (!chunk_writer.write(window_buffer.data(), window_bytes)) {
+                        logMessage(LogType::ERROR, "Falha ao gravar o chunk " + std::to_string(chunk_id) + " do arquivo " + file_name + " em disco.");
+                        close(client_sockfd);
+                        co_return;
+                    }
+                    window_bytes = 0;
+                }
             }
 
-            // Verifica se todos os bytes esperados foram recebidos
-            if (chunk_total_bytes_received >= chunk_size) {
-                logMessage(LogType::SUCCESS, "SUCESSO AO RECEBER O CHUNK " + std::to_string(chunk_id) + " DO ARQUIVO " + file_name + " de " + client_ip + ":" + std::to_string(client_port));
+            // Recebe o hash do chunk, enviado logo após os seus bytes
+            char hash_trailer[Constants::CHUNK_HASH_TRAILER_SIZE];
+            size_t hash_bytes_received = 0;
+            while (hash_bytes_received < sizeof(hash_trailer)) {
+                ssize_t bytes_received = co_await event_loop.recv(client_sockfd, hash_trailer + hash_bytes_received, sizeof(hash_trailer) - hash_bytes_received);
+                if (bytes_received <= 0) {
+                    logMessage(LogType::ERROR, "Conexão encerrada antes do hash do chunk " + std::to_string(chunk_id) + " de " + client_ip + ":" + std::to_string(client_port));
+                    close(client_sockfd);
+                    co_return;
+                }
+                hash_bytes_received += bytes_received;
+            }
 
-                // Salva o chunk localmente
-                file_manager.saveChunk(file_name, chunk_id, chunk_buffer, chunk_size);
-            } else {
-                logMessage(LogType::ERROR, "Falha ao receber o chunk " + std::to_string(chunk_id) + " de " + client_ip + ":" + std::to_string(client_port) + ". Bytes esperados: " + std::to_string(chunk_size) + ", recebidos: " + std::to_string(chunk_total_bytes_received));
+            // Confere o hash calculado durante o recebimento antes de disponibilizar o chunk
+            std::string expected_hash(hash_trailer, sizeof(hash_trailer));
+            std::string received_hash = formatChunkHash(chunk_writer.getHash());
+            if (received_hash != expected_hash) {
+                logMessage(LogType::ERROR, "Hash inválido para o chunk " + std::to_string(chunk_id) + " de " + client_ip + ":" + std::to_string(client_port) + ". Esperado: " + expected_hash + ", calculado: " + received_hash);
+                continue;
+            }
+
+            logMessage(LogType::SUCCESS, "SUCESSO AO RECEBER O CHUNK " + std::to_string(chunk_id) + " DO ARQUIVO " + file_name + " de " + client_ip + ":" + std::to_string(client_port));
+
+            // Registra a vazão realmente obtida do remetente
+            if (sender_udp_port > 0) {
+                peer_quality.recordTransfer(std::make_tuple(client_ip, sender_udp_port), chunk_size, std::chrono::steady_clock::now() - transfer_started_at);
+            }
+
+            // Disponibiliza o chunk localmente
+            file_manager.commitChunk(file_name, chunk_id, chunk_writer);
+        }
+    }
+
+    // Fecha o socket após terminar
+    close(client_sockfd);
+}
+
+
+/**
+ * @brief Recebe chunks enviados por um peer no mesmo host através do transporte local.
+ */
+Task<void> TCPServer::receiveLocalChunks(int client_sockfd) {
+    // Continua a leitura até o cliente fechar a conexão
+    while (true) {
+        // Buffer do pool para armazenar os dados da mensagem de controle
+        BufferPool::Buffer control_message_buffer = BufferPool::instance().acquire(Constants::CONTROL_MESSAGE_MAX_SIZE);
+        if (!control_message_buffer) {
+            logMessage(LogType::ERROR, "Sem memória para receber a mensagem de controle do transporte local.");
+            break;
+        }
+
+        // Buffer para os dados auxiliares que carregam o descritor do chunk
+        alignas(struct cmsghdr) char ancillary_buffer[CMSG_SPACE(sizeof(int))] = {0};
+
+        struct iovec iov{};
+        iov.iov_base = control_message_buffer.data();
+        iov.iov_len = Constants::CONTROL_MESSAGE_MAX_SIZE - 1;
+
+        struct msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ancillary_buffer;
+        msg.msg_controllen = sizeof(ancillary_buffer);
+
+        // Recebe uma mensagem de controle inteira junto com o descritor do chunk
+        ssize_t control_message_size = recvmsg(client_sockfd, &msg, MSG_CMSG_CLOEXEC);
+
+        // Sem dados disponíveis: espera o socket ficar pronto para leitura
+        if (control_message_size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!co_await event_loop.readable(client_sockfd)) {
+                break;
+            }
+            continue;
+        }
+
+        // Verifica se houve erro ou o cliente fechou a conexão
+        if (control_message_size < 0) {
+            perror("Erro ao receber a mensagem de controle do transporte local");
+            break;
+        } else if (control_message_size == 0) {
+            logMessage(LogType::INFO, "Conexão local fechada pelo cliente.");
+            break;
+        }
+
+        // Extrai o descritor do chunk dos dados auxiliares
+        int chunk_fd = -1;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            std::memcpy(&chunk_fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+
+        // Mensagem maior que o buffer ou com descritores a mais: o restante foi descartado pelo kernel
+        if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+            logMessage(LogType::ERROR, "Mensagem truncada recebida pelo transporte local. Descartada.");
+            if (chunk_fd >= 0) {
+                close(chunk_fd);
             }
+            continue;
+        }
+
+        // Transforma a mensagem de controle em um stream para extração
+        control_message_buffer.resize(control_message_size);
+        BufferStream control_message_stream(control_message_buffer);
+
+        // Variáveis para armazenar os valores da mensagem de controle
+        std::string command, file_name;
+        ChunkId chunk_id = -1;
+        ByteCount transfer_speed = 0, chunk_size = 0;
+        std::string destination_ip;
+        int destination_port = -1;
+
+        // Extrai os valores da mensagem de controle
+        control_message_stream >> command >> file_name >> chunk_id >> transfer_speed >> chunk_size >> destination_ip >> destination_port;
+
+        if (command == "PUT" && chunk_fd >= 0 && (destination_ip != ip || destination_port != port)) {
+            // O remetente resolveu o socket de outro peer: o chunk não é deste peer
+            logMessage(LogType::ERROR, "Chunk " + std::to_string(chunk_id) + " do arquivo " + file_name + " endereçado a " + destination_ip + ":" + std::to_string(destination_port) + " recebido pelo transporte local de " + ip + ":" + std::to_string(port) + ". Descartado.");
+        } else if (command == "PUT" && chunk_fd >= 0) {
+            // A cópia do chunk para o disco é executada com prioridade baixa
+            co_await event_loop.schedule(TaskPriority::LOW);
+            if (file_manager.saveChunkFromFd(file_name, chunk_id, chunk_fd, chunk_size)) {
+                logMessage(LogType::SUCCESS, "SUCESSO AO RECEBER O CHUNK " + std::to_string(chunk_id) + " DO ARQUIVO " + file_name + " pelo transporte local (" + std::to_string(chunk_size) + " bytes).");
+            }
+        } else {
+            logMessage(LogType::ERROR, "Mensagem inválida recebida pelo transporte local: '" + control_message_stream.str() + "'");
+        }
+
+        if (chunk_fd >= 0) {
+            close(chunk_fd);
         }
     }
 
@@ -183,26 +420,31 @@ void TCPServer::receiveChunks(int client_sockfd) {
 /**
  * @brief Transfere chunks para o peer solicitante.
  */
-void TCPServer::sendChunks(const std::string& file_name, const std::vector<int>& chunks, const PeerInfo& destination_info) {
-    // Cria um novo socket para a conexão
-    int new_sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+Task<void> TCPServer::sendChunks(std::string file_name, std::vector<ChunkId> chunks, PeerInfo destination_info) {
+    // Peers no mesmo host recebem os chunks pelo transporte local, se estiver disponível
+    if (Constants::LOCAL_TRANSPORT_ENABLED && isColocated(destination_info.ip) && co_await sendChunksLocal(file_name, chunks, destination_info)) {
+        co_return;
+    }
+
+    // Cria um novo socket não bloqueante para a conexão
+    int new_sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
     if (new_sockfd < 0) {
         perror("Erro ao criar socket.");
-        return;
+        co_return;
     }
 
     // Estrutura para armazenar informações do endereço do destinatário
     struct sockaddr_in destination_addr = createSockAddr(destination_info.ip.c_str(), destination_info.port);
 
     // Tenta se conectar ao destinatário
-    if (connect(new_sockfd, (struct sockaddr*)&destination_addr, sizeof(destination_addr)) < 0) {
+    if (co_await event_loop.connect(new_sockfd, (struct sockaddr*)&destination_addr, sizeof(destination_addr)) < 0) {
         perror("Erro ao conectar ao peer.");
         close(new_sockfd);
-        return;
+        co_return;
     }
 
     // Itera sobre os chunks e envia um a um
-    for (int chunk : chunks) {
+    for (ChunkId chunk : chunks) {
         // Obtém o caminho do chunk
         std::string chunk_path = file_manager.getChunkPath(file_name, chunk);
 
@@ -216,64 +458,70 @@ void TCPServer::sendChunks(const std::string& file_name, const std::vector<int>&
         }
 
         // Obtém o tamanho do chunk
-        size_t chunk_size = chunk_file.tellg();
+        ByteCount chunk_size = chunk_file.tellg();
 
         // Volta para o início do arquivo
         chunk_file.seekg(0);
         
-        // Cria um buffer em memória para armazenar todos os bytes do arquivo
-        char file_buffer[chunk_size] = {0};
-        
-        // Lê o arquivo inteiro para o buffer
-        chunk_file.read(file_buffer, chunk_size);
-
-        // Fecha o arquivo após a leitura
-        chunk_file.close();
+        // Obtém do pool a janela em memória: o chunk é lido do disco e enviado uma janela por vez
+        size_t window_size = std::max<ByteCount>(1, std::min<ByteCount>(chunk_size, Constants::CHUNK_STREAM_WINDOW_SIZE));
+        BufferPool::Buffer window_buffer = BufferPool::instance().acquire(window_size);
+        if (!window_buffer) {
+            logMessage(LogType::ERROR, "Sem memória para enviar o chunk " + std::to_string(chunk) + ".");
+            continue;  // Pula para o próximo chunk
+        }
 
         // Cria a mensagem de controle
         std::stringstream ss;
-        ss << "PUT " << file_name << " " << chunk << " " << transfer_speed << " " << chunk_size;
+        ss << "PUT " << file_name << " " << chunk << " " << transfer_speed << " " << chunk_size << " " << udp_port;
         
         // transforma a stringstream em string
         std::string control_message = ss.str();
 
-        // Define o buffer de controle com tamanho fixo e preenche com 0s
-        char control_message_buffer[Constants::CONTROL_MESSAGE_MAX_SIZE] = {0};
+        // Obtém do pool o buffer de controle com tamanho fixo e preenche com 0s (buffers reutilizados têm dados antigos)
+        BufferPool::Buffer control_message_buffer = BufferPool::instance().acquire(Constants::CONTROL_MESSAGE_MAX_SIZE);
+        if (!control_message_buffer) {
+            logMessage(LogType::ERROR, "Sem memória para enviar a mensagem de controle do chunk " + std::to_string(chunk) + ".");
+            continue;  // Pula para o próximo chunk
+        }
+        std::memset(control_message_buffer.data(), 0, Constants::CONTROL_MESSAGE_MAX_SIZE);
 
         // Garante que a mensagem sempre vai ter no máximo o tamanho do buffer, - 1 para colocar o terminador de string
-        int bytes_to_copy = std::min(control_message.size(), sizeof(control_message_buffer) - 1);
+        int bytes_to_copy = std::min(control_message.size(), static_cast<size_t>(Constants::CONTROL_MESSAGE_MAX_SIZE - 1));
 
         // Copia a mensagem de controle para o buffer
-        std::memcpy(control_message_buffer, control_message.c_str(), bytes_to_copy);
-
-        // Adiciona um caractere nulo no final da mensagem para garantir o fim da string
-        control_message_buffer[bytes_to_copy] = '\0';
+        std::memcpy(control_message_buffer.data(), control_message.c_str(), bytes_to_copy);
 
         // Variável para armazenar o número total de bytes enviado
-        size_t total_bytes_sent = 0;
+        ByteCount total_bytes_sent = 0;
 
         // Variável para armazenar o número de bytes a ser enviado
         size_t bytes_to_send = 0;
 
         // Variável para armazenar o número de bytes enviado no send
-        size_t bytes_sent = 0;
+        ssize_t bytes_sent = 0;
+
+        // Indica que a conexão falhou e os chunks restantes não podem mais ser enviados
+        bool send_failed = false;
 
         while (total_bytes_sent < Constants::CONTROL_MESSAGE_MAX_SIZE) {
             bytes_to_send = 0;
             bytes_sent = 0;
 
             // Calcula quantos bytes enviar no próximo bloco
-            bytes_to_send = std::min(transfer_speed, Constants::CONTROL_MESSAGE_MAX_SIZE - static_cast<int>(total_bytes_sent));
+            bytes_to_send = std::min<ByteCount>(transfer_speed, Constants::CONTROL_MESSAGE_MAX_SIZE - total_bytes_sent);
 
             // Envia o bloco atual da mensagem
-            bytes_sent = send(new_sockfd, control_message_buffer + total_bytes_sent, bytes_to_send, 0);
+            bytes_sent = co_await event_loop.send(new_sockfd, control_message_buffer.data() + total_bytes_sent, bytes_to_send);
             
             // Verifica se houve erro ou o cliente fechou a conexão
             if (bytes_sent < 0) {
                 perror("Erro ao enviar o bloco da mensagem de controle.");
+                send_failed = true;
                 break;
             } else if (bytes_sent == 0) {
                 logMessage(LogType::INFO, "Conexão fechada pelo cliente.");
+                send_failed = true;
                 break;
             }
 
@@ -282,37 +530,84 @@ void TCPServer::sendChunks(const std::string& file_name, const std::vector<int>&
             logMessage(LogType::INFO, "Enviado " + std::to_string(bytes_sent) + " bytes da mensagem de controle para " + destination_info.ip + ":" + std::to_string(destination_info.port) + " (" + std::to_string(total_bytes_sent) + "/" + std::to_string(Constants::CONTROL_MESSAGE_MAX_SIZE) + " bytes).");
 
             // Simula a velocidade de transferência (bytes/segundo)
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            co_await event_loop.sleep(std::chrono::seconds(1));
         }
 
-        total_bytes_sent = 0;;
-
-        // Envia o chunk em blocos, respeitando a velocidade de transferência
-        while (total_bytes_sent < chunk_size) {
-            bytes_to_send = 0;
-            bytes_sent = 0;
+        total_bytes_sent = 0;
 
-            // Calcula quantos bytes enviar no próximo bloco
-            bytes_to_send = std::min(static_cast<size_t>(transfer_speed), chunk_size - total_bytes_sent);
+        // Hash calculado à medida que o chunk é lido, enviado ao final para o destino conferir
+        std::uint64_t chunk_hash = Constants::CHUNK_HASH_INITIAL_VALUE;
 
-            // Envia os bytes da estrutura em memória (file_buffer)
-            bytes_sent = send(new_sockfd, file_buffer + total_bytes_sent, bytes_to_send, 0);
+        // Bytes enviados desde a última pausa: a cada transfer_speed bytes (e ao fim do chunk) o envio
+        // pausa 1 segundo, independentemente de quantas janelas esses bytes ocupam
+        ByteCount bytes_since_pause = 0;
 
-            // Verifica se houve erro ou o cliente fechou a conexão
-            if (bytes_sent < 0) {
-                perror("Erro ao enviar o chunk.");
-                break;
-            } else if (bytes_sent == 0) {
-                logMessage(LogType::INFO, "Conexão fechada pelo cliente.");
+        // Envia o chunk uma janela por vez, e cada janela em blocos, respeitando a velocidade de transferência
+        while (!send_failed && total_bytes_sent < chunk_size) {
+            // Lê a próxima janela do chunk
+            size_t window_bytes = std::min<ByteCount>(window_size, chunk_size - total_bytes_sent);
+            if (!chunk_file.read(window_buffer.data(), window_bytes)) {
+                logMessage(LogType::ERROR, "Erro ao ler o chunk " + std::to_string(chunk) + " do arquivo " + file_name + ".");
+                send_failed = true;
                 break;
             }
+            chunk_hash = updateChunkHash(chunk_hash, window_buffer.data(), window_bytes);
 
-            total_bytes_sent += bytes_sent;
+            size_t window_bytes_sent = 0;
+            while (window_bytes_sent < window_bytes) {
+                bytes_to_send = 0;
+                bytes_sent = 0;
+
+                // Calcula quantos bytes enviar no próximo bloco: o que resta do segundo atual (a velocidade pode
+                // ter diminuído com a recarga de config.txt), limitado à janela
+                ByteCount speed = transfer_speed;
+                bytes_to_send = std::min<ByteCount>(speed > bytes_since_pause ? speed - bytes_since_pause : 1, window_bytes - window_bytes_sent);
 
-            logMessage(LogType::CHUNK_SENT, "Enviado " + std::to_string(bytes_sent) + " bytes do chunk " + std::to_string(chunk) + " do arquivo " + file_name + " para " + destination_info.ip + ":" + std::to_string(destination_info.port) + " (" + std::to_string(total_bytes_sent) + "/" + std::to_string(chunk_size) + " bytes).");
+                // Envia os bytes da janela em memória
+                bytes_sent = co_await event_loop.send(new_sockfd, window_buffer.data() + window_bytes_sent, bytes_to_send);
 
-            // Simula a velocidade de transferência em bytes por segundo
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+                // Verifica se houve erro ou o cliente fechou a conexão
+                if (bytes_sent < 0) {
+                    perror("Erro ao enviar o chunk.");
+                    send_failed = true;
+                    break;
+                } else if (bytes_sent == 0) {
+                    logMessage(LogType::INFO, "Conexão fechada pelo cliente.");
+                    send_failed = true;
+                    break;
+                }
+
+                window_bytes_sent += bytes_sent;
+                total_bytes_sent += bytes_sent;
+                bytes_since_pause += bytes_sent;
+
+                logMessage(LogType::CHUNK_SENT, "Enviado " + std::to_string(bytes_sent) + " bytes do chunk " + std::to_string(chunk) + " do arquivo " + file_name + " para " + destination_info.ip + ":" + std::to_string(destination_info.port) + " (" + std::to_string(total_bytes_sent) + "/" + std::to_string(chunk_size) + " bytes).");
+
+                // Simula a velocidade de transferência em bytes por segundo
+                if (bytes_since_pause >= speed || total_bytes_sent == chunk_size) {
+                    co_await event_loop.sleep(std::chrono::seconds(1));
+                    bytes_since_pause = 0;
+                }
+            }
+        }
+
+        // Envia o hash do chunk logo após os seus bytes
+        std::string hash_trailer = formatChunkHash(chunk_hash);
+        size_t hash_bytes_sent = 0;
+        while (!send_failed && hash_bytes_sent < hash_trailer.size()) {
+            bytes_sent = co_await event_loop.send(new_sockfd, hash_trailer.data() + hash_bytes_sent, hash_trailer.size() - hash_bytes_sent);
+            if (bytes_sent <= 0) {
+                perror("Erro ao enviar o hash do chunk.");
+                send_failed = true;
+                break;
+            }
+            hash_bytes_sent += bytes_sent;
+        }
+
+        // Sem conexão, os chunks restantes não podem ser enviados
+        if (send_failed) {
+            logMessage(LogType::ERROR, "Falha ao enviar o chunk " + std::to_string(chunk) + " do arquivo " + file_name + " para " + destination_info.ip + ":" + std::to_string(destination_info.port));
+            break;
         }
 
         logMessage(LogType::SUCCESS, "SUCESSO AO ENVIAR O CHUNK " + std::to_string(chunk) + " DO ARQUIVO " + file_name + " para " + destination_info.ip + ":" + std::to_string(destination_info.port));
@@ -323,6 +618,151 @@ void TCPServer::sendChunks(const std::string& file_name, const std::vector<int>&
 }
 
 
+/**
+ * @brief Transfere chunks para um peer no mesmo host através do transporte local.
+ */
+Task<bool> TCPServer::sendChunksLocal(const std::string& file_name, const std::vector<ChunkId>& chunks, const PeerInfo& destination_info) {
+    struct sockaddr_un destination_addr{};
+    destination_addr.sun_family = AF_UNIX;
+    std::string destination_path = getLocalSocketPath(destination_info.ip, destination_info.port);
+    if (destination_path.empty() || destination_path.size() >= sizeof(destination_addr.sun_path)) {
+        co_return false;
+    }
+    std::strncpy(destination_addr.sun_path, destination_path.c_str(), sizeof(destination_addr.sun_path) - 1);
+
+    // Cria um novo Unix domain socket não bloqueante para a conexão, com uma mensagem por chunk
+    int new_sockfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (new_sockfd < 0) {
+        perror("Erro ao criar socket do transporte local.");
+        co_return false;
+    }
+
+    // Se o destino não tiver o transporte local, a transferência segue via TCP
+    if (co_await event_loop.connect(new_sockfd, (struct sockaddr*)&destination_addr, sizeof(destination_addr)) < 0) {
+        close(new_sockfd);
+        co_return false;
+    }
+
+    // Itera sobre os chunks e envia o descritor de cada um
+    for (ChunkId chunk : chunks) {
+        // Obtém o caminho do chunk
+        std::string chunk_path = file_manager.getChunkPath(file_name, chunk);
+
+        // Abre o arquivo somente leitura, o descritor é repassado ao destino
+        int chunk_fd = open(chunk_path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat chunk_stat{};
+        if (chunk_fd < 0 || fstat(chunk_fd, &chunk_stat) < 0) {
+            logMessage(LogType::ERROR, "Chunk " + std::to_string(chunk) + " não encontrado.");
+            if (chunk_fd >= 0) {
+                close(chunk_fd);
+            }
+            continue;  // Pula para o próximo chunk
+        }
+
+        ByteCount chunk_size = chunk_stat.st_size;
+
+        // Cria a mensagem de controle, com o endereço do destino para que ele confira que o chunk é seu. Sem hash: o
+        // destino copia os bytes do próprio arquivo do remetente
+        std::stringstream ss;
+        ss << "PUT " << file_name << " " << chunk << " " << transfer_speed << " " << chunk_size << " " << destination_info.ip << " " << destination_info.port;
+        std::string control_message = ss.str();
+
+        struct iovec iov{};
+        iov.iov_base = const_cast<char*>(control_message.c_str());
+        iov.iov_len = control_message.size();
+
+        // Anexa o descritor do chunk como dado auxiliar (SCM_RIGHTS)
+        alignas(struct cmsghdr) char ancillary_buffer[CMSG_SPACE(sizeof(int))] = {0};
+
+        struct msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ancillary_buffer;
+        msg.msg_controllen = sizeof(ancillary_buffer);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &chunk_fd, sizeof(int));
+
+        // Sem espaço no buffer do socket: espera o destino consumir as mensagens anteriores. Com SOCK_SEQPACKET a
+        // mensagem é enviada inteira ou não é enviada
+        ssize_t bytes_sent = -1;
+        while (true) {
+            bytes_sent = sendmsg(new_sockfd, &msg, MSG_NOSIGNAL);
+            if (bytes_sent >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                break;
+            }
+            if (errno != EINTR && !co_await event_loop.writable(new_sockfd)) {
+                errno = ECANCELED;
+                break;
+            }
+        }
+
+        // O destino recebe uma cópia do descritor, o original pode ser fechado
+        close(chunk_fd);
+
+        if (bytes_sent != static_cast<ssize_t>(control_message.size())) {
+            perror("Erro ao enviar o chunk pelo transporte local.");
+            break;
+        }
+
+        logMessage(LogType::SUCCESS, "SUCESSO AO ENVIAR O CHUNK " + std::to_string(chunk) + " DO ARQUIVO " + file_name + " para " + destination_info.ip + ":" + std::to_string(destination_info.port) + " pelo transporte local (" + std::to_string(chunk_size) + " bytes).");
+    }
+
+    // Fecha o socket após enviar todos os chunks
+    close(new_sockfd);
+    co_return true;
+}
+
+
+/**
+ * @brief Verifica se um peer está no mesmo host que este peer.
+ */
+bool TCPServer::isColocated(const std::string& peer_ip) const {
+    return peer_ip == ip || peer_ip.rfind("127.", 0) == 0;
+}
+
+
+/**
+ * @brief Monta o caminho do Unix domain socket do transporte local de um peer.
+ */
+std::string TCPServer::getLocalSocketPath(const std::string& peer_ip, int tcp_port) {
+    std::string directory;
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir != nullptr && runtime_dir[0] != '\0') {
+        directory = runtime_dir;
+    } else {
+        // Pasta privada do usuário em /tmp, recusada se pertencer a outro usuário ou for acessível por outros
+        directory = Constants::LOCAL_SOCKET_FALLBACK_DIR + std::to_string(getuid());
+        mkdir(directory.c_str(), 0700);
+        struct stat directory_stat{};
+        if (lstat(directory.c_str(), &directory_stat) < 0 || !S_ISDIR(directory_stat.st_mode) ||
+            directory_stat.st_uid != getuid() || (directory_stat.st_mode & 0077) != 0) {
+            return "";
+        }
+    }
+    return directory + "/" + Constants::LOCAL_SOCKET_NAME_PREFIX + peer_ip + "-" + std::to_string(tcp_port) + ".sock";
+}
+
+
+/**
+ * @brief Verifica se há um processo escutando no Unix domain socket informado.
+ */
+bool TCPServer::isLocalSocketInUse(const struct sockaddr_un& local_addr) {
+    int probe_sockfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe_sockfd < 0) {
+        return false;
+    }
+
+    // ECONNREFUSED: arquivo sem processo escutando. EAGAIN: fila de conexões cheia, mas há um processo
+    bool in_use = connect(probe_sockfd, (const struct sockaddr*)&local_addr, sizeof(local_addr)) == 0 || errno == EAGAIN;
+    close(probe_sockfd);
+    return in_use;
+}
+
+
 /**
  * @brief Obtém o endereço IP e a porta TCP do cliente conectado via socket.
  */
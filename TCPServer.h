@@ -1,9 +1,15 @@
 #ifndef TCPSERVER_H
 #define TCPSERVER_H
 
+#include "AsyncRuntime.h"
+#include "BufferPool.h"
 #include "FileManager.h"
+#include "PeerQuality.h"
 #include "Utils.h"
+#include <atomic>
 #include <string>
+#include <sys/types.h>
+#include <sys/un.h>
 
 
 /**
@@ -31,10 +37,15 @@ class TCPServer {
 private:
     const std::string ip;                                   ///< Endereço IP do peer.
     const int port;                                         ///< Porta TCP para transferência.
+    const int udp_port;                                     ///< Porta UDP do peer, informada nos chunks enviados para identificar o remetente.
     const int peer_id;                                      ///< Identificador único (ID) do peer.
-    const int transfer_speed;                               ///< Capacidade de transferência em bytes por segundo.
+    std::atomic<ByteCount> transfer_speed;                  ///< Capacidade de transferência em bytes por segundo. Alterada em execução quando config.txt muda.
     int server_sockfd;                                      ///< Socket TCP para aceitar conexões.
+    int local_server_sockfd;                                ///< Unix domain socket para aceitar conexões de peers no mesmo host.
+    ino_t local_socket_inode;                               ///< Inode do arquivo do Unix domain socket criado por este peer, para removê-lo apenas se ainda for o mesmo.
     FileManager& file_manager;                              ///< Referência ao gerenciador de arquivos.
+    PeerQuality& peer_quality;                              ///< Tabela em que é registrada a vazão medida de cada chunk recebido.
+    EventLoop& event_loop;                                  ///< Referência ao runtime de corrotinas que executa as transferências.
 
 public:
     /**
@@ -46,32 +57,77 @@ public:
      * 
      * @param ip Endereço IP do peer.
      * @param port Porta TCP para transferência.
+     * @param udp_port Porta UDP do peer.
      * @param peer_id ID do peer na rede P2P.
      * @param transfer_speed Capacidade de transferência em bytes por segundo.
      * @param file_manager Referência ao gerenciador de arquivos para acessar os chunks disponíveis.
+     * @param peer_quality Referência à tabela de qualidade dos peers.
+     * @param event_loop Referência ao runtime de corrotinas que executa as transferências.
      */
-    TCPServer(const std::string& ip, int port, int peer_id, int transfer_speed, FileManager& file_manager);
+    TCPServer(const std::string& ip, int port, int udp_port, int peer_id, ByteCount transfer_speed, FileManager& file_manager, PeerQuality& peer_quality, EventLoop& event_loop);
+
+
+    /**
+     * @brief Destrutor da classe TCPServer.
+     * 
+     * Fecha os sockets de escuta e remove o arquivo do Unix domain socket do transporte local.
+     */
+    ~TCPServer();
+
+
+    /**
+     * @brief Altera a velocidade de envio dos chunks.
+     * 
+     * Os envios em andamento passam a usar a nova velocidade a partir do próximo bloco.
+     * 
+     * @param speed Nova velocidade em bytes/segundo.
+     */
+    void setTransferSpeed(ByteCount speed) { transfer_speed.store(speed); }
 
 
     /**
      * @brief Inicia o servidor TCP para aceitar conexões.
      * 
-     * Este método cria um socket TCP e aguarda conexões de peers que desejam
-     * transferir chunks. As transferências para cada conexão são gerenciadas
-     * em threads separadas para permitir múltiplas transferências simultâneas.
+     * Esta corrotina aguarda conexões de peers que desejam transferir chunks até o
+     * EventLoop ser encerrado. O recebimento de cada conexão é gerenciado em uma
+     * corrotina separada para permitir múltiplas transferências simultâneas.
      */
-    void run();
+    Task<void> run();
+
+
+    /**
+     * @brief Inicia o servidor do transporte local para aceitar conexões de peers no mesmo host.
+     * 
+     * Aguarda conexões no Unix domain socket do peer. Cada conexão é tratada em uma
+     * corrotina separada, da mesma forma que as conexões TCP.
+     */
+    Task<void> runLocal();
 
 
     /**
      * @brief Recebe chunks enviados por um peer e ao receber todos, monta o arquivo final.
      * 
      * Este método recebe dados de um chunk de um cliente que está conectado ao servidor.
-     * Ele armazena o chunk no diretório designado do peer.
+     * Ele armazena o chunk no diretório designado do peer. A vazão de cada chunk recebido é
+     * registrada na tabela de qualidade, pelo endereço UDP informado na mensagem PUT.
      * 
-     * @param client_sockfd Socket do cliente conectado.
+     * @param client_sockfd Socket do cliente conectado (não bloqueante).
      */
-    void receiveChunks(int client_sockfd);
+    Task<void> receiveChunks(int client_sockfd);
+
+
+    /**
+     * @brief Recebe chunks enviados por um peer no mesmo host através do transporte local.
+     * 
+     * O socket é SOCK_SEQPACKET: cada recvmsg devolve uma mensagem inteira, com a mensagem de
+     * controle PUT e, como dado auxiliar (SCM_RIGHTS), o descritor do arquivo de chunk do
+     * remetente. Mensagens truncadas são descartadas. O conteúdo é copiado diretamente desse
+     * descritor pelo FileManager. Mensagens PUT endereçadas a outro peer (IP e porta TCP
+     * diferentes dos deste peer) são descartadas.
+     * 
+     * @param client_sockfd Unix domain socket do cliente conectado (não bloqueante).
+     */
+    Task<void> receiveLocalChunks(int client_sockfd);
 
 
     /**
@@ -79,13 +135,61 @@ public:
      * 
      * Este método é responsável por enviar chunks específicos de um arquivo para um peer
      * que solicitou via mensagem REQUEST. Os chunks são recuperados do gerenciador de
-     * arquivos e então enviados.
+     * arquivos e então enviados. Os parâmetros são recebidos por valor, pois a corrotina
+     * pode continuar executando depois que quem a iniciou terminou.
      * 
      * @param file_name Nome do arquivo cujos chunks estão sendo solicitados.
      * @param chunks Lista com os IDs dos chunks que devem ser transferidos.
      * @param destination_info Informações sobre o peer que está solicitando os chunks, incluindo seu endereço IP e porta UDP (Porta TCP = Porta UDP + 1000).
      */
-    void sendChunks(const std::string& file_name, const std::vector<int>& chunks, const PeerInfo& destination_info);
+    Task<void> sendChunks(std::string file_name, std::vector<ChunkId> chunks, PeerInfo destination_info);
+
+
+    /**
+     * @brief Transfere chunks para um peer no mesmo host através do transporte local.
+     * 
+     * Conecta ao Unix domain socket do destino e, para cada chunk, envia a mensagem de controle
+     * PUT junto com o descritor do arquivo de chunk (SCM_RIGHTS), sem copiar os dados. Cada PUT
+     * é um único pacote SOCK_SEQPACKET, enviado inteiro. O socket é não bloqueante: a conexão e os envios aguardam o EventLoop, como no envio via TCP.
+     * 
+     * @param file_name Nome do arquivo cujos chunks estão sendo solicitados.
+     * @param chunks Lista com os IDs dos chunks que devem ser transferidos.
+     * @param destination_info Informações sobre o peer que está solicitando os chunks (IP e porta TCP).
+     * @return true se foi possível conectar ao destino pelo transporte local, false caso contrário.
+     */
+    Task<bool> sendChunksLocal(const std::string& file_name, const std::vector<ChunkId>& chunks, const PeerInfo& destination_info);
+
+
+    /**
+     * @brief Verifica se um peer está no mesmo host que este peer.
+     * 
+     * @param peer_ip Endereço IP do peer.
+     * @return true se o IP é de loopback ou igual ao IP deste peer, false caso contrário.
+     */
+    bool isColocated(const std::string& peer_ip) const;
+
+
+    /**
+     * @brief Monta o caminho do Unix domain socket do transporte local de um peer.
+     * 
+     * O socket fica na pasta de execução do usuário (XDG_RUNTIME_DIR ou, na falta dela,
+     * Constants::LOCAL_SOCKET_FALLBACK_DIR<uid>, criada com permissão 0700) e o nome inclui o
+     * IP e a porta TCP, pois peers co-locados em IPs de loopback diferentes podem usar a mesma porta.
+     * 
+     * @param peer_ip Endereço IP do peer.
+     * @param tcp_port Porta TCP do peer.
+     * @return Caminho do socket no sistema de arquivos, ou vazio se a pasta não puder ser usada.
+     */
+    static std::string getLocalSocketPath(const std::string& peer_ip, int tcp_port);
+
+
+    /**
+     * @brief Verifica se há um processo escutando no Unix domain socket informado.
+     * 
+     * @param local_addr Endereço do socket.
+     * @return true se a conexão foi aceita ou está na fila, false se o arquivo não existe ou sobrou de uma execução anterior.
+     */
+    static bool isLocalSocketInUse(const struct sockaddr_un& local_addr);
 
 
     /**
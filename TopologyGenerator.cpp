@@ -0,0 +1,548 @@
+#include "Utils.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/**
+ * Gerador de redes e cargas sintéticas.
+ *
+ * Gera um config.txt e um topologia.txt no formato lido pelo ConfigManager para redes de
+ * qualquer tamanho, em uma das formas abaixo, e uma carga de trabalho correspondente: os
+ * metadados (.p2p) de cada arquivo e os chunks distribuídos entre as pastas dos peers.
+ *
+ *   ring            anel em que cada peer se liga aos degree/2 vizinhos de cada lado
+ *   random-regular  grafo aleatório em que todos os peers têm (aproximadamente) o mesmo grau
+ *   small-world     anel reconectado com probabilidade rewire (Watts-Strogatz)
+ *   power-law       ligação preferencial (Barabási-Albert), com graus em lei de potência
+ *   clustered       grupos de peers ligados em anel, com pontes aleatórias entre os grupos
+ *
+ * A mesma semente gera sempre os mesmos arquivos: todos os sorteios usam o std::mt19937_64,
+ * cuja sequência é definida pelo padrão, e não as distribuições da biblioteca, cujos
+ * resultados variam entre implementações.
+ *
+ * Uso: p2p-generator --shape <forma> --peers <n> [opções]. A pasta de saída faz o papel de
+ * Constants::BASE_PATH: os peers devem ser executados a partir da pasta que a contém como src/.
+ */
+
+
+namespace {
+
+/**
+ * @brief Opções do gerador, com os valores padrão.
+ */
+struct GeneratorOptions {
+    std::string shape = "ring";             ///< Forma da topologia.
+    int peers = 5;                          ///< Número de peers.
+    int degree = 2;                         ///< Grau médio desejado.
+    double rewire = 0.1;                    ///< Probabilidade de reconexão (small-world) ou de ponte (clustered).
+    int clusters = 0;                       ///< Número de grupos (clustered). 0 escolhe a raiz quadrada do número de peers.
+    std::uint64_t seed = 1;                 ///< Semente dos sorteios.
+    std::string ip = "127.0.0.1";           ///< IP do primeiro peer.
+    int base_port = 6000;                   ///< Porta UDP do primeiro peer de cada IP.
+    int peers_per_ip = 1000;                ///< Número de peers por IP. Os seguintes usam os próximos endereços.
+    ByteCount min_speed = 200;              ///< Menor velocidade de transferência em bytes/segundo.
+    ByteCount max_speed = 200;              ///< Maior velocidade de transferência em bytes/segundo.
+    int files = 1;                          ///< Número de arquivos da carga. 0 gera apenas a topologia.
+    std::string file_prefix = "arquivo";    ///< Prefixo do nome dos arquivos (<prefixo><i>.bin).
+    ChunkId chunks = 4;                     ///< Número de chunks de cada arquivo.
+    ByteCount chunk_size = 3000;            ///< Tamanho de cada chunk em bytes.
+    int replicas = 1;                       ///< Número de peers que recebem cada chunk.
+    int ttl = 5;                            ///< TTL inicial gravado nos metadados.
+    std::string placement = "uniform";      ///< Escolha dos donos dos chunks: uniform ou degree (proporcional ao grau).
+    std::string output = "generated";       ///< Pasta de saída.
+};
+
+
+/**
+ * @brief Gerador de números aleatórios reprodutível entre plataformas.
+ */
+class SeededRandom {
+private:
+    std::mt19937_64 engine; ///< Gerador com sequência definida pelo padrão.
+
+public:
+    explicit SeededRandom(std::uint64_t seed) : engine(seed) {}
+
+    /**
+     * @brief Sorteia um inteiro em [0, bound), com a multiplicação de Lemire.
+     */
+    std::uint64_t below(std::uint64_t bound) {
+        return static_cast<std::uint64_t>((static_cast<unsigned __int128>(engine()) * bound) >> 64);
+    }
+
+    /**
+     * @brief Sorteia um real em [0, 1).
+     */
+    double unit() {
+        return static_cast<double>(engine() >> 11) * 0x1.0p-53;
+    }
+
+    /**
+     * @brief Retorna 64 bits aleatórios.
+     */
+    std::uint64_t bits() { return engine(); }
+};
+
+
+/**
+ * @brief Grafo não direcionado, com a lista de vizinhos de cada peer.
+ */
+using Graph = std::vector<std::vector<int>>;
+
+
+/**
+ * @brief Liga dois peers, ignorando laços e arestas repetidas.
+ *
+ * @return true se a aresta foi adicionada.
+ */
+bool addEdge(Graph& graph, int a, int b) {
+    if (a == b || std::find(graph[a].begin(), graph[a].end(), b) != graph[a].end()) {
+        return false;
+    }
+    graph[a].push_back(b);
+    graph[b].push_back(a);
+    return true;
+}
+
+
+/**
+ * @brief Remove a aresta entre dois peers.
+ */
+void removeEdge(Graph& graph, int a, int b) {
+    graph[a].erase(std::find(graph[a].begin(), graph[a].end(), b));
+    graph[b].erase(std::find(graph[b].begin(), graph[b].end(), a));
+}
+
+
+/**
+ * @brief Liga os peers first..first+count-1 em anel, cada um aos half_degree vizinhos de cada lado.
+ */
+void addRingLattice(Graph& graph, int first, int count, int half_degree) {
+    for (int i = 0; i < count; ++i) {
+        for (int k = 1; k <= half_degree && k < count; ++k) {
+            addEdge(graph, first + i, first + (i + k) % count);
+        }
+    }
+}
+
+
+/**
+ * @brief Anel: cada peer se liga aos degree/2 vizinhos de cada lado.
+ */
+Graph generateRing(const GeneratorOptions& options) {
+    Graph graph(options.peers);
+    addRingLattice(graph, 0, options.peers, std::max(1, options.degree / 2));
+    return graph;
+}
+
+
+/**
+ * @brief Grafo aleatório regular pelo modelo de configuração.
+ *
+ * Cada peer recebe degree pontas, que são embaralhadas e ligadas em pares. Os pares que
+ * formariam laços ou arestas repetidas são descartados, e esses peers ficam com grau menor.
+ */
+Graph generateRandomRegular(const GeneratorOptions& options, SeededRandom& random) {
+    Graph graph(options.peers);
+    std::vector<int> stubs;
+    stubs.reserve(static_cast<std::size_t>(options.peers) * options.degree);
+    for (int peer = 0; peer < options.peers; ++peer) {
+        stubs.insert(stubs.end(), options.degree, peer);
+    }
+    for (std::size_t i = stubs.size(); i > 1; --i) {
+        std::swap(stubs[i - 1], stubs[random.below(i)]);
+    }
+
+    std::size_t discarded = 0;
+    for (std::size_t i = 0; i + 1 < stubs.size(); i += 2) {
+        if (!addEdge(graph, stubs[i], stubs[i + 1])) {
+            discarded++;
+        }
+    }
+    if (discarded > 0) {
+        logMessage(LogType::INFO, "random-regular: " + std::to_string(discarded) + " pares descartados (laços ou arestas repetidas).");
+    }
+    return graph;
+}
+
+
+/**
+ * @brief Mundo pequeno (Watts-Strogatz): anel em que cada aresta é reconectada com probabilidade rewire.
+ */
+Graph generateSmallWorld(const GeneratorOptions& options, SeededRandom& random) {
+    Graph graph = generateRing(options);
+    int half_degree = std::max(1, options.degree / 2);
+
+    for (int k = 1; k <= half_degree; ++k) {
+        for (int i = 0; i < options.peers; ++i) {
+            int neighbor = (i + k) % options.peers;
+            if (random.unit() >= options.rewire) {
+                continue;
+            }
+            // Troca o vizinho por um peer aleatório, se houver algum ainda não ligado
+            int target = static_cast<int>(random.below(options.peers));
+            if (target != i && std::find(graph[i].begin(), graph[i].end(), target) == graph[i].end()
+                && std::find(graph[i].begin(), graph[i].end(), neighbor) != graph[i].end()) {
+                removeEdge(graph, i, neighbor);
+                addEdge(graph, i, target);
+            }
+        }
+    }
+    return graph;
+}
+
+
+/**
+ * @brief Lei de potência (Barabási-Albert): cada novo peer se liga a degree/2 peers, escolhidos com probabilidade proporcional ao grau.
+ */
+Graph generatePowerLaw(const GeneratorOptions& options, SeededRandom& random) {
+    Graph graph(options.peers);
+    int links = std::max(1, options.degree / 2);
+    int initial = std::min(options.peers, links + 1);
+
+    // Cada peer aparece uma vez por aresta: sortear uma posição é sortear proporcionalmente ao grau
+    std::vector<int> endpoints;
+    for (int a = 0; a < initial; ++a) {
+        for (int b = a + 1; b < initial; ++b) {
+            addEdge(graph, a, b);
+            endpoints.push_back(a);
+            endpoints.push_back(b);
+        }
+    }
+
+    for (int peer = initial; peer < options.peers; ++peer) {
+        int added = 0;
+        for (int attempt = 0; added < links && attempt < links * 16; ++attempt) {
+            int target = endpoints.empty() ? static_cast<int>(random.below(peer)) : endpoints[random.below(endpoints.size())];
+            if (addEdge(graph, peer, target)) {
+                endpoints.push_back(target);
+                added++;
+            }
+        }
+        endpoints.insert(endpoints.end(), added, peer);
+    }
+    return graph;
+}
+
+
+/**
+ * @brief Grupos: peers divididos em grupos ligados em anel, com pontes entre grupos.
+ *
+ * O primeiro peer de cada grupo se liga ao primeiro do grupo seguinte, o que mantém a rede
+ * conexa. Além disso, cada peer ganha uma ponte para um peer aleatório de outro grupo com
+ * probabilidade rewire.
+ */
+Graph generateClustered(const GeneratorOptions& options, SeededRandom& random) {
+    Graph graph(options.peers);
+    int clusters = options.clusters > 0 ? options.clusters : std::max(1, static_cast<int>(std::sqrt(options.peers)));
+    clusters = std::min(clusters, options.peers);
+    int half_degree = std::max(1, options.degree / 2);
+
+    // Limites dos grupos: os primeiros peers % clusters grupos têm um peer a mais
+    std::vector<int> cluster_first(clusters + 1);
+    for (int c = 0; c <= clusters; ++c) {
+        cluster_first[c] = static_cast<int>(static_cast<std::int64_t>(options.peers) * c / clusters);
+    }
+    for (int c = 0; c < clusters; ++c) {
+        addRingLattice(graph, cluster_first[c], cluster_first[c + 1] - cluster_first[c], half_degree);
+    }
+
+    if (clusters > 1) {
+        for (int c = 0; c < clusters; ++c) {
+            addEdge(graph, cluster_first[c], cluster_first[(c + 1) % clusters]);
+        }
+        for (int c = 0; c < clusters; ++c) {
+            for (int peer = cluster_first[c]; peer < cluster_first[c + 1]; ++peer) {
+                if (random.unit() >= options.rewire) {
+                    continue;
+                }
+                // Sorteia um peer fora do grupo
+                int outside = static_cast<int>(random.below(options.peers - (cluster_first[c + 1] - cluster_first[c])));
+                int target = outside < cluster_first[c] ? outside : outside + (cluster_first[c + 1] - cluster_first[c]);
+                addEdge(graph, peer, target);
+            }
+        }
+    }
+    return graph;
+}
+
+
+/**
+ * @brief Gera a topologia escolhida.
+ *
+ * @return O grafo, ou um grafo vazio se a forma não existir.
+ */
+Graph generateTopology(const GeneratorOptions& options, SeededRandom& random) {
+    if (options.shape == "ring") return generateRing(options);
+    if (options.shape == "random-regular") return generateRandomRegular(options, random);
+    if (options.shape == "small-world") return generateSmallWorld(options, random);
+    if (options.shape == "power-law") return generatePowerLaw(options, random);
+    if (options.shape == "clustered") return generateClustered(options, random);
+    return {};
+}
+
+
+/**
+ * @brief Grava o config.txt: "<id>: <ip>, <porta UDP>, <velocidade>".
+ *
+ * A porta TCP de cada peer é a UDP + 1000, então cada IP recebe no máximo peers_per_ip peers
+ * a partir de base_port, e os seguintes passam para o próximo endereço.
+ */
+bool writeConfig(const GeneratorOptions& options, const std::filesystem::path& path, SeededRandom& random) {
+    in_addr first_address{};
+    if (inet_pton(AF_INET, options.ip.c_str(), &first_address) != 1) {
+        logMessage(LogType::ERROR, "IP inválido: " + options.ip);
+        return false;
+    }
+    std::uint32_t first_ip = ntohl(first_address.s_addr);
+
+    std::ofstream config(path);
+    if (!config) {
+        logMessage(LogType::ERROR, "Não foi possível criar " + path.string());
+        return false;
+    }
+
+    char ip_text[INET_ADDRSTRLEN];
+    for (int peer = 0; peer < options.peers; ++peer) {
+        in_addr address{};
+        address.s_addr = htonl(first_ip + static_cast<std::uint32_t>(peer / options.peers_per_ip));
+        inet_ntop(AF_INET, &address, ip_text, sizeof(ip_text));
+
+        ByteCount speed = options.min_speed + static_cast<ByteCount>(random.below(static_cast<std::uint64_t>(options.max_speed - options.min_speed) + 1));
+        config << peer << ": " << ip_text << ", " << options.base_port + peer % options.peers_per_ip << ", " << speed << '\n';
+    }
+    return static_cast<bool>(config);
+}
+
+
+/**
+ * @brief Grava o topologia.txt: "<id>: <vizinho>, <vizinho>, ...", com os vizinhos em ordem crescente.
+ */
+bool writeTopology(Graph& graph, const std::filesystem::path& path) {
+    std::ofstream topology(path);
+    if (!topology) {
+        logMessage(LogType::ERROR, "Não foi possível criar " + path.string());
+        return false;
+    }
+
+    for (std::size_t peer = 0; peer < graph.size(); ++peer) {
+        std::sort(graph[peer].begin(), graph[peer].end());
+        topology << peer << ':';
+        for (std::size_t i = 0; i < graph[peer].size(); ++i) {
+            topology << (i == 0 ? " " : ", ") << graph[peer][i];
+        }
+        topology << '\n';
+    }
+    return static_cast<bool>(topology);
+}
+
+
+/**
+ * @brief Grava os arquivos da carga: os metadados de cada arquivo e os seus chunks nas pastas dos donos.
+ *
+ * Cada chunk é entregue a replicas peers distintos, sorteados uniformemente ou com probabilidade
+ * proporcional ao grau. Todas as réplicas de um chunk têm o mesmo conteúdo, gerado pela semente.
+ */
+bool writeWorkload(const GeneratorOptions& options, const Graph& graph, const std::filesystem::path& output, SeededRandom& random) {
+    // Peers sorteáveis: um por peer (uniform) ou um por ponta de aresta (degree)
+    std::vector<int> candidates;
+    for (int peer = 0; peer < options.peers; ++peer) {
+        std::size_t weight = options.placement == "degree" ? std::max<std::size_t>(graph[peer].size(), 1) : 1;
+        candidates.insert(candidates.end(), weight, peer);
+    }
+
+    std::map<int, std::size_t> chunks_per_peer;
+    std::string content(static_cast<std::size_t>(options.chunk_size), '\0');
+    for (int file = 0; file < options.files; ++file) {
+        std::string file_name = options.file_prefix + std::to_string(file) + ".bin";
+
+        std::ofstream metadata(output / (file_name + ".p2p"));
+        metadata << file_name << '\n' << options.chunks << '\n' << options.ttl << '\n' << options.chunk_size << '\n';
+        if (!metadata) {
+            logMessage(LogType::ERROR, "Não foi possível criar os metadados de " + file_name);
+            return false;
+        }
+
+        for (ChunkId chunk = 0; chunk < options.chunks; ++chunk) {
+            for (std::size_t i = 0; i < content.size(); i += 8) {
+                std::uint64_t word = random.bits();
+                std::copy_n(reinterpret_cast<const char*>(&word), std::min<std::size_t>(8, content.size() - i), content.begin() + i);
+            }
+
+            std::vector<int> owners;
+            while (owners.size() < static_cast<std::size_t>(options.replicas)) {
+                int owner = candidates[random.below(candidates.size())];
+                if (std::find(owners.begin(), owners.end(), owner) == owners.end()) {
+                    owners.push_back(owner);
+                }
+            }
+
+            for (const int owner : owners) {
+                std::filesystem::path directory = output / std::to_string(owner);
+                std::filesystem::create_directories(directory);
+                std::ofstream chunk_file(directory / (file_name + ".ch" + std::to_string(chunk)), std::ios::binary);
+                chunk_file.write(content.data(), static_cast<std::streamsize>(content.size()));
+                if (!chunk_file) {
+                    logMessage(LogType::ERROR, "Não foi possível gravar o chunk " + std::to_string(chunk) + " de " + file_name);
+                    return false;
+                }
+                chunks_per_peer[owner]++;
+            }
+        }
+    }
+
+    logMessage(LogType::INFO, std::to_string(options.files) + " arquivo(s) de " + std::to_string(options.chunks) + " chunks distribuídos entre "
+               + std::to_string(chunks_per_peer.size()) + " peers.");
+    return true;
+}
+
+
+/**
+ * @brief Converte o valor de uma opção numérica.
+ *
+ * @return true se o texto inteiro for um número válido.
+ */
+template <typename T>
+bool parseNumber(const std::string& text, T& value) {
+    const char* end = text.data() + text.size();
+    auto [ptr, error] = std::from_chars(text.data(), end, value);
+    return error == std::errc() && ptr == end;
+}
+
+
+/**
+ * @brief Lê as opções da linha de comando.
+ *
+ * @return true se todas as opções forem válidas.
+ */
+bool parseOptions(int argc, char* argv[], GeneratorOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            logMessage(LogType::ERROR, "Falta o valor da opção " + option);
+            return false;
+        }
+        std::string value = argv[++i];
+
+        bool valid = true;
+        if (option == "--shape") options.shape = value;
+        else if (option == "--peers") valid = parseNumber(value, options.peers);
+        else if (option == "--degree") valid = parseNumber(value, options.degree);
+        else if (option == "--rewire") valid = parseNumber(value, options.rewire);
+        else if (option == "--clusters") valid = parseNumber(value, options.clusters);
+        else if (option == "--seed") valid = parseNumber(value, options.seed);
+        else if (option == "--ip") options.ip = value;
+        else if (option == "--base-port") valid = parseNumber(value, options.base_port);
+        else if (option == "--peers-per-ip") valid = parseNumber(value, options.peers_per_ip);
+        else if (option == "--speed") {
+            // "<velocidade>" ou "<mínima>:<máxima>"
+            std::size_t colon = value.find(':');
+            valid = parseNumber(value.substr(0, colon), options.min_speed);
+            options.max_speed = options.min_speed;
+            if (valid && colon != std::string::npos) {
+                valid = parseNumber(value.substr(colon + 1), options.max_speed);
+            }
+        }
+        else if (option == "--files") valid = parseNumber(value, options.files);
+        else if (option == "--file-prefix") options.file_prefix = value;
+        else if (option == "--chunks") valid = parseNumber(value, options.chunks);
+        else if (option == "--chunk-size") valid = parseNumber(value, options.chunk_size);
+        else if (option == "--replicas") valid = parseNumber(value, options.replicas);
+        else if (option == "--ttl") valid = parseNumber(value, options.ttl);
+        else if (option == "--placement") options.placement = value;
+        else if (option == "--output") options.output = value;
+        else {
+            logMessage(LogType::ERROR, "Opção desconhecida: " + option);
+            return false;
+        }
+
+        if (!valid) {
+            logMessage(LogType::ERROR, "Valor inválido para " + option + ": " + value);
+            return false;
+        }
+    }
+
+    // Validação dos valores
+    if (options.peers < 1 || options.degree < 1 || options.rewire < 0 || options.rewire > 1 || options.clusters < 0) {
+        logMessage(LogType::ERROR, "Parâmetros da topologia inválidos: --peers e --degree devem ser positivos e --rewire deve estar em [0, 1].");
+        return false;
+    }
+    if (options.peers_per_ip < 1 || options.base_port < 1 || options.base_port + options.peers_per_ip - 1 + 1000 > 65535) {
+        logMessage(LogType::ERROR, "Portas inválidas: a porta TCP (UDP + 1000) do último peer de cada IP passaria de 65535. Reduza --peers-per-ip ou --base-port.");
+        return false;
+    }
+    if (options.min_speed < 1 || options.max_speed < options.min_speed) {
+        logMessage(LogType::ERROR, "Velocidades inválidas: use --speed <mínima>:<máxima> com 0 < mínima <= máxima.");
+        return false;
+    }
+    if (options.files < 0 || options.chunks < 1 || options.chunk_size < 1 || options.ttl < 0
+        || options.replicas < 1 || options.replicas > options.peers) {
+        logMessage(LogType::ERROR, "Parâmetros da carga inválidos: --chunks e --chunk-size devem ser positivos e --replicas deve estar entre 1 e --peers.");
+        return false;
+    }
+    if (options.placement != "uniform" && options.placement != "degree") {
+        logMessage(LogType::ERROR, "Distribuição desconhecida: " + options.placement + " (use uniform ou degree).");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    if (argc < 2 || !parseOptions(argc, argv, options)) {
+        logMessage(LogType::ERROR, "Uso: " + std::string(argv[0]) + " --shape <ring|random-regular|small-world|power-law|clustered> --peers <n>"
+                   " [--degree <k>] [--rewire <p>] [--clusters <c>] [--seed <s>] [--ip <ip>] [--base-port <porta>] [--peers-per-ip <n>]"
+                   " [--speed <mínima>[:<máxima>]] [--files <n>] [--file-prefix <nome>] [--chunks <n>] [--chunk-size <bytes>]"
+                   " [--replicas <n>] [--ttl <ttl>] [--placement <uniform|degree>] [--output <pasta>]");
+        return 1;
+    }
+
+    // Sorteios independentes para a topologia, as velocidades e a carga: mudar uma delas não altera as outras
+    SeededRandom topology_random(options.seed);
+    SeededRandom config_random(options.seed ^ 0x9E3779B97F4A7C15ULL);
+    SeededRandom workload_random(options.seed ^ 0xC2B2AE3D27D4EB4FULL);
+
+    Graph graph = generateTopology(options, topology_random);
+    if (graph.empty()) {
+        logMessage(LogType::ERROR, "Forma desconhecida: " + options.shape);
+        return 1;
+    }
+
+    std::filesystem::path output(options.output);
+    std::error_code error;
+    std::filesystem::create_directories(output, error);
+    if (error) {
+        logMessage(LogType::ERROR, "Não foi possível criar a pasta " + output.string() + ": " + error.message());
+        return 1;
+    }
+
+    if (!writeConfig(options, output / "config.txt", config_random) || !writeTopology(graph, output / "topologia.txt")) {
+        return 1;
+    }
+
+    std::size_t edges = 0;
+    std::size_t max_degree = 0;
+    for (const auto& neighbors : graph) {
+        edges += neighbors.size();
+        max_degree = std::max(max_degree, neighbors.size());
+    }
+    logMessage(LogType::SUCCESS, options.shape + ": " + std::to_string(options.peers) + " peers, " + std::to_string(edges / 2)
+               + " arestas, grau máximo " + std::to_string(max_degree) + " (semente " + std::to_string(options.seed) + ").");
+
+    if (options.files > 0 && !writeWorkload(options, graph, output, workload_random)) {
+        return 1;
+    }
+    return 0;
+}
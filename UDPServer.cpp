@@ -1,6 +1,8 @@
 #include "UDPServer.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <cstring>
 #include <iostream>
@@ -9,75 +11,256 @@
 #include <chrono>
 #include <sstream>
 #include <algorithm>
+#include <random>
+#include <charconv>
+#include <optional>
 
 /**
  * @brief Construtor da classe UDPServer.
  */
-UDPServer::UDPServer(const std::string& ip, int port, int tcp_port, int peer_id, int transfer_speed, FileManager& file_manager, TCPServer& tcp_server)
-    : ip(ip), port(port), tcp_port(tcp_port), peer_id(peer_id), transfer_speed(transfer_speed), file_manager(file_manager), tcp_server(tcp_server) {}
+UDPServer::UDPServer(const std::string& ip, int port, int tcp_port, int peer_id, ByteCount transfer_speed, FileManager& file_manager, TCPServer& tcp_server,
+                     PeerQuality& peer_quality, PeerTable& peer_table, EventLoop& event_loop)
+    : ip(ip), port(port), tcp_port(tcp_port), peer_id(peer_id), transfer_speed(transfer_speed), file_manager(file_manager), tcp_server(tcp_server),
+      peer_quality(peer_quality), peer_table(peer_table), event_loop(event_loop), dht(ip, port) {}
 
 
 /**
  * @brief Inicia o servidor UDP, permitindo que o peer receba e envie mensagens.
  */
 void UDPServer::run() {
-    char buffer[Constants::CONTROL_MESSAGE_MAX_SIZE];
+    initializeUDPSocket();
+
+    // Cada socket adicional tem sua própria thread de recebimento
+    std::vector<std::thread> receiver_threads;
+    for (std::size_t shard_index = 1; shard_index < receiver_sockfds.size(); ++shard_index) {
+        receiver_threads.emplace_back(&UDPServer::runReceiver, this, shard_index);
+    }
+
+    // O socket do grupo multicast também tem sua própria thread
+    if (multicast_sockfd >= 0) {
+        receiver_threads.emplace_back(&UDPServer::receiveMessages, this, multicast_sockfd);
+    }
+
+    // O primeiro socket é atendido pela própria thread do servidor
+    runReceiver(0);
+
+    for (auto& receiver_thread : receiver_threads) {
+        receiver_thread.join();
+    }
+
+    for (int receiver_sockfd : receiver_sockfds) {
+        close(receiver_sockfd);
+    }
+    if (multicast_sockfd >= 0) {
+        close(multicast_sockfd);
+    }
+}
+
+
+/**
+ * @brief Encerra os loops de recebimento.
+ */
+void UDPServer::stop() {
+    // O shutdown acorda as threads bloqueadas no recvfrom, que percebem o encerramento do EventLoop
+    for (int receiver_sockfd : receiver_sockfds) {
+        shutdown(receiver_sockfd, SHUT_RDWR);
+    }
+    if (multicast_sockfd >= 0) {
+        shutdown(multicast_sockfd, SHUT_RDWR);
+    }
+}
+
+
+/**
+ * @brief Loop de recebimento de um dos sockets UDP.
+ */
+void UDPServer::runReceiver(std::size_t shard_index) {
+    // Fixa a thread em um núcleo para que cada socket seja tratado sempre pelo mesmo núcleo
+    if (Constants::UDP_RECEIVER_PIN_TO_CORE && receiver_sockfds.size() > 1) {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(shard_index % cores, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+
+    receiveMessages(receiver_sockfds[shard_index]);
+}
+
+
+/**
+ * @brief Recebe as mensagens de um socket UDP até o EventLoop ser encerrado.
+ */
+void UDPServer::receiveMessages(int receiver_sockfd) {
     struct sockaddr_in sender_addr{};
     socklen_t addr_len = sizeof(sender_addr);
 
-    initializeUDPSocket();
+    while (!event_loop.isStopping()) {
+        // Obtém do pool o buffer que leva a mensagem até a corrotina que a processa
+        BufferPool::Buffer message = BufferPool::instance().acquire(Constants::CONTROL_MESSAGE_MAX_SIZE);
+        if (!message) {
+            logMessage(LogType::ERROR, "Sem memória para receber mensagens UDP.");
+            break;
+        }
 
-    while (true) {
-        // Recebe a mensagem UDP
-        ssize_t bytes_received = recvfrom(sockfd, buffer, Constants::CONTROL_MESSAGE_MAX_SIZE, 0,
+        // Recebe a mensagem UDP diretamente no buffer
+        addr_len = sizeof(sender_addr);
+        ssize_t bytes_received = recvfrom(receiver_sockfd, message.data(), Constants::CONTROL_MESSAGE_MAX_SIZE, 0,
                                  (struct sockaddr*)&sender_addr, &addr_len);
         if (bytes_received > 0) {
-            buffer[bytes_received] = '\0';
-            std::string message(buffer);
+            // Considera apenas os bytes até o primeiro terminador de string
+            message.resize(strnlen(message.data(), bytes_received));
 
             auto [direct_sender_ip, direct_sender_port] = getSenderAddressInfo(sender_addr);
 
             // Cria uma instância de PeerInfo para armazenar o IP e a porta UDP do remetente
             PeerInfo direct_sender_info(std::string(direct_sender_ip), direct_sender_port);
 
-            // Cria uma nova thread para processar a mensagem recebida
-            std::thread(&UDPServer::processMessage, this, message, direct_sender_info).detach();
+            // Processa a mensagem nesta thread até a primeira espera: a interpretação e as respostas imediatas ficam
+            // no núcleo do socket, e só as continuações (timers, envios em andamento) passam pelo Executor
+            event_loop.spawnInline(processMessage(std::move(message), direct_sender_info));
         }
     }
 }
 
 
 /**
- * @brief Função para criar e configurar o socket UDP.
+ * @brief Função para criar e configurar os sockets UDP.
  */
 void UDPServer::initializeUDPSocket() {
-    // Cria um socket UDP IPv4 (SOCK_DGRAM) especificando explicitamente o protocolo UDP (IPPROTO_UDP)
-    // Nota: SOCK_DGRAM já indica o uso de UDP, mas IPPROTO_UDP é passado para maior clareza e compatibilidade
-    if ((sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
-        perror("Falha ao criar socket");
-        exit(EXIT_FAILURE);
+    // Número de sockets na porta UDP, 0 indica um por núcleo
+    std::size_t shards = Constants::UDP_RECEIVER_SHARDS > 0
+        ? static_cast<std::size_t>(Constants::UDP_RECEIVER_SHARDS)
+        : std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t shard_index = 0; shard_index < shards; ++shard_index) {
+        int receiver_sockfd;
+
+        // Cria um socket UDP IPv4 (SOCK_DGRAM) especificando explicitamente o protocolo UDP (IPPROTO_UDP)
+        // Nota: SOCK_DGRAM já indica o uso de UDP, mas IPPROTO_UDP é passado para maior clareza e compatibilidade
+        if ((receiver_sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+            perror("Falha ao criar socket");
+            exit(EXIT_FAILURE);
+        }
+
+        // Com mais de um socket, todos precisam de SO_REUSEPORT para compartilhar a porta
+        if (shards > 1) {
+            int enable = 1;
+            if (setsockopt(receiver_sockfd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+                perror("Erro ao configurar SO_REUSEPORT no socket UDP");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // Associa o socket ao IP do peer, como o servidor TCP: peers no mesmo host em IPs de loopback
+        // diferentes (127.0.0.1, 127.0.0.2, ...) podem usar a mesma porta UDP
+        struct sockaddr_in addr = createSockAddr(ip.c_str(), port);
+
+        // Associa o socket UDP ao endereço IP e à porta especificados na estrutura addr
+        if (bind(receiver_sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            perror("Erro ao fazer bind no socket UDP");
+            exit(EXIT_FAILURE);
+        }
+
+        receiver_sockfds.push_back(receiver_sockfd);
     }
 
-    // Configura uma estrutura sockaddr_in para definir o endereço e a porta do socket UDP
-    struct sockaddr_in addr{};
+    // As mensagens são enviadas pelo primeiro socket, assim a porta de origem é sempre a porta UDP do peer
+    sockfd = receiver_sockfds[0];
 
-    // Define a família de endereços como IPv4
-    addr.sin_family = AF_INET;
+    logMessage(LogType::INFO, "Servidor UDP inicializado em " + ip + ":" + std::to_string(port) + " com " + std::to_string(shards) + " socket(s) de recebimento");
+
+    if (Constants::MULTICAST_DISCOVERY_ENABLED) {
+        initializeMulticastSocket();
+    }
+}
+
+
+/**
+ * @brief Cria o socket que recebe as buscas enviadas ao grupo multicast e configura o envio ao grupo.
+ */
+void UDPServer::initializeMulticastSocket() {
+    struct in_addr group_addr{};
+    struct in_addr interface_addr{};
+    if (inet_pton(AF_INET, Constants::MULTICAST_GROUP.c_str(), &group_addr) != 1 || inet_pton(AF_INET, ip.c_str(), &interface_addr) != 1) {
+        logMessage(LogType::ERROR, "Endereço inválido para a descoberta por multicast. A descoberta seguirá apenas pelos vizinhos.");
+        return;
+    }
+
+    int group_sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (group_sockfd < 0) {
+        perror("Falha ao criar o socket multicast");
+        return;
+    }
 
-    // htonl() converte para a ordem de bytes de rede
-    // Define o endereço IP para aceitar conexões de qualquer interface de rede local disponível (INADDR_ANY)
+    // Todos os peers do host escutam a mesma porta do grupo
+    int enable = 1;
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(Constants::MULTICAST_PORT);
+
+    struct ip_mreq membership{};
+    membership.imr_multiaddr = group_addr;
+    membership.imr_interface = interface_addr;
+
+    if (setsockopt(group_sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0 ||
+        bind(group_sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        setsockopt(group_sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+        perror("Erro ao entrar no grupo multicast");
+        close(group_sockfd);
+        return;
+    }
+
+    // As buscas saem pelo socket principal (a porta de origem é a porta UDP do peer), pela interface do peer
+    unsigned char hops = Constants::MULTICAST_HOPS;
+    unsigned char loopback = 1;
+    if (setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_IF, &interface_addr, sizeof(interface_addr)) < 0 ||
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) < 0 ||
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loopback, sizeof(loopback)) < 0) {
+        perror("Erro ao configurar o envio multicast");
+        close(group_sockfd);
+        return;
+    }
+
+    multicast_sockfd = group_sockfd;
+    logMessage(LogType::INFO, "Descoberta por multicast ativa no grupo " + Constants::MULTICAST_GROUP + ":" + std::to_string(Constants::MULTICAST_PORT) + ".");
+}
+
+
+/**
+ * @brief Envia uma busca (MDISCOVERY) com TTL 0 ao grupo multicast da rede local.
+ */
+void UDPServer::sendMulticastDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, const ChunkRange& range) {
+    // Mesmo formato da DISCOVERY, com outro comando para que quem recebe aplique o atraso aleatório
+    std::string message = "M" + buildChunkDiscoveryMessage(file_name, total_chunks, 0, PeerInfo(ip, port), range);
+
+    if (sendUDPMessage(Constants::MULTICAST_GROUP, Constants::MULTICAST_PORT, message) < 0) {
+        perror("Erro ao enviar mensagem UDP ao grupo multicast");
+    } else {
+        logMessage(LogType::DISCOVERY_SENT, "Mensagem de descoberta enviada ao grupo multicast " + Constants::MULTICAST_GROUP + " -> " + message);
+    }
+}
+
 
-    // Define a porta do socket
-    addr.sin_port = htons(port);
+/**
+ * @brief Processa uma busca recebida pelo grupo multicast (MDISCOVERY), depois de um atraso aleatório.
+ */
+Task<void> UDPServer::processMulticastDiscoveryMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    // O próprio peer também recebe a sua busca
+    if (direct_sender_info.ip == ip && direct_sender_info.port == port) {
+        co_return;
+    }
 
-    // Associa o socket UDP ao endereço IP e à porta especificados na estrutura addr
-    if (bind(sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        perror("Erro ao fazer bind no socket UDP");
-        exit(EXIT_FAILURE);
+    // Espalha as respostas dos peers do grupo no tempo, para o solicitante não receber todas de uma vez
+    static thread_local std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<int> backoff_ms(0, Constants::MULTICAST_RESPONSE_MAX_BACKOFF_MS);
+    bool completed = co_await event_loop.sleep(std::chrono::milliseconds(backoff_ms(generator)));
+    if (!completed) {
+        co_return;
     }
 
-    logMessage(LogType::INFO, "Servidor UDP inicializado em " + ip + ":" + std::to_string(port));
+    co_await processChunkDiscoveryMessage(message, direct_sender_info);
 }
 
 
@@ -109,12 +292,61 @@ ssize_t UDPServer::sendUDPMessage(const std::string& ip, int port, const std::st
  * @brief Define os vizinhos para o peer atual.
  */
 void UDPServer::setUDPNeighbors(const std::vector<std::tuple<std::string, int>>& neighbors) {
+    std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
     for (const auto& neighbor : neighbors) {
         std::string neighbor_ip = std::get<0>(neighbor);
         int neighbor_port = std::get<1>(neighbor);
 
         udpNeighbors.emplace_back(neighbor_ip, neighbor_port);
+        configured_neighbors.insert(neighbor);
+
+        // Os vizinhos são os primeiros contatos da DHT
+        dht.addContact(neighbor_ip, neighbor_port);
+    }
+}
+
+
+/**
+ * @brief Aplica em execução uma nova lista de vizinhos lida de topologia.txt.
+ */
+void UDPServer::reloadUDPNeighbors(const std::vector<std::tuple<std::string, int>>& neighbors) {
+    std::set<std::tuple<std::string, int>> new_configured(neighbors.begin(), neighbors.end());
+    std::vector<std::tuple<std::string, int>> removed;
+    {
+        std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+        std::set_difference(configured_neighbors.begin(), configured_neighbors.end(), new_configured.begin(), new_configured.end(),
+                            std::back_inserter(removed));
+        for (const auto& neighbor : removed) {
+            configured_neighbors.erase(neighbor);
+        }
     }
+
+    for (const auto& neighbor : removed) {
+        if (removeUDPNeighbor(neighbor)) {
+            logMessage(LogType::INFO, "Vizinho " + std::get<0>(neighbor) + ":" + std::to_string(std::get<1>(neighbor)) + " removido da topologia.");
+        }
+    }
+    for (const auto& neighbor : new_configured) {
+        addUDPNeighbor(neighbor, true);
+    }
+}
+
+
+/**
+ * @brief Retorna uma cópia da lista atual de vizinhos, que pode mudar em execução.
+ */
+std::vector<std::tuple<std::string, int>> UDPServer::getUDPNeighbors() const {
+    std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+    return udpNeighbors;
+}
+
+
+/**
+ * @brief Verifica se um peer é vizinho direto deste peer.
+ */
+bool UDPServer::isUDPNeighbor(const std::tuple<std::string, int>& peer) const {
+    std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+    return std::find(udpNeighbors.begin(), udpNeighbors.end(), peer) != udpNeighbors.end();
 }
 
 
@@ -137,12 +369,12 @@ std::tuple<std::string, int> UDPServer::getSenderAddressInfo(const sockaddr_in&
 
 
 /**
- * @brief Envia uma mensagem de descoberta (DISCOVERY) para todos os vizinhos.
+ * @brief Envia uma mensagem de descoberta (DISCOVERY) para os vizinhos.
  */
-void UDPServer::sendChunkDiscoveryMessage(const std::string& file_name, int total_chunks, int ttl, const PeerInfo& chunk_requester_info) {
-    std::string message = buildChunkDiscoveryMessage(file_name, total_chunks, ttl, chunk_requester_info);
+Task<void> UDPServer::sendChunkDiscoveryMessage(std::string file_name, ChunkId total_chunks, int ttl, PeerInfo chunk_requester_info, ChunkRange range) {
+    std::string message = buildChunkDiscoveryMessage(file_name, total_chunks, ttl, chunk_requester_info, range);
 
-    for (const auto& [neighbor_ip, neighbor_port] : udpNeighbors) {
+    for (const auto& [neighbor_ip, neighbor_port] : selectDiscoveryNeighbors(file_name, ttl)) {
         // Usa a função sendUDPMessage para enviar a mensagem
         ssize_t bytes_sent = sendUDPMessage(neighbor_ip, neighbor_port, message);
 
@@ -155,7 +387,7 @@ void UDPServer::sendChunkDiscoveryMessage(const std::string& file_name, int tota
         }
         
         // Professor pediu para dar um tempo quando for enviar as mensagens de descoberta
-        std::this_thread::sleep_for(std::chrono::seconds(Constants::DISCOVERY_MESSAGE_INTERVAL_SECONDS));
+        co_await event_loop.sleep(std::chrono::seconds(Constants::DISCOVERY_MESSAGE_INTERVAL_SECONDS));
     }
 }
 
@@ -163,8 +395,11 @@ void UDPServer::sendChunkDiscoveryMessage(const std::string& file_name, int tota
 /**
  * @brief Envia uma resposta (RESPONSE) contendo os chunks disponíveis para um arquivo.
  */
-void UDPServer::sendChunkResponseMessage(const std::string& file_name, const PeerInfo& chunk_requester_info) {
-    std::vector<int> chunks_available = file_manager.getAvailableChunks(file_name);
+void UDPServer::sendChunkResponseMessage(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range) {
+    std::vector<ChunkId> chunks_available = file_manager.getAvailableChunks(file_name);
+
+    // Anuncia apenas os chunks que interessam ao solicitante
+    std::erase_if(chunks_available, [&](ChunkId chunk) { return !range.contains(chunk); });
 
     if (!chunks_available.empty()) {
         std::string response_message = buildChunkResponseMessage(file_name, chunks_available);
@@ -178,7 +413,7 @@ void UDPServer::sendChunkResponseMessage(const std::string& file_name, const Pee
         }
 
         std::stringstream chunks_ss;
-        for (const int& chunk : chunks_available) {
+        for (const ChunkId& chunk : chunks_available) {
             chunks_ss << chunk << " ";
         }
 
@@ -195,24 +430,51 @@ void UDPServer::sendChunkResponseMessage(const std::string& file_name, const Pee
  * @brief Envia uma mensagem (REQUEST) para pedir chunks específicos de um arquivo.
  */
 void UDPServer::sendChunkRequestMessage(const std::string& file_name) {
+    // Chunks que ninguém possui agora serão pedidos quando algum peer os anunciar (HAVE)
+    {
+        std::lock_guard<std::mutex> requested_lock(requested_chunks_mutex);
+        bulk_request_files.insert(file_name);
+    }
+
     // Seleciona qual chunk pegar de qual peer
-    auto chunks_by_peer = file_manager.selectPeersForChunkDownload(file_name);
+    sendChunkRequests(file_name, file_manager.selectPeersForChunkDownload(file_name));
+}
+
+
+/**
+ * @brief Envia mensagens (REQUEST) pedindo apenas alguns chunks de um arquivo.
+ */
+std::vector<ChunkId> UDPServer::sendChunkRequestMessage(const std::string& file_name, const std::vector<ChunkId>& chunk_ids) {
+    auto chunks_by_peer = file_manager.selectPeersForChunkDownload(file_name, chunk_ids);
+    sendChunkRequests(file_name, chunks_by_peer);
+
+    std::vector<ChunkId> requested_chunks;
+    for (const auto& [peer, chunks] : chunks_by_peer) {
+        requested_chunks.insert(requested_chunks.end(), chunks.begin(), chunks.end());
+    }
+    return requested_chunks;
+}
+
+
+/**
+ * @brief Envia a mensagem REQUEST para cada peer selecionado.
+ */
+void UDPServer::sendChunkRequests(const std::string& file_name, const std::unordered_map<PeerId, std::vector<ChunkId>>& chunks_by_peer) {
+    {
+        std::lock_guard<std::mutex> requested_lock(requested_chunks_mutex);
+        auto& requested = requested_chunks[file_name];
+        for (const auto& [peer, chunks] : chunks_by_peer) {
+            requested.insert(chunks.begin(), chunks.end());
+        }
+    }
 
     // Itera sobre cada peer e seus chunks
-    for (const auto& [peer_ip_port, chunks] : chunks_by_peer) {
+    for (const auto& [peer, chunks] : chunks_by_peer) {
         // Monta a mensagem de requisição (REQUEST) para os chunks específicos
         std::string request_message = buildChunkRequestMessage(file_name, chunks);
 
-        // Extrai a porta e o IP da string "iP:port"
-        std::string peer_ip;
-        int peer_port;
-
-        // Encontra a posição do ":" para separar o IP da porta
-        std::size_t colon_pos = peer_ip_port.find(':');
-        if (colon_pos != std::string::npos) {
-            peer_ip = peer_ip_port.substr(0, colon_pos); // Extrai o IP
-            peer_port = std::stoi(peer_ip_port.substr(colon_pos + 1)); // Converte a porta para int
-        }
+        // Obtém o IP e a porta do peer na tabela de PeerId
+        const auto& [peer_ip, peer_port] = peer_table.getEndpoint(peer);
 
         // Envia a mensagem REQUEST via UDP para o peer (IP e porta)
         ssize_t bytes_sent = sendUDPMessage(peer_ip, peer_port, request_message);
@@ -220,19 +482,111 @@ void UDPServer::sendChunkRequestMessage(const std::string& file_name) {
         if (bytes_sent < 0) {
             perror("Erro ao enviar mensagem UDP REQUEST de chunks");
         } else {
-            logMessage(LogType::REQUEST_SENT, "Mensagem REQUEST enviada para " + peer_ip_port +
+            logMessage(LogType::REQUEST_SENT, "Mensagem REQUEST enviada para " + peer_ip + ":" + std::to_string(peer_port) +
                        " -> " + request_message);
         }
     }
 }
 
 
+/**
+ * @brief Registra um peer que buscou um arquivo, para que ele receba anúncios (HAVE) dos chunks novos.
+ */
+void UDPServer::registerInterest(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range) {
+    auto expires_at = std::chrono::steady_clock::now() + std::chrono::seconds(Constants::HAVE_INTEREST_TTL_SECONDS);
+
+    std::lock_guard<std::mutex> interest_lock(interested_peers_mutex);
+    auto& peers = interested_peers[file_name];
+
+    // A mesma busca chega por vários caminhos: renova o interesse em vez de duplicá-lo
+    auto it = std::find_if(peers.begin(), peers.end(), [&](const InterestedPeer& peer) {
+        return peer.info.ip == chunk_requester_info.ip && peer.info.port == chunk_requester_info.port;
+    });
+    if (it != peers.end()) {
+        it->range = range;
+        it->expires_at = expires_at;
+        return;
+    }
+
+    if (peers.size() >= Constants::HAVE_MAX_INTERESTED_PEERS) {
+        peers.erase(std::min_element(peers.begin(), peers.end(), [](const InterestedPeer& a, const InterestedPeer& b) {
+            return a.expires_at < b.expires_at;
+        }));
+    }
+    peers.push_back(InterestedPeer{chunk_requester_info, range, expires_at});
+}
+
+
+/**
+ * @brief Envia periodicamente mensagens HAVE com os chunks salvos desde o último envio.
+ */
+Task<void> UDPServer::runHaveAnnouncer() {
+    const auto interval = std::chrono::milliseconds(Constants::HAVE_ANNOUNCE_INTERVAL_MS);
+    while (!event_loop.isStopping()) {
+        bool completed = co_await event_loop.sleep(interval);
+        if (!completed) {
+            break;
+        }
+
+        auto new_chunks = file_manager.takeNewChunks(Constants::HAVE_MAX_CHUNKS_PER_INTERVAL);
+        if (new_chunks.empty()) {
+            continue;
+        }
+
+        // Copia os interessados de cada arquivo, descartando os que expiraram
+        auto now = std::chrono::steady_clock::now();
+        std::vector<std::pair<std::string, std::vector<InterestedPeer>>> announcements;
+        {
+            std::lock_guard<std::mutex> interest_lock(interested_peers_mutex);
+            for (const auto& [file_name, chunks] : new_chunks) {
+                auto it = interested_peers.find(file_name);
+                if (it == interested_peers.end()) {
+                    continue;
+                }
+                std::erase_if(it->second, [&](const InterestedPeer& peer) { return peer.expires_at <= now; });
+                if (it->second.empty()) {
+                    interested_peers.erase(it);
+                    continue;
+                }
+                announcements.emplace_back(file_name, it->second);
+            }
+        }
+
+        for (const auto& [file_name, peers] : announcements) {
+            const auto& chunks = new_chunks[file_name];
+            for (const auto& peer : peers) {
+                // Anuncia apenas os chunks que interessam ao peer
+                std::vector<ChunkId> chunks_in_range;
+                std::copy_if(chunks.begin(), chunks.end(), std::back_inserter(chunks_in_range),
+                             [&](ChunkId chunk) { return peer.range.contains(chunk); });
+                if (chunks_in_range.empty()) {
+                    continue;
+                }
+
+                for (const auto& have_message : buildChunkHaveMessages(file_name, chunks_in_range)) {
+                    if (sendUDPMessage(peer.info.ip, peer.info.port, have_message) < 0) {
+                        perror("Erro ao enviar mensagem UDP HAVE");
+                    } else {
+                        logMessage(LogType::HAVE_SENT, "Mensagem HAVE enviada para " + peer.info.ip + ":" + std::to_string(peer.info.port) + " -> " + have_message);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
 /**
  * @brief Monta a mensagem de descoberta (DISCOVERY) de um arquivo para envio.
  */
-std::string UDPServer::buildChunkDiscoveryMessage(const std::string& file_name, int total_chunks, int ttl, const PeerInfo& chunk_requester_info) const {
+std::string UDPServer::buildChunkDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, int ttl, const PeerInfo& chunk_requester_info, const ChunkRange& range) const {
     std::stringstream ss;
     ss << "DISCOVERY " << file_name << " " << total_chunks << " " << ttl << " " << chunk_requester_info.ip << ":" << chunk_requester_info.port;
+
+    // Download parcial: informa o intervalo de chunks de interesse
+    if (range.first != 0 || range.end != total_chunks) {
+        ss << " " << range.first << " " << range.end;
+    }
     return ss.str();
 }
 
@@ -240,11 +594,11 @@ std::string UDPServer::buildChunkDiscoveryMessage(const std::string& file_name,
 /**
  * @brief Monta a mensagem de resposta (RESPONSE) contendo os chunks disponíveis.
  */
-std::string UDPServer::buildChunkResponseMessage(const std::string& file_name, const std::vector<int>& chunks_available) const {
+std::string UDPServer::buildChunkResponseMessage(const std::string& file_name, const std::vector<ChunkId>& chunks_available) const {
     std::stringstream ss;
     ss << "RESPONSE " << file_name << " " << transfer_speed << " ";  // Inicia a mensagem com LogType::RESPONSE e o nome do arquivo
     
-    for (const int& chunk : chunks_available) {
+    for (const ChunkId& chunk : chunks_available) {
         ss << chunk << " ";  // Adiciona o ID de cada chunk disponível
     }
 
@@ -252,14 +606,39 @@ std::string UDPServer::buildChunkResponseMessage(const std::string& file_name, c
 }
 
 
+/**
+ * @brief Monta as mensagens de anúncio (HAVE) de chunks novos de um arquivo.
+ */
+std::vector<std::string> UDPServer::buildChunkHaveMessages(const std::string& file_name, const std::vector<ChunkId>& chunks) const {
+    std::vector<std::string> messages;
+    const std::string header = "HAVE " + file_name + " " + std::to_string(transfer_speed) + " ";
+    std::string message = header;
+
+    for (const ChunkId& chunk : chunks) {
+        std::string chunk_text = std::to_string(chunk) + " ";
+        // Inicia uma nova mensagem quando a atual passaria do tamanho máximo (o receptor reserva um byte para o terminador)
+        if (message.size() + chunk_text.size() >= static_cast<std::size_t>(Constants::CONTROL_MESSAGE_MAX_SIZE) && message.size() > header.size()) {
+            messages.push_back(message);
+            message = header;
+        }
+        message += chunk_text;
+    }
+    if (message.size() > header.size()) {
+        messages.push_back(message);
+    }
+
+    return messages;
+}
+
+
 /**
  * @brief Monta a mensagem de requisição (REQUEST) para pedir chunks específicos de um arquivo.
  */
-std::string UDPServer::buildChunkRequestMessage(const std::string& file_name, const std::vector<int>& chunks) const {
+std::string UDPServer::buildChunkRequestMessage(const std::string& file_name, const std::vector<ChunkId>& chunks) const {
     std::stringstream ss;
     ss << "REQUEST " << file_name << " " << tcp_port << " ";
     
-    for (const int& chunk : chunks) {
+    for (const ChunkId& chunk : chunks) {
         ss << chunk << " ";
     }
 
@@ -270,14 +649,17 @@ std::string UDPServer::buildChunkRequestMessage(const std::string& file_name, co
 /**
  * @brief Processa uma mensagem recebida de outro peer.
  */
-void UDPServer::processMessage(const std::string& message, const PeerInfo& direct_sender_info) {
-    std::stringstream ss(message);
+Task<void> UDPServer::processMessage(BufferPool::Buffer message, PeerInfo direct_sender_info) {
+    // Lê a mensagem diretamente do buffer recebido
+    BufferStream ss(std::move(message));
     std::string command, file_name;
     ss >> command;
 
     if (command == "DISCOVERY") {
-         processChunkDiscoveryMessage(ss, direct_sender_info);
-    } else if (command == "RESPONSE") {
+        co_await processChunkDiscoveryMessage(ss, direct_sender_info);
+    } else if (command == "MDISCOVERY") {
+        co_await processMulticastDiscoveryMessage(ss, direct_sender_info);
+    } else if (command == "RESPONSE" || command == "LOCATION") {
         {
             std::streampos pos_before_file_name = ss.tellg(); // Salva a posição antes de ler o file_name
             ss >> file_name;
@@ -285,14 +667,60 @@ void UDPServer::processMessage(const std::string& message, const PeerInfo& direc
             if (processing_active_map[file_name]) {
                 ss.clear(); // Limpa qualquer flag de erro no stream
                 ss.seekg(pos_before_file_name); // Volta para a posição antes de ler o file_name
-                processChunkResponseMessage(ss, direct_sender_info);
+                if (command == "RESPONSE") {
+                    processChunkResponseMessage(ss, direct_sender_info);
+                } else {
+                    processLocationMessage(ss, direct_sender_info, false);
+                }
             } else {
-                logMessage(LogType::OTHER, "Mensagem RESPONSE recebida para " + file_name + ", mas o processamento está desativado.");
+                logMessage(LogType::OTHER, "Mensagem " + command + " recebida para " + file_name + ", mas o processamento está desativado.");
             }
         }
     }
+    else if (command == "AGGREGATE") {
+        processAggregateMessage(ss, direct_sender_info);
+    }
+    else if (command == "CACHE") {
+        processLocationMessage(ss, direct_sender_info, true);
+    }
+    else if (command == "REGISTER") {
+        processRegisterMessage(ss, direct_sender_info);
+    }
+    else if (command == "HAVE") {
+        processChunkHaveMessage(ss, direct_sender_info);
+    }
+    else if (command == "BLOOM") {
+        processBloomMessage(ss, direct_sender_info);
+    }
+    else if (command == "WALK" || command == "WALK_CONTINUE") {
+        processWalkMessage(ss, direct_sender_info, command == "WALK_CONTINUE");
+    }
+    else if (command == "WALK_CHECK") {
+        processWalkCheckMessage(ss, direct_sender_info);
+    }
+    else if (command == "FIND_NODE" || command == "FIND_PROVIDERS") {
+        dht.addContact(direct_sender_info.ip, direct_sender_info.port);
+        processDHTQueryMessage(ss, direct_sender_info, command == "FIND_PROVIDERS");
+    }
+    else if (command == "NODES") {
+        dht.addContact(direct_sender_info.ip, direct_sender_info.port);
+        processDHTNodesMessage(ss, direct_sender_info);
+    }
+    else if (command == "ADD_PROVIDER") {
+        dht.addContact(direct_sender_info.ip, direct_sender_info.port);
+        processDHTAddProviderMessage(ss, direct_sender_info);
+    }
+    else if (command == "PEX") {
+        processPexMessage(ss, direct_sender_info);
+    }
+    else if (command == "NEIGHBOR_ADD" || command == "NEIGHBOR_ACCEPT" || command == "NEIGHBOR_DROP") {
+        processNeighborMessage(command, direct_sender_info);
+    }
+    else if (command == "PING" || command == "PONG") {
+        processProbeMessage(ss, direct_sender_info, command == "PONG");
+    }
     else if (command == "REQUEST") {
-        processChunkRequestMessage(ss, direct_sender_info);
+        co_await processChunkRequestMessage(ss, direct_sender_info);
     }
     else {
         logMessage(LogType::ERROR, "Comando desconhecido recebido: " + command);
@@ -303,18 +731,23 @@ void UDPServer::processMessage(const std::string& message, const PeerInfo& direc
 /**
  * @brief Processa uma mensagem de descoberta (DISCOVERY) recebida de outro peer.
  */
-void UDPServer::processChunkDiscoveryMessage(std::stringstream& message, const PeerInfo& direct_sender_info) {
+Task<void> UDPServer::processChunkDiscoveryMessage(std::istream& message, const PeerInfo& direct_sender_info) {
     std::string file_name, chunk_requester_ip_port, chunk_requester_ip;
-    int total_chunks, ttl, chunk_requester_port;
-    size_t colon_pos;
-
-    // Extrai os dados da mensagem DISCOVERY
-    message >> file_name >> total_chunks >> ttl >> chunk_requester_ip_port;
+    ChunkId total_chunks;
+    int ttl, chunk_requester_port;
+
+    // Extrai os dados da mensagem DISCOVERY e separa o IP e a porta do peer original
+    if (!(message >> file_name >> total_chunks >> ttl >> chunk_requester_ip_port) ||
+        !parseAddress(chunk_requester_ip_port, chunk_requester_ip, chunk_requester_port)) {
+        logMessage(LogType::ERROR, "Mensagem DISCOVERY mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        co_return;
+    }
 
-    // Separa o IP e a porta do peer original
-    colon_pos = chunk_requester_ip_port.find(':');
-    chunk_requester_ip = chunk_requester_ip_port.substr(0, colon_pos);
-    chunk_requester_port = std::stoi(chunk_requester_ip_port.substr(colon_pos + 1));
+    // Intervalo de chunks opcional (downloads parciais), por padrão o arquivo inteiro
+    ChunkRange range{0, total_chunks};
+    if (!(message >> range.first >> range.end)) {
+        range = ChunkRange{0, total_chunks};
+    }
 
     // Só manda mensagem de descoberta de mensagens que não foi o próprio peer que enviou
     if (chunk_requester_ip != ip || chunk_requester_port != port) {
@@ -326,12 +759,53 @@ void UDPServer::processChunkDiscoveryMessage(std::stringstream& message, const P
         // Monta um Peer Info do solicitante dos chunks do arquivo
         PeerInfo chunk_requester_info(std::string(chunk_requester_ip), chunk_requester_port);
 
-        // Verifica se possui chunks do arquivo e envia a resposta
-        sendChunkResponseMessage(file_name, chunk_requester_info);
+        // Cópias da mesma busca chegam por vários caminhos da inundação
+        QueryCoalescing coalescing = super_peers.empty() ? coalesceQuery(file_name, chunk_requester_info, range, ttl) : QueryCoalescing::NEW;
+        if (coalescing == QueryCoalescing::DUPLICATE) {
+            logMessage(LogType::OTHER, "Cópia da busca de " + file_name + " do Peer " + chunk_requester_ip_port + " descartada.");
+            co_return;
+        }
+
+        // Verifica se possui chunks do arquivo e envia a resposta (direto ao solicitante ou pelo caminho inverso)
+        bool reverse_path = Constants::REVERSE_PATH_RESPONSES && super_peers.empty();
+        if (reverse_path) {
+            registerReverseRoute(file_name, chunk_requester_info, direct_sender_info);
+            addToAggregate(file_name, chunk_requester_info, std::make_tuple(ip, port), transfer_speed,
+                           clipChunkRuns(toChunkRuns(file_manager.getAvailableChunks(file_name)), range));
+        } else {
+            sendChunkResponseMessage(file_name, chunk_requester_info, range);
+        }
+
+        // Chunks obtidos daqui em diante são anunciados ao solicitante (HAVE)
+        registerInterest(file_name, chunk_requester_info, range);
+
+        // Permite que o peer anterior responda pelo cache às próximas buscas (pelo caminho inverso, ele já vê as respostas)
+        if (Constants::RESPONSE_CACHE_ENABLED && super_peers.empty() && !reverse_path &&
+            (direct_sender_info.ip != chunk_requester_ip || direct_sender_info.port != chunk_requester_port)) {
+            sendCacheHint(file_name, total_chunks, direct_sender_info);
+        }
 
+        // Com super-peers, a busca percorre apenas a camada de super-peers
+        if (!super_peers.empty()) {
+            if (is_super_peer) {
+                sendIndexedLocations(file_name, chunk_requester_info, range);
+                if (!isSuperPeer(std::make_tuple(direct_sender_info.ip, direct_sender_info.port))) {
+                    forwardDiscoveryToSuperPeers(file_name, total_chunks, chunk_requester_info, range);
+                }
+            }
+        }
+        // Outra busca do arquivo já inundou a rede a partir deste peer, e os seus resultados voltam por ele
+        else if (coalescing == QueryCoalescing::SUBSCRIBED) {
+            answerFromResponseCache(file_name, chunk_requester_info, range);
+            logMessage(LogType::INFO, "Busca de " + file_name + " do Peer " + chunk_requester_ip_port + " atendida pela busca em andamento, sem repassar aos vizinhos.");
+        }
+        // Arquivo popular: o cache já tem quem possui todos os chunks de interesse
+        else if (Constants::RESPONSE_CACHE_ENABLED && answerFromResponseCache(file_name, chunk_requester_info, range)) {
+            logMessage(LogType::INFO, "DISCOVERY de " + file_name + " respondida pelo cache, sem repassar aos vizinhos.");
+        }
         // Propaga a mensagem para os vizinhos se o TTL for maior que zero
-        if (ttl > 0) {
-            sendChunkDiscoveryMessage(file_name, total_chunks, ttl - 1, chunk_requester_info);
+        else if (ttl > 0) {
+            co_await sendChunkDiscoveryMessage(file_name, total_chunks, ttl - 1, chunk_requester_info, range);
         }
     }
 }
@@ -340,16 +814,20 @@ void UDPServer::processChunkDiscoveryMessage(std::stringstream& message, const P
 /**
  * @brief Processa uma mensagem de resposta (RESPONSE) recebida de outro peer.
  */
-void UDPServer::processChunkResponseMessage(std::stringstream& message, const PeerInfo& direct_sender_info) {
+void UDPServer::processChunkResponseMessage(std::istream& message, const PeerInfo& direct_sender_info) {
     std::string file_name;
-    int transfer_speed;
-    std::vector<int> chunks_received;
+    ByteCount transfer_speed;
+    std::vector<ChunkId> chunks_received;
+
+    std::vector<ChunkId> chunks_announced;
 
     // Extrai o nome do arquivo e os chunks disponíveis
     message >> file_name >> transfer_speed;
 
-    int chunk;
+    ChunkId chunk;
     while (message >> chunk) {
+        chunks_announced.push_back(chunk);
+
         // Só adiciona no map chunk_location_info os chunks que eu não possuo
         bool has_chunk = file_manager.hasChunk(file_name, chunk);
         if (!has_chunk) {
@@ -357,15 +835,21 @@ void UDPServer::processChunkResponseMessage(std::stringstream& message, const Pe
         }
     }
 
+    // A resposta também serve às próximas buscas que passarem por este peer
+    if (Constants::RESPONSE_CACHE_ENABLED) {
+        cacheResponse(file_name, std::make_tuple(direct_sender_info.ip, direct_sender_info.port), transfer_speed, toChunkRuns(chunks_announced));
+    }
+
     if (chunks_received.size() > 0) {
         std::stringstream chunks_ss;
 
-        for (const int& chunk : chunks_received) {
+        for (const ChunkId& chunk : chunks_received) {
             chunks_ss << chunk << " ";
         }
 
         // Armazena as respostas recebidas no mapa
         file_manager.storeChunkLocationInfo(file_name, chunks_received, direct_sender_info.ip, direct_sender_info.port, transfer_speed);
+        trackHolder(direct_sender_info.ip, direct_sender_info.port);
 
         logMessage(LogType::RESPONSE_RECEIVED,
                "Recebida resposta do Peer " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) +
@@ -373,13 +857,67 @@ void UDPServer::processChunkResponseMessage(std::stringstream& message, const Pe
     }
 }
 
+/**
+ * @brief Processa um anúncio (HAVE) de chunks que outro peer acabou de obter.
+ */
+void UDPServer::processChunkHaveMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    std::string file_name;
+    ByteCount transfer_speed;
+    std::vector<ChunkId> chunks_announced;
+
+    message >> file_name >> transfer_speed;
+
+    ChunkId chunk;
+    while (message >> chunk) {
+        if (!file_manager.hasChunk(file_name, chunk)) {
+            chunks_announced.push_back(chunk);
+        }
+    }
+
+    if (chunks_announced.empty()) {
+        return;
+    }
+
+    // Atualiza a localização dos chunks (ignorado se o arquivo não estiver sendo baixado)
+    file_manager.storeChunkLocationInfo(file_name, chunks_announced, direct_sender_info.ip, direct_sender_info.port, transfer_speed);
+
+    std::stringstream chunks_ss;
+    for (const ChunkId& announced_chunk : chunks_announced) {
+        chunks_ss << announced_chunk << " ";
+    }
+    logMessage(LogType::HAVE_RECEIVED,
+               "Recebido anúncio do Peer " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) +
+               " para o arquivo '" + file_name + "'. Novos chunks disponíveis: " + chunks_ss.str());
+
+    // Em downloads feitos de uma vez, pede os chunks que ainda não tinham fonte
+    std::vector<ChunkId> chunks_to_request;
+    {
+        std::lock_guard<std::mutex> requested_lock(requested_chunks_mutex);
+        if (bulk_request_files.count(file_name) == 0) {
+            return;
+        }
+        const auto& requested = requested_chunks[file_name];
+        for (const ChunkId announced_chunk : chunks_announced) {
+            if (requested.count(announced_chunk) == 0) {
+                chunks_to_request.push_back(announced_chunk);
+            }
+        }
+    }
+
+    if (!chunks_to_request.empty()) {
+        sendChunkRequestMessage(file_name, chunks_to_request);
+    }
+}
+
+
 /**
  * @brief Processa uma mensagem de requisição (REQUEST) recebida de outro peer.
  */
-void UDPServer::processChunkRequestMessage(std::stringstream& message, const PeerInfo& direct_sender_info) {
+Task<void> UDPServer::processChunkRequestMessage(std::istream& message, const PeerInfo& direct_sender_info) {
     std::string file_name;
-    std::vector<int> requested_chunks;
-    int tcp_port, chunk_id;
+    std::vector<ChunkId> requested_chunks;
+    int tcp_port;
+    ChunkId chunk_id;
 
     // Extrai o nome do arquivo e porta TCP
     message >> file_name >> tcp_port;
@@ -391,7 +929,7 @@ void UDPServer::processChunkRequestMessage(std::stringstream& message, const Pee
 
     // Cria uma string com todos os chunks solicitados
     std::string chunks_str;
-    for (const int& chunk : requested_chunks) {
+    for (const ChunkId& chunk : requested_chunks) {
         chunks_str += std::to_string(chunk) + " ";
     }
 
@@ -402,20 +940,1582 @@ void UDPServer::processChunkRequestMessage(std::stringstream& message, const Pee
     PeerInfo direct_sender_info_tcp = PeerInfo(direct_sender_info.ip, tcp_port);
 
     // Envia os chunks via TCP
-    tcp_server.sendChunks(file_name, requested_chunks, direct_sender_info_tcp);
+    co_await tcp_server.sendChunks(file_name, requested_chunks, direct_sender_info_tcp);
 }
 
 
 /**
  * @brief  Espera por um tempo determinado pelas respostas e então desativa o processamento de respostas para o arquivo.
  */
-void UDPServer::waitForResponses(const std::string& file_name) {
-    std::this_thread::sleep_for(std::chrono::seconds(Constants::RESPONSE_TIMEOUT_SECONDS)); // Aguarda o tempo de resposta
+Task<void> UDPServer::waitForResponses(std::string file_name) {
+    co_await event_loop.sleep(std::chrono::seconds(Constants::RESPONSE_TIMEOUT_SECONDS)); // Aguarda o tempo de resposta
 
     {
         std::lock_guard<std::mutex> file_lock(processing_mutex);
         processing_active_map[file_name] = false; // Desativa o processamento para o file_name após o timeout
     }
 
+    {
+        // Os walkers ainda em andamento param na próxima consulta à origem
+        std::lock_guard<std::mutex> walk_lock(walk_queries_mutex);
+        std::erase_if(walk_queries, [&](const auto& entry) { return entry.second.file_name == file_name; });
+    }
+
+    {
+        // Uma nova busca local do arquivo não é mais agrupada com esta
+        std::lock_guard<std::mutex> queries_lock(pending_queries_mutex);
+        auto file_it = pending_queries.find(file_name);
+        if (file_it != pending_queries.end()) {
+            for (auto& [key, query] : file_it->second) {
+                if (query.requester == std::make_tuple(ip, port)) {
+                    query.answered = true;
+                }
+            }
+        }
+    }
+
     logMessage(LogType::INFO, "Processamento de mensagens RESPONSE desativado para o arquivo: " + file_name);
 }
+
+
+/**
+ * @brief Responde a uma consulta da DHT (FIND_NODE ou FIND_PROVIDERS) com uma mensagem NODES.
+ */
+void UDPServer::processDHTQueryMessage(std::istream& message, const PeerInfo& direct_sender_info, bool find_providers) {
+    std::uint64_t rpc_id, key;
+    if (!(message >> rpc_id >> key)) {
+        logMessage(LogType::ERROR, "Consulta da DHT mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    // Formato: NODES <consulta> <n_provedores> <ip:porta>... <n_nós> <ip:porta>...
+    std::vector<DHTContact> providers = find_providers ? dht.getProviders(key) : std::vector<DHTContact>();
+    std::vector<DHTContact> nodes = dht.getClosestContacts(key, Constants::DHT_BUCKET_SIZE);
+
+    std::stringstream ss;
+    ss << "NODES " << rpc_id << " " << providers.size();
+    for (const auto& provider : providers) {
+        ss << " " << provider.ip << ":" << provider.port;
+    }
+    ss << " " << nodes.size();
+    for (const auto& node : nodes) {
+        ss << " " << node.ip << ":" << node.port;
+    }
+
+    if (sendUDPMessage(direct_sender_info.ip, direct_sender_info.port, ss.str()) < 0) {
+        perror("Erro ao enviar mensagem UDP NODES");
+    }
+}
+
+
+/**
+ * @brief Entrega uma resposta da DHT (NODES) à busca que a aguarda.
+ */
+void UDPServer::processDHTNodesMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    std::uint64_t rpc_id;
+    std::size_t count;
+    DHTReply reply;
+
+    // Lê uma lista "<n> <ip:porta>..." de contatos
+    auto read_contacts = [&](std::vector<DHTContact>& contacts) {
+        if (!(message >> count)) {
+            return false;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            std::string address, contact_ip;
+            int contact_port;
+            if (!(message >> address) || !parseAddress(address, contact_ip, contact_port)) {
+                return false;
+            }
+            contacts.push_back(DHTContact{DHTNode::nodeIdFor(contact_ip, contact_port), contact_ip, contact_port, {}});
+        }
+        return true;
+    };
+
+    if (!(message >> rpc_id) || !read_contacts(reply.providers) || !read_contacts(reply.nodes)) {
+        logMessage(LogType::ERROR, "Resposta da DHT mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    dht.completeRpc(rpc_id, std::move(reply));
+}
+
+
+/**
+ * @brief Guarda o registro de provedor publicado por outro peer (ADD_PROVIDER).
+ */
+void UDPServer::processDHTAddProviderMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    std::uint64_t key;
+    std::string file_name;
+    if (!(message >> key >> file_name)) {
+        logMessage(LogType::ERROR, "Registro de provedor mal formado recebido de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    dht.addProvider(key, direct_sender_info.ip, direct_sender_info.port);
+}
+
+
+/**
+ * @brief Busca iterativa na DHT pelos nós mais próximos de uma chave (e, opcionalmente, pelos seus provedores).
+ */
+Task<DHTReply> UDPServer::lookup(std::uint64_t key, bool find_providers, std::string description) {
+    auto start_time = std::chrono::steady_clock::now();
+    auto distance_less = [key](const DHTContact& a, const DHTContact& b) { return (a.id ^ key) < (b.id ^ key); };
+
+    DHTReply result;
+    std::vector<DHTContact> shortlist = dht.getClosestContacts(key, Constants::DHT_BUCKET_SIZE);
+    std::set<std::uint64_t> queried;
+    std::set<std::uint64_t> provider_ids;
+    std::size_t messages_sent = 0;
+    int rounds = 0;
+
+    // Registros guardados no próprio peer (o próprio peer como provedor não conta)
+    provider_ids.insert(dht.getSelfId());
+    if (find_providers) {
+        for (auto& provider : dht.getProviders(key)) {
+            if (provider_ids.insert(provider.id).second) {
+                result.providers.push_back(std::move(provider));
+            }
+        }
+    }
+
+    // A busca de provedores também vai até os k mais próximos: cada publicador guarda o seu registro nos nós que
+    // ele conhece, então um único nó raramente tem todos os provedores do arquivo
+    while (rounds < Constants::DHT_MAX_LOOKUP_ROUNDS && !event_loop.isStopping()) {
+        // Contatos mais próximos ainda não consultados
+        std::vector<DHTContact> to_query;
+        for (const auto& contact : shortlist) {
+            if (to_query.size() >= Constants::DHT_LOOKUP_PARALLELISM) {
+                break;
+            }
+            if (queried.count(contact.id) == 0) {
+                to_query.push_back(contact);
+            }
+        }
+        if (to_query.empty()) {
+            break;
+        }
+        rounds++;
+
+        // Envia as consultas da rodada em paralelo
+        auto round = std::make_shared<DHTLookupRound>();
+        std::vector<std::uint64_t> rpc_ids;
+        for (const auto& contact : to_query) {
+            queried.insert(contact.id);
+            std::uint64_t rpc_id = dht.registerRpc(round);
+            rpc_ids.push_back(rpc_id);
+
+            std::string query = std::string(find_providers ? "FIND_PROVIDERS " : "FIND_NODE ") + std::to_string(rpc_id) + " " + std::to_string(key);
+            if (sendUDPMessage(contact.ip, contact.port, query) >= 0) {
+                messages_sent++;
+            }
+        }
+
+        // Espera as respostas (o token é cancelado quando a última chega)
+        co_await event_loop.sleep(std::chrono::milliseconds(Constants::DHT_RPC_TIMEOUT_MS), round->all_replied);
+
+        // Depois de liberar as consultas nenhuma resposta é mais adicionada à rodada
+        dht.releaseRpcs(rpc_ids);
+
+        for (const auto& reply : round->replies) {
+            for (const auto& provider : reply.providers) {
+                if (provider_ids.insert(provider.id).second) {
+                    result.providers.push_back(provider);
+                }
+            }
+            for (const auto& node : reply.nodes) {
+                bool known = std::any_of(shortlist.begin(), shortlist.end(), [&](const DHTContact& contact) { return contact.id == node.id; });
+                if (!known && node.id != dht.getSelfId()) {
+                    shortlist.push_back(node);
+                }
+            }
+        }
+
+        // Mantém apenas os k contatos mais próximos
+        std::sort(shortlist.begin(), shortlist.end(), distance_less);
+        if (shortlist.size() > Constants::DHT_BUCKET_SIZE) {
+            shortlist.resize(Constants::DHT_BUCKET_SIZE);
+        }
+    }
+
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    logMessage(LogType::INFO, "Busca na DHT (" + description + "): " + std::to_string(result.providers.size()) + " provedor(es), " +
+               std::to_string(rounds) + " rodada(s), " + std::to_string(messages_sent) + " mensagem(ns), " + std::to_string(elapsed_ms) + " ms.");
+
+    result.nodes = std::move(shortlist);
+    co_return result;
+}
+
+
+/**
+ * @brief Publica este peer como provedor de um arquivo nos nós mais próximos da chave do arquivo.
+ */
+Task<void> UDPServer::publishProvider(std::string file_name) {
+    std::uint64_t key = DHTNode::keyFor(file_name);
+    DHTReply closest = co_await lookup(key, false, "publicação de " + file_name);
+
+    // O próprio peer também guarda o registro (ele pode estar entre os mais próximos da chave)
+    dht.addProvider(key, ip, port);
+
+    std::string message = "ADD_PROVIDER " + std::to_string(key) + " " + file_name;
+    for (const auto& node : closest.nodes) {
+        if (sendUDPMessage(node.ip, node.port, message) < 0) {
+            perror("Erro ao enviar mensagem UDP ADD_PROVIDER");
+        }
+    }
+}
+
+
+/**
+ * @brief Publica periodicamente na DHT os arquivos dos quais o peer possui chunks.
+ */
+Task<void> UDPServer::runDHTPublisher() {
+    const auto check_interval = std::chrono::seconds(Constants::DHT_PUBLISH_CHECK_INTERVAL_SECONDS);
+    const auto republish_interval = std::chrono::seconds(Constants::DHT_REPUBLISH_INTERVAL_SECONDS);
+    const auto refresh_interval = std::chrono::seconds(Constants::DHT_REFRESH_INTERVAL_SECONDS);
+    std::map<std::string, std::chrono::steady_clock::time_point> published_at;
+    std::optional<std::chrono::steady_clock::time_point> refreshed_at;
+
+    while (!event_loop.isStopping()) {
+        bool completed = co_await event_loop.sleep(check_interval);
+        if (!completed) {
+            break;
+        }
+
+        // Busca o próprio identificador: os nós mais próximos dele passam a conhecer este peer e
+        // este peer passa a conhecê-los. Sem isso, os nós próximos de uma chave não se conhecem
+        // e as buscas param antes de chegar a eles
+        auto now = std::chrono::steady_clock::now();
+        if (!refreshed_at || now - *refreshed_at >= refresh_interval) {
+            co_await lookup(dht.getSelfId(), false, refreshed_at ? "atualização da tabela de roteamento" : "entrada na DHT");
+            refreshed_at = now;
+        }
+
+        for (const auto& file_name : file_manager.getLocalFileNames()) {
+            auto it = published_at.find(file_name);
+            if (it == published_at.end() || now - it->second >= republish_interval) {
+                published_at[file_name] = now;
+                co_await publishProvider(file_name);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Busca na DHT os peers que possuem chunks de um arquivo.
+ */
+Task<std::vector<PeerInfo>> UDPServer::findProviders(std::string file_name) {
+    DHTReply reply = co_await lookup(DHTNode::keyFor(file_name), true, "provedores de " + file_name);
+
+    std::vector<PeerInfo> providers;
+    for (const auto& provider : reply.providers) {
+        providers.emplace_back(provider.ip, provider.port);
+    }
+    co_return providers;
+}
+
+
+/**
+ * @brief Envia uma mensagem DISCOVERY com TTL 0 diretamente a um peer.
+ */
+void UDPServer::sendDirectDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, const PeerInfo& target, const ChunkRange& range) {
+    std::string message = buildChunkDiscoveryMessage(file_name, total_chunks, 0, PeerInfo(ip, port), range);
+
+    if (sendUDPMessage(target.ip, target.port, message) < 0) {
+        perror("Erro ao enviar mensagem UDP");
+    } else {
+        logMessage(LogType::DISCOVERY_SENT, "Mensagem de descoberta enviada ao provedor " + target.ip + ":" + std::to_string(target.port) + " -> " + message);
+    }
+}
+
+
+/**
+ * @brief Monta o filtro de Bloom atenuado enviado a um vizinho.
+ */
+AttenuatedBloomFilter UDPServer::buildFilterFor(const std::tuple<std::string, int>& neighbor) {
+    AttenuatedBloomFilter filter;
+    for (const auto& file_name : file_manager.getLocalFileNames()) {
+        filter.add(0, DHTNode::keyFor(file_name));
+    }
+
+    auto oldest_valid = std::chrono::steady_clock::now() - std::chrono::seconds(Constants::BLOOM_FILTER_TTL_SECONDS);
+    std::lock_guard<std::mutex> filters_lock(neighbor_filters_mutex);
+    for (const auto& [other_neighbor, neighbor_filter] : neighbor_filters) {
+        if (other_neighbor != neighbor && neighbor_filter.received_at >= oldest_valid) {
+            filter.mergeShifted(neighbor_filter.filter);
+        }
+    }
+    return filter;
+}
+
+
+/**
+ * @brief Envia periodicamente a cada vizinho o filtro de Bloom atenuado montado para ele.
+ */
+Task<void> UDPServer::runBloomExchange() {
+    // Sem o roteamento pelos filtros, ninguém usa os filtros recebidos
+    if (!Constants::BLOOM_ROUTING_ENABLED) {
+        co_return;
+    }
+
+    const auto interval = std::chrono::seconds(Constants::BLOOM_EXCHANGE_INTERVAL_SECONDS);
+    while (!event_loop.isStopping()) {
+        for (const auto& neighbor : getUDPNeighbors()) {
+            std::string message = "BLOOM " + buildFilterFor(neighbor).serialize();
+            if (sendUDPMessage(std::get<0>(neighbor), std::get<1>(neighbor), message) < 0) {
+                perror("Erro ao enviar mensagem UDP BLOOM");
+            }
+        }
+
+        bool completed = co_await event_loop.sleep(interval);
+        if (!completed) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Envia periodicamente sondas de RTT (PING) aos vizinhos e aos peers que possuem chunks.
+ */
+Task<void> UDPServer::runQualityProber() {
+    const auto interval = std::chrono::seconds(Constants::PEER_QUALITY_PROBE_INTERVAL_SECONDS);
+    while (!event_loop.isStopping()) {
+        for (const auto& neighbor : getUDPNeighbors()) {
+            peer_quality.addPeer(neighbor);
+        }
+        for (const auto& [peer, nonce] : peer_quality.startProbeRound()) {
+            sendProbe(peer, nonce);
+        }
+
+        bool completed = co_await event_loop.sleep(interval);
+        if (!completed) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Envia uma sonda de RTT (PING) a um peer cadastrado na tabela de qualidade.
+ */
+void UDPServer::sendProbe(const std::tuple<std::string, int>& peer, std::uint64_t nonce) {
+    if (nonce == 0) {
+        return;
+    }
+    if (sendUDPMessage(std::get<0>(peer), std::get<1>(peer), "PING " + std::to_string(nonce)) < 0) {
+        perror("Erro ao enviar mensagem UDP PING");
+    }
+}
+
+
+/**
+ * @brief Cadastra na tabela de qualidade um peer que possui chunks e, se for novo, já o sonda.
+ */
+void UDPServer::trackHolder(const std::string& holder_ip, int holder_port) {
+    auto holder = std::make_tuple(holder_ip, holder_port);
+    if (peer_quality.addPeer(holder)) {
+        sendProbe(holder, peer_quality.startProbe(holder));
+    }
+}
+
+
+/**
+ * @brief Processa uma sonda de RTT (PING), respondendo com PONG, ou a resposta a uma sonda deste peer (PONG).
+ */
+void UDPServer::processProbeMessage(std::istream& message, const PeerInfo& direct_sender_info, bool pong) {
+    std::uint64_t nonce = 0;
+    if (!(message >> nonce)) {
+        logMessage(LogType::ERROR, "Sonda de RTT mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    if (!pong) {
+        if (sendUDPMessage(direct_sender_info.ip, direct_sender_info.port, "PONG " + std::to_string(nonce)) < 0) {
+            perror("Erro ao enviar mensagem UDP PONG");
+        }
+        return;
+    }
+
+    peer_quality.recordPong(std::make_tuple(direct_sender_info.ip, direct_sender_info.port), nonce);
+}
+
+
+/**
+ * @brief Mantém a vizinhança em execução: troca listas de vizinhos (PEX) e adiciona ou descarta vizinhos.
+ */
+Task<void> UDPServer::runOverlayMaintenance() {
+    if (!Constants::OVERLAY_MAINTENANCE_ENABLED) {
+        co_return;
+    }
+
+    const auto interval = std::chrono::seconds(Constants::OVERLAY_MAINTENANCE_INTERVAL_SECONDS);
+    while (!event_loop.isStopping()) {
+        // Cada vizinho recebe a lista dos demais
+        std::vector<std::tuple<std::string, int>> neighbors = getUDPNeighbors();
+        for (const auto& neighbor : neighbors) {
+            std::string message = "PEX";
+            std::size_t announced = 0;
+            for (const auto& [other_ip, other_port] : neighbors) {
+                if (announced == Constants::OVERLAY_PEX_MAX_PEERS) {
+                    break;
+                }
+                if (std::make_tuple(other_ip, other_port) != neighbor) {
+                    message += " " + other_ip + ":" + std::to_string(other_port);
+                    announced++;
+                }
+            }
+            if (sendUDPMessage(std::get<0>(neighbor), std::get<1>(neighbor), message) < 0) {
+                perror("Erro ao enviar mensagem UDP PEX");
+            }
+        }
+
+        maintainOverlay();
+
+        bool completed = co_await event_loop.sleep(interval);
+        if (!completed) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Executa uma rodada de manutenção da vizinhança.
+ */
+void UDPServer::maintainOverlay() {
+    // Vizinhos que deixaram de responder às sondas de RTT
+    for (const auto& neighbor : getUDPNeighbors()) {
+        if (peer_quality.getLostProbes(neighbor) >= Constants::OVERLAY_DEAD_NEIGHBOR_PROBES && removeUDPNeighbor(neighbor)) {
+            sendUDPMessage(std::get<0>(neighbor), std::get<1>(neighbor), "NEIGHBOR_DROP");
+            logMessage(LogType::INFO, "Vizinho " + std::get<0>(neighbor) + ":" + std::to_string(std::get<1>(neighbor)) + " descartado: não responde às sondas.");
+        }
+    }
+
+    // Candidatos válidos, que passam a ser sondados
+    auto now = std::chrono::steady_clock::now();
+    auto oldest_valid = now - std::chrono::seconds(Constants::OVERLAY_CANDIDATE_TTL_SECONDS);
+    std::vector<std::tuple<std::string, int>> candidates;
+    std::vector<std::tuple<std::string, int>> neighbors;
+    std::vector<std::tuple<std::string, int>> dynamic_neighbors;
+    {
+        std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+        std::erase_if(neighbor_candidates, [&](const auto& item) {
+            return item.second < oldest_valid || std::find(udpNeighbors.begin(), udpNeighbors.end(), item.first) != udpNeighbors.end();
+        });
+        for (const auto& [candidate, announced_at] : neighbor_candidates) {
+            candidates.push_back(candidate);
+        }
+        neighbors = udpNeighbors;
+        for (const auto& neighbor : udpNeighbors) {
+            if (configured_neighbors.count(neighbor) == 0) {
+                dynamic_neighbors.push_back(neighbor);
+            }
+        }
+    }
+    for (const auto& candidate : candidates) {
+        peer_quality.addPeer(candidate);
+    }
+    candidates = peer_quality.rankByLatency(std::move(candidates));
+    std::erase_if(candidates, [&](const auto& candidate) { return peer_quality.getLostProbes(candidate) >= Constants::PEER_QUALITY_MAX_LOST_PROBES; });
+    if (candidates.empty()) {
+        return;
+    }
+
+    // Abaixo do grau alvo: pede vínculo aos candidatos de menor RTT
+    if (neighbors.size() < Constants::OVERLAY_TARGET_DEGREE) {
+        std::size_t missing = Constants::OVERLAY_TARGET_DEGREE - neighbors.size();
+        for (std::size_t i = 0; i < missing && i < candidates.size(); ++i) {
+            sendUDPMessage(std::get<0>(candidates[i]), std::get<1>(candidates[i]), "NEIGHBOR_ADD");
+        }
+        return;
+    }
+
+    // No grau alvo: troca o vizinho adicionado em execução mais lento por um candidato bem mais rápido
+    double best_rtt = peer_quality.getRttMs(candidates.front());
+    if (best_rtt == 0 || dynamic_neighbors.empty()) {
+        return;
+    }
+    auto slowest = std::max_element(dynamic_neighbors.begin(), dynamic_neighbors.end(), [&](const auto& a, const auto& b) {
+        return peer_quality.getRttMs(a) < peer_quality.getRttMs(b);
+    });
+    double slowest_rtt = peer_quality.getRttMs(*slowest);
+    if (best_rtt < slowest_rtt * Constants::OVERLAY_REPLACE_RTT_RATIO && slowest_rtt - best_rtt >= Constants::OVERLAY_REPLACE_MIN_GAIN_MS) {
+        {
+            std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+            pending_replacements[candidates.front()] = *slowest;
+        }
+        sendUDPMessage(std::get<0>(candidates.front()), std::get<1>(candidates.front()), "NEIGHBOR_ADD");
+    }
+}
+
+
+/**
+ * @brief Adiciona um vizinho, se ainda houver espaço (Constants::OVERLAY_MAX_DEGREE).
+ */
+bool UDPServer::addUDPNeighbor(const std::tuple<std::string, int>& neighbor, bool configured) {
+    if (neighbor == std::make_tuple(ip, port)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+        if (configured) {
+            configured_neighbors.insert(neighbor);
+        }
+        if ((!configured && udpNeighbors.size() >= Constants::OVERLAY_MAX_DEGREE) ||
+            std::find(udpNeighbors.begin(), udpNeighbors.end(), neighbor) != udpNeighbors.end()) {
+            return false;
+        }
+        udpNeighbors.push_back(neighbor);
+        neighbor_candidates.erase(neighbor);
+    }
+
+    dht.addContact(std::get<0>(neighbor), std::get<1>(neighbor));
+    peer_quality.addPeer(neighbor);
+    logMessage(LogType::INFO, "Vizinho " + std::get<0>(neighbor) + ":" + std::to_string(std::get<1>(neighbor)) + " adicionado.");
+    return true;
+}
+
+
+/**
+ * @brief Remove um vizinho e o filtro de Bloom recebido dele.
+ */
+bool UDPServer::removeUDPNeighbor(const std::tuple<std::string, int>& neighbor) {
+    {
+        std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+        auto it = std::find(udpNeighbors.begin(), udpNeighbors.end(), neighbor);
+        if (it == udpNeighbors.end()) {
+            return false;
+        }
+        udpNeighbors.erase(it);
+        configured_neighbors.erase(neighbor);
+    }
+
+    std::lock_guard<std::mutex> filters_lock(neighbor_filters_mutex);
+    neighbor_filters.erase(neighbor);
+    return true;
+}
+
+
+/**
+ * @brief Guarda os candidatos a vizinho anunciados por um vizinho (PEX).
+ */
+void UDPServer::processPexMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    std::tuple<std::string, int> sender(direct_sender_info.ip, direct_sender_info.port);
+
+    // O remetente considera este peer seu vizinho: aceita o vínculo ou o desfaz
+    if (!isUDPNeighbor(sender) && !addUDPNeighbor(sender)) {
+        sendUDPMessage(direct_sender_info.ip, direct_sender_info.port, "NEIGHBOR_DROP");
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::string address;
+    std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+    while (message >> address) {
+        std::size_t separator = address.rfind(':');
+        int candidate_port = 0;
+        if (separator == std::string::npos ||
+            std::from_chars(address.data() + separator + 1, address.data() + address.size(), candidate_port).ec != std::errc()) {
+            continue;
+        }
+
+        std::tuple<std::string, int> candidate(address.substr(0, separator), candidate_port);
+        if (candidate == std::make_tuple(ip, port) || std::find(udpNeighbors.begin(), udpNeighbors.end(), candidate) != udpNeighbors.end()) {
+            continue;
+        }
+        auto it = neighbor_candidates.find(candidate);
+        if (it != neighbor_candidates.end()) {
+            it->second = now;
+        } else if (neighbor_candidates.size() < Constants::OVERLAY_MAX_CANDIDATES) {
+            neighbor_candidates.emplace(candidate, now);
+        }
+    }
+}
+
+
+/**
+ * @brief Processa um pedido de vínculo (NEIGHBOR_ADD), a sua aceitação (NEIGHBOR_ACCEPT) ou o fim de um vínculo (NEIGHBOR_DROP).
+ */
+void UDPServer::processNeighborMessage(const std::string& command, const PeerInfo& direct_sender_info) {
+    std::tuple<std::string, int> sender(direct_sender_info.ip, direct_sender_info.port);
+
+    if (command == "NEIGHBOR_ADD") {
+        if (addUDPNeighbor(sender) || isUDPNeighbor(sender)) {
+            sendUDPMessage(direct_sender_info.ip, direct_sender_info.port, "NEIGHBOR_ACCEPT");
+        }
+    } else if (command == "NEIGHBOR_ACCEPT") {
+        std::optional<std::tuple<std::string, int>> replaced;
+        {
+            std::lock_guard<std::mutex> neighbors_lock(neighbors_mutex);
+            auto it = pending_replacements.find(sender);
+            if (it != pending_replacements.end()) {
+                replaced = it->second;
+                pending_replacements.erase(it);
+            }
+        }
+
+        // Na troca, o vizinho mais lento dá lugar ao novo
+        if (replaced && removeUDPNeighbor(*replaced)) {
+            sendUDPMessage(std::get<0>(*replaced), std::get<1>(*replaced), "NEIGHBOR_DROP");
+            logMessage(LogType::INFO, "Vizinho " + std::get<0>(*replaced) + ":" + std::to_string(std::get<1>(*replaced)) + " substituído por " +
+                       direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) + ", de menor RTT.");
+        }
+        if (!addUDPNeighbor(sender) && !isUDPNeighbor(sender)) {
+            sendUDPMessage(direct_sender_info.ip, direct_sender_info.port, "NEIGHBOR_DROP");
+        }
+    } else if (removeUDPNeighbor(sender)) {
+        logMessage(LogType::INFO, "Vizinho " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) + " encerrou o vínculo.");
+    }
+}
+
+
+/**
+ * @brief Guarda o filtro de Bloom atenuado recebido de um vizinho (BLOOM).
+ */
+void UDPServer::processBloomMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    std::tuple<std::string, int> sender(direct_sender_info.ip, direct_sender_info.port);
+    if (!isUDPNeighbor(sender)) {
+        return; // Só vizinhos diretos trocam filtros
+    }
+
+    std::string filter_text;
+    std::getline(message, filter_text);
+
+    AttenuatedBloomFilter filter;
+    if (!AttenuatedBloomFilter::deserialize(filter_text, filter)) {
+        logMessage(LogType::ERROR, "Filtro de Bloom mal formado recebido de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    std::lock_guard<std::mutex> filters_lock(neighbor_filters_mutex);
+    neighbor_filters[sender] = NeighborFilter{std::move(filter), std::chrono::steady_clock::now()};
+}
+
+
+/**
+ * @brief Seleciona os vizinhos que devem receber uma mensagem DISCOVERY.
+ */
+std::vector<std::tuple<std::string, int>> UDPServer::selectDiscoveryNeighbors(const std::string& file_name, int ttl) {
+    std::vector<std::tuple<std::string, int>> neighbors = getUDPNeighbors();
+    if (!Constants::BLOOM_ROUTING_ENABLED) {
+        return peer_quality.rankByLatency(std::move(neighbors));
+    }
+
+    std::uint64_t key = DHTNode::keyFor(file_name);
+    auto oldest_valid = std::chrono::steady_clock::now() - std::chrono::seconds(Constants::BLOOM_FILTER_TTL_SECONDS);
+    std::vector<std::tuple<std::string, int>> matching;     // Filtro indica o arquivo a até ttl saltos
+    std::vector<std::tuple<std::string, int>> unfiltered;   // Sem filtro válido (ainda não recebido ou expirado)
+    std::vector<std::tuple<std::string, int>> pruned;       // Filtro não indica o arquivo
+    {
+        std::lock_guard<std::mutex> filters_lock(neighbor_filters_mutex);
+        for (const auto& neighbor : neighbors) {
+            auto it = neighbor_filters.find(neighbor);
+            if (it == neighbor_filters.end() || it->second.received_at < oldest_valid) {
+                unfiltered.push_back(neighbor);
+            } else if (it->second.filter.mayContainWithin(key, ttl)) {
+                matching.push_back(neighbor);
+            } else {
+                pruned.push_back(neighbor);
+            }
+        }
+    }
+
+    // O vizinho alcança ttl saltos além dele e o filtro resume apenas os níveis 0 a BLOOM_FILTER_DEPTH - 1:
+    // além do horizonte o filtro não descarta ninguém, apenas coloca os vizinhos que o indicam à frente
+    if (ttl >= Constants::BLOOM_FILTER_DEPTH) {
+        std::vector<std::tuple<std::string, int>> ranked = peer_quality.rankByLatency(std::move(matching));
+        std::vector<std::tuple<std::string, int>> ranked_unfiltered = peer_quality.rankByLatency(std::move(unfiltered));
+        std::vector<std::tuple<std::string, int>> ranked_pruned = peer_quality.rankByLatency(std::move(pruned));
+        ranked.insert(ranked.end(), ranked_unfiltered.begin(), ranked_unfiltered.end());
+        ranked.insert(ranked.end(), ranked_pruned.begin(), ranked_pruned.end());
+        return ranked;
+    }
+
+    // Dentro do horizonte, os vizinhos cujo filtro não indica o arquivo são descartados
+    std::vector<std::tuple<std::string, int>> selected = std::move(matching);
+    selected.insert(selected.end(), unfiltered.begin(), unfiltered.end());
+    if (selected.size() < neighbors.size()) {
+        logMessage(LogType::INFO, "Filtros de Bloom: DISCOVERY de " + file_name + " encaminhada a " + std::to_string(selected.size()) +
+                   " de " + std::to_string(neighbors.size()) + " vizinhos.");
+    }
+    return peer_quality.rankByLatency(std::move(selected));
+}
+
+
+/**
+ * @brief Inicia uma busca por passeios aleatórios: Constants::WALK_WALKERS walkers partem para vizinhos aleatórios.
+ */
+void UDPServer::startRandomWalk(const std::string& file_name, ChunkId total_chunks, const ChunkRange& range) {
+    static thread_local std::mt19937_64 generator(std::random_device{}());
+    std::uint64_t query_id = generator();
+    {
+        std::lock_guard<std::mutex> walk_lock(walk_queries_mutex);
+        walk_queries[query_id] = RandomWalkQuery{file_name, range};
+    }
+
+    logMessage(LogType::INFO, "Busca por passeios aleatórios de " + file_name + " iniciada com " + std::to_string(Constants::WALK_WALKERS) + " walkers.");
+
+    std::string message = buildWalkMessage("WALK", query_id, 0, file_name, total_chunks, PeerInfo(ip, port), range);
+    for (int walker = 0; walker < Constants::WALK_WALKERS; ++walker) {
+        forwardWalk(message, PeerInfo(ip, port));
+    }
+}
+
+
+/**
+ * @brief Monta uma mensagem de passeio aleatório (WALK, WALK_CHECK ou WALK_CONTINUE).
+ */
+std::string UDPServer::buildWalkMessage(const std::string& command, std::uint64_t query_id, int hops, const std::string& file_name, ChunkId total_chunks,
+                                        const PeerInfo& chunk_requester_info, const ChunkRange& range) const {
+    std::stringstream ss;
+    ss << command << " " << query_id << " " << hops << " " << file_name << " " << total_chunks << " "
+       << chunk_requester_info.ip << ":" << chunk_requester_info.port << " " << range.first << " " << range.end;
+    return ss.str();
+}
+
+
+/**
+ * @brief Envia um walker (WALK) a um vizinho escolhido aleatoriamente.
+ */
+void UDPServer::forwardWalk(const std::string& message, const PeerInfo& previous_hop) {
+    std::vector<std::tuple<std::string, int>> neighbors = getUDPNeighbors();
+    std::vector<std::tuple<std::string, int>> candidates;
+    for (const auto& neighbor : neighbors) {
+        if (std::get<0>(neighbor) != previous_hop.ip || std::get<1>(neighbor) != previous_hop.port) {
+            candidates.push_back(neighbor);
+        }
+    }
+    if (candidates.empty()) {
+        candidates = neighbors; // Folha da topologia: o walker volta por onde veio
+    }
+    if (candidates.empty()) {
+        return;
+    }
+
+    static thread_local std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<std::size_t> distribution(0, candidates.size() - 1);
+    const auto& [neighbor_ip, neighbor_port] = candidates[distribution(generator)];
+
+    if (sendUDPMessage(neighbor_ip, neighbor_port, message) < 0) {
+        perror("Erro ao enviar mensagem UDP WALK");
+    } else {
+        logMessage(LogType::DISCOVERY_SENT, "Walker enviado para Peer " + neighbor_ip + ":" + std::to_string(neighbor_port) + " -> " + message);
+    }
+}
+
+
+/**
+ * @brief Processa um walker recebido (WALK) ou liberado pela origem para continuar (WALK_CONTINUE).
+ */
+void UDPServer::processWalkMessage(std::istream& message, const PeerInfo& direct_sender_info, bool resumed) {
+    std::uint64_t query_id;
+    int hops;
+    std::string file_name, chunk_requester_ip_port;
+    ChunkId total_chunks;
+    ChunkRange range;
+
+    if (!(message >> query_id >> hops >> file_name >> total_chunks >> chunk_requester_ip_port >> range.first >> range.end)) {
+        logMessage(LogType::ERROR, "Mensagem WALK mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    std::string chunk_requester_ip;
+    int chunk_requester_port;
+    if (!parseAddress(chunk_requester_ip_port, chunk_requester_ip, chunk_requester_port)) {
+        return;
+    }
+    PeerInfo chunk_requester_info(chunk_requester_ip, chunk_requester_port);
+    bool is_origin = chunk_requester_ip == ip && chunk_requester_port == port;
+
+    if (!resumed) {
+        hops++;
+
+        // A origem não responde a si mesma, apenas repassa o walker que voltou a ela
+        if (!is_origin) {
+            logMessage(LogType::DISCOVERY_RECEIVED,
+                       "Recebido walker do arquivo '" + file_name + "' (" + std::to_string(hops) + " saltos) do Peer " +
+                       direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) +
+                       ". Resposta será enviada para o Peer " + chunk_requester_ip_port);
+            sendChunkResponseMessage(file_name, chunk_requester_info, range);
+            registerInterest(file_name, chunk_requester_info, range);
+        }
+
+        if (hops >= Constants::WALK_MAX_HOPS) {
+            logMessage(LogType::OTHER, "Walker da busca " + std::to_string(query_id) + " por " + file_name + " encerrado após " + std::to_string(hops) + " saltos.");
+            return;
+        }
+
+        // Um walker que voltou à origem é encerrado por ela mesma se a busca tiver terminado
+        if (is_origin && !isRandomWalkActive(query_id)) {
+            return;
+        }
+
+        // Pergunta à origem se a busca continua antes de seguir
+        if (hops % Constants::WALK_CHECK_INTERVAL_HOPS == 0 && !is_origin) {
+            std::string check_message = buildWalkMessage("WALK_CHECK", query_id, hops, file_name, total_chunks, chunk_requester_info, range);
+            if (sendUDPMessage(chunk_requester_ip, chunk_requester_port, check_message) < 0) {
+                perror("Erro ao enviar mensagem UDP WALK_CHECK");
+            }
+            return;
+        }
+    }
+
+    forwardWalk(buildWalkMessage("WALK", query_id, hops, file_name, total_chunks, chunk_requester_info, range), direct_sender_info);
+}
+
+
+/**
+ * @brief Verifica se uma busca por passeios aleatórios iniciada por este peer continua.
+ */
+bool UDPServer::isRandomWalkActive(std::uint64_t query_id) {
+    RandomWalkQuery query;
+    {
+        std::lock_guard<std::mutex> walk_lock(walk_queries_mutex);
+        auto it = walk_queries.find(query_id);
+        if (it == walk_queries.end()) {
+            return false;
+        }
+        query = it->second;
+    }
+
+    // Todos os chunks de interesse já têm fonte: os walkers restantes só gerariam mensagens
+    if (file_manager.countUnlocatedChunks(query.file_name, query.range) == 0) {
+        std::lock_guard<std::mutex> walk_lock(walk_queries_mutex);
+        if (walk_queries.erase(query_id) > 0) {
+            logMessage(LogType::INFO, "Busca por passeios aleatórios de " + query.file_name + " concluída: todos os chunks têm fonte conhecida.");
+        }
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Responde à pergunta de um walker (WALK_CHECK) sobre a continuação de uma busca iniciada por este peer.
+ */
+void UDPServer::processWalkCheckMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    std::uint64_t query_id;
+    int hops;
+    std::string file_name, chunk_requester_ip_port;
+    ChunkId total_chunks;
+    ChunkRange range;
+
+    if (!(message >> query_id >> hops >> file_name >> total_chunks >> chunk_requester_ip_port >> range.first >> range.end)) {
+        logMessage(LogType::ERROR, "Mensagem WALK_CHECK mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    if (!isRandomWalkActive(query_id)) {
+        return;
+    }
+
+    std::string continue_message = buildWalkMessage("WALK_CONTINUE", query_id, hops, file_name, total_chunks, PeerInfo(ip, port), range);
+    if (sendUDPMessage(direct_sender_info.ip, direct_sender_info.port, continue_message) < 0) {
+        perror("Erro ao enviar mensagem UDP WALK_CONTINUE");
+    }
+}
+
+
+/**
+ * @brief Define os super-peers da rede e o papel deste peer.
+ */
+void UDPServer::setSuperPeers(const std::vector<std::tuple<std::string, int>>& super_peers) {
+    this->super_peers = super_peers;
+    if (super_peers.empty()) {
+        return;
+    }
+
+    is_super_peer = isSuperPeer(std::make_tuple(ip, port));
+    if (is_super_peer) {
+        logMessage(LogType::INFO, "Peer " + std::to_string(peer_id) + " é super-peer (" + std::to_string(super_peers.size()) + " super-peers na rede).");
+        return;
+    }
+
+    auto neighbor_it = std::find_if(super_peers.begin(), super_peers.end(), [&](const auto& super_peer) {
+        return isUDPNeighbor(super_peer);
+    });
+    home_super_peer = neighbor_it != super_peers.end() ? *neighbor_it : super_peers[dht.getSelfId() % super_peers.size()];
+
+    logMessage(LogType::INFO, "Peer " + std::to_string(peer_id) + " é folha do super-peer " + std::get<0>(home_super_peer) + ":" +
+               std::to_string(std::get<1>(home_super_peer)) + ".");
+}
+
+
+/**
+ * @brief Verifica se um endereço é de um super-peer.
+ */
+bool UDPServer::isSuperPeer(const std::tuple<std::string, int>& address) const {
+    return std::find(super_peers.begin(), super_peers.end(), address) != super_peers.end();
+}
+
+
+/**
+ * @brief Monta as mensagens com sequências de chunks (REGISTER e LOCATION) a partir de um prefixo comum.
+ */
+std::vector<std::string> UDPServer::buildRunMessages(const std::string& prefix, const std::vector<ChunkRange>& runs) const {
+    std::vector<std::string> messages;
+    std::string current = prefix;
+    bool has_runs = false;
+
+    for (const ChunkRange& run : runs) {
+        std::string field = " " + std::to_string(run.first) + " " + std::to_string(run.end);
+        if (has_runs && current.size() + field.size() > static_cast<std::size_t>(Constants::CONTROL_MESSAGE_MAX_SIZE)) {
+            messages.push_back(std::move(current));
+            current = prefix;
+        }
+        current += field;
+        has_runs = true;
+    }
+
+    if (has_runs) {
+        messages.push_back(std::move(current));
+    }
+    return messages;
+}
+
+
+/**
+ * @brief Registra periodicamente os chunks desta folha no seu super-peer (REGISTER).
+ */
+Task<void> UDPServer::runSuperPeerRegistration() {
+    if (super_peers.empty() || is_super_peer) {
+        co_return;
+    }
+
+    const auto& [super_peer_ip, super_peer_port] = home_super_peer;
+    const auto interval = std::chrono::seconds(Constants::SUPER_PEER_REGISTER_INTERVAL_SECONDS);
+    while (!event_loop.isStopping()) {
+        registration_generation++;
+        for (const auto& file_name : file_manager.getLocalFileNames()) {
+            std::string prefix = "REGISTER " + file_name + " " + std::to_string(transfer_speed) + " " + std::to_string(registration_generation);
+            for (const auto& message : buildRunMessages(prefix, toChunkRuns(file_manager.getAvailableChunks(file_name)))) {
+                if (sendUDPMessage(super_peer_ip, super_peer_port, message) < 0) {
+                    perror("Erro ao enviar mensagem UDP REGISTER");
+                }
+            }
+        }
+
+        bool completed = co_await event_loop.sleep(interval);
+        if (!completed) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Guarda no índice do super-peer os chunks registrados por uma folha (REGISTER).
+ */
+void UDPServer::processRegisterMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    if (!is_super_peer) {
+        return;
+    }
+
+    std::string file_name;
+    ByteCount leaf_speed;
+    std::uint64_t generation;
+    if (!(message >> file_name >> leaf_speed >> generation)) {
+        logMessage(LogType::ERROR, "Mensagem REGISTER mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    std::vector<ChunkRange> runs;
+    ChunkRange run;
+    while (message >> run.first >> run.end) {
+        runs.push_back(run);
+    }
+
+    auto expires_at = std::chrono::steady_clock::now() + std::chrono::seconds(Constants::SUPER_PEER_REGISTRATION_TTL_SECONDS);
+    std::tuple<std::string, int> leaf(direct_sender_info.ip, direct_sender_info.port);
+
+    std::lock_guard<std::mutex> index_lock(leaf_index_mutex);
+    auto& file_index = leaf_index[file_name];
+    auto it = file_index.find(leaf);
+    if (it == file_index.end()) {
+        logMessage(LogType::INFO, "Folha " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) + " registrou chunks de " + file_name + ".");
+        file_index.emplace(leaf, LeafRegistration{leaf_speed, std::move(runs), generation, expires_at});
+        return;
+    }
+
+    // Mensagens da mesma rodada completam o registro; uma rodada nova o substitui
+    LeafRegistration& registration = it->second;
+    if (registration.generation != generation) {
+        registration.runs.clear();
+        registration.generation = generation;
+    }
+    registration.runs.insert(registration.runs.end(), runs.begin(), runs.end());
+    registration.transfer_speed = leaf_speed;
+    registration.expires_at = expires_at;
+}
+
+
+/**
+ * @brief Responde a uma busca com os chunks das folhas registradas neste super-peer (LOCATION).
+ */
+void UDPServer::sendIndexedLocations(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range) {
+    std::vector<std::string> messages;
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> index_lock(leaf_index_mutex);
+        auto file_it = leaf_index.find(file_name);
+        if (file_it == leaf_index.end()) {
+            return;
+        }
+
+        std::erase_if(file_it->second, [&](const auto& entry) { return entry.second.expires_at <= now; });
+        for (const auto& [leaf, registration] : file_it->second) {
+            const auto& [leaf_ip, leaf_port] = leaf;
+            if (leaf_ip == chunk_requester_info.ip && leaf_port == chunk_requester_info.port) {
+                continue;
+            }
+
+            for (auto& message : buildLocationMessages("LOCATION", file_name, leaf, registration.transfer_speed, registration.runs, range)) {
+                messages.push_back(std::move(message));
+            }
+        }
+    }
+
+    for (const auto& message : messages) {
+        if (sendUDPMessage(chunk_requester_info.ip, chunk_requester_info.port, message) < 0) {
+            perror("Erro ao enviar mensagem UDP LOCATION");
+        }
+    }
+}
+
+
+/**
+ * @brief Monta as mensagens que informam os chunks de um peer (LOCATION ou CACHE), recortados em um intervalo.
+ */
+std::vector<std::string> UDPServer::buildLocationMessages(const std::string& command, const std::string& file_name, const std::tuple<std::string, int>& holder,
+                                                          ByteCount holder_speed, const std::vector<ChunkRange>& runs, const ChunkRange& range) const {
+    std::string prefix = command + " " + file_name + " " + std::get<0>(holder) + ":" + std::to_string(std::get<1>(holder)) + " " + std::to_string(holder_speed);
+    return buildRunMessages(prefix, clipChunkRuns(runs, range));
+}
+
+
+/**
+ * @brief Processa a localização (LOCATION) de chunks de outro peer, informada por um super-peer.
+ */
+void UDPServer::processLocationMessage(std::istream& message, const PeerInfo& direct_sender_info, bool cache_only) {
+    std::string file_name, holder_address, holder_ip;
+    int holder_port;
+    ByteCount holder_speed;
+
+    if (!(message >> file_name >> holder_address >> holder_speed) || !parseAddress(holder_address, holder_ip, holder_port)) {
+        logMessage(LogType::ERROR, "Mensagem LOCATION mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+    if (holder_ip == ip && holder_port == port) {
+        return;
+    }
+
+    std::vector<ChunkRange> runs;
+    ChunkRange run;
+    while (message >> run.first >> run.end) {
+        if (run.size() > 0) {
+            runs.push_back(run);
+        }
+    }
+
+    if (Constants::RESPONSE_CACHE_ENABLED) {
+        cacheResponse(file_name, std::make_tuple(holder_ip, holder_port), holder_speed, runs);
+    }
+    if (cache_only) {
+        return;
+    }
+
+    // Só adiciona os chunks que o peer não possui
+    std::vector<ChunkId> chunks_received;
+    for (const ChunkRange& received_run : runs) {
+        for (ChunkId chunk = received_run.first; chunk < received_run.end; ++chunk) {
+            if (!file_manager.hasChunk(file_name, chunk)) {
+                chunks_received.push_back(chunk);
+            }
+        }
+    }
+
+    if (chunks_received.empty()) {
+        return;
+    }
+
+    file_manager.storeChunkLocationInfo(file_name, chunks_received, holder_ip, holder_port, holder_speed);
+    trackHolder(holder_ip, holder_port);
+
+    std::stringstream chunks_ss;
+    for (const ChunkId& chunk : chunks_received) {
+        chunks_ss << chunk << " ";
+    }
+    logMessage(LogType::RESPONSE_RECEIVED,
+               "Peer " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) + " informou que o Peer " +
+               holder_address + " possui chunks do arquivo '" + file_name + "': " + chunks_ss.str());
+}
+
+
+/**
+ * @brief Repassa uma busca aos outros super-peers, com TTL 0.
+ */
+void UDPServer::forwardDiscoveryToSuperPeers(const std::string& file_name, ChunkId total_chunks, const PeerInfo& chunk_requester_info, const ChunkRange& range) {
+    std::string message = buildChunkDiscoveryMessage(file_name, total_chunks, 0, chunk_requester_info, range);
+    for (const auto& [super_peer_ip, super_peer_port] : super_peers) {
+        if (super_peer_ip == ip && super_peer_port == port) {
+            continue;
+        }
+        if (sendUDPMessage(super_peer_ip, super_peer_port, message) < 0) {
+            perror("Erro ao enviar mensagem UDP");
+        } else {
+            logMessage(LogType::DISCOVERY_SENT, "Mensagem de descoberta repassada ao super-peer " + super_peer_ip + ":" + std::to_string(super_peer_port) + " -> " + message);
+        }
+    }
+}
+
+
+/**
+ * @brief Inicia uma busca pela camada de super-peers.
+ */
+void UDPServer::sendSuperPeerDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, const ChunkRange& range) {
+    PeerInfo self_info(ip, port);
+
+    if (is_super_peer) {
+        sendIndexedLocations(file_name, self_info, range);
+        forwardDiscoveryToSuperPeers(file_name, total_chunks, self_info, range);
+        return;
+    }
+
+    const auto& [super_peer_ip, super_peer_port] = home_super_peer;
+    sendDirectDiscoveryMessage(file_name, total_chunks, PeerInfo(super_peer_ip, super_peer_port), range);
+}
+
+
+/**
+ * @brief Guarda no cache os chunks de um arquivo que um peer possui, por Constants::RESPONSE_CACHE_TTL_SECONDS.
+ */
+void UDPServer::cacheResponse(const std::string& file_name, const std::tuple<std::string, int>& holder, ByteCount holder_speed, std::vector<ChunkRange> runs) {
+    if (runs.empty()) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> cache_lock(response_cache_mutex);
+
+    // Abre espaço para um arquivo novo descartando o que expira primeiro
+    if (response_cache.find(file_name) == response_cache.end() && response_cache.size() >= Constants::RESPONSE_CACHE_MAX_FILES) {
+        auto latest_expiry = [](const auto& holders) {
+            auto latest = std::chrono::steady_clock::time_point::min();
+            for (const auto& [cached_holder, cached] : holders) {
+                latest = std::max(latest, cached.expires_at);
+            }
+            return latest;
+        };
+        auto oldest = std::min_element(response_cache.begin(), response_cache.end(), [&](const auto& a, const auto& b) {
+            return latest_expiry(a.second) < latest_expiry(b.second);
+        });
+        response_cache.erase(oldest);
+    }
+
+    auto& holders = response_cache[file_name];
+    std::erase_if(holders, [&](const auto& entry) { return entry.second.expires_at <= now; });
+    if (holders.find(holder) == holders.end() && holders.size() >= Constants::RESPONSE_CACHE_MAX_HOLDERS_PER_FILE) {
+        holders.erase(std::min_element(holders.begin(), holders.end(), [](const auto& a, const auto& b) {
+            return a.second.expires_at < b.second.expires_at;
+        }));
+    }
+    holders[holder] = CachedResponse{holder_speed, std::move(runs), now + std::chrono::seconds(Constants::RESPONSE_CACHE_TTL_SECONDS)};
+}
+
+
+/**
+ * @brief Envia ao peer que repassou uma DISCOVERY os chunks que este peer possui (CACHE).
+ */
+void UDPServer::sendCacheHint(const std::string& file_name, ChunkId total_chunks, const PeerInfo& previous_hop) {
+    std::vector<ChunkRange> runs = toChunkRuns(file_manager.getAvailableChunks(file_name));
+    for (const auto& message : buildLocationMessages("CACHE", file_name, std::make_tuple(ip, port), transfer_speed, runs, ChunkRange{0, total_chunks})) {
+        if (sendUDPMessage(previous_hop.ip, previous_hop.port, message) < 0) {
+            perror("Erro ao enviar mensagem UDP CACHE");
+        }
+    }
+}
+
+
+/**
+ * @brief Responde a uma busca com as respostas válidas do cache (LOCATION).
+ */
+bool UDPServer::answerFromResponseCache(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range) {
+    std::vector<std::string> messages;
+    std::vector<ChunkRange> covered_runs;
+    std::vector<std::pair<std::tuple<std::string, int>, HolderSummary>> cached_holders;
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> cache_lock(response_cache_mutex);
+        auto file_it = response_cache.find(file_name);
+        if (file_it == response_cache.end()) {
+            return false;
+        }
+
+        std::erase_if(file_it->second, [&](const auto& entry) { return entry.second.expires_at <= now; });
+        for (const auto& [holder, cached] : file_it->second) {
+            const auto& [holder_ip, holder_port] = holder;
+            if (holder_ip == chunk_requester_info.ip && holder_port == chunk_requester_info.port) {
+                continue;
+            }
+            cached_holders.emplace_back(holder, HolderSummary{cached.transfer_speed, clipChunkRuns(cached.runs, range)});
+            covered_runs.insert(covered_runs.end(), cached.runs.begin(), cached.runs.end());
+        }
+        if (file_it->second.empty()) {
+            response_cache.erase(file_it);
+        }
+    }
+
+    // Pelo caminho inverso, o cache entra no resumo agregado da busca; senão, segue em mensagens LOCATION
+    bool answered = false;
+    for (const auto& [holder, summary] : cached_holders) {
+        if (summary.runs.empty()) {
+            continue;
+        }
+        answered = true;
+        if (Constants::REVERSE_PATH_RESPONSES && addToAggregate(file_name, chunk_requester_info, holder, summary.transfer_speed, summary.runs)) {
+            continue;
+        }
+        for (auto& message : buildLocationMessages("LOCATION", file_name, holder, summary.transfer_speed, summary.runs, range)) {
+            messages.push_back(std::move(message));
+        }
+    }
+
+    if (!answered) {
+        return false;
+    }
+
+    for (const auto& message : messages) {
+        if (sendUDPMessage(chunk_requester_info.ip, chunk_requester_info.port, message) < 0) {
+            perror("Erro ao enviar mensagem UDP LOCATION");
+        }
+    }
+
+    // Verifica se o cache e os chunks locais (já enviados em RESPONSE) cobrem todo o intervalo
+    std::vector<ChunkRange> own_runs = toChunkRuns(file_manager.getAvailableChunks(file_name));
+    covered_runs.insert(covered_runs.end(), own_runs.begin(), own_runs.end());
+
+    for (const ChunkRange& run : mergeChunkRuns(std::move(covered_runs))) {
+        if (run.first <= range.first && run.end >= range.end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Guarda o salto anterior de uma busca, se ela ainda não passou por este peer.
+ */
+void UDPServer::registerReverseRoute(const std::string& file_name, const PeerInfo& chunk_requester_info, const PeerInfo& previous_hop) {
+    auto now = std::chrono::steady_clock::now();
+    auto key = std::make_tuple(file_name, chunk_requester_info.ip, chunk_requester_info.port);
+
+    std::lock_guard<std::mutex> routes_lock(reverse_routes_mutex);
+    auto it = reverse_routes.find(key);
+    if (it != reverse_routes.end() && it->second.expires_at > now) {
+        return;
+    }
+    reverse_routes[key] = ReverseRoute{std::make_tuple(previous_hop.ip, previous_hop.port), {},
+                                       now + std::chrono::seconds(Constants::REVERSE_PATH_ROUTE_TTL_SECONDS)};
+}
+
+
+/**
+ * @brief Acrescenta os chunks de um peer ao resumo agregado de uma busca, enviado depois ao salto anterior.
+ */
+bool UDPServer::addToAggregate(const std::string& file_name, const PeerInfo& chunk_requester_info, const std::tuple<std::string, int>& holder,
+                               ByteCount holder_speed, const std::vector<ChunkRange>& runs) {
+    std::lock_guard<std::mutex> routes_lock(reverse_routes_mutex);
+    auto it = reverse_routes.find(std::make_tuple(file_name, chunk_requester_info.ip, chunk_requester_info.port));
+    if (it == reverse_routes.end()) {
+        return false;
+    }
+    if (runs.empty()) {
+        return true;
+    }
+
+    HolderSummary& summary = it->second.pending[holder];
+    summary.transfer_speed = holder_speed;
+    summary.runs.insert(summary.runs.end(), runs.begin(), runs.end());
+    summary.runs = mergeChunkRuns(std::move(summary.runs));
+    return true;
+}
+
+
+/**
+ * @brief Monta as mensagens AGGREGATE com os resumos de uma busca.
+ */
+std::vector<std::string> UDPServer::buildAggregateMessages(const std::string& file_name, const std::tuple<std::string, int>& chunk_requester,
+                                                           const std::map<std::tuple<std::string, int>, HolderSummary>& summaries) const {
+    const std::size_t max_size = static_cast<std::size_t>(Constants::CONTROL_MESSAGE_MAX_SIZE);
+    const std::size_t count_field_size = 21; // " <n>", com n de até 20 dígitos
+    const std::string prefix = "AGGREGATE " + file_name + " " + std::get<0>(chunk_requester) + ":" + std::to_string(std::get<1>(chunk_requester));
+
+    std::vector<std::string> messages;
+    std::string current = prefix;
+    auto append_segment = [&](const std::string& segment) {
+        if (current.size() > prefix.size() && current.size() + segment.size() > max_size) {
+            messages.push_back(std::move(current));
+            current = prefix;
+        }
+        current += segment;
+    };
+
+    for (const auto& [holder, summary] : summaries) {
+        const std::string holder_fields = " " + std::get<0>(holder) + ":" + std::to_string(std::get<1>(holder)) + " " + std::to_string(summary.transfer_speed);
+
+        // Um peer com muitas sequências é dividido em vários trechos, cada um com o próprio cabeçalho
+        std::string runs_text;
+        std::size_t run_count = 0;
+        for (const ChunkRange& run : summary.runs) {
+            std::string run_text = " " + std::to_string(run.first) + " " + std::to_string(run.end);
+            if (run_count > 0 && prefix.size() + holder_fields.size() + count_field_size + runs_text.size() + run_text.size() > max_size) {
+                append_segment(holder_fields + " " + std::to_string(run_count) + runs_text);
+                runs_text.clear();
+                run_count = 0;
+            }
+            runs_text += run_text;
+            run_count++;
+        }
+        if (run_count > 0) {
+            append_segment(holder_fields + " " + std::to_string(run_count) + runs_text);
+        }
+    }
+
+    if (current.size() > prefix.size()) {
+        messages.push_back(std::move(current));
+    }
+    return messages;
+}
+
+
+/**
+ * @brief Envia periodicamente ao salto anterior de cada busca o resumo agregado das respostas novas.
+ */
+Task<void> UDPServer::runAggregateFlusher() {
+    if (!Constants::REVERSE_PATH_RESPONSES) {
+        co_return;
+    }
+
+    const auto interval = std::chrono::milliseconds(Constants::REVERSE_PATH_FLUSH_INTERVAL_MS);
+    while (!event_loop.isStopping()) {
+        std::vector<std::pair<std::tuple<std::string, int>, std::string>> outgoing;
+        {
+            auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> routes_lock(reverse_routes_mutex);
+            for (auto it = reverse_routes.begin(); it != reverse_routes.end();) {
+                auto& [key, route] = *it;
+                if (!route.pending.empty()) {
+                    const auto& [file_name, requester_ip, requester_port] = key;
+                    for (auto& message : buildAggregateMessages(file_name, std::make_tuple(requester_ip, requester_port), route.pending)) {
+                        outgoing.emplace_back(route.previous_hop, std::move(message));
+                    }
+                    route.pending.clear();
+                }
+                it = route.expires_at <= now ? reverse_routes.erase(it) : std::next(it);
+            }
+        }
+
+        for (const auto& [previous_hop, message] : outgoing) {
+            if (sendUDPMessage(std::get<0>(previous_hop), std::get<1>(previous_hop), message) < 0) {
+                perror("Erro ao enviar mensagem UDP AGGREGATE");
+            } else {
+                logMessage(LogType::RESPONSE_SENT, "Resumo agregado enviado para Peer " + std::get<0>(previous_hop) + ":" +
+                           std::to_string(std::get<1>(previous_hop)) + " -> " + message);
+            }
+        }
+
+        bool completed = co_await event_loop.sleep(interval);
+        if (!completed) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Processa um resumo agregado de respostas (AGGREGATE).
+ */
+void UDPServer::processAggregateMessage(std::istream& message, const PeerInfo& direct_sender_info) {
+    std::string file_name, requester_address, requester_ip;
+    int requester_port;
+    if (!(message >> file_name >> requester_address) || !parseAddress(requester_address, requester_ip, requester_port)) {
+        logMessage(LogType::ERROR, "Mensagem AGGREGATE mal formada recebida de " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port));
+        return;
+    }
+
+    // Lê os resumos: "<peer> <velocidade> <n> <first end>*n"
+    std::vector<std::pair<std::tuple<std::string, int>, HolderSummary>> summaries;
+    std::string holder_address, holder_ip;
+    int holder_port;
+    ByteCount holder_speed;
+    std::size_t run_count;
+    while (message >> holder_address >> holder_speed >> run_count) {
+        HolderSummary summary{holder_speed, {}};
+        ChunkRange run;
+        for (std::size_t i = 0; i < run_count && message >> run.first >> run.end; ++i) {
+            summary.runs.push_back(run);
+        }
+        if (parseAddress(holder_address, holder_ip, holder_port) && (holder_ip != ip || holder_port != port)) {
+            summaries.emplace_back(std::make_tuple(holder_ip, holder_port), std::move(summary));
+        }
+    }
+
+    for (const auto& [holder, summary] : summaries) {
+        if (Constants::RESPONSE_CACHE_ENABLED) {
+            cacheResponse(file_name, holder, summary.transfer_speed, summary.runs);
+        }
+    }
+
+    // Os solicitantes inscritos nesta busca recebem os mesmos resultados
+    PeerInfo chunk_requester_info(requester_ip, requester_port);
+    for (const auto& [subscriber, subscriber_range] : getQuerySubscribers(file_name, chunk_requester_info)) {
+        PeerInfo subscriber_info(std::get<0>(subscriber), std::get<1>(subscriber));
+        for (const auto& [holder, summary] : summaries) {
+            addToAggregate(file_name, subscriber_info, holder, summary.transfer_speed, clipChunkRuns(summary.runs, subscriber_range));
+        }
+    }
+
+    // Peer intermediário: soma ao resumo da busca, que segue para o salto anterior
+    if (requester_ip != ip || requester_port != port) {
+        for (const auto& [holder, summary] : summaries) {
+            if (!addToAggregate(file_name, chunk_requester_info, holder, summary.transfer_speed, summary.runs)) {
+                logMessage(LogType::OTHER, "Resumo agregado de " + file_name + " descartado: caminho inverso expirado.");
+                return;
+            }
+        }
+        return;
+    }
+
+    // Solicitante: registra todos os peers do resumo de uma vez
+    std::lock_guard<std::mutex> file_lock(processing_mutex);
+    if (!processing_active_map[file_name]) {
+        logMessage(LogType::OTHER, "Mensagem AGGREGATE recebida para " + file_name + ", mas o processamento está desativado.");
+        return;
+    }
+
+    for (const auto& [holder, summary] : summaries) {
+        std::vector<ChunkId> chunks_received;
+        for (const ChunkRange& run : summary.runs) {
+            for (ChunkId chunk = run.first; chunk < run.end; ++chunk) {
+                if (!file_manager.hasChunk(file_name, chunk)) {
+                    chunks_received.push_back(chunk);
+                }
+            }
+        }
+        if (!chunks_received.empty()) {
+            file_manager.storeChunkLocationInfo(file_name, chunks_received, std::get<0>(holder), std::get<1>(holder), summary.transfer_speed);
+            trackHolder(std::get<0>(holder), std::get<1>(holder));
+        }
+    }
+
+    logMessage(LogType::RESPONSE_RECEIVED,
+               "Resumo agregado recebido do Peer " + direct_sender_info.ip + ":" + std::to_string(direct_sender_info.port) +
+               " para o arquivo '" + file_name + "': " + std::to_string(summaries.size()) + " peer(s) com chunks.");
+}
+
+
+/**
+ * @brief Consulta e atualiza a tabela de buscas em andamento de um arquivo.
+ */
+QueryCoalescing UDPServer::coalesceQuery(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range, int ttl) {
+    if (!Constants::QUERY_COALESCING_ENABLED) {
+        return QueryCoalescing::NEW;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto requester = std::make_tuple(chunk_requester_info.ip, chunk_requester_info.port);
+    bool local = chunk_requester_info.ip == ip && chunk_requester_info.port == port;
+    auto covers = [&](const PendingQuery& query) {
+        return query.range.first <= range.first && query.range.end >= range.end && query.ttl >= ttl;
+    };
+
+    std::lock_guard<std::mutex> queries_lock(pending_queries_mutex);
+
+    // A tabela cresce com a taxa de buscas: as expiradas são removidas de tempos em tempos, e não a cada busca
+    if (now - pending_queries_swept_at >= std::chrono::milliseconds(Constants::QUERY_TABLE_SWEEP_INTERVAL_MS)) {
+        for (auto file_it = pending_queries.begin(); file_it != pending_queries.end();) {
+            std::erase_if(file_it->second, [&](const auto& entry) { return entry.second.expires_at <= now; });
+            file_it = file_it->second.empty() ? pending_queries.erase(file_it) : std::next(file_it);
+        }
+        pending_queries_swept_at = now;
+    }
+    auto& queries = pending_queries[file_name];
+
+    // Mesmo solicitante: cópia da mesma inundação, que ainda está chegando por outros caminhos, ou nova tentativa
+    // (depois de um silêncio maior que o intervalo, depois da resposta ou com TTL maior). Uma busca local agrupa
+    // as novas até terminar a sua espera
+    auto key = std::make_tuple(chunk_requester_info.ip, chunk_requester_info.port, range.first, range.end);
+    auto same = queries.find(key);
+    if (same != queries.end() && same->second.expires_at <= now) {
+        queries.erase(same);
+        same = queries.end();
+    }
+    if (same != queries.end()) {
+        PendingQuery& query = same->second;
+        bool is_copy = !query.answered && (local || now - query.received_at < std::chrono::milliseconds(Constants::QUERY_RESEND_INTERVAL_MS));
+        if (is_copy && covers(query)) {
+            query.received_at = now;
+            (local ? queries_local_coalesced : queries_duplicate)++;
+            return QueryCoalescing::DUPLICATE;
+        }
+        if (!is_copy) {
+            query.expires_at = now + std::chrono::seconds(Constants::QUERY_COALESCING_WINDOW_SECONDS);
+            query.answered = false;
+        }
+        query.ttl = ttl;
+        query.received_at = now;
+        queries_processed++;
+        return QueryCoalescing::NEW;
+    }
+
+    // Outro solicitante: os resultados da busca em andamento só passam por aqui pelo caminho inverso
+    if (Constants::REVERSE_PATH_RESPONSES && !local) {
+        auto covering = std::find_if(queries.begin(), queries.end(), [&](const auto& entry) {
+            return entry.second.expires_at > now && covers(entry.second);
+        });
+        if (covering != queries.end()) {
+            covering->second.subscribers.emplace_back(requester, range);
+            queries_subscribed++;
+            return QueryCoalescing::SUBSCRIBED;
+        }
+    }
+
+    queries.emplace(key, PendingQuery{requester, range, ttl, {}, now + std::chrono::seconds(Constants::QUERY_COALESCING_WINDOW_SECONDS), now});
+    queries_processed++;
+    return QueryCoalescing::NEW;
+}
+
+
+/**
+ * @brief Retorna os outros solicitantes atendidos por uma busca em andamento.
+ */
+std::vector<std::pair<std::tuple<std::string, int>, ChunkRange>> UDPServer::getQuerySubscribers(const std::string& file_name, const PeerInfo& chunk_requester_info) {
+    auto requester = std::make_tuple(chunk_requester_info.ip, chunk_requester_info.port);
+
+    std::lock_guard<std::mutex> queries_lock(pending_queries_mutex);
+    auto file_it = pending_queries.find(file_name);
+    if (file_it == pending_queries.end()) {
+        return {};
+    }
+    for (const auto& [key, query] : file_it->second) {
+        if (query.requester == requester) {
+            return query.subscribers;
+        }
+    }
+    return {};
+}
+
+
+/**
+ * @brief Monta uma linha de log com os contadores de buscas agrupadas.
+ */
+std::string UDPServer::describeQueryStats() const {
+    return "Buscas: " + std::to_string(queries_processed.load()) + " processadas, " +
+           std::to_string(queries_duplicate.load()) + " cópias descartadas, " +
+           std::to_string(queries_subscribed.load()) + " atendidas por outra busca, " +
+           std::to_string(queries_local_coalesced.load()) + " locais agrupadas.";
+}
@@ -1,16 +1,108 @@
 #ifndef UDPSERVER_H
 #define UDPSERVER_H
 
+#include "AsyncRuntime.h"
+#include "AttenuatedBloomFilter.h"
+#include "DHTNode.h"
 #include "FileManager.h"
+#include "PeerQuality.h"
+#include "PeerTable.h"
 #include "TCPServer.h"
 #include "Utils.h"
 #include <string>
+#include <atomic>
 #include <map>
 #include <vector>
 #include <set>
 #include <tuple>
 #include <unordered_map>
 #include <mutex>
+#include <chrono>
+
+
+/**
+ * @brief Peer que enviou uma mensagem DISCOVERY recentemente e recebe anúncios (HAVE) do arquivo.
+ */
+struct InterestedPeer {
+    PeerInfo info;                                      ///< IP e porta UDP do peer que fez a busca.
+    ChunkRange range;                                   ///< Chunks de interesse do peer.
+    std::chrono::steady_clock::time_point expires_at;   ///< Momento em que o interesse expira.
+};
+
+/**
+ * @brief Filtro de Bloom atenuado recebido de um vizinho.
+ */
+struct NeighborFilter {
+    AttenuatedBloomFilter filter;                       ///< Arquivos alcançáveis através do vizinho, por distância.
+    std::chrono::steady_clock::time_point received_at;  ///< Momento em que o filtro foi recebido.
+};
+
+/**
+ * @brief Registro dos chunks de um arquivo que uma folha mantém no seu super-peer.
+ */
+struct LeafRegistration {
+    ByteCount transfer_speed;                           ///< Velocidade de transferência da folha em bytes/segundo.
+    std::vector<ChunkRange> runs;                       ///< Chunks da folha, comprimidos em sequências contíguas.
+    std::uint64_t generation;                           ///< Rodada de registro da folha. Mensagens da mesma rodada se somam, uma rodada nova substitui o registro.
+    std::chrono::steady_clock::time_point expires_at;   ///< Momento em que o registro expira se não for renovado.
+};
+
+/**
+ * @brief Resposta guardada no cache: os chunks de um arquivo que um peer possui.
+ */
+struct CachedResponse {
+    ByteCount transfer_speed;                           ///< Velocidade de transferência do peer em bytes/segundo.
+    std::vector<ChunkRange> runs;                       ///< Chunks do peer, em sequências contíguas.
+    std::chrono::steady_clock::time_point expires_at;   ///< Momento em que a resposta expira.
+};
+
+/**
+ * @brief Resumo dos chunks de um arquivo que um peer possui, transportado em uma mensagem AGGREGATE.
+ */
+struct HolderSummary {
+    ByteCount transfer_speed;                           ///< Velocidade de transferência do peer em bytes/segundo.
+    std::vector<ChunkRange> runs;                       ///< Chunks do peer, em sequências contíguas.
+};
+
+/**
+ * @brief Caminho inverso de uma busca: para onde enviar as respostas agregadas neste salto.
+ */
+struct ReverseRoute {
+    std::tuple<std::string, int> previous_hop;          ///< Peer de quem a DISCOVERY foi recebida pela primeira vez.
+    std::map<std::tuple<std::string, int>, HolderSummary> pending; ///< Respostas ainda não enviadas ao salto anterior, por peer que possui os chunks.
+    std::chrono::steady_clock::time_point expires_at;   ///< Momento em que o caminho é descartado.
+};
+
+/**
+ * @brief Resultado da consulta à tabela de buscas em andamento (ver UDPServer::coalesceQuery).
+ */
+enum class QueryCoalescing {
+    NEW,            ///< Busca nova: é respondida e repassada normalmente.
+    DUPLICATE,      ///< Cópia de uma busca já processada que não alcança mais longe: é descartada.
+    SUBSCRIBED      ///< Atendida pela inundação de outra busca do arquivo que passa por este peer: é respondida, mas não repassada.
+};
+
+/**
+ * @brief Busca em andamento de um arquivo, registrada na tabela usada para agrupar buscas.
+ */
+struct PendingQuery {
+    std::tuple<std::string, int> requester;             ///< Peer que fez a busca (IP e porta UDP).
+    ChunkRange range;                                   ///< Chunks de interesse.
+    int ttl;                                            ///< Maior TTL com que a busca chegou a este peer.
+    std::vector<std::pair<std::tuple<std::string, int>, ChunkRange>> subscribers; ///< Outros solicitantes atendidos por esta busca, com os seus intervalos.
+    std::chrono::steady_clock::time_point expires_at;   ///< Momento em que a busca sai da tabela.
+    std::chrono::steady_clock::time_point received_at;  ///< Momento em que chegou a última cópia, processada ou descartada.
+    bool answered = false;                              ///< A espera pelas respostas terminou (apenas buscas locais, ver UDPServer::waitForResponses).
+};
+
+/**
+ * @brief Busca por passeios aleatórios iniciada por este peer, consultada pelos walkers para saber se continuam.
+ */
+struct RandomWalkQuery {
+    std::string file_name;                              ///< Nome do arquivo buscado.
+    ChunkRange range;                                   ///< Chunks de interesse.
+};
+
 
 /**
  * @brief Classe responsável por gerenciar a comunicação UDP para descoberta de chunks de um arquivo em uma rede P2P.
@@ -26,13 +118,449 @@ private:
     const int port;                                         ///< Porta UDP que o peer está utilizando para a comunicação.
     const int tcp_port;                                     ///< Porta TCP para enviar na mensagem de request.
     const int peer_id;                                      ///< Identificador único (ID) do peer.
-    const int transfer_speed;                               ///< Velocidade de transferência de dados em bytes/segundo.
-    int sockfd;                                             ///< Descriptor do socket UDP utilizado para a comunicação.
-    std::vector<std::tuple<std::string, int>> udpNeighbors; ///< Lista contendo os vizinhos diretos do peer (endereços IP e portas UDP).
+    std::atomic<ByteCount> transfer_speed;                  ///< Velocidade de transferência de dados em bytes/segundo. Alterada em execução quando config.txt muda.
+    int sockfd;                                             ///< Descriptor do socket UDP utilizado para o envio das mensagens.
+    std::vector<int> receiver_sockfds;                      ///< Sockets UDP de recebimento, todos na mesma porta (SO_REUSEPORT). O primeiro é o próprio sockfd.
+    int multicast_sockfd = -1;                              ///< Socket que recebe as buscas do grupo multicast (-1 se a descoberta por multicast estiver desativada).
+    std::vector<std::tuple<std::string, int>> udpNeighbors; ///< Lista contendo os vizinhos diretos do peer (endereços IP e portas UDP). Alterada em execução pela manutenção da vizinhança.
+    std::set<std::tuple<std::string, int>> configured_neighbors; ///< Vizinhos lidos de topologia.txt ainda na lista. Só são descartados se deixarem de responder.
+    std::map<std::tuple<std::string, int>, std::chrono::steady_clock::time_point> neighbor_candidates; ///< Candidatos a vizinho anunciados por PEX, com o momento do último anúncio.
+    std::map<std::tuple<std::string, int>, std::tuple<std::string, int>> pending_replacements; ///< Vizinho a descartar quando cada candidato pedido como substituto aceitar.
+    mutable std::mutex neighbors_mutex;                     ///< Mutex que protege udpNeighbors, configured_neighbors, neighbor_candidates e pending_replacements.
     std::map<std::string, bool> processing_active_map;      ///< Mapa para controlar o estado de processamento de cada arquivo. Mapeia file_name para processing_active.
     std::mutex processing_mutex;                            ///< Mutex para proteger o acesso ao processing_active_map.
     FileManager& file_manager;                              ///< Referência ao gerenciador de chunks de um arquivo.
     TCPServer& tcp_server;                                  ///< Referência ao servidor TCP.
+    PeerQuality& peer_quality;                              ///< Referência à tabela com o RTT e a vazão medidos de cada peer.
+    PeerTable& peer_table;                                  ///< Referência à tabela de PeerId, usada para resolver os peers escolhidos para download.
+    EventLoop& event_loop;                                  ///< Referência ao runtime de corrotinas que processa as mensagens.
+    std::unordered_map<std::string, std::vector<InterestedPeer>> interested_peers; ///< Peers que buscaram cada arquivo recentemente e recebem HAVE dos chunks novos.
+    std::mutex interested_peers_mutex;                      ///< Mutex que protege interested_peers.
+    std::unordered_map<std::string, std::set<ChunkId>> requested_chunks; ///< Chunks já pedidos de cada arquivo sendo baixado.
+    std::set<std::string> bulk_request_files;               ///< Arquivos baixados de uma vez (não sequencialmente), cujos chunks novos anunciados por HAVE são pedidos na hora.
+    std::mutex requested_chunks_mutex;                      ///< Mutex que protege requested_chunks e bulk_request_files.
+    DHTNode dht;                                            ///< Tabela de roteamento e registros de provedores da DHT.
+    std::map<std::tuple<std::string, int>, NeighborFilter> neighbor_filters; ///< Último filtro de Bloom atenuado recebido de cada vizinho.
+    std::mutex neighbor_filters_mutex;                      ///< Mutex que protege neighbor_filters.
+    std::unordered_map<std::uint64_t, RandomWalkQuery> walk_queries; ///< Buscas por passeios aleatórios em andamento iniciadas por este peer, pelo identificador da busca.
+    std::mutex walk_queries_mutex;                          ///< Mutex que protege walk_queries.
+    std::vector<std::tuple<std::string, int>> super_peers;  ///< Super-peers da rede (IP e porta UDP). Vazio se os super-peers estiverem desativados.
+    bool is_super_peer = false;                             ///< Indica se este peer é um super-peer.
+    std::tuple<std::string, int> home_super_peer;           ///< Super-peer em que esta folha registra seus chunks e faz suas buscas.
+    std::uint64_t registration_generation = 0;              ///< Rodada atual de registro desta folha no super-peer.
+    std::unordered_map<std::string, std::map<std::tuple<std::string, int>, LeafRegistration>> leaf_index; ///< Índice do super-peer: chunks de cada arquivo registrados por cada folha.
+    std::mutex leaf_index_mutex;                            ///< Mutex que protege leaf_index.
+    std::unordered_map<std::string, std::map<std::tuple<std::string, int>, CachedResponse>> response_cache; ///< Respostas recentes de cada arquivo, por peer que possui os chunks.
+    std::mutex response_cache_mutex;                        ///< Mutex que protege response_cache.
+    std::map<std::tuple<std::string, std::string, int>, ReverseRoute> reverse_routes; ///< Caminho inverso de cada busca (arquivo, IP e porta do solicitante).
+    std::mutex reverse_routes_mutex;                        ///< Mutex que protege reverse_routes.
+    std::unordered_map<std::string, std::map<std::tuple<std::string, int, ChunkId, ChunkId>, PendingQuery>> pending_queries; ///< Buscas em andamento de cada arquivo (originadas ou repassadas por este peer), por solicitante (IP e porta) e intervalo.
+    std::chrono::steady_clock::time_point pending_queries_swept_at; ///< Momento da última remoção das buscas expiradas de pending_queries.
+    std::mutex pending_queries_mutex;                       ///< Mutex que protege pending_queries e pending_queries_swept_at.
+    std::atomic<std::uint64_t> queries_processed{0};        ///< Buscas novas processadas.
+    std::atomic<std::uint64_t> queries_duplicate{0};        ///< Cópias de buscas descartadas.
+    std::atomic<std::uint64_t> queries_subscribed{0};       ///< Buscas atendidas pela inundação de outra busca.
+    std::atomic<std::uint64_t> queries_local_coalesced{0};  ///< Buscas locais agrupadas com outra busca local do mesmo arquivo.
+
+    /**
+     * @brief Monta o filtro de Bloom atenuado enviado a um vizinho.
+     * 
+     * O nível 0 contém os arquivos dos quais este peer possui chunks, e os demais níveis são os
+     * filtros recebidos dos outros vizinhos, deslocados de um nível. O filtro recebido do próprio
+     * destino não é incluído, para que ele não veja a si mesmo através deste peer.
+     * 
+     * @param neighbor Vizinho que receberá o filtro.
+     * @return Filtro a ser enviado.
+     */
+    AttenuatedBloomFilter buildFilterFor(const std::tuple<std::string, int>& neighbor);
+
+    /**
+     * @brief Guarda o filtro de Bloom atenuado recebido de um vizinho (BLOOM).
+     * 
+     * @param message Stream com os níveis do filtro.
+     * @param direct_sender_info Vizinho que enviou o filtro.
+     */
+    void processBloomMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Envia uma sonda de RTT (PING) a um peer cadastrado na tabela de qualidade.
+     * 
+     * @param peer IP e porta UDP do peer.
+     * @param nonce Identificador da sonda (ver PeerQuality::startProbe).
+     */
+    void sendProbe(const std::tuple<std::string, int>& peer, std::uint64_t nonce);
+
+    /**
+     * @brief Cadastra na tabela de qualidade um peer que possui chunks e, se for novo, já o sonda.
+     * 
+     * Assim o RTT dos peers que responderam a uma busca costuma estar medido quando os chunks
+     * são distribuídos entre eles.
+     * 
+     * @param ip Endereço IP do peer.
+     * @param port Porta UDP do peer.
+     */
+    void trackHolder(const std::string& ip, int port);
+
+    /**
+     * @brief Processa uma sonda de RTT (PING), respondendo com PONG, ou a resposta a uma sonda deste peer (PONG).
+     * 
+     * @param message Stream com o identificador da sonda.
+     * @param direct_sender_info Informações sobre o peer que enviou a mensagem.
+     * @param pong Indica se a mensagem é um PONG.
+     */
+    void processProbeMessage(std::istream& message, const PeerInfo& direct_sender_info, bool pong);
+
+    /**
+     * @brief Adiciona um vizinho, se ainda houver espaço (Constants::OVERLAY_MAX_DEGREE).
+     * 
+     * Um vizinho de topologia.txt (configured) é adicionado mesmo acima do limite e só é
+     * descartado se deixar de responder.
+     * 
+     * @param neighbor IP e porta UDP do novo vizinho.
+     * @param configured Indica se o vizinho vem de topologia.txt.
+     * @return true se o peer passou a ser vizinho, false se já era ou não há espaço.
+     */
+    bool addUDPNeighbor(const std::tuple<std::string, int>& neighbor, bool configured = false);
+
+    /**
+     * @brief Remove um vizinho e o filtro de Bloom recebido dele.
+     * 
+     * @param neighbor IP e porta UDP do vizinho.
+     * @return true se o peer era vizinho.
+     */
+    bool removeUDPNeighbor(const std::tuple<std::string, int>& neighbor);
+
+    /**
+     * @brief Guarda os candidatos a vizinho anunciados por um vizinho (PEX).
+     * 
+     * Um PEX de um peer que não é vizinho indica que ele considera este peer seu vizinho: o
+     * vínculo é aceito se houver espaço, senão o peer é avisado com NEIGHBOR_DROP.
+     * 
+     * @param message Stream com os vizinhos anunciados ("IP:porta" separados por espaço).
+     * @param direct_sender_info Informações sobre o peer que enviou a mensagem.
+     */
+    void processPexMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Processa um pedido de vínculo (NEIGHBOR_ADD), a sua aceitação (NEIGHBOR_ACCEPT) ou o fim de um vínculo (NEIGHBOR_DROP).
+     * 
+     * @param command Comando recebido.
+     * @param direct_sender_info Informações sobre o peer que enviou a mensagem.
+     */
+    void processNeighborMessage(const std::string& command, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Executa uma rodada de manutenção da vizinhança.
+     * 
+     * Descarta os vizinhos que deixaram de responder a Constants::OVERLAY_DEAD_NEIGHBOR_PROBES
+     * sondas. Abaixo de Constants::OVERLAY_TARGET_DEGREE vizinhos, pede vínculo aos candidatos de
+     * menor RTT. No grau alvo, troca o vizinho adicionado em execução de maior RTT por um candidato
+     * com RTT menor que Constants::OVERLAY_REPLACE_RTT_RATIO vezes o dele (e ao menos
+     * Constants::OVERLAY_REPLACE_MIN_GAIN_MS menor). Os vizinhos de
+     * topologia.txt só são descartados se deixarem de responder.
+     */
+    void maintainOverlay();
+
+    /**
+     * @brief Seleciona os vizinhos que devem receber uma mensagem DISCOVERY.
+     * 
+     * Com Constants::BLOOM_ROUTING_ENABLED, seleciona os vizinhos cujo filtro indica o arquivo a
+     * até ttl saltos, além dos vizinhos sem filtro válido. Se o TTL passar do horizonte dos filtros
+     * (ttl >= Constants::BLOOM_FILTER_DEPTH), o arquivo pode estar além dele e todos os vizinhos são
+     * selecionados: primeiro os cujo filtro indica o arquivo, depois os sem filtro válido e por último
+     * os demais. Cada grupo é ordenado pelo RTT medido (ver PeerQuality::rankByLatency), assim os mais
+     * rápidos recebem a mensagem primeiro.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param ttl TTL com que a mensagem chegará aos vizinhos.
+     * @return Vizinhos selecionados, na ordem de envio.
+     */
+    std::vector<std::tuple<std::string, int>> selectDiscoveryNeighbors(const std::string& file_name, int ttl);
+
+    /**
+     * @brief Monta uma mensagem de passeio aleatório (WALK, WALK_CHECK ou WALK_CONTINUE).
+     * 
+     * As três mensagens têm os mesmos campos, assim o estado do walker viaja inteiro na mensagem
+     * e nenhum peer do caminho precisa guardá-lo.
+     * 
+     * @param command Tipo da mensagem.
+     * @param query_id Identificador da busca.
+     * @param hops Número de peers já visitados pelo walker.
+     * @param file_name Nome do arquivo buscado.
+     * @param total_chunks Número total de chunks do arquivo.
+     * @param chunk_requester_info Peer que iniciou a busca.
+     * @param range Intervalo de chunks de interesse.
+     * @return A mensagem formatada.
+     */
+    std::string buildWalkMessage(const std::string& command, std::uint64_t query_id, int hops, const std::string& file_name, ChunkId total_chunks,
+                                 const PeerInfo& chunk_requester_info, const ChunkRange& range) const;
+
+    /**
+     * @brief Envia um walker (WALK) a um vizinho escolhido aleatoriamente.
+     * 
+     * O vizinho de onde o walker veio só é escolhido se for o único.
+     * 
+     * @param message Mensagem WALK a ser enviada.
+     * @param previous_hop Peer de onde o walker veio.
+     */
+    void forwardWalk(const std::string& message, const PeerInfo& previous_hop);
+
+    /**
+     * @brief Processa um walker recebido (WALK) ou liberado pela origem para continuar (WALK_CONTINUE).
+     * 
+     * Ao receber WALK, o peer responde à origem com RESPONSE se possuir chunks do arquivo. Em
+     * seguida, o walker é encerrado após Constants::WALK_MAX_HOPS peers, pergunta à origem se a
+     * busca continua (WALK_CHECK) a cada Constants::WALK_CHECK_INTERVAL_HOPS peers ou segue para
+     * um vizinho aleatório.
+     * 
+     * @param message Stream com os dados do walker.
+     * @param direct_sender_info Peer que enviou a mensagem.
+     * @param resumed Indica se a mensagem é WALK_CONTINUE (o peer já respondeu à origem).
+     */
+    void processWalkMessage(std::istream& message, const PeerInfo& direct_sender_info, bool resumed);
+
+    /**
+     * @brief Responde à pergunta de um walker (WALK_CHECK) sobre a continuação de uma busca iniciada por este peer.
+     * 
+     * Se a busca continua (ver isRandomWalkActive), a mensagem volta como WALK_CONTINUE; caso
+     * contrário, não há resposta e o walker termina.
+     * 
+     * @param message Stream com os dados do walker.
+     * @param direct_sender_info Peer em que o walker está.
+     */
+    void processWalkCheckMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Verifica se uma busca por passeios aleatórios iniciada por este peer continua.
+     * 
+     * A busca termina em waitForResponses ou quando todos os chunks de interesse têm uma fonte
+     * conhecida (nesse caso, ela é removida aqui).
+     * 
+     * @param query_id Identificador da busca.
+     * @return true se os walkers da busca devem continuar.
+     */
+    bool isRandomWalkActive(std::uint64_t query_id);
+
+    /**
+     * @brief Verifica se um endereço é de um super-peer.
+     */
+    bool isSuperPeer(const std::tuple<std::string, int>& address) const;
+
+    /**
+     * @brief Monta as mensagens com sequências de chunks (REGISTER e LOCATION) a partir de um prefixo comum.
+     * 
+     * As sequências são divididas em quantas mensagens forem necessárias para que nenhuma passe de
+     * Constants::CONTROL_MESSAGE_MAX_SIZE bytes.
+     * 
+     * @param prefix Início de todas as mensagens (comando e campos fixos).
+     * @param runs Sequências de chunks, cada uma enviada como "first end".
+     * @return Mensagens formatadas.
+     */
+    std::vector<std::string> buildRunMessages(const std::string& prefix, const std::vector<ChunkRange>& runs) const;
+
+    /**
+     * @brief Guarda no índice do super-peer os chunks registrados por uma folha (REGISTER).
+     * 
+     * @param message Stream com o nome do arquivo, a velocidade e a rodada de registro da folha, e as sequências de chunks.
+     * @param direct_sender_info Folha que enviou o registro.
+     */
+    void processRegisterMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Processa a localização (LOCATION) de chunks de outro peer, informada por um super-peer.
+     * 
+     * Funciona como RESPONSE, mas os chunks pertencem ao peer informado na mensagem, e não a quem a enviou.
+     * A localização também é guardada no cache de respostas. A mensagem CACHE tem o mesmo formato e
+     * só alimenta o cache.
+     * 
+     * @param message Stream com o nome do arquivo, o endereço e a velocidade do peer, e as sequências de chunks.
+     * @param direct_sender_info Peer que enviou a mensagem (super-peer, peer que respondeu pelo cache ou que possui os chunks).
+     * @param cache_only Indica se a mensagem é CACHE (apenas guardada no cache).
+     */
+    void processLocationMessage(std::istream& message, const PeerInfo& direct_sender_info, bool cache_only);
+
+    /**
+     * @brief Monta as mensagens que informam os chunks de um peer (LOCATION ou CACHE), recortados em um intervalo.
+     * 
+     * @param command Tipo da mensagem.
+     * @param file_name Nome do arquivo.
+     * @param holder Peer que possui os chunks (IP e porta UDP).
+     * @param holder_speed Velocidade de transferência do peer em bytes/segundo.
+     * @param runs Chunks do peer, em sequências contíguas.
+     * @param range Intervalo de chunks de interesse.
+     * @return Mensagens formatadas (vazio se nenhum chunk estiver no intervalo).
+     */
+    std::vector<std::string> buildLocationMessages(const std::string& command, const std::string& file_name, const std::tuple<std::string, int>& holder,
+                                                   ByteCount holder_speed, const std::vector<ChunkRange>& runs, const ChunkRange& range) const;
+
+    /**
+     * @brief Guarda no cache os chunks de um arquivo que um peer possui, por Constants::RESPONSE_CACHE_TTL_SECONDS.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param holder Peer que possui os chunks (IP e porta UDP).
+     * @param holder_speed Velocidade de transferência do peer em bytes/segundo.
+     * @param runs Chunks do peer, em sequências contíguas.
+     */
+    void cacheResponse(const std::string& file_name, const std::tuple<std::string, int>& holder, ByteCount holder_speed, std::vector<ChunkRange> runs);
+
+    /**
+     * @brief Envia ao peer que repassou uma DISCOVERY os chunks que este peer possui (CACHE).
+     * 
+     * As respostas vão direto ao solicitante, assim os peers do caminho não as veem. A cópia
+     * permite que o peer anterior responda pelo cache às próximas buscas do arquivo.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param total_chunks Número total de chunks do arquivo.
+     * @param previous_hop Peer que repassou a mensagem.
+     */
+    void sendCacheHint(const std::string& file_name, ChunkId total_chunks, const PeerInfo& previous_hop);
+
+    /**
+     * @brief Responde a uma busca com as respostas válidas do cache (LOCATION).
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester_info Peer que fez a busca.
+     * @param range Intervalo de chunks de interesse.
+     * @return true se o cache e os chunks deste peer cobrem todo o intervalo, e a busca não precisa ser repassada.
+     */
+    bool answerFromResponseCache(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range);
+
+    /**
+     * @brief Guarda o salto anterior de uma busca, se ela ainda não passou por este peer.
+     * 
+     * A busca é identificada pelo arquivo e pelo solicitante, que já estão na mensagem DISCOVERY.
+     * As cópias que chegam por outros caminhos mantêm o primeiro salto anterior.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester_info Peer que fez a busca.
+     * @param previous_hop Peer que repassou a mensagem.
+     */
+    void registerReverseRoute(const std::string& file_name, const PeerInfo& chunk_requester_info, const PeerInfo& previous_hop);
+
+    /**
+     * @brief Acrescenta os chunks de um peer ao resumo agregado de uma busca, enviado depois ao salto anterior.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester_info Peer que fez a busca.
+     * @param holder Peer que possui os chunks (IP e porta UDP).
+     * @param holder_speed Velocidade de transferência do peer em bytes/segundo.
+     * @param runs Chunks do peer, em sequências contíguas.
+     * @return false se não há caminho inverso para a busca.
+     */
+    bool addToAggregate(const std::string& file_name, const PeerInfo& chunk_requester_info, const std::tuple<std::string, int>& holder,
+                        ByteCount holder_speed, const std::vector<ChunkRange>& runs);
+
+    /**
+     * @brief Monta as mensagens AGGREGATE com os resumos de uma busca.
+     * 
+     * Formato: "AGGREGATE <arquivo> <solicitante> (<peer> <velocidade> <n> <first end>*n)*". Os resumos são
+     * divididos em quantas mensagens forem necessárias para que nenhuma passe de
+     * Constants::CONTROL_MESSAGE_MAX_SIZE bytes.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester Solicitante da busca (IP e porta UDP).
+     * @param summaries Resumos por peer que possui os chunks.
+     * @return Mensagens formatadas.
+     */
+    std::vector<std::string> buildAggregateMessages(const std::string& file_name, const std::tuple<std::string, int>& chunk_requester,
+                                                    const std::map<std::tuple<std::string, int>, HolderSummary>& summaries) const;
+
+    /**
+     * @brief Processa um resumo agregado de respostas (AGGREGATE).
+     * 
+     * No solicitante, os chunks de todos os peers do resumo são registrados de uma vez. Nos
+     * peers intermediários, o resumo é guardado no cache de respostas e somado ao resumo da
+     * busca neste salto.
+     * 
+     * @param message Stream com os dados do resumo.
+     * @param direct_sender_info Peer que enviou o resumo.
+     */
+    void processAggregateMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Retorna os outros solicitantes atendidos por uma busca em andamento.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester_info Peer que fez a busca.
+     * @return Solicitantes inscritos na busca, com os seus intervalos de interesse.
+     */
+    std::vector<std::pair<std::tuple<std::string, int>, ChunkRange>> getQuerySubscribers(const std::string& file_name, const PeerInfo& chunk_requester_info);
+
+    /**
+     * @brief Responde a uma busca com os chunks das folhas registradas neste super-peer (LOCATION).
+     * 
+     * Os registros expirados são descartados aqui.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester_info Peer que fez a busca.
+     * @param range Intervalo de chunks de interesse.
+     */
+    void sendIndexedLocations(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range);
+
+    /**
+     * @brief Repassa uma busca aos outros super-peers, com TTL 0.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param total_chunks Número total de chunks do arquivo.
+     * @param chunk_requester_info Peer que fez a busca.
+     * @param range Intervalo de chunks de interesse.
+     */
+    void forwardDiscoveryToSuperPeers(const std::string& file_name, ChunkId total_chunks, const PeerInfo& chunk_requester_info, const ChunkRange& range);
+
+    /**
+     * @brief Responde a uma consulta da DHT (FIND_NODE ou FIND_PROVIDERS) com uma mensagem NODES.
+     * 
+     * @param message Stream com os dados da consulta (identificador da consulta e chave).
+     * @param direct_sender_info Peer que enviou a consulta.
+     * @param find_providers Indica se a consulta pede também os provedores da chave.
+     */
+    void processDHTQueryMessage(std::istream& message, const PeerInfo& direct_sender_info, bool find_providers);
+
+    /**
+     * @brief Entrega uma resposta da DHT (NODES) à busca que a aguarda.
+     * 
+     * @param message Stream com os dados da resposta.
+     * @param direct_sender_info Peer que enviou a resposta.
+     */
+    void processDHTNodesMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Guarda o registro de provedor publicado por outro peer (ADD_PROVIDER).
+     * 
+     * @param message Stream com os dados da mensagem (chave e nome do arquivo).
+     * @param direct_sender_info Peer que possui chunks do arquivo.
+     */
+    void processDHTAddProviderMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+    /**
+     * @brief Busca iterativa na DHT pelos nós mais próximos de uma chave (e, opcionalmente, pelos seus provedores).
+     * 
+     * Em cada rodada, consulta em paralelo os Constants::DHT_LOOKUP_PARALLELISM contatos ainda não
+     * consultados mais próximos da chave e espera as respostas por até Constants::DHT_RPC_TIMEOUT_MS.
+     * Termina quando os Constants::DHT_BUCKET_SIZE contatos mais próximos já foram consultados ou após
+     * Constants::DHT_MAX_LOOKUP_ROUNDS rodadas. Na busca de provedores, junta os provedores de todas as respostas.
+     * 
+     * @param key Chave buscada.
+     * @param find_providers Indica se a busca procura provedores (FIND_PROVIDERS) ou apenas nós (FIND_NODE).
+     * @param description Texto usado no log com as estatísticas da busca.
+     * @return Provedores encontrados e os Constants::DHT_BUCKET_SIZE nós mais próximos da chave.
+     */
+    Task<DHTReply> lookup(std::uint64_t key, bool find_providers, std::string description);
+
+    /**
+     * @brief Publica este peer como provedor de um arquivo nos nós mais próximos da chave do arquivo.
+     * 
+     * @param file_name Nome do arquivo.
+     */
+    Task<void> publishProvider(std::string file_name);
+
+    /**
+     * @brief Envia a mensagem REQUEST para cada peer selecionado.
+     * 
+     * @param file_name O nome do arquivo cujos chunks estão sendo solicitados.
+     * @param chunks_by_peer Chunks a serem pedidos a cada peer (PeerId).
+     */
+    void sendChunkRequests(const std::string& file_name, const std::unordered_map<PeerId, std::vector<ChunkId>>& chunks_by_peer);
 
 public:
     /**
@@ -49,28 +577,76 @@ public:
      * @param transfer_speed Velocidade de transferência de dados em bytes/segundo do peer.
      * @param file_manager Referência ao gerenciador de arquivos do peer.
      * @param tcp_server Referência ao servidor TCP do peer.
+     * @param peer_quality Referência à tabela de qualidade dos peers.
+     * @param peer_table Referência à tabela de PeerId dos peers.
+     * @param event_loop Referência ao runtime de corrotinas que processa as mensagens.
      */
-    UDPServer(const std::string& ip, int port, int tcp_port, int peer_id, int transfer_speed, FileManager& file_manager, TCPServer& tcp_server);
+    UDPServer(const std::string& ip, int port, int tcp_port, int peer_id, ByteCount transfer_speed, FileManager& file_manager, TCPServer& tcp_server,
+              PeerQuality& peer_quality, PeerTable& peer_table, EventLoop& event_loop);
 
 
     /**
      * @brief Inicia o servidor UDP, permitindo que o peer receba e envie mensagens.
      * 
-     * Essa função ativa o loop principal para o recebimento de mensagens UDP e 
-     * encaminha as mensagens recebidas para o processamento adequado.
+     * Essa função cria os sockets UDP e ativa um loop de recebimento para cada um deles,
+     * encaminhando as mensagens recebidas para o processamento adequado. Com mais de um
+     * socket (Constants::UDP_RECEIVER_SHARDS), o kernel distribui os datagramas entre eles
+     * e cada loop roda em sua própria thread. Retorna após o EventLoop ser encerrado e stop
+     * ser chamado.
      */
     void run();
 
 
     /**
-     * @brief Função para criar e configurar o socket UDP.
+     * @brief Encerra os loops de recebimento, desbloqueando as threads que aguardam datagramas.
+     */
+    void stop();
+
+
+    /**
+     * @brief Loop de recebimento de um dos sockets UDP.
+     * 
+     * Fixa a thread no núcleo do socket (Constants::UDP_RECEIVER_PIN_TO_CORE) e recebe as
+     * suas mensagens com receiveMessages.
+     * 
+     * @param shard_index Índice do socket em receiver_sockfds.
+     */
+    void runReceiver(std::size_t shard_index);
+
+
+    /**
+     * @brief Recebe as mensagens de um socket UDP até o EventLoop ser encerrado.
      * 
-     * Esta função cria um socket UDP, configura o endereço e vincula o socket à porta UDP do peer.
+     * Recebe cada mensagem diretamente em um buffer do BufferPool e a processa na própria thread
+     * de recebimento (EventLoop::spawnInline), entregando o buffer à corrotina sem cópias. A
+     * corrotina só passa para o Executor quando precisa esperar, assim cada socket interpreta e
+     * responde as suas mensagens no seu núcleo.
      * 
+     * @param receiver_sockfd Socket de recebimento (um dos receiver_sockfds ou o multicast_sockfd).
+     */
+    void receiveMessages(int receiver_sockfd);
+
+
+    /**
+     * @brief Função para criar e configurar os sockets UDP.
+     * 
+     * Esta função cria os sockets UDP, configura o endereço e vincula os sockets à porta UDP do peer.
+     * Quando há mais de um socket, todos usam SO_REUSEPORT para compartilhar a mesma porta.
      */
     void initializeUDPSocket();
 
 
+    /**
+     * @brief Cria o socket que recebe as buscas enviadas ao grupo multicast e configura o envio ao grupo.
+     * 
+     * O socket entra no grupo Constants::MULTICAST_GROUP na interface do IP do peer e escuta
+     * Constants::MULTICAST_PORT, compartilhada (SO_REUSEADDR) por todos os peers do host. As buscas
+     * saem pelo sockfd com TTL Constants::MULTICAST_HOPS e com loopback ativo, para alcançar os
+     * peers da mesma máquina. Em caso de falha, a descoberta segue apenas pelos vizinhos.
+     */
+    void initializeMulticastSocket();
+
+
     /**
      * @brief Inicializa o recebimento de respostas para chunks de um arquivo específico.
      * 
@@ -85,6 +661,209 @@ public:
     void initializeProcessingActive(std::string file_name);
 
 
+    /**
+     * @brief Registra um peer que buscou um arquivo, para que ele receba anúncios (HAVE) dos chunks novos.
+     * 
+     * O interesse expira após Constants::HAVE_INTEREST_TTL_SECONDS, e cada arquivo guarda no máximo
+     * Constants::HAVE_MAX_INTERESTED_PEERS peers.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester_info IP e porta UDP do peer que fez a busca.
+     * @param range Chunks de interesse do peer.
+     */
+    void registerInterest(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range);
+
+
+    /**
+     * @brief Envia periodicamente mensagens HAVE com os chunks salvos desde o último envio.
+     * 
+     * A cada Constants::HAVE_ANNOUNCE_INTERVAL_MS, os chunks novos (no máximo
+     * Constants::HAVE_MAX_CHUNKS_PER_INTERVAL) são anunciados aos peers interessados no arquivo,
+     * respeitando o intervalo de chunks de cada um. Executa até o EventLoop ser encerrado.
+     */
+    Task<void> runHaveAnnouncer();
+
+
+    /**
+     * @brief Publica periodicamente na DHT os arquivos dos quais o peer possui chunks.
+     * 
+     * Antes, o peer entra na DHT buscando o próprio identificador, o que o apresenta aos nós mais
+     * próximos dele, e repete a busca a cada Constants::DHT_REFRESH_INTERVAL_SECONDS. Arquivos novos são publicados em até Constants::DHT_PUBLISH_CHECK_INTERVAL_SECONDS, e todos
+     * são republicados a cada Constants::DHT_REPUBLISH_INTERVAL_SECONDS, antes de os registros
+     * expirarem. Executa até o EventLoop ser encerrado.
+     */
+    Task<void> runDHTPublisher();
+
+
+    /**
+     * @brief Envia periodicamente a cada vizinho o filtro de Bloom atenuado montado para ele.
+     * 
+     * O envio ocorre a cada Constants::BLOOM_EXCHANGE_INTERVAL_SECONDS, assim o conteúdo a i saltos
+     * leva cerca de i intervalos para aparecer nos filtros. Retorna imediatamente com
+     * Constants::BLOOM_ROUTING_ENABLED desativado. Executa até o EventLoop ser encerrado.
+     */
+    Task<void> runBloomExchange();
+
+
+    /**
+     * @brief Mantém a vizinhança em execução: troca listas de vizinhos (PEX) e adiciona ou descarta vizinhos.
+     * 
+     * A cada Constants::OVERLAY_MAINTENANCE_INTERVAL_SECONDS, envia a cada vizinho a lista dos
+     * demais (PEX) e executa uma rodada de maintainOverlay. Assim a rede se recompõe quando peers
+     * morrem e tende a vínculos de menor RTT e menor diâmetro. Não faz nada com
+     * Constants::OVERLAY_MAINTENANCE_ENABLED desativado. Executa até o EventLoop ser encerrado.
+     */
+    Task<void> runOverlayMaintenance();
+
+
+    /**
+     * @brief Envia periodicamente sondas de RTT (PING) aos vizinhos e aos peers que possuem chunks.
+     * 
+     * A cada Constants::PEER_QUALITY_PROBE_INTERVAL_SECONDS os vizinhos são (re)cadastrados na
+     * tabela de qualidade e todos os peers da tabela recebem um PING. Executa até o EventLoop ser
+     * encerrado.
+     */
+    Task<void> runQualityProber();
+
+
+    /**
+     * @brief Busca na DHT os peers que possuem chunks de um arquivo.
+     * 
+     * A busca leva O(log N) saltos, ao contrário da inundação por DISCOVERY, que envia mensagens
+     * por todas as arestas até o TTL.
+     * 
+     * @param file_name Nome do arquivo.
+     * @return Endereços UDP dos provedores encontrados (vazio se nenhum for encontrado).
+     */
+    Task<std::vector<PeerInfo>> findProviders(std::string file_name);
+
+
+    /**
+     * @brief Envia uma mensagem DISCOVERY com TTL 0 diretamente a um peer.
+     * 
+     * Usada com os provedores encontrados na DHT: o peer responde com RESPONSE como na
+     * inundação, mas sem repassar a mensagem.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param total_chunks Número total de chunks do arquivo.
+     * @param target Peer que recebe a mensagem.
+     * @param range Intervalo de chunks de interesse.
+     */
+    void sendDirectDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, const PeerInfo& target, const ChunkRange& range);
+
+
+    /**
+     * @brief Indica se a descoberta por multicast está ativa (ver initializeMulticastSocket).
+     */
+    bool isMulticastEnabled() const { return multicast_sockfd >= 0; }
+
+
+    /**
+     * @brief Envia uma busca (MDISCOVERY) com TTL 0 ao grupo multicast da rede local.
+     * 
+     * Um único datagrama alcança todos os peers do segmento. Cada um responde com RESPONSE como
+     * na inundação, depois de um atraso aleatório (ver processMulticastDiscoveryMessage).
+     * 
+     * @param file_name Nome do arquivo.
+     * @param total_chunks Número total de chunks do arquivo.
+     * @param range Intervalo de chunks de interesse.
+     */
+    void sendMulticastDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, const ChunkRange& range);
+
+
+    /**
+     * @brief Inicia uma busca por passeios aleatórios: Constants::WALK_WALKERS walkers partem para vizinhos aleatórios.
+     * 
+     * Ao contrário da inundação, o número de mensagens cresce com o número de walkers e de saltos,
+     * não com o número de arestas ao alcance do TTL. A busca é encerrada pela origem (ver
+     * processWalkCheckMessage) ou em waitForResponses.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param total_chunks Número total de chunks do arquivo.
+     * @param range Intervalo de chunks de interesse.
+     */
+    void startRandomWalk(const std::string& file_name, ChunkId total_chunks, const ChunkRange& range);
+
+
+    /**
+     * @brief Define os super-peers da rede e o papel deste peer.
+     * 
+     * Uma folha usa como super-peer o primeiro vizinho que for super-peer. Sem nenhum, escolhe
+     * um super-peer pelo seu identificador na DHT, distribuindo as folhas entre eles.
+     * 
+     * @param super_peers Super-peers (IP e porta UDP), do mais rápido para o mais lento (ver ConfigManager::selectSuperPeers).
+     */
+    void setSuperPeers(const std::vector<std::tuple<std::string, int>>& super_peers);
+
+
+    /**
+     * @brief Verifica se a rede usa super-peers.
+     */
+    bool hasSuperPeers() const { return !super_peers.empty(); }
+
+
+    /**
+     * @brief Registra periodicamente os chunks desta folha no seu super-peer (REGISTER).
+     * 
+     * Os chunks de cada arquivo são enviados comprimidos em sequências contíguas a cada
+     * Constants::SUPER_PEER_REGISTER_INTERVAL_SECONDS, o que também renova o registro. Retorna
+     * imediatamente em super-peers ou se os super-peers estiverem desativados.
+     */
+    Task<void> runSuperPeerRegistration();
+
+
+    /**
+     * @brief Inicia uma busca pela camada de super-peers.
+     * 
+     * Uma folha envia a mensagem DISCOVERY apenas ao seu super-peer. O super-peer responde com os
+     * seus chunks e os das folhas registradas nele, e repassa a busca aos outros super-peers, que
+     * fazem o mesmo. Assim, a busca não depende do número de folhas.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param total_chunks Número total de chunks do arquivo.
+     * @param range Intervalo de chunks de interesse.
+     */
+    void sendSuperPeerDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, const ChunkRange& range);
+
+
+    /**
+     * @brief Envia periodicamente ao salto anterior de cada busca o resumo agregado das respostas novas.
+     * 
+     * Com Constants::REVERSE_PATH_RESPONSES, as respostas de cada busca que chegam a este peer
+     * em um intervalo de Constants::REVERSE_PATH_FLUSH_INTERVAL_MS seguem juntas. Os caminhos
+     * expirados são descartados aqui. Retorna imediatamente se a opção estiver desativada.
+     */
+    Task<void> runAggregateFlusher();
+
+
+    /**
+     * @brief Consulta e atualiza a tabela de buscas em andamento de um arquivo.
+     * 
+     * Uma busca do mesmo solicitante cujo intervalo e TTL já foram cobertos por outra é uma cópia
+     * (DUPLICATE), comum na inundação, que chega por vários caminhos, se chegar até
+     * Constants::QUERY_RESEND_INTERVAL_MS após a cópia anterior e a busca ainda não tiver sido
+     * respondida. Depois de um silêncio maior, é uma nova tentativa do solicitante e é processada (NEW). Uma
+     * busca local agrupa as novas buscas locais do arquivo até o fim da sua espera pelas respostas. Com
+     * Constants::REVERSE_PATH_RESPONSES, uma busca de outro solicitante coberta por uma busca em
+     * andamento é inscrita nela (SUBSCRIBED): os resumos agregados dessa busca, que voltam por este
+     * peer, também seguem para o novo solicitante. Caso contrário, a busca é registrada (NEW).
+     * Com Constants::QUERY_COALESCING_ENABLED desativado, toda busca é NEW.
+     * 
+     * @param file_name Nome do arquivo buscado.
+     * @param chunk_requester_info Peer que fez a busca (o próprio peer nas buscas locais).
+     * @param range Intervalo de chunks de interesse.
+     * @param ttl TTL com que a busca chegou a este peer.
+     * @return Como a busca deve ser tratada.
+     */
+    QueryCoalescing coalesceQuery(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range, int ttl);
+
+
+    /**
+     * @brief Monta uma linha de log com os contadores de buscas agrupadas.
+     */
+    std::string describeQueryStats() const;
+
+
     /**
      * @brief Função que envia uma mensagem UDP.
      * 
@@ -102,13 +881,46 @@ public:
      * @brief Define os vizinhos para o peer atual.
      * 
      * Esta função é usada para configurar os peers vizinhos com quem este peer 
-     * pode se comunicar diretamente via UDP.
+     * pode se comunicar diretamente via UDP. Esses vizinhos (de topologia.txt) só são
+     * descartados pela manutenção da vizinhança se deixarem de responder.
      * 
      * @param neighbors Vizinhos do peer (IP e Porta UDP).
      */
     void setUDPNeighbors(const std::vector<std::tuple<std::string, int>>& neighbors);
 
 
+    /**
+     * @brief Aplica em execução uma nova lista de vizinhos lida de topologia.txt.
+     * 
+     * Os vizinhos que saíram da topologia são removidos e os que entraram são adicionados. Os
+     * vizinhos adicionados pela manutenção da vizinhança (PEX) e as buscas e transferências em
+     * andamento não são afetados.
+     * 
+     * @param neighbors Vizinhos do peer na nova topologia (IP e porta UDP).
+     */
+    void reloadUDPNeighbors(const std::vector<std::tuple<std::string, int>>& neighbors);
+
+
+    /**
+     * @brief Altera a velocidade de transferência anunciada nas respostas (RESPONSE, HAVE, REGISTER).
+     * 
+     * @param speed Nova velocidade em bytes/segundo.
+     */
+    void setTransferSpeed(ByteCount speed) { transfer_speed.store(speed); }
+
+
+    /**
+     * @brief Retorna uma cópia da lista atual de vizinhos, que pode mudar em execução.
+     */
+    std::vector<std::tuple<std::string, int>> getUDPNeighbors() const;
+
+
+    /**
+     * @brief Verifica se um peer é vizinho direto deste peer.
+     */
+    bool isUDPNeighbor(const std::tuple<std::string, int>& peer) const;
+
+
     /**
      * @brief Obtém o endereço IP e a porta UDP do peer a partir de uma estrutura sockaddr_in.
      * 
@@ -122,16 +934,19 @@ public:
 
 
     /**
-     * @brief Envia uma mensagem de descoberta (DISCOVERY) para todos os vizinhos.
+     * @brief Envia uma mensagem de descoberta (DISCOVERY) para os vizinhos.
      * 
      * Essa mensagem será usada para solicitar a localização de um arquivo específico na rede.
+     * Os vizinhos são escolhidos por selectDiscoveryNeighbors. Entre um vizinho e outro, a corrotina aguarda Constants::DISCOVERY_MESSAGE_INTERVAL_SECONDS
+     * sem bloquear a thread.
      * 
      * @param file_name Nome do arquivo que o peer deseja localizar.
      * @param total_chunks Número total de chunks que compõem o arquivo.
      * @param ttl Time-to-live para limitar o alcance do flooding.
      * @param chunk_requester_info Informações sobre o peer que solicitou os chunks do arquivo, como seu endereço IP e porta UDP.
+     * @param range Intervalo de chunks de interesse. Fora de um download parcial, todos os chunks do arquivo.
      */
-    void sendChunkDiscoveryMessage(const std::string& file_name, int total_chunks, int ttl, const PeerInfo& chunk_requester_info);
+    Task<void> sendChunkDiscoveryMessage(std::string file_name, ChunkId total_chunks, int ttl, PeerInfo chunk_requester_info, ChunkRange range);
     
 
     /**
@@ -142,8 +957,9 @@ public:
      * 
      * @param file_name Nome do arquivo solicitado.
      * @param chunk_requester_info Informações sobre o peer que solicitou os chunks do arquivo, como seu endereço IP e porta UDP.
+     * @param range Intervalo de chunks de interesse do solicitante. Apenas os chunks do intervalo são anunciados.
      */
-    void sendChunkResponseMessage(const std::string& file_name, const PeerInfo& chunk_requester_info);
+    void sendChunkResponseMessage(const std::string& file_name, const PeerInfo& chunk_requester_info, const ChunkRange& range);
 
 
     /**
@@ -157,6 +973,18 @@ public:
     void sendChunkRequestMessage(const std::string& file_name);
 
 
+    /**
+     * @brief Envia mensagens (REQUEST) pedindo apenas alguns chunks de um arquivo.
+     * 
+     * Usada pelo download sequencial, que pede somente os chunks da janela atual.
+     * 
+     * @param file_name O nome do arquivo cujos chunks estão sendo solicitados.
+     * @param chunk_ids Chunks a serem solicitados.
+     * @return Chunks efetivamente solicitados (chunks sem peers conhecidos ficam de fora).
+     */
+    std::vector<ChunkId> sendChunkRequestMessage(const std::string& file_name, const std::vector<ChunkId>& chunk_ids);
+
+
     /**
      * @brief Monta a mensagem de descoberta (DISCOVERY) de um arquivo para envio.
      * 
@@ -167,9 +995,10 @@ public:
      * @param total_chunks Número total de chunks do arquivo.
      * @param ttl Time-to-live da mensagem DISCOVERY.
      * @param chunk_requester_info Informações sobre o peer que solicitou os chunks do arquivo, como seu endereço IP e porta UDP.
+     * @param range Intervalo de chunks de interesse. Só é incluído na mensagem quando não cobre o arquivo inteiro.
      * @return String contendo a mensagem DISCOVERY formatada.
      */
-    std::string buildChunkDiscoveryMessage(const std::string& file_name, int total_chunks, int ttl, const PeerInfo& chunk_requester_info) const;
+    std::string buildChunkDiscoveryMessage(const std::string& file_name, ChunkId total_chunks, int ttl, const PeerInfo& chunk_requester_info, const ChunkRange& range) const;
 
 
     /**
@@ -182,7 +1011,7 @@ public:
      * @param chunks_available Vetor com os IDs dos chunks disponíveis.
      * @return String contendo a mensagem RESPONSE formatada.
      */
-    std::string buildChunkResponseMessage(const std::string& file_name, const std::vector<int>& chunks_available) const;
+    std::string buildChunkResponseMessage(const std::string& file_name, const std::vector<ChunkId>& chunks_available) const;
 
 
     /**
@@ -194,19 +1023,32 @@ public:
      * @param chunks Lista de IDs dos chunks que estão sendo solicitados.
      * @return A string contendo a mensagem REQUEST montada.
      */
-    std::string buildChunkRequestMessage(const std::string& file_name, const std::vector<int>& chunks) const;
+    std::string buildChunkRequestMessage(const std::string& file_name, const std::vector<ChunkId>& chunks) const;
+
+
+    /**
+     * @brief Monta as mensagens de anúncio (HAVE) de chunks novos de um arquivo.
+     * 
+     * Os chunks são divididos em quantas mensagens forem necessárias para que nenhuma passe de
+     * Constants::CONTROL_MESSAGE_MAX_SIZE bytes.
+     * 
+     * @param file_name Nome do arquivo.
+     * @param chunks Chunks a serem anunciados.
+     * @return Mensagens HAVE formatadas.
+     */
+    std::vector<std::string> buildChunkHaveMessages(const std::string& file_name, const std::vector<ChunkId>& chunks) const;
 
 
     /**
      * @brief Processa uma mensagem recebida de outro peer.
      * 
-     * A mensagem recebida será analisada e processada em uma nova thread para 
-     * melhorar o desempenho e permitir a recepção simultânea de várias mensagens.
+     * A mensagem recebida será analisada e processada em uma corrotina própria para 
+     * permitir o processamento simultâneo de várias mensagens sem criar threads.
      * 
-     * @param message A mensagem recebida.
+     * @param message Buffer com a mensagem recebida.
      * @param direct_sender_info Informações sobre o peer que enviou diretamente a mensagem, incluindo seu endereço IP e porta UDP.
      */
-    void processMessage(const std::string& message, const PeerInfo& direct_sender_info);
+    Task<void> processMessage(BufferPool::Buffer message, PeerInfo direct_sender_info);
 
 
     /**
@@ -216,12 +1058,30 @@ public:
      * por peers que estão buscando um arquivo na rede. A função extrai as informações 
      * da mensagem, verifica se o peer atual possui os chunks do arquivo solicitado e, 
      * caso positivo, envia uma resposta. Caso o TTL (Time-to-Live) ainda esteja válido, 
-     * a mensagem é propagada para os vizinhos.
+     * a mensagem é propagada para os vizinhos. Com super-peers, a mensagem não é propagada
+     * pelos vizinhos: um super-peer responde também pelas suas folhas e, se a busca veio de uma
+     * folha, a repassa aos outros super-peers. Sem super-peers, a mensagem também não é propagada
+     * se o cache de respostas cobrir todos os chunks de interesse ou se a busca for atendida por
+     * outra em andamento (ver coalesceQuery). Cópias de uma busca já processada são descartadas.
      * 
      * @param message Stream com os dados da mensagem DISCOVERY.
      * @param direct_sender_info Informações sobre o peer que enviou diretamente a mensagem, incluindo seu endereço IP e porta UDP.
      */
-    void processChunkDiscoveryMessage(std::stringstream& message, const PeerInfo& direct_sender_info);
+    Task<void> processChunkDiscoveryMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+
+    /**
+     * @brief Processa uma busca recebida pelo grupo multicast (MDISCOVERY).
+     * 
+     * A mensagem tem os campos da DISCOVERY com TTL 0. Antes de respondê-la, o peer espera um
+     * atraso aleatório de até Constants::MULTICAST_RESPONSE_MAX_BACKOFF_MS, para que as respostas
+     * de todos os peers do grupo não cheguem ao solicitante ao mesmo tempo. A própria busca,
+     * recebida de volta pelo loopback, é ignorada.
+     * 
+     * @param message Stream com os dados da mensagem, após o comando.
+     * @param direct_sender_info Peer que enviou a busca (IP e porta UDP).
+     */
+    Task<void> processMulticastDiscoveryMessage(std::istream& message, const PeerInfo& direct_sender_info);
 
 
     /**
@@ -234,7 +1094,20 @@ public:
      * @param message Stream com os dados da mensagem RESPONSE.
      * @param direct_sender_info Informações sobre o peer que enviou diretamente a mensagem, incluindo seu endereço IP e porta UDP.
      */
-    void processChunkResponseMessage(std::stringstream& message, const PeerInfo& direct_sender_info);
+    void processChunkResponseMessage(std::istream& message, const PeerInfo& direct_sender_info);
+
+
+    /**
+     * @brief Processa um anúncio (HAVE) de chunks que outro peer acabou de obter.
+     * 
+     * Atualiza a localização dos chunks, mesmo depois de encerrado o processamento de RESPONSE.
+     * Em downloads feitos de uma vez, os chunks anunciados que ainda não foram pedidos (porque
+     * ninguém os tinha na descoberta) são pedidos imediatamente.
+     * 
+     * @param message Stream com os dados da mensagem HAVE.
+     * @param direct_sender_info Informações sobre o peer que enviou o anúncio, incluindo seu endereço IP e porta UDP.
+     */
+    void processChunkHaveMessage(std::istream& message, const PeerInfo& direct_sender_info);
 
 
     /**
@@ -246,15 +1119,19 @@ public:
      * @param message Stream com os dados da mensagem de requisição.
      * @param direct_sender_info Informações sobre o peer que enviou a requisição, incluindo seu endereço IP e porta UDP.
      */
-    void processChunkRequestMessage(std::stringstream& message, const PeerInfo& direct_sender_info);
+    Task<void> processChunkRequestMessage(std::istream& message, const PeerInfo& direct_sender_info);
 
 
     /**
      * @brief Espera por um tempo determinado pelas respostas e então desativa o processamento de respostas para o arquivo.
      * 
+     * A espera é feita com um timer do EventLoop, sem bloquear a thread. As buscas por passeios
+     * aleatórios do arquivo também são encerradas, e a busca local do arquivo é marcada como
+     * respondida na tabela de buscas em andamento, para que uma nova busca não seja agrupada a ela.
+     * 
      * @param file_name Nome do arquivo para o qual as respostas serão aguardadas.
      */
-    void waitForResponses(const std::string& file_name);
+    Task<void> waitForResponses(std::string file_name);
 };
 
 #endif // UDPSERVER_H
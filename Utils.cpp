@@ -1,7 +1,11 @@
 #include "Utils.h"
+#include <algorithm>
 #include <mutex>
 #include <arpa/inet.h>
+#include <charconv>
 #include <cstring>
+#include <iomanip>
+#include <sstream>
 
 
 //< Mutex para proteger a saída do console
@@ -34,6 +38,12 @@ void logMessage(LogType type, const std::string& message) {
         case LogType::RESPONSE_SENT:
             std::cout << Constants::GRAY << "[RESPONSE_SENT] " << message;
             break;
+        case LogType::HAVE_RECEIVED:
+            std::cout << Constants::PURPLE << "[HAVE_RECEIVED] " << message;
+            break;
+        case LogType::HAVE_SENT:
+            std::cout << Constants::PURPLE << "[HAVE_SENT] " << message;
+            break;
         case LogType::REQUEST_RECEIVED:
             std::cout << Constants::ORANGE << "[REQUEST_RECEIVED] " << message;
             break;
@@ -116,3 +126,123 @@ struct sockaddr_in createSockAddr(const std::string& ip, int port) {
 
     return addr; // Retorna a estrutura configurada
 }
+
+
+/**
+ * @brief Atualiza incrementalmente o hash (FNV-1a de 64 bits) de um chunk.
+ */
+std::uint64_t updateChunkHash(std::uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL; // Primo FNV de 64 bits
+    }
+    return hash;
+}
+
+
+/**
+ * @brief Formata o hash de um chunk como texto hexadecimal de tamanho fixo.
+ */
+std::string formatChunkHash(std::uint64_t hash) {
+    std::stringstream ss;
+    ss << std::hex << std::setw(Constants::CHUNK_HASH_TRAILER_SIZE) << std::setfill('0') << hash;
+    return ss.str();
+}
+
+
+/**
+ * @brief Separa um pedido de download parcial no formato "<nome>@<offset>+<tamanho>".
+ */
+bool parseByteRangeSpec(const std::string& spec, std::string& file_name, ByteCount& offset, ByteCount& length) {
+    std::size_t at_pos = spec.rfind('@');
+    std::size_t plus_pos = spec.find('+', at_pos == std::string::npos ? 0 : at_pos);
+    file_name = spec;
+    if (at_pos == std::string::npos || plus_pos == std::string::npos) {
+        return false;
+    }
+
+    const char* offset_begin = spec.data() + at_pos + 1;
+    const char* offset_end = spec.data() + plus_pos;
+    const char* length_end = spec.data() + spec.size();
+    auto offset_result = std::from_chars(offset_begin, offset_end, offset);
+    auto length_result = std::from_chars(offset_end + 1, length_end, length);
+
+    if (offset_result.ec != std::errc() || offset_result.ptr != offset_end ||
+        length_result.ec != std::errc() || length_result.ptr != length_end || length == 0) {
+        return false;
+    }
+
+    file_name = spec.substr(0, at_pos);
+    return true;
+}
+
+
+/**
+ * @brief Separa um endereço no formato "<ip>:<porta>".
+ */
+bool parseAddress(const std::string& address, std::string& ip, int& port) {
+    std::size_t colon_pos = address.rfind(':');
+    if (colon_pos == std::string::npos || colon_pos == 0) {
+        return false;
+    }
+
+    auto result = std::from_chars(address.data() + colon_pos + 1, address.data() + address.size(), port);
+    if (result.ec != std::errc() || result.ptr != address.data() + address.size()) {
+        return false;
+    }
+
+    ip = address.substr(0, colon_pos);
+    return true;
+}
+
+
+/**
+ * @brief Comprime um conjunto de chunks em sequências contíguas (codificação por carreiras do bitmap).
+ */
+std::vector<ChunkRange> toChunkRuns(const std::vector<ChunkId>& chunks) {
+    std::vector<ChunkRange> runs;
+    for (const ChunkId chunk : chunks) {
+        if (!runs.empty() && runs.back().end == chunk) {
+            runs.back().end++;
+        } else {
+            runs.push_back(ChunkRange{chunk, chunk + 1});
+        }
+    }
+    return runs;
+}
+
+
+/**
+ * @brief Ordena sequências de chunks e junta as que se sobrepõem ou se tocam.
+ */
+std::vector<ChunkRange> mergeChunkRuns(std::vector<ChunkRange> runs) {
+    std::sort(runs.begin(), runs.end(), [](const ChunkRange& a, const ChunkRange& b) { return a.first < b.first; });
+
+    std::vector<ChunkRange> merged;
+    for (const ChunkRange& run : runs) {
+        if (run.size() == 0) {
+            continue;
+        }
+        if (!merged.empty() && run.first <= merged.back().end) {
+            merged.back().end = std::max(merged.back().end, run.end);
+        } else {
+            merged.push_back(run);
+        }
+    }
+    return merged;
+}
+
+
+/**
+ * @brief Recorta sequências de chunks em um intervalo, descartando as que ficam vazias.
+ */
+std::vector<ChunkRange> clipChunkRuns(const std::vector<ChunkRange>& runs, const ChunkRange& range) {
+    std::vector<ChunkRange> clipped_runs;
+    for (const ChunkRange& run : runs) {
+        ChunkRange clipped{std::max(run.first, range.first), std::min(run.end, range.end)};
+        if (clipped.size() > 0) {
+            clipped_runs.push_back(clipped);
+        }
+    }
+    return clipped_runs;
+}
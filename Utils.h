@@ -2,9 +2,11 @@
 #define UTILS_H
 
 #include "Constants.h"
+#include <cstdint>
 #include <iostream>
 #include <regex>
 #include <string>
+#include <vector>
 
 
 /**
@@ -19,6 +21,8 @@ enum class LogType {
     REQUEST_SENT,
     RESPONSE_RECEIVED,
     RESPONSE_SENT,
+    HAVE_RECEIVED,
+    HAVE_SENT,
     CHUNK_SENT,
     CHUNK_RECEIVED,
     SUCCESS,
@@ -26,6 +30,34 @@ enum class LogType {
 };
 
 
+/**
+ * @brief Índice de um chunk dentro de um arquivo (e número de chunks de um arquivo).
+ * 
+ * Usa 64 bits para permitir arquivos com mais de 2^31 chunks. Valores negativos indicam erro.
+ */
+using ChunkId = std::int64_t;
+
+
+/**
+ * @brief Quantidade de bytes: tamanhos, offsets e velocidades de transferência (bytes/segundo).
+ */
+using ByteCount = std::uint64_t;
+
+
+/**
+ * @brief Intervalo de chunks [first, end) de um arquivo.
+ * 
+ * Usado nos downloads parciais, que buscam apenas os chunks que contêm um trecho do arquivo.
+ */
+struct ChunkRange {
+    ChunkId first = 0;  ///< Primeiro chunk do intervalo.
+    ChunkId end = 0;    ///< Chunk seguinte ao último do intervalo.
+
+    bool contains(ChunkId chunk) const { return chunk >= first && chunk < end; }
+    ChunkId size() const { return end > first ? end - first : 0; }
+};
+
+
 /**
  * @brief Remove espaços em branco ao redor de uma string.
  * 
@@ -62,4 +94,78 @@ void displaySuccessMessage(const std::string& file_name, const std::string& peer
  */
 struct sockaddr_in createSockAddr(const std::string& ip, int port);
 
+
+/**
+ * @brief Atualiza incrementalmente o hash (FNV-1a de 64 bits) de um chunk.
+ * 
+ * Permite calcular o hash à medida que os dados chegam ou são lidos, sem manter o chunk
+ * inteiro em memória. O primeiro bloco deve usar Constants::CHUNK_HASH_INITIAL_VALUE.
+ * 
+ * @param hash Hash dos bytes anteriores.
+ * @param data Próximos bytes do chunk.
+ * @param size Número de bytes em data.
+ * @return Hash atualizado.
+ */
+std::uint64_t updateChunkHash(std::uint64_t hash, const char* data, size_t size);
+
+
+/**
+ * @brief Formata o hash de um chunk como texto hexadecimal de tamanho fixo.
+ * 
+ * @param hash Hash do chunk.
+ * @return Texto com Constants::CHUNK_HASH_TRAILER_SIZE dígitos hexadecimais.
+ */
+std::string formatChunkHash(std::uint64_t hash);
+
+
+/**
+ * @brief Separa um pedido de download parcial no formato "<nome>@<offset>+<tamanho>".
+ * 
+ * @param spec Texto informado na linha de comando.
+ * @param file_name Recebe o nome do arquivo (o próprio spec, se ele não contiver um trecho válido).
+ * @param offset Recebe a posição inicial do trecho em bytes.
+ * @param length Recebe o tamanho do trecho em bytes.
+ * @return true se spec contém um trecho válido, false se for apenas um nome de arquivo ou estiver mal formado.
+ */
+bool parseByteRangeSpec(const std::string& spec, std::string& file_name, ByteCount& offset, ByteCount& length);
+
+
+/**
+ * @brief Separa um endereço no formato "<ip>:<porta>".
+ * 
+ * @param address Endereço em texto.
+ * @param ip Recebe o endereço IP.
+ * @param port Recebe a porta.
+ * @return true se o endereço é válido, false caso contrário.
+ */
+bool parseAddress(const std::string& address, std::string& ip, int& port);
+
+
+/**
+ * @brief Comprime um conjunto de chunks em sequências contíguas (codificação por carreiras do bitmap).
+ * 
+ * @param chunks Chunks em ordem crescente e sem repetições.
+ * @return Intervalos [first, end) que cobrem exatamente os chunks informados.
+ */
+std::vector<ChunkRange> toChunkRuns(const std::vector<ChunkId>& chunks);
+
+
+/**
+ * @brief Ordena sequências de chunks e junta as que se sobrepõem ou se tocam.
+ * 
+ * @param runs Sequências em qualquer ordem.
+ * @return Sequências disjuntas em ordem crescente.
+ */
+std::vector<ChunkRange> mergeChunkRuns(std::vector<ChunkRange> runs);
+
+
+/**
+ * @brief Recorta sequências de chunks em um intervalo, descartando as que ficam vazias.
+ * 
+ * @param runs Sequências de chunks.
+ * @param range Intervalo de interesse.
+ * @return Partes das sequências dentro do intervalo.
+ */
+std::vector<ChunkRange> clipChunkRuns(const std::vector<ChunkRange>& runs, const ChunkRange& range);
+
 #endif // UTILS_H
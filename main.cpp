@@ -7,7 +7,7 @@
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        logMessage(LogType::ERROR, "Uso: " + std::string(argv[0]) + " <peer_id> <file_name_1> <file_name_2> ...");
+        logMessage(LogType::ERROR, "Uso: " + std::string(argv[0]) + " <peer_id> [--sequential] [--dht] [--walk] [--stream <pasta>] <file_name_1>[@<offset>+<tamanho>] <file_name_2> ...");
         return 1;
     }
 
@@ -20,9 +20,29 @@ int main(int argc, char* argv[]) {
     // Identifica o Peer
     int peer_id = std::stoi(argv[1]);
 
-    // Pega o nome dos arquivos
+    // Pega o nome dos arquivos e as opções de download sequencial, de busca pela DHT, de busca por passeios aleatórios e de leitura em streaming
     std::vector<std::string> file_names;
+    bool sequential = false;
+    bool dht = false;
+    bool walk = false;
+    std::string stream_dir;
     for (int i = 2; i < argc; ++i) {
+        if (std::string(argv[i]) == "--sequential") {
+            sequential = true;
+            continue;
+        }
+        if (std::string(argv[i]) == "--dht") {
+            dht = true;
+            continue;
+        }
+        if (std::string(argv[i]) == "--walk") {
+            walk = true;
+            continue;
+        }
+        if (std::string(argv[i]) == "--stream" && i + 1 < argc) {
+            stream_dir = argv[++i];
+            continue;
+        }
         file_names.push_back(argv[i]);
     }
 
@@ -32,13 +52,16 @@ int main(int argc, char* argv[]) {
     auto config = ConfigManager::loadConfig();
 
     // Verifica se o peer_id está na configuração
-    if (config.find(peer_id) == config.end()) {
+    std::size_t config_index = config.find(peer_id);
+    if (config_index == config.size()) {
         logMessage(LogType::ERROR, "Peer " + std::to_string(peer_id) + " não encontrado nas configurações.");
         return 1;
     }
 
     // Obtém as configurações do peer
-    auto [ip, udp_port, speed] = config[peer_id];
+    std::string ip(config.getIp(config_index));
+    int udp_port = config.udp_ports[config_index];
+    ByteCount speed = config.transfer_speeds[config_index];
     int tcp_port = udp_port + 1000; // Exemplo: porta TCP é a UDP + 1000
 
     // Mata os processos nas portas que serão utilizadas para comunicação TCP e UDP
@@ -51,22 +74,22 @@ int main(int argc, char* argv[]) {
     auto topology = ConfigManager::loadTopology();
 
     // Verifica se o peer_id está na configuração
-    if (topology.find(peer_id) == topology.end()) {
+    if (topology.find(peer_id) == topology.size()) {
         logMessage(LogType::ERROR, "Peer " + std::to_string(peer_id) + " não encontrado na topologia.");
         return 1;
     }
 
-    //  Expande ela para incluir informações dos vizinhos do peer
-    auto expand_topology = ConfigManager::expandTopology(topology, config);
-
-    // Pega os vizinhos do peer
-    auto neighbors = expand_topology[peer_id];
+    // Pega o IP e a porta UDP dos vizinhos do peer
+    auto neighbors = ConfigManager::expandNeighbors(topology, config, peer_id);
     
+    // Seleciona os super-peers pela velocidade de cada peer
+    auto super_peers = ConfigManager::selectSuperPeers(config);
+
     // Cria o peer
-    Peer peer(peer_id, ip, udp_port, tcp_port, speed, neighbors);
+    Peer peer(peer_id, ip, udp_port, tcp_port, speed, neighbors, super_peers);
 
     // Inicia o peer com os nomes dos arquivos que deseja buscar
-    peer.start(file_names);
+    peer.start(file_names, sequential, dht, walk, stream_dir);
 
     return 0;
 }
@@ -0,0 +1,92 @@
+#!/usr/bin/env bash
+#
+# Compara a leitura do config.txt e do topologia.txt (ConfigManager::loadConfig e loadTopology) pelo leitor atual
+# (mmap + std::from_chars, tabelas planas) com o leitor antigo (ifstream + stringstream, std::map).
+#
+# O p2p-generator gera uma rede com PEERS peers (padrão 1 milhão). Um pequeno programa que chama o ConfigManager é
+# compilado duas vezes, com -O2: com o ConfigManager.cpp e o Utils.cpp desta árvore e com os do commit OLD_REF
+# (padrão: o último com o leitor por ifstream). Cada leitura é executada RUNS vezes num processo novo.
+# Com 1 milhão de peers, o leitor antigo leva mais de um minuto por leitura do config.txt.
+#
+# Para cada leitor e arquivo são medidos:
+#   peers     peers lidos (linhas do arquivo)
+#   melhor_s  menor tempo de leitura entre as execuções
+#   mediana_s tempo mediano
+#   pico_mb   memória máxima do processo (ru_maxrss) na execução mais rápida
+#
+# Uso: scripts/bench_config_parser.sh
+# Variáveis: GENERATOR_BIN (binário, padrão ./p2p-generator), PEERS (padrão 1000000), SHAPE (padrão random-regular),
+#            DEGREE (padrão 8), RUNS (padrão 3), OLD_REF (commit do leitor antigo), CXX (padrão g++).
+
+set -u
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+GENERATOR_BIN="${GENERATOR_BIN:-$REPO_DIR/p2p-generator}"
+PEERS="${PEERS:-1000000}"
+SHAPE="${SHAPE:-random-regular}"
+DEGREE="${DEGREE:-8}"
+RUNS="${RUNS:-3}"
+OLD_REF="${OLD_REF:-$(git -C "$REPO_DIR" log -1 --format=%H -S"std::ifstream file(file_path)" -- ConfigManager.cpp)^}"
+CXX="${CXX:-g++}"
+
+if [ ! -x "$GENERATOR_BIN" ]; then
+    echo "Binário $GENERATOR_BIN não encontrado. Rode make generator antes." >&2
+    exit 1
+fi
+
+WORK_DIR="$(mktemp -d /tmp/p2p-config-bench.XXXXXX)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# Programa de medição: lê um dos arquivos e imprime os peers lidos, o tempo em segundos e o pico de memória em KiB.
+# Usa só a interface comum aos dois leitores (loadConfig() e loadTopology() sem argumentos, size()).
+cat > "$WORK_DIR/bench.cpp" <<'EOF'
+#include "ConfigManager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+
+int main(int argc, char* argv[]) {
+    bool topology = argc > 1 && std::strcmp(argv[1], "topology") == 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t peers = topology ? ConfigManager::loadTopology().size() : ConfigManager::loadConfig().size();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    std::printf("%zu %.3f %ld\n", peers, elapsed.count(), usage.ru_maxrss);
+    return 0;
+}
+EOF
+
+# Compila o programa de medição com o ConfigManager de uma pasta e imprime o caminho do binário
+build_parser() {
+    local source_dir=$1
+    "$CXX" -std=c++20 -O2 -I"$source_dir" -o "$source_dir/bench" "$WORK_DIR/bench.cpp" \
+        "$source_dir/ConfigManager.cpp" "$source_dir/Utils.cpp" > "$source_dir/build.log" 2>&1 || return 1
+    echo "$source_dir/bench"
+}
+
+mkdir -p "$WORK_DIR/atual" "$WORK_DIR/antigo"
+cp "$REPO_DIR"/*.cpp "$REPO_DIR"/*.h "$WORK_DIR/atual"
+if ! git -C "$REPO_DIR" archive "$OLD_REF" ConfigManager.cpp ConfigManager.h Utils.cpp Utils.h Constants.h | tar -x -C "$WORK_DIR/antigo"; then
+    echo "Não foi possível extrair o leitor antigo de $OLD_REF." >&2
+    exit 1
+fi
+
+"$GENERATOR_BIN" --shape "$SHAPE" --peers "$PEERS" --degree "$DEGREE" --peers-per-ip 50000 --files 0 \
+    --output "$WORK_DIR/src" > /dev/null || { echo "Falha ao gerar a rede com $PEERS peers." >&2; exit 1; }
+echo "Rede gerada: config.txt com $(du -h "$WORK_DIR/src/config.txt" | cut -f1), topologia.txt com $(du -h "$WORK_DIR/src/topologia.txt" | cut -f1)."
+
+printf "%-8s %-10s %-10s %-10s %-10s %s\n" leitor arquivo peers melhor_s mediana_s pico_mb
+for parser in atual antigo; do
+    binary=$(build_parser "$WORK_DIR/$parser") || { echo "Falha ao compilar o leitor $parser:" >&2; cat "$WORK_DIR/$parser/build.log" >&2; exit 1; }
+    for file in config topology; do
+        # Uma linha "peers segundos KiB" por execução, ordenadas pelo tempo
+        results=$(for ((run = 0; run < RUNS; ++run)); do (cd "$WORK_DIR" && "$binary" "$file"); done | sort -g -k2,2)
+        read -r peers best rss < <(echo "$results" | head -1)
+        median=$(echo "$results" | awk -v n="$RUNS" 'NR == int((n + 1) / 2) { print $2 }')
+        printf "%-8s %-10s %-10s %-10s %-10s %s\n" "$parser" "$file" "$peers" "$best" "$median" "$((rss / 1024))"
+    done
+done
@@ -0,0 +1,161 @@
+#!/usr/bin/env bash
+#
+# Compara a busca por inundação com a busca pela DHT (--dht).
+#
+# Para cada semente, o p2p-generator gera uma rede (SHAPE, padrão power-law) com um arquivo cujos chunks ficam
+# espalhados entre os peers. Todos os peers são executados nesta máquina. Os que não buscam nada sobem primeiro e
+# têm PUBLISH_SECONDS para entrar na DHT e publicar os seus arquivos; depois o peer de menor grau sem chunks busca
+# o arquivo, por inundação (com cada TTL de FLOOD_TTLS) e pela DHT.
+#
+# Para cada execução são medidos, a partir dos logs:
+#   descobertas  DISCOVERY enviados por todos os peers (na DHT, os enviados diretamente aos provedores)
+#   rpc_dht      mensagens da busca de provedores na DHT feita pela origem (FIND_PROVIDERS)
+#   mensagens    descobertas + rpc_dht
+#   respostas    RESPONSE enviados à origem
+#   provedores   provedores encontrados na DHT ("-" na inundação; 0 indica que a DHT caiu na inundação)
+#   tempo_ms     tempo entre o início da busca e a resposta que completou a localização de todos os chunks
+#   completo     se todos os chunks foram localizados e o arquivo foi montado
+# A manutenção da DHT (entrada, atualização da tabela e publicação) é feita por todos os peers nos dois modos; o
+# total de mensagens dessas buscas na execução aparece em rpc_manut, como referência do custo fixo da DHT.
+#
+# Cada peer é um processo com as suas threads, então o tamanho da rede é limitado pela máquina: algumas centenas
+# de peers por núcleo. Redes maiores (a comparação com 10 mil peers) exigem PEERS maior numa máquina com mais
+# núcleos e RUN_SECONDS e PUBLISH_SECONDS proporcionais.
+#
+# Uso: scripts/bench_dht_vs_flood.sh
+# Variáveis: P2P_BIN e GENERATOR_BIN (binários, padrão ./p2p e ./p2p-generator), SHAPE (padrão power-law),
+#            PEERS (padrão 50), DEGREE (padrão 4), CHUNKS (padrão 8), SEEDS (padrão "1 2 3"),
+#            FLOOD_TTLS (padrão "3 5"), BASE_PORT (padrão 6600), PUBLISH_SECONDS (padrão 20),
+#            RUN_SECONDS (duração de cada busca, padrão 40).
+# Atenção: o p2p mata os processos que estiverem usando as portas BASE_PORT..BASE_PORT+PEERS-1 e +1000.
+
+set -u
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+P2P_BIN="${P2P_BIN:-$REPO_DIR/p2p}"
+GENERATOR_BIN="${GENERATOR_BIN:-$REPO_DIR/p2p-generator}"
+SHAPE="${SHAPE:-power-law}"
+PEERS="${PEERS:-50}"
+DEGREE="${DEGREE:-4}"
+CHUNKS="${CHUNKS:-8}"
+SEEDS="${SEEDS:-1 2 3}"
+FLOOD_TTLS="${FLOOD_TTLS:-3 5}"
+BASE_PORT="${BASE_PORT:-6600}"
+PUBLISH_SECONDS="${PUBLISH_SECONDS:-20}"
+RUN_SECONDS="${RUN_SECONDS:-40}"
+FILE_NAME="arquivo0.bin"
+
+for binary in "$P2P_BIN" "$GENERATOR_BIN"; do
+    if [ ! -x "$binary" ]; then
+        echo "Binário $binary não encontrado. Rode make e make generator antes." >&2
+        exit 1
+    fi
+done
+
+PIDS=()
+cleanup_peers() {
+    for pid in "${PIDS[@]}"; do
+        kill -TERM "$pid" 2>/dev/null
+    done
+    sleep 1
+    for pid in "${PIDS[@]}"; do
+        kill -9 "$pid" 2>/dev/null
+        wait "$pid" 2>/dev/null
+    done
+    PIDS=()
+}
+trap cleanup_peers EXIT
+
+WORK_DIR="$(mktemp -d /tmp/p2p-dht-bench.XXXXXX)"
+
+# Escolhe o peer de menor grau que não tem nenhum chunk do arquivo
+pick_requester() {
+    local src_dir=$1
+    awk -F'[:,]' '{ print NF - 1, $1 }' "$src_dir/topologia.txt" | sort -n -k1,1 -k2,2 | while read -r _ peer; do
+        if ! ls "$src_dir/$peer"/"$FILE_NAME".ch* > /dev/null 2>&1; then
+            echo "$peer"
+            break
+        fi
+    done
+}
+
+# Executa uma busca e imprime uma linha da tabela de resultados
+run_search() {
+    local seed=$1 mode=$2 ttl=$3
+    local run_dir="$WORK_DIR/$seed-$mode-$ttl"
+    mkdir -p "$run_dir"
+
+    "$GENERATOR_BIN" --shape "$SHAPE" --peers "$PEERS" --degree "$DEGREE" --seed "$seed" --base-port "$BASE_PORT" \
+        --files 1 --chunks "$CHUNKS" --chunk-size 1000 --replicas 1 --ttl "${ttl/-/5}" --speed 100000 --output "$run_dir/src" > /dev/null
+    local requester
+    requester=$(pick_requester "$run_dir/src")
+
+    # Sem arquivos para buscar: os peers só atendem às buscas dos outros e mantêm a DHT
+    local peer
+    for ((peer = 0; peer < PEERS; ++peer)); do
+        if [ "$peer" != "$requester" ]; then
+            (cd "$run_dir" && exec "$P2P_BIN" "$peer" --sequential > "peer$peer.log" 2>&1) &
+            PIDS+=($!)
+        fi
+    done
+    sleep "$PUBLISH_SECONDS"
+
+    # Log da origem com o instante de cada linha, para medir o tempo até a localização dos chunks
+    local dht_option=""
+    if [ "$mode" = "dht" ]; then
+        dht_option="--dht"
+    fi
+    (cd "$run_dir" && exec "$P2P_BIN" "$requester" $dht_option "$FILE_NAME" \
+        > >(perl -MTime::HiRes=time -ne '$| = 1; printf "%.3f %s", time, $_' > "peer$requester.log") 2>&1) &
+    PIDS+=($!)
+
+    sleep "$RUN_SECONDS"
+    cleanup_peers
+
+    local requester_log="$run_dir/peer$requester.log"
+    local discoveries dht_rpcs responses providers maintenance located_ms complete
+    discoveries=$(cat "$run_dir"/peer*.log | grep -a -c "Mensagem de descoberta enviada")
+    responses=$(cat "$run_dir"/peer*.log | grep -a -c "RESPONSE_SENT")
+    dht_rpcs=$(grep -a -o "Busca na DHT (provedores de [^)]*): [0-9]* provedor(es), [0-9]* rodada(s), [0-9]* mensagem" "$requester_log" |
+        awk '{ sum += $(NF - 1) } END { print sum + 0 }')
+    providers="-"
+    if [ "$mode" = "dht" ]; then
+        providers=$(grep -a -o "Busca na DHT (provedores de [^)]*): [0-9]*" "$requester_log" | awk '{ print $NF }' | head -1)
+    fi
+    maintenance=$(cat "$run_dir"/peer*.log | grep -a -o "Busca na DHT ([^)]*): [0-9]* provedor(es), [0-9]* rodada(s), [0-9]* mensagem" |
+        grep -v "(provedores de " | awk '{ sum += $(NF - 1) } END { print sum + 0 }')
+
+    # A busca começa no primeiro DISCOVERY enviado ou, na DHT, no início da busca de provedores (duração descontada)
+    located_ms=$(sed 's/\x1b\[[0-9;]*m//g' "$requester_log" | awk -v total="$CHUNKS" '
+        start == 0 && /Busca na DHT \(provedores de / {
+            line = $0
+            sub(/ ms\..*/, "", line)
+            n = split(line, fields, " ")
+            start = $1 - fields[n] / 1000
+        }
+        start == 0 && /Mensagem de descoberta enviada/ { start = $1 }
+        start > 0 && found < total && /Recebida resposta do Peer/ {
+            now = $1
+            sub(/.*Chunks disponíveis: /, "")
+            for (i = 1; i <= NF; ++i) if (!($i in seen)) { seen[$i] = 1; found++ }
+            if (found == total) printf "%.0f", (now - start) * 1000
+        }')
+    complete="não"
+    if grep -a -q "montado com sucesso" "$requester_log"; then
+        complete="sim"
+    fi
+
+    printf "%-8s %-5s %-5s %-7s %-12s %-8s %-10s %-10s %-11s %-10s %-9s %s\n" "$seed" "$mode" "$ttl" "$requester" \
+        "$discoveries" "$dht_rpcs" "$((discoveries + dht_rpcs))" "$responses" "${providers:-0}" "$maintenance" "${located_ms:--}" "$complete"
+    rm -rf "$run_dir"
+}
+
+printf "%-8s %-5s %-5s %-7s %-12s %-8s %-10s %-10s %-11s %-10s %-9s %s\n" semente modo ttl origem descobertas rpc_dht mensagens \
+    respostas provedores rpc_manut tempo_ms completo
+for seed in $SEEDS; do
+    for ttl in $FLOOD_TTLS; do
+        run_search "$seed" flood "$ttl"
+    done
+    run_search "$seed" dht -
+done
+rmdir "$WORK_DIR"
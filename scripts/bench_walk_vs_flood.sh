@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+#
+# Compara a busca por inundação com a busca por passeios aleatórios (--walk) em topologias em lei de potência.
+#
+# Para cada semente, o p2p-generator gera uma rede power-law (Barabási-Albert) com um arquivo cujos chunks ficam
+# espalhados entre os peers. Todos os peers são executados nesta máquina, e o peer de menor grau sem chunks busca
+# o arquivo: por inundação, com cada TTL de FLOOD_TTLS, e por passeios aleatórios (Constants::WALK_WALKERS walkers).
+#
+# Para cada execução são medidos, a partir dos logs:
+#   consultas    DISCOVERY e WALK enviados por todos os peers
+#   checagens    WALK_CHECK enviados pelos walkers à origem (cada um gera no máximo um WALK_CONTINUE)
+#   respostas    RESPONSE enviados à origem
+#   alcance      peers que receberam a busca
+#   tempo_ms     tempo entre o início da busca e a resposta que completou a localização de todos os chunks
+#   completo     se todos os chunks foram localizados e o arquivo foi montado
+#
+# Uso: scripts/bench_walk_vs_flood.sh
+# Variáveis: P2P_BIN e GENERATOR_BIN (binários, padrão ./p2p e ./p2p-generator), PEERS (padrão 50),
+#            DEGREE (padrão 4), CHUNKS (padrão 8), SEEDS (padrão "1 2 3"), FLOOD_TTLS (padrão "2 3 5"),
+#            BASE_PORT (padrão 6200), RUN_SECONDS (duração de cada execução, padrão 45).
+# Atenção: o p2p mata os processos que estiverem usando as portas BASE_PORT..BASE_PORT+PEERS-1 e +1000.
+
+set -u
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+P2P_BIN="${P2P_BIN:-$REPO_DIR/p2p}"
+GENERATOR_BIN="${GENERATOR_BIN:-$REPO_DIR/p2p-generator}"
+PEERS="${PEERS:-50}"
+DEGREE="${DEGREE:-4}"
+CHUNKS="${CHUNKS:-8}"
+SEEDS="${SEEDS:-1 2 3}"
+FLOOD_TTLS="${FLOOD_TTLS:-2 3 5}"
+BASE_PORT="${BASE_PORT:-6200}"
+RUN_SECONDS="${RUN_SECONDS:-45}"
+FILE_NAME="arquivo0.bin"
+
+for binary in "$P2P_BIN" "$GENERATOR_BIN"; do
+    if [ ! -x "$binary" ]; then
+        echo "Binário $binary não encontrado. Rode make e make generator antes." >&2
+        exit 1
+    fi
+done
+
+PIDS=()
+cleanup_peers() {
+    for pid in "${PIDS[@]}"; do
+        kill -TERM "$pid" 2>/dev/null
+    done
+    sleep 1
+    for pid in "${PIDS[@]}"; do
+        kill -9 "$pid" 2>/dev/null
+        wait "$pid" 2>/dev/null
+    done
+    PIDS=()
+}
+trap cleanup_peers EXIT
+
+WORK_DIR="$(mktemp -d /tmp/p2p-walk-bench.XXXXXX)"
+
+# Escolhe o peer de menor grau que não tem nenhum chunk do arquivo
+pick_requester() {
+    local src_dir=$1
+    awk -F'[:,]' '{ print NF - 1, $1 }' "$src_dir/topologia.txt" | sort -n -k1,1 -k2,2 | while read -r _ peer; do
+        if ! ls "$src_dir/$peer"/"$FILE_NAME".ch* > /dev/null 2>&1; then
+            echo "$peer"
+            break
+        fi
+    done
+}
+
+# Executa uma busca e imprime uma linha da tabela de resultados
+run_search() {
+    local seed=$1 mode=$2 ttl=$3
+    local run_dir="$WORK_DIR/$seed-$mode-$ttl"
+    mkdir -p "$run_dir"
+
+    "$GENERATOR_BIN" --shape power-law --peers "$PEERS" --degree "$DEGREE" --seed "$seed" --base-port "$BASE_PORT" \
+        --files 1 --chunks "$CHUNKS" --chunk-size 1000 --replicas 1 --ttl "${ttl/-/5}" --speed 100000 --output "$run_dir/src" > /dev/null
+    local requester
+    requester=$(pick_requester "$run_dir/src")
+
+    local walk_option=""
+    if [ "$mode" = "walk" ]; then
+        walk_option="--walk"
+    fi
+
+    local peer
+    for ((peer = 0; peer < PEERS; ++peer)); do
+        if [ "$peer" = "$requester" ]; then
+            # Log da origem com o instante de cada linha, para medir o tempo até a localização dos chunks
+            (cd "$run_dir" && exec "$P2P_BIN" "$peer" $walk_option "$FILE_NAME" \
+                > >(perl -MTime::HiRes=time -ne '$| = 1; printf "%.3f %s", time, $_' > "peer$peer.log") 2>&1) &
+        else
+            # Sem arquivos para buscar: o peer só atende às buscas dos outros
+            (cd "$run_dir" && exec "$P2P_BIN" "$peer" --sequential > "peer$peer.log" 2>&1) &
+        fi
+        PIDS+=($!)
+    done
+
+    sleep "$RUN_SECONDS"
+    cleanup_peers
+
+    local queries checks responses reached located_ms complete
+    queries=$(cat "$run_dir"/peer*.log | grep -a -c -e "Mensagem de descoberta enviada" -e "Walker enviado")
+    checks=$(cat "$run_dir"/peer*.log | grep -a -o "Recebido walker do arquivo '[^']*' ([0-9]* saltos)" |
+        awk -F'[( ]' '{ hops = $(NF - 1); if (hops % 4 == 0 && hops < 64) count++ } END { print count + 0 }')
+    responses=$(cat "$run_dir"/peer*.log | grep -a -c "RESPONSE_SENT")
+    reached=$(grep -a -l -e "Recebido pedido de descoberta do arquivo" -e "Recebido walker do arquivo" "$run_dir"/peer*.log | grep -v -c "/peer$requester.log$")
+    located_ms=$(sed 's/\x1b\[[0-9;]*m//g' "$run_dir/peer$requester.log" | awk -v total="$CHUNKS" '
+        start == 0 && (/Busca por passeios aleatórios de .* iniciada/ || /Mensagem de descoberta enviada/) { start = $1 }
+        start > 0 && found < total && /Recebida resposta do Peer/ {
+            now = $1
+            sub(/.*Chunks disponíveis: /, "")
+            for (i = 1; i <= NF; ++i) if (!($i in seen)) { seen[$i] = 1; found++ }
+            if (found == total) printf "%.0f", (now - start) * 1000
+        }')
+    complete="não"
+    if grep -a -q "montado com sucesso" "$run_dir/peer$requester.log"; then
+        complete="sim"
+    fi
+
+    printf "%-6s %-6s %-5s %-10s %-10s %-10s %-10s %-8s %-10s %s\n" "$seed" "$mode" "$ttl" "$requester" \
+        "$queries" "$checks" "$responses" "$reached" "${located_ms:--}" "$complete"
+    rm -rf "$run_dir"
+}
+
+printf "%-6s %-6s %-5s %-10s %-10s %-10s %-10s %-8s %-10s %s\n" semente modo ttl origem consultas checagens respostas alcance tempo_ms completo
+for seed in $SEEDS; do
+    for ttl in $FLOOD_TTLS; do
+        run_search "$seed" flood "$ttl"
+    done
+    run_search "$seed" walk -
+done
+rmdir "$WORK_DIR"
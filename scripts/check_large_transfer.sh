@@ -0,0 +1,194 @@
+#!/usr/bin/env bash
+#
+# Verifica a transferência de um arquivo com offsets acima de 4 GiB pelo caminho TCP e pelo transporte local.
+#
+# Cada execução sobe três peers numa pasta temporária:
+#   - Peer 1 tem os dois chunks de big.bin. O chunk 0 tem 4 GiB + 1 MiB + 512 bytes (esparso, com blocos aleatórios no início,
+#     em torno de 2^32 e no fim), então o chunk 1 começa depois de 2^32.
+#   - Peer 0 baixa o arquivo inteiro e o monta.
+#   - Peer 2 baixa só um trecho dentro do chunk 1, gravado no arquivo de saída num offset acima de 4 GiB.
+# A velocidade de transferência dos peers também passa de 2^32 bytes/s.
+#
+# O caminho TCP é forçado com XDG_RUNTIME_DIR inválido (o transporte local fica desabilitado). O transporte local
+# vem desligado por padrão (Constants::LOCAL_TRANSPORT_ENABLED): o modo local compila o p2p numa cópia da árvore
+# com ele ligado e usa uma pasta de runtime própria da execução.
+#
+# Uso: scripts/check_large_transfer.sh [tcp|local|all]
+# Variáveis: P2P_BIN (binário do modo tcp, padrão ./p2p), BASE_PORT (porta UDP do peer 0, padrão 6100),
+#            WORK_DIR (pasta temporária, precisa de ~9 GiB livres), TIMEOUT_SECONDS (padrão 900).
+# Atenção: o p2p mata os processos que estiverem usando as portas BASE_PORT..BASE_PORT+2 e +1000.
+
+set -u
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+P2P_BIN="${P2P_BIN:-$REPO_DIR/p2p}"
+BASE_PORT="${BASE_PORT:-6100}"
+TIMEOUT_SECONDS="${TIMEOUT_SECONDS:-900}"
+MODES="${1:-all}"
+
+GIB=$((1024 * 1024 * 1024))
+MIB=$((1024 * 1024))
+CHUNK_SIZE=$((4 * GIB + MIB + 512))
+LAST_CHUNK_SIZE=$MIB
+FILE_SIZE=$((CHUNK_SIZE + LAST_CHUNK_SIZE))
+SPEED=$((5 * GIB))
+RANGE_OFFSET=$((CHUNK_SIZE + 100))
+RANGE_LENGTH=1000
+
+if [ "$MODES" = "all" ]; then
+    MODES="tcp local"
+fi
+
+if [ ! -x "$P2P_BIN" ]; then
+    echo "Binário $P2P_BIN não encontrado. Rode make antes." >&2
+    exit 1
+fi
+
+PIDS=()
+cleanup_peers() {
+    for pid in "${PIDS[@]}"; do
+        kill -TERM "$pid" 2>/dev/null
+    done
+    sleep 1
+    for pid in "${PIDS[@]}"; do
+        kill -9 "$pid" 2>/dev/null
+        wait "$pid" 2>/dev/null
+    done
+    PIDS=()
+}
+trap cleanup_peers EXIT
+
+# Compila o p2p com o transporte local ligado e imprime o caminho do binário
+build_local_variant() {
+    local build_dir="$BASE_WORK_DIR/build-local"
+    mkdir -p "$build_dir"
+    cp "$REPO_DIR"/*.cpp "$REPO_DIR"/*.h "$REPO_DIR"/Makefile "$build_dir"
+    sed -i "s/\(LOCAL_TRANSPORT_ENABLED *= *\)false/\1true/" "$build_dir/Constants.h"
+    make -C "$build_dir" -j"$(nproc)" > "$build_dir/build.log" 2>&1 || return 1
+    echo "$build_dir/p2p"
+}
+
+# Grava 1 MiB aleatório no offset informado de um arquivo, sem truncá-lo
+write_random_block() {
+    dd if=/dev/urandom of="$1" bs=$MIB count=1 seek="$2" oflag=seek_bytes conv=notrunc status=none
+}
+
+# Espera uma linha no log de um peer, até o prazo da execução
+wait_for_log() {
+    local log_file=$1 pattern=$2 deadline=$3
+    while [ "$(date +%s)" -lt "$deadline" ]; do
+        if grep -q "$pattern" "$log_file" 2>/dev/null; then
+            return 0
+        fi
+        sleep 2
+    done
+    return 1
+}
+
+run_check() {
+    local mode=$1
+    local work_dir="$BASE_WORK_DIR/$mode"
+    mkdir -p "$work_dir/src/0" "$work_dir/src/1" "$work_dir/src/2" "$work_dir/run"
+    chmod 700 "$work_dir/run"
+
+    local runtime_dir="$work_dir/run" binary="$P2P_BIN"
+    if [ "$mode" = "tcp" ]; then
+        runtime_dir="/nonexistent"
+    else
+        binary=$(build_local_variant) || { echo "[$mode] FALHA: não foi possível compilar o p2p com o transporte local, veja $BASE_WORK_DIR/build-local/build.log" >&2; return 1; }
+    fi
+
+    cat > "$work_dir/src/config.txt" <<EOF
+0: 127.0.0.1, $BASE_PORT, $SPEED
+1: 127.0.0.1, $((BASE_PORT + 1)), $SPEED
+2: 127.0.0.1, $((BASE_PORT + 2)), $SPEED
+EOF
+    cat > "$work_dir/src/topologia.txt" <<EOF
+0: 1
+1: 0, 2
+2: 1
+EOF
+    printf 'big.bin\n2\n1\n%s\n' "$CHUNK_SIZE" > "$work_dir/src/big.bin.p2p"
+
+    local chunk0="$work_dir/src/1/big.bin.ch0" chunk1="$work_dir/src/1/big.bin.ch1"
+    truncate -s "$CHUNK_SIZE" "$chunk0"
+    write_random_block "$chunk0" 0
+    write_random_block "$chunk0" $((4 * GIB - MIB / 2))
+    write_random_block "$chunk0" $((CHUNK_SIZE - MIB))
+    head -c "$LAST_CHUNK_SIZE" /dev/urandom > "$chunk1"
+
+    echo "[$mode] Pasta de trabalho: $work_dir"
+    local start
+    start=$(date +%s)
+    (cd "$work_dir" && XDG_RUNTIME_DIR="$runtime_dir" exec "$binary" 1 --sequential > peer1.log 2>&1) &
+    PIDS+=($!)
+    (cd "$work_dir" && XDG_RUNTIME_DIR="$runtime_dir" exec "$binary" 0 big.bin > peer0.log 2>&1) &
+    PIDS+=($!)
+    (cd "$work_dir" && XDG_RUNTIME_DIR="$runtime_dir" exec "$binary" 2 "big.bin@$RANGE_OFFSET+$RANGE_LENGTH" > peer2.log 2>&1) &
+    PIDS+=($!)
+
+    local deadline=$((start + TIMEOUT_SECONDS)) failed=0
+    if ! wait_for_log "$work_dir/peer2.log" "gravados em" "$deadline"; then
+        echo "[$mode] FALHA: peer 2 não gravou o trecho pedido em ${TIMEOUT_SECONDS}s." >&2
+        failed=1
+    fi
+    if ! wait_for_log "$work_dir/peer0.log" "montado com sucesso" "$deadline"; then
+        echo "[$mode] FALHA: peer 0 não montou big.bin em ${TIMEOUT_SECONDS}s." >&2
+        failed=1
+    fi
+    local elapsed=$(($(date +%s) - start))
+    cleanup_peers
+
+    # Confirma o transporte usado pelo chunk grande
+    if [ "$failed" -eq 0 ]; then
+        if [ "$mode" = "local" ] && ! grep -q "CHUNK 0 DO ARQUIVO big.bin pelo transporte local" "$work_dir/peer0.log"; then
+            echo "[$mode] FALHA: o chunk 0 não chegou pelo transporte local." >&2
+            failed=1
+        fi
+        if [ "$mode" = "tcp" ] && ! grep -q "CHUNK 0 DO ARQUIVO big.bin de 127.0.0.1" "$work_dir/peer0.log"; then
+            echo "[$mode] FALHA: o chunk 0 não chegou pelo TCP." >&2
+            failed=1
+        fi
+    fi
+
+    # Arquivo inteiro: tamanho e hash iguais aos dos chunks concatenados
+    if [ "$failed" -eq 0 ]; then
+        local assembled="$work_dir/src/0/big.bin"
+        local expected_hash assembled_hash
+        expected_hash=$(cat "$chunk0" "$chunk1" | sha256sum | cut -d' ' -f1)
+        assembled_hash=$(sha256sum < "$assembled" | cut -d' ' -f1)
+        if [ "$(stat -c %s "$assembled")" -ne "$FILE_SIZE" ] || [ "$expected_hash" != "$assembled_hash" ]; then
+            echo "[$mode] FALHA: big.bin montado pelo peer 0 difere do original." >&2
+            failed=1
+        fi
+    fi
+
+    # Download parcial: o chunk 1 inteiro gravado a partir de CHUNK_SIZE (> 2^32)
+    if [ "$failed" -eq 0 ]; then
+        local partial="$work_dir/src/2/big.bin"
+        if [ "$(stat -c %s "$partial")" -ne "$FILE_SIZE" ] || ! cmp -s -i "$CHUNK_SIZE:0" -n "$LAST_CHUNK_SIZE" "$partial" "$chunk1"; then
+            echo "[$mode] FALHA: trecho gravado pelo peer 2 difere do chunk 1." >&2
+            failed=1
+        fi
+    fi
+
+    if [ "$failed" -eq 0 ]; then
+        echo "[$mode] OK: $FILE_SIZE bytes montados e trecho em $RANGE_OFFSET conferido em ${elapsed}s."
+        rm -rf "$work_dir"
+    else
+        echo "[$mode] Logs mantidos em $work_dir" >&2
+        rm -f "$work_dir"/src/*/big.bin*
+    fi
+    return "$failed"
+}
+
+BASE_WORK_DIR="${WORK_DIR:-$(mktemp -d /var/tmp/p2p-large.XXXXXX)}"
+status=0
+for mode in $MODES; do
+    run_check "$mode" || status=1
+done
+if [ "$status" -eq 0 ]; then
+    rm -rf "$BASE_WORK_DIR/build-local"
+    rmdir "$BASE_WORK_DIR" 2>/dev/null
+fi
+exit "$status"
@@ -0,0 +1,148 @@
+#!/usr/bin/env bash
+#
+# Verifica a leitura de um arquivo enquanto ele é baixado (--stream, Peer::readFileRange).
+#
+# Três peers numa pasta temporária, todos via TCP (XDG_RUNTIME_DIR inválido desabilita o transporte local, que
+# não respeita a velocidade de transferência):
+#   - Peer 1 tem os CHUNKS chunks de stream.bin e os envia a SPEED bytes/s.
+#   - Peer 0 baixa o arquivo inteiro em ordem (--sequential) e o grava em streaming em out0/stream.bin.
+#   - Peer 2 baixa só um trecho no meio do arquivo e o grava em streaming em out2/stream.bin.
+#
+# Confere que as saídas em streaming são iguais ao arquivo (e ao trecho) original e que os primeiros bytes do
+# peer 0 ficaram disponíveis antes de o arquivo ser montado.
+#
+# Uso: scripts/check_stream_read.sh
+# Variáveis: P2P_BIN (binário, padrão ./p2p), BASE_PORT (porta UDP do peer 0, padrão 6150), CHUNKS (padrão 16),
+#            CHUNK_SIZE (padrão 1 MiB), SPEED (padrão 2 MiB/s), TIMEOUT_SECONDS (padrão 120).
+# Atenção: o p2p mata os processos que estiverem usando as portas BASE_PORT..BASE_PORT+2 e +1000.
+
+set -u
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+P2P_BIN="${P2P_BIN:-$REPO_DIR/p2p}"
+BASE_PORT="${BASE_PORT:-6150}"
+CHUNKS="${CHUNKS:-16}"
+CHUNK_SIZE="${CHUNK_SIZE:-$((1024 * 1024))}"
+SPEED="${SPEED:-$((2 * 1024 * 1024))}"
+TIMEOUT_SECONDS="${TIMEOUT_SECONDS:-120}"
+RANGE_OFFSET=$((CHUNK_SIZE * 5 + 12345))
+RANGE_LENGTH=$((CHUNK_SIZE * 3))
+
+if [ ! -x "$P2P_BIN" ]; then
+    echo "Binário $P2P_BIN não encontrado. Rode make antes." >&2
+    exit 1
+fi
+
+PIDS=()
+cleanup_peers() {
+    for pid in "${PIDS[@]}"; do
+        kill -TERM "$pid" 2>/dev/null
+    done
+    sleep 1
+    for pid in "${PIDS[@]}"; do
+        kill -9 "$pid" 2>/dev/null
+        wait "$pid" 2>/dev/null
+    done
+    PIDS=()
+}
+trap cleanup_peers EXIT
+
+# Espera uma linha no log de um peer, até o prazo da execução
+wait_for_log() {
+    local log_file=$1 pattern=$2 deadline=$3
+    while [ "$(date +%s)" -lt "$deadline" ]; do
+        if grep -a -q "$pattern" "$log_file" 2>/dev/null; then
+            return 0
+        fi
+        sleep 1
+    done
+    return 1
+}
+
+# Instante (segundos, do log com horário) da primeira linha com o padrão
+log_time() {
+    grep -a -m1 "$2" "$1" | cut -d' ' -f1
+}
+
+WORK_DIR="$(mktemp -d /tmp/p2p-stream.XXXXXX)"
+mkdir -p "$WORK_DIR/src/0" "$WORK_DIR/src/1" "$WORK_DIR/src/2" "$WORK_DIR/out0" "$WORK_DIR/out2"
+
+cat > "$WORK_DIR/src/config.txt" <<EOF
+0: 127.0.0.1, $BASE_PORT, $SPEED
+1: 127.0.0.1, $((BASE_PORT + 1)), $SPEED
+2: 127.0.0.1, $((BASE_PORT + 2)), $SPEED
+EOF
+cat > "$WORK_DIR/src/topologia.txt" <<EOF
+0: 1
+1: 0, 2
+2: 1
+EOF
+printf 'stream.bin\n%s\n2\n%s\n' "$CHUNKS" "$CHUNK_SIZE" > "$WORK_DIR/src/stream.bin.p2p"
+for ((chunk = 0; chunk < CHUNKS; ++chunk)); do
+    head -c "$CHUNK_SIZE" /dev/urandom > "$WORK_DIR/src/1/stream.bin.ch$chunk"
+done
+for ((chunk = 0; chunk < CHUNKS; ++chunk)); do
+    cat "$WORK_DIR/src/1/stream.bin.ch$chunk"
+done > "$WORK_DIR/original.bin"
+
+start=$(date +%s)
+(cd "$WORK_DIR" && XDG_RUNTIME_DIR=/nonexistent exec "$P2P_BIN" 1 --sequential > peer1.log 2>&1) &
+PIDS+=($!)
+# Log do peer 0 com o instante de cada linha, para comparar a leitura em streaming com a montagem do arquivo
+(cd "$WORK_DIR" && XDG_RUNTIME_DIR=/nonexistent exec "$P2P_BIN" 0 --sequential --stream out0 stream.bin \
+    > >(perl -MTime::HiRes=time -ne '$| = 1; printf "%.3f %s", time, $_' > peer0.log) 2>&1) &
+PIDS+=($!)
+(cd "$WORK_DIR" && XDG_RUNTIME_DIR=/nonexistent exec "$P2P_BIN" 2 --stream out2 "stream.bin@$RANGE_OFFSET+$RANGE_LENGTH" > peer2.log 2>&1) &
+PIDS+=($!)
+
+deadline=$((start + TIMEOUT_SECONDS)) failed=0
+for log_file in peer0.log peer2.log; do
+    if ! wait_for_log "$WORK_DIR/$log_file" "Leitura em streaming de stream.bin encerrada" "$deadline"; then
+        echo "FALHA: a leitura em streaming de $log_file não terminou em ${TIMEOUT_SECONDS}s." >&2
+        failed=1
+    fi
+done
+if ! wait_for_log "$WORK_DIR/peer0.log" "montado com sucesso" "$deadline"; then
+    echo "FALHA: peer 0 não montou stream.bin em ${TIMEOUT_SECONDS}s." >&2
+    failed=1
+fi
+cleanup_peers
+
+# Arquivo inteiro lido em streaming pelo peer 0
+if [ "$failed" -eq 0 ] && ! cmp -s "$WORK_DIR/out0/stream.bin" "$WORK_DIR/original.bin"; then
+    echo "FALHA: a saída em streaming do peer 0 difere do arquivo original." >&2
+    failed=1
+fi
+
+# Trecho lido em streaming pelo peer 2
+if [ "$failed" -eq 0 ] && ! cmp -s -n "$RANGE_LENGTH" "$WORK_DIR/out2/stream.bin" <(tail -c +$((RANGE_OFFSET + 1)) "$WORK_DIR/original.bin"); then
+    echo "FALHA: a saída em streaming do peer 2 difere do trecho em $RANGE_OFFSET." >&2
+    failed=1
+fi
+if [ "$failed" -eq 0 ] && [ "$(stat -c %s "$WORK_DIR/out2/stream.bin")" -ne "$RANGE_LENGTH" ]; then
+    echo "FALHA: a saída em streaming do peer 2 não tem $RANGE_LENGTH bytes." >&2
+    failed=1
+fi
+
+# Os primeiros bytes precisam estar disponíveis antes do fim do download
+if [ "$failed" -eq 0 ]; then
+    search_start=$(log_time "$WORK_DIR/peer0.log" "Download sequencial de stream.bin iniciado")
+    first_bytes=$(log_time "$WORK_DIR/peer0.log" "primeiros .* bytes disponíveis")
+    assembled=$(log_time "$WORK_DIR/peer0.log" "montado com sucesso")
+    first_ms=$(awk -v a="$search_start" -v b="$first_bytes" 'BEGIN { printf "%.0f", (b - a) * 1000 }')
+    assembled_ms=$(awk -v a="$search_start" -v b="$assembled" 'BEGIN { printf "%.0f", (b - a) * 1000 }')
+    if [ "$first_ms" -ge "$assembled_ms" ]; then
+        echo "FALHA: os primeiros bytes ($first_ms ms) só ficaram disponíveis com o arquivo montado ($assembled_ms ms)." >&2
+        failed=1
+    else
+        echo "Primeiros bytes lidos ${first_ms} ms após o início do download; arquivo montado em ${assembled_ms} ms."
+    fi
+fi
+
+if [ "$failed" -eq 0 ]; then
+    echo "OK: $((CHUNKS * CHUNK_SIZE)) bytes e o trecho de $RANGE_LENGTH bytes em $RANGE_OFFSET lidos em streaming."
+    rm -rf "$WORK_DIR"
+else
+    echo "Logs mantidos em $WORK_DIR" >&2
+fi
+exit "$failed"
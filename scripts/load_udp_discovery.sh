@@ -0,0 +1,173 @@
+#!/usr/bin/env bash
+#
+# Teste de carga do recebimento UDP: mede quantas DISCOVERY por segundo um peer atende (com a RESPONSE enviada)
+# para cada número de sockets de recebimento (Constants::UDP_RECEIVER_SHARDS).
+#
+# Para cada valor de SHARDS, o p2p é compilado numa cópia da árvore com UDP_RECEIVER_SHARDS trocado, e um único
+# peer com o arquivo carga.bin é executado. Um gerador em Python mantém WINDOW buscas em andamento, enviadas de
+# SENDERS sockets (portas de origem diferentes, para que o SO_REUSEPORT as distribua entre os sockets do peer).
+# Cada busca tem TTL 0, para não ser repassada, e um solicitante diferente (127.x.y.z na mesma porta), para não
+# ser agrupada com as anteriores: todas as respostas chegam ao mesmo socket do gerador, que as conta.
+#
+# A vazão (respostas por segundo) é medida depois de WARMUP_SECONDS. Buscas sem resposta em 1 s são perdidas.
+# O gerador ocupa um núcleo: a escala com os shards só aparece com núcleos livres para o peer. Com menos núcleos,
+# a vazão mede sobretudo a fatia de CPU que o peer recebe do escalonador; o tempo de CPU do peer por resposta
+# (us/resposta, usuário + sistema durante a carga) mostra o custo de cada mensagem independentemente disso.
+#
+# Uso: scripts/load_udp_discovery.sh
+# Variáveis: SHARDS (padrão "1 2 4"), SENDERS (padrão 64), WINDOW (padrão 256), DURATION_SECONDS (padrão 20),
+#            WARMUP_SECONDS (padrão 5), BASE_PORT (porta UDP do peer, padrão 6400; o gerador usa BASE_PORT + 2).
+# Atenção: o p2p mata os processos que estiverem usando as portas BASE_PORT, BASE_PORT + 1 e +1000.
+
+set -u
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+SHARDS="${SHARDS:-1 2 4}"
+SENDERS="${SENDERS:-64}"
+WINDOW="${WINDOW:-256}"
+DURATION_SECONDS="${DURATION_SECONDS:-20}"
+WARMUP_SECONDS="${WARMUP_SECONDS:-5}"
+BASE_PORT="${BASE_PORT:-6400}"
+CHUNKS=8
+
+PEER_PID=""
+cleanup_peer() {
+    if [ -n "$PEER_PID" ]; then
+        kill -TERM "$PEER_PID" 2>/dev/null
+        sleep 1
+        kill -9 "$PEER_PID" 2>/dev/null
+        wait "$PEER_PID" 2>/dev/null
+        PEER_PID=""
+    fi
+}
+trap cleanup_peer EXIT
+
+WORK_DIR="$(mktemp -d /tmp/p2p-udp-load.XXXXXX)"
+
+# Compila o p2p com o número de sockets de recebimento informado
+build_variant() {
+    local shards=$1 build_dir="$WORK_DIR/build-$1"
+    mkdir -p "$build_dir"
+    cp "$REPO_DIR"/*.cpp "$REPO_DIR"/*.h "$REPO_DIR"/Makefile "$build_dir"
+    sed -i "s/\(UDP_RECEIVER_SHARDS *= *\)[0-9]*/\1$shards/" "$build_dir/Constants.h"
+    make -C "$build_dir" -j"$(nproc)" > "$build_dir/build.log" 2>&1 || return 1
+    echo "$build_dir/p2p"
+}
+
+# Tempo de CPU (usuário + sistema, em ticks) consumido pelo peer até agora
+peer_cpu_ticks() {
+    awk '{ print $14 + $15 }' "/proc/$PEER_PID/stat"
+}
+
+# Gerador de carga: imprime enviadas, respondidas, perdidas e respostas por segundo
+generate_load() {
+    python3 - "$BASE_PORT" "$((BASE_PORT + 2))" "$CHUNKS" "$SENDERS" "$WINDOW" "$DURATION_SECONDS" "$WARMUP_SECONDS" <<'EOF'
+import collections, select, socket, sys, time
+
+peer_port, sink_port, chunks, senders, window, duration, warmup = map(int, sys.argv[1:])
+target = ("127.0.0.1", peer_port)
+
+sink = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+sink.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 8 << 20)
+sink.bind(("0.0.0.0", sink_port))
+sink.setblocking(False)
+
+sockets = []
+for _ in range(senders):
+    sender = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sender.bind(("127.0.0.1", 0))
+    sender.setblocking(False)
+    sockets.append(sender)
+
+def query(n):
+    # Solicitante único por busca, fora de 127.0.0.x
+    requester = "127.%d.%d.%d" % (1 + (n >> 16) % 250, (n >> 8) & 255, n & 255)
+    return ("DISCOVERY carga.bin %d 0 %s:%d" % (chunks, requester, sink_port)).encode()
+
+# Espera o peer responder antes de medir
+deadline = time.monotonic() + 30
+while time.monotonic() < deadline:
+    sockets[0].sendto(b"DISCOVERY carga.bin %d 0 127.255.0.1:%d" % (chunks, sink_port), target)
+    if select.select([sink], [], [], 0.5)[0]:
+        break
+else:
+    print("0 0 0 0")
+    sys.exit(1)
+time.sleep(0.5)
+while True:
+    try:
+        sink.recv(2048)
+    except BlockingIOError:
+        break
+
+sent = answered = lost = measured = 0
+in_flight = collections.deque()
+start = time.monotonic()
+warm = start + warmup
+end = start + duration
+n = 0
+while True:
+    now = time.monotonic()
+    if now >= end:
+        break
+    while in_flight and now - in_flight[0] > 1.0:
+        in_flight.popleft()
+        lost += 1
+    while len(in_flight) < window:
+        try:
+            sockets[n % senders].sendto(query(n), target)
+        except BlockingIOError:
+            break
+        in_flight.append(now)
+        n += 1
+        sent += 1
+    if select.select([sink], [], [], 0.01)[0]:
+        while True:
+            try:
+                sink.recv(2048)
+            except BlockingIOError:
+                break
+            answered += 1
+            if in_flight:
+                in_flight.popleft()
+            if now >= warm:
+                measured += 1
+    # As dicas de cache que o peer envia aos remetentes não interessam
+    for sender in sockets:
+        try:
+            while True:
+                sender.recv(2048)
+        except BlockingIOError:
+            pass
+
+print(sent, answered, lost, int(measured / (duration - warmup)))
+EOF
+}
+
+printf "%-8s %-10s %-12s %-10s %-13s %s\n" shards enviadas respondidas perdidas respostas/s us/resposta
+for shards in $SHARDS; do
+    binary=$(build_variant "$shards") || { echo "Falha ao compilar com $shards shard(s), veja $WORK_DIR/build-$shards/build.log" >&2; exit 1; }
+
+    run_dir="$WORK_DIR/run-$shards"
+    mkdir -p "$run_dir/src/0"
+    printf '0: 127.0.0.1, %s, 1000000\n1: 127.0.0.1, %s, 1000000\n' "$BASE_PORT" "$((BASE_PORT + 1))" > "$run_dir/src/config.txt"
+    printf '0: 1\n1: 0\n' > "$run_dir/src/topologia.txt"
+    printf 'carga.bin\n%s\n0\n' "$CHUNKS" > "$run_dir/src/carga.bin.p2p"
+    for ((chunk = 0; chunk < CHUNKS; ++chunk)); do
+        head -c 1000 /dev/urandom > "$run_dir/src/0/carga.bin.ch$chunk"
+    done
+
+    # Só o peer 0 é executado: o peer 1 existe apenas para que o peer 0 tenha um vizinho
+    (cd "$run_dir" && exec "$binary" 0 --sequential > /dev/null 2>&1) &
+    PEER_PID=$!
+    sleep 6
+
+    cpu_before=$(peer_cpu_ticks)
+    read -r sent answered lost rate < <(generate_load)
+    cpu_after=$(peer_cpu_ticks)
+    cleanup_peer
+    cpu_per_response=$(awk -v ticks=$((cpu_after - cpu_before)) -v hz="$(getconf CLK_TCK)" -v n="$answered" \
+        'BEGIN { if (n > 0) printf "%.1f", ticks / hz / n * 1e6; else print "-" }')
+    printf "%-8s %-10s %-12s %-10s %-13s %s\n" "$shards" "$sent" "$answered" "$lost" "$rate" "$cpu_per_response"
+done
+rm -rf "$WORK_DIR"